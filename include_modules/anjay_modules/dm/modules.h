@@ -25,6 +25,34 @@ VISIBILITY_PRIVATE_HEADER_BEGIN
 
 typedef void anjay_dm_module_deleter_t(anjay_t *anjay, void *arg);
 
+/**
+ * Looks up the access mask that the server identified by @p ssid has for the
+ * Object Instance /@p oid/@p iid (or for creating instances of @p oid, if
+ * @p iid is @ref ANJAY_IID_INVALID), as stored in the Access Control object.
+ *
+ * @returns 0 if @p out_mask has been filled, or a negative value if the lookup
+ *          cannot be performed by the module, in which case the Access Control
+ *          object will be read through the data model.
+ */
+typedef int anjay_dm_module_access_mask_getter_t(anjay_t *anjay,
+                                                 void *arg,
+                                                 anjay_oid_t oid,
+                                                 anjay_iid_t iid,
+                                                 anjay_ssid_t ssid,
+                                                 anjay_access_mask_t *out_mask);
+
+/**
+ * Looks up the Owner of the Access Control object instance @p ac_iid.
+ *
+ * @returns 0 if @p out_owner has been filled, or a negative value if the
+ *          lookup cannot be performed by the module, in which case the Owner
+ *          resource will be read through the data model.
+ */
+typedef int anjay_dm_module_access_owner_getter_t(anjay_t *anjay,
+                                                  void *arg,
+                                                  anjay_iid_t ac_iid,
+                                                  anjay_ssid_t *out_owner);
+
 typedef struct {
     /**
      * Global overlay of handlers that may replace handlers natively declared
@@ -63,6 +91,20 @@ typedef struct {
      */
     anjay_notify_callback_t *notify_callback;
 
+    /**
+     * Optional fast path for access control checks, for modules that keep
+     * the Access Control object's state in memory. Modules are queried in
+     * the order of the most recently installed first; the first one that
+     * succeeds determines the result.
+     */
+    anjay_dm_module_access_mask_getter_t *get_access_mask;
+
+    /**
+     * Optional fast path for reading the Owner of an Access Control object
+     * instance, queried the same way as @ref get_access_mask.
+     */
+    anjay_dm_module_access_owner_getter_t *get_access_owner;
+
     /**
      * A function to be called when the module is uninstalled, that will clean
      * up any resources used by it.
@@ -115,6 +115,11 @@ typedef enum anjay_request_action {
     ANJAY_ACTION_BOOTSTRAP_FINISH
 } anjay_request_action_t;
 
+/**
+ * Reads a Single Resource into @p buffer, without encoding it in any format.
+ * Strings and bytes are copied as-is; numeric and boolean values are stored in
+ * their in-memory representation.
+ */
 int _anjay_dm_res_read(anjay_t *anjay,
                        const anjay_uri_path_t *path,
                        char *buffer,
@@ -135,29 +140,37 @@ static inline int _anjay_dm_res_read_string(anjay_t *anjay,
     return result;
 }
 
+/**
+ * Reads integer values of a Resource directly into @p out_values, which may
+ * hold up to @p capacity elements.
+ *
+ * If @p out_riids is not NULL, the Resource may be a Multiple Resource - in
+ * that case, Resource Instance IDs are stored in @p out_riids. @p out_count
+ * is set to the number of values returned by the data model, which may be
+ * larger than @p capacity - only the first @p capacity values are stored then.
+ */
+int _anjay_dm_res_read_i64_array(anjay_t *anjay,
+                                 const anjay_uri_path_t *path,
+                                 anjay_riid_t *out_riids,
+                                 int64_t *out_values,
+                                 size_t capacity,
+                                 size_t *out_count);
+
 static inline int _anjay_dm_res_read_i64(anjay_t *anjay,
                                          const anjay_uri_path_t *path,
                                          int64_t *out_value) {
-    size_t bytes_read;
-    int result = _anjay_dm_res_read(anjay, path, (char *) out_value,
-                                    sizeof(*out_value), &bytes_read);
+    size_t count;
+    int result = _anjay_dm_res_read_i64_array(anjay, path, NULL, out_value, 1,
+                                              &count);
     if (result) {
         return result;
     }
-    return bytes_read != sizeof(*out_value);
+    return count != 1;
 }
 
-static inline int _anjay_dm_res_read_bool(anjay_t *anjay,
-                                          const anjay_uri_path_t *path,
-                                          bool *out_value) {
-    size_t bytes_read;
-    int result = _anjay_dm_res_read(anjay, path, (char *) out_value,
-                                    sizeof(*out_value), &bytes_read);
-    if (result) {
-        return result;
-    }
-    return bytes_read != sizeof(*out_value);
-}
+int _anjay_dm_res_read_bool(anjay_t *anjay,
+                            const anjay_uri_path_t *path,
+                            bool *out_value);
 
 typedef struct anjay_dm anjay_dm_t;
 
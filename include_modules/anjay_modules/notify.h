@@ -27,7 +27,11 @@ VISIBILITY_PRIVATE_HEADER_BEGIN
 
 typedef struct {
     bool instance_set_changed;
-    // NOTE: known_{added,removed}_iids lists may not be exhaustive
+    // set if the instance set might have changed in ways not reflected in the
+    // known_{added,removed}_iids lists
+    bool unknown_change;
+    // NOTE: known_{added,removed}_iids lists may not be exhaustive, unless
+    // unknown_change is false
     AVS_LIST(anjay_iid_t) known_added_iids;
     AVS_LIST(anjay_iid_t) known_removed_iids;
 } anjay_notify_queue_instance_entry_t;
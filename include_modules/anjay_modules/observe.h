@@ -24,9 +24,17 @@ VISIBILITY_PRIVATE_HEADER_BEGIN
 
 void _anjay_observe_gc(anjay_t *anjay);
 
+/**
+ * Discards effective attributes cached for all observations. Shall be called
+ * whenever attributes might have changed without the instance set of the
+ * relevant object being reported as changed.
+ */
+void _anjay_observe_invalidate_attrs(anjay_t *anjay);
+
 #else // WITH_OBSERVE
 
 #    define _anjay_observe_gc(...) ((void) 0)
+#    define _anjay_observe_invalidate_attrs(...) ((void) 0)
 
 #endif // WITH_OBSERVE
 
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2017-2018 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANJAY_INCLUDE_ANJAY_MODULES_PERSISTENCE_JOURNAL_H
+#define ANJAY_INCLUDE_ANJAY_MODULES_PERSISTENCE_JOURNAL_H
+
+#include <anjay_config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <avsystem/commons/list.h>
+#include <avsystem/commons/stream.h>
+
+#ifdef WITH_AVS_PERSISTENCE
+#    include <avsystem/commons/persistence.h>
+#endif // WITH_AVS_PERSISTENCE
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+/**
+ * Append-only persistence journal shared by the Security, Server, Access
+ * Control and Attribute Storage modules.
+ *
+ * A journal stream consists of an 8-byte header - "AJNL" followed by the 4-byte
+ * magic of the module - and a sequence of records:
+ *
+ * - <c>type</c> (1 byte): 'P' (put), 'D' (delete) or 'C' (commit)
+ * - <c>key</c> (u32 BE): ID of the element (e.g. Instance ID) the record
+ *   refers to; 0 for commit records
+ * - <c>size</c> (u32 BE): size of the payload; 0 for delete and commit records
+ * - <c>payload</c>: element serialized with avs_persistence
+ * - <c>checksum</c> (u32 BE): FNV-1a hash of all preceding fields of the record
+ *
+ * Records are grouped in batches terminated with a commit record. Batches that
+ * were not committed (e.g. because of a power loss while appending) are ignored
+ * during restore.
+ *
+ * A compacted journal is a header followed by a single batch of put records
+ * describing the whole state. Appending writes only put records for elements
+ * that changed since the previous write, and delete records for elements that
+ * vanished.
+ */
+
+typedef struct {
+    uint32_t key;
+    /** Size of the whole record describing the element in the journal. */
+    uint32_t record_size;
+    /** Hash of the payload most recently written for the element. */
+    uint64_t payload_hash;
+} anjay_journal_digest_t;
+
+typedef struct {
+    /**
+     * Digests of the elements present in the journal, sorted by key. These
+     * describe the state stored in the journal, not the in-memory state.
+     */
+    AVS_LIST(anjay_journal_digest_t) digests;
+    /** Amount of bytes in the journal stream, including the header. */
+    size_t size;
+    /** Amount of bytes a compacted journal with the same state would take. */
+    size_t compacted_size;
+    /**
+     * True if the journal has been created or restored and new records can be
+     * appended to it.
+     */
+    bool valid;
+} anjay_journal_t;
+
+static inline void _anjay_journal_cleanup(anjay_journal_t *journal) {
+    AVS_LIST_CLEAR(&journal->digests);
+    journal->size = 0;
+    journal->compacted_size = 0;
+    journal->valid = false;
+}
+
+/**
+ * Checks whether the journal cannot be appended to, or obsolete records take
+ * more space in it than the actual state.
+ */
+static inline bool
+_anjay_journal_needs_compaction(const anjay_journal_t *journal) {
+    return !journal->valid || journal->size > 2 * journal->compacted_size;
+}
+
+#ifdef WITH_AVS_PERSISTENCE
+
+typedef char anjay_journal_magic_t[4];
+
+typedef struct {
+    anjay_journal_t *journal;
+    avs_stream_abstract_t *stream;
+    bool compact;
+    int64_t last_key;
+    /* first old digest not yet matched against put elements */
+    AVS_LIST(anjay_journal_digest_t) old_digest;
+    AVS_LIST(anjay_journal_digest_t) new_digests;
+    AVS_LIST(anjay_journal_digest_t) *new_digests_tail;
+    size_t bytes_written;
+    size_t compacted_size;
+    /* buffer the currently written element is serialized into */
+    char *buffer;
+    size_t buffer_size;
+    size_t buffer_capacity;
+} anjay_journal_writer_t;
+
+/**
+ * Starts writing records to @p stream.
+ *
+ * If @p compact is true, a new journal header is written and @p stream will
+ * contain the whole state once @ref _anjay_journal_writer_finish succeeds.
+ * Otherwise, only records for elements that differ from what is already
+ * stored in the journal are appended to @p stream, which must be positioned at
+ * the end of the journal previously created or restored using @p journal.
+ */
+int _anjay_journal_writer_init(anjay_journal_writer_t *writer,
+                               anjay_journal_t *journal,
+                               avs_stream_abstract_t *stream,
+                               const anjay_journal_magic_t magic,
+                               bool compact);
+
+/**
+ * Serializes @p element using @p handler and writes it to the journal if it
+ * differs from the version already stored there. Elements MUST be passed in
+ * strictly ascending order of @p key.
+ */
+int _anjay_journal_writer_put(anjay_journal_writer_t *writer,
+                              uint32_t key,
+                              avs_persistence_handler_collection_element_t
+                                      *handler,
+                              void *element,
+                              void *user_data);
+
+/**
+ * Finishes writing records and releases resources allocated by @p writer.
+ *
+ * If @p result is 0, delete records for elements not passed to
+ * @ref _anjay_journal_writer_put are written and the batch is committed. The
+ * journal state is only updated if everything has been written successfully.
+ * If appending fails, the journal is marked as requiring compaction, as the
+ * stream may contain a partially written record.
+ *
+ * @returns @p result if it is nonzero, or the result of finishing the batch.
+ */
+int _anjay_journal_writer_finish(anjay_journal_writer_t *writer, int result);
+
+typedef int anjay_journal_restore_handler_t(avs_persistence_context_t *ctx,
+                                            uint32_t key,
+                                            void *user_data);
+
+/**
+ * Replays the journal stored in @p stream and calls @p handler for each
+ * element of the resulting state, in ascending order of keys.
+ *
+ * @p out_journal shall be a zero-initialized journal; on success it describes
+ * the contents of @p stream and the caller shall replace its previous journal
+ * state with it. It is marked as requiring compaction if @p stream has a
+ * damaged or uncommitted tail.
+ */
+int _anjay_journal_restore(anjay_journal_t *out_journal,
+                           avs_stream_abstract_t *stream,
+                           const anjay_journal_magic_t magic,
+                           anjay_journal_restore_handler_t *handler,
+                           void *user_data);
+
+#endif // WITH_AVS_PERSISTENCE
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif /* ANJAY_INCLUDE_ANJAY_MODULES_PERSISTENCE_JOURNAL_H */
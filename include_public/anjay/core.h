@@ -23,6 +23,7 @@
 #include <avsystem/commons/coap/tx_params.h>
 #include <avsystem/commons/list.h>
 #include <avsystem/commons/net.h>
+#include <avsystem/commons/stream.h>
 #include <avsystem/commons/time.h>
 
 #ifdef __cplusplus
@@ -104,6 +105,34 @@ void anjay_smsdrv_cleanup(anjay_smsdrv_t **smsdrv_ptr);
     }
 // clang-format on
 
+/**
+ * Policy of choosing which notification values to drop when the limits of
+ * the notification queue are exceeded. See
+ * @ref anjay_configuration_t#notify_queue_connection_limit .
+ *
+ * In all cases, a value that has already been sent and is waiting for an
+ * acknowledgement is never dropped.
+ */
+typedef enum {
+    /**
+     * The oldest queued values are dropped first. This includes error
+     * notifications; a warning is logged if one is dropped.
+     */
+    ANJAY_NOTIFY_QUEUE_DROP_OLDEST,
+    /**
+     * The oldest values that have been superseded by a newer value of the same
+     * observation are dropped first. If that is not enough, the oldest values
+     * are dropped regardless. Error notifications are never dropped.
+     */
+    ANJAY_NOTIFY_QUEUE_KEEP_LATEST_PER_PATH,
+    /**
+     * The oldest values other than error notifications (which terminate the
+     * observation and thus need to reach the server) are dropped first. Error
+     * notifications are never dropped, even if it means exceeding the limits.
+     */
+    ANJAY_NOTIFY_QUEUE_DROP_NON_ERROR
+} anjay_notify_queue_drop_policy_t;
+
 typedef struct anjay_configuration {
     /**
      * Endpoint name as presented to the LwM2M server. Must be non-NULL, or
@@ -268,6 +297,165 @@ typedef struct anjay_configuration {
      * bootstrap sequence.
      */
     bool disable_server_initiated_bootstrap;
+
+    /**
+     * Number of fixed-size blocks preallocated for scheduler jobs. If not 0,
+     * jobs whose data fits in a single block are allocated from the pool
+     * instead of the heap, which limits heap fragmentation on constrained
+     * platforms. Jobs are still allocated on the heap if the pool is
+     * exhausted.
+     *
+     * NOTE: This field is ignored if Anjay is compiled without
+     * WITH_POOL_ALLOCATOR.
+     */
+    size_t sched_pool_block_count;
+
+    /**
+     * Size (in bytes) of a single block of the scheduler job pool. If 0,
+     * a default value, large enough for all jobs scheduled internally by the
+     * library, will be used.
+     *
+     * NOTE: This field is ignored if Anjay is compiled without
+     * WITH_POOL_ALLOCATOR.
+     */
+    size_t sched_pool_block_size;
+
+    /**
+     * Number of fixed-size blocks preallocated for notification values stored
+     * by the Observe subsystem. If not 0, values whose encoded representation
+     * fits in a single block are allocated from the pool instead of the heap.
+     * Larger values, as well as values allocated when the pool is exhausted,
+     * are still allocated on the heap.
+     *
+     * NOTE: This field is ignored if Anjay is compiled without
+     * WITH_POOL_ALLOCATOR.
+     */
+    size_t observe_pool_block_count;
+
+    /**
+     * Size (in bytes) of a single block of the notification value pool. If 0,
+     * a default value suitable for small, single-resource notifications will be
+     * used.
+     *
+     * NOTE: This field is ignored if Anjay is compiled without
+     * WITH_POOL_ALLOCATOR.
+     */
+    size_t observe_pool_block_size;
+
+    /**
+     * If set to true, a notification that is waiting to be sent (e.g. while
+     * the server is offline and Notification Storing is enabled) is replaced
+     * by a newer value of the same observation instead of having the new value
+     * queued after it. This limits the number of notifications sent after
+     * reconnecting, at the cost of the server not receiving the intermediate
+     * values.
+     *
+     * Notifications that have already been sent and are waiting for
+     * an acknowledgement are never replaced.
+     */
+    bool coalesce_notifications;
+
+    /**
+     * Maximum amount of memory (in bytes) that may be used by notification
+     * values waiting to be sent to a single server over a single connection,
+     * e.g. while the server is offline and Notification Storing is enabled.
+     * When it is exceeded, queued values are dropped according to
+     * <c>notify_queue_drop_policy</c>. 0 means no limit.
+     *
+     * The number of dropped values can be checked using
+     * @ref anjay_get_notify_queue_stats .
+     */
+    size_t notify_queue_connection_limit;
+
+    /**
+     * Maximum amount of memory (in bytes) that may be used by notification
+     * values waiting to be sent to all servers in total. When it is exceeded,
+     * the value to drop is chosen among the queues of all connections.
+     * 0 means no limit.
+     */
+    size_t notify_queue_total_limit;
+
+    /**
+     * Policy of choosing notification values to drop when either
+     * <c>notify_queue_connection_limit</c> or <c>notify_queue_total_limit</c>
+     * is exceeded.
+     */
+    anjay_notify_queue_drop_policy_t notify_queue_drop_policy;
+
+    /**
+     * If set to true, effective attributes of each observation are resolved
+     * only once and reused for subsequent notifications, instead of being
+     * read from the data model every time a notification is considered.
+     *
+     * The cached attributes are discarded after Write-Attributes, after any
+     * change to the Server object, and after the set of Instances of any
+     * Object changes. Applications that implement attribute handlers in their
+     * own objects shall call @ref anjay_notify_instances_changed whenever the
+     * attributes change by other means.
+     */
+    bool cache_notification_attrs;
+
+    /**
+     * If set to true, when multiple observations of the same path and
+     * Content-Format (e.g. ones made by different servers) are to be notified
+     * during a single call to @ref anjay_sched_run, the value is read from the
+     * data model and encoded only once, and reused for all of them.
+     *
+     * Values of whole Objects are only shared between observations made by
+     * the same server, as they depend on its access rights.
+     */
+    bool share_notification_reads;
+
+    /**
+     * If set to true, only a 64-bit hash of the most recently sent value of
+     * each observed entity is retained, instead of a full copy of the
+     * payload. Changes of the value are then detected by comparing hashes,
+     * which significantly reduces memory usage when many large values are
+     * observed, at the cost of a negligible probability of a change going
+     * unnoticed due to a hash collision.
+     *
+     * Numeric values used for the Step, Less Than and Greater Than attributes
+     * are retained regardless of this setting.
+     */
+    bool notification_digests;
+
+    /**
+     * If set to true, Anjay keeps a map from Short Server IDs to Server Object
+     * Instance IDs, instead of reading the Short Server ID Resource of each
+     * Server Object Instance whenever it needs to find one.
+     *
+     * The map is rebuilt after any change to the Server Object is reported,
+     * either by an LwM2M operation or by calling @ref anjay_notify_changed or
+     * @ref anjay_notify_instances_changed . It shall not be enabled if the
+     * Server Object implementation may change the Short Server ID Resources
+     * without reporting it.
+     */
+    bool cache_server_iids;
+
+    /**
+     * If set to true, the list of Objects and Object Instances sent in
+     * Register and Update messages is queried from the data model only once,
+     * and then kept up to date using the changes reported through
+     * @ref anjay_notify_instances_changed and LwM2M operations. Otherwise, the
+     * whole data model is enumerated each time a Registration Update is
+     * considered.
+     *
+     * It shall not be enabled if the application may create or remove Object
+     * Instances without calling @ref anjay_notify_instances_changed .
+     */
+    bool track_registration_objects;
+
+    /**
+     * If set to true, each Object Instance sent in a TLV response to a Read
+     * on an Object path is read twice: first to calculate its encoded size,
+     * and then to actually send it. This allows sending the data directly
+     * as it is read, instead of holding whole Object Instances in memory,
+     * which may be preferable for Objects with large Instances.
+     *
+     * It shall not be enabled if the resource_read handlers may return
+     * different values when called twice in quick succession.
+     */
+    bool precompute_tlv_sizes;
 } anjay_configuration_t;
 
 /**
@@ -405,6 +593,31 @@ AVS_LIST(const anjay_socket_entry_t) anjay_get_socket_entries(anjay_t *anjay);
  */
 int anjay_serve(anjay_t *anjay, avs_net_abstract_socket_t *ready_socket);
 
+/**
+ * Reads and handles messages from given @p ready_socket, like
+ * @ref anjay_serve, but after handling the first message, also handles any
+ * further messages that are already queued on the socket, without blocking.
+ *
+ * This makes it possible to handle bursts of requests (e.g. many Read or
+ * Observe requests sent by the server at once) without going through the
+ * application's poll() loop for every single datagram.
+ *
+ * @param anjay        Anjay object to operate on.
+ * @param ready_socket A socket to read the messages from.
+ * @param max_msgs     Maximum number of messages to handle in a single call.
+ *                     If 0, messages are handled for as long as there are any
+ *                     queued on the socket.
+ *
+ * @returns 0 on success, a negative value in case of error. Errors related to
+ *          single messages, such as receiving a malformed packet, do not stop
+ *          handling the remaining queued messages; the first such error is
+ *          returned after the whole batch has been handled. Handling stops
+ *          early only if the socket reports an error.
+ */
+int anjay_serve_batch(anjay_t *anjay,
+                      avs_net_abstract_socket_t *ready_socket,
+                      size_t max_msgs);
+
 /** Object ID */
 typedef uint16_t anjay_oid_t;
 
@@ -686,6 +899,41 @@ int anjay_exit_offline(anjay_t *anjay);
  */
 bool anjay_all_connections_failed(anjay_t *anjay);
 
+/**
+ * Dumps all observations registered by the LwM2M Servers, along with the
+ * values last sent for them and notifications queued for sending, into the
+ * @p out_stream .
+ *
+ * Attributes are not stored, as they are always read from the data model.
+ * Confirmable notifications that have not been acknowledged yet are stored as
+ * queued, and will be sent again after restoring.
+ *
+ * @param anjay      Anjay object to operate on.
+ * @param out_stream Stream to write to.
+ *
+ * @returns 0 on success, a negative value in case of error.
+ */
+int anjay_observe_persist(anjay_t *anjay, avs_stream_abstract_t *out_stream);
+
+/**
+ * Attempts to restore observations previously dumped using
+ * @ref anjay_observe_persist from the specified @p in_stream .
+ *
+ * This function should be called after the data model, including the Security
+ * and Server objects, has been set up, so that the notifications can be
+ * scheduled according to the current attributes. Observations for servers
+ * that are no longer configured are removed when the server list is reloaded.
+ *
+ * Note: if restore fails, the current observations will be left untouched; on
+ * success though, all of them will be replaced with the restored ones.
+ *
+ * @param anjay     Anjay object to operate on.
+ * @param in_stream Stream to read from.
+ *
+ * @returns 0 on success, a negative value in case of error.
+ */
+int anjay_observe_restore(anjay_t *anjay, avs_stream_abstract_t *in_stream);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
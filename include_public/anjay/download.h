@@ -145,6 +145,19 @@ typedef struct anjay_download_config {
      * inherit parameters from Anjay.
      */
     avs_coap_tx_params_t *coap_tx_params;
+
+    /**
+     * Maximum number of CoAP block requests that may be awaiting a response
+     * at the same time. Blocks received out of order are buffered, so
+     * @ref anjay_download_config_t#on_next_block is still called with
+     * consecutive chunks of data. Buffering requires up to
+     * <c>coap_max_blocks_in_flight</c> times the block size of additional
+     * memory.
+     *
+     * 0 or 1 means that each block is requested only after the previous one
+     * is received. Ignored for HTTP transfers.
+     */
+    size_t coap_max_blocks_in_flight;
 } anjay_download_config_t;
 
 typedef void *anjay_download_handle_t;
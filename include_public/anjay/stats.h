@@ -51,6 +51,96 @@ uint64_t anjay_get_num_incoming_retransmissions(anjay_t *anjay);
  */
 uint64_t anjay_get_num_outgoing_retransmissions(anjay_t *anjay);
 
+/**
+ * Memory pools used by the library when compiled with WITH_POOL_ALLOCATOR.
+ * See @ref anjay_configuration_t for details.
+ */
+typedef enum {
+    /** Pool used for scheduler jobs */
+    ANJAY_POOL_SCHED,
+    /** Pool used for notification values stored by the Observe subsystem */
+    ANJAY_POOL_OBSERVE
+} anjay_pool_id_t;
+
+/**
+ * Usage statistics of a memory pool.
+ */
+typedef struct {
+    /** Size of a single pool block, in bytes. */
+    size_t block_size;
+
+    /** Number of blocks preallocated for the pool. */
+    size_t block_count;
+
+    /** Number of pool-sized allocations that are currently alive. */
+    size_t blocks_in_use;
+
+    /**
+     * Maximum value of <c>blocks_in_use</c> observed since the pool has been
+     * created. If it is greater than <c>block_count</c>, the pool has been
+     * exhausted at some point and increasing its size may be considered.
+     */
+    size_t high_water_mark;
+
+    /**
+     * Number of allocations that could not be satisfied from the pool (either
+     * because it was exhausted or because the requested size exceeded
+     * <c>block_size</c>) and used the heap instead.
+     */
+    uint64_t heap_fallbacks;
+} anjay_pool_stats_t;
+
+/**
+ * Retrieves usage statistics of one of the memory pools used by the library.
+ *
+ * @param anjay     Anjay object to operate on.
+ * @param pool      Pool to query.
+ * @param out_stats Structure to fill with the statistics.
+ *
+ * @returns 0 on success, or a negative value if the pool does not exist.
+ *
+ * NOTE: When WITH_POOL_ALLOCATOR is disabled this function always fails.
+ */
+int anjay_get_pool_stats(anjay_t *anjay,
+                         anjay_pool_id_t pool,
+                         anjay_pool_stats_t *out_stats);
+
+/**
+ * Statistics of the queue of notifications waiting to be sent.
+ */
+typedef struct {
+    /** Number of notification values currently waiting to be sent. */
+    size_t queued_values;
+
+    /** Amount of memory (in bytes) used by the queued values. */
+    size_t queued_bytes;
+
+    /**
+     * Number of values that have been dropped without sending because the
+     * queue limits configured in @ref anjay_configuration_t were exceeded.
+     */
+    uint64_t dropped_values;
+} anjay_notify_queue_stats_t;
+
+/**
+ * Retrieves statistics of the queue of notifications waiting to be sent.
+ *
+ * @param anjay     Anjay object to operate on.
+ * @param ssid      Short Server ID of the server to get statistics for, or
+ *                  @ref ANJAY_SSID_ANY to get the totals for all servers.
+ *                  Per-server values only take into account servers that
+ *                  currently have any observations; <c>dropped_values</c> is
+ *                  reset when all observations of a server are cancelled.
+ * @param out_stats Structure to fill with the statistics.
+ *
+ * @returns 0 on success, or a negative value in case of error.
+ *
+ * NOTE: When WITH_OBSERVE is disabled this function always fails.
+ */
+int anjay_get_notify_queue_stats(anjay_t *anjay,
+                                 anjay_ssid_t ssid,
+                                 anjay_notify_queue_stats_t *out_stats);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -76,6 +76,51 @@ int anjay_access_control_restore(anjay_t *anjay,
  */
 bool anjay_access_control_is_modified(anjay_t *anjay);
 
+/**
+ * Appends changes made to Access Control Object Instances since the journal
+ * was last written to the @p out_stream . Only Instances that have been added,
+ * modified or removed are written; if nothing has changed, nothing is written.
+ *
+ * @p out_stream MUST be positioned at the end of the journal most recently
+ * created with @ref anjay_access_control_journal_compact or read with
+ * @ref anjay_access_control_journal_restore . If this function fails, the
+ * journal needs to be compacted before anything else can be appended.
+ *
+ * @param anjay         ANJAY object with the Access Control module installed
+ * @param out_stream    stream to append to
+ * @return 0 in case of success, negative value in case of an error
+ */
+int anjay_access_control_journal_append(anjay_t *anjay,
+                                        avs_stream_abstract_t *out_stream);
+
+/**
+ * Writes a new journal containing all Access Control Object Instances to the
+ * @p out_stream . If this function fails, the old journal is still valid.
+ *
+ * @param anjay         ANJAY object with the Access Control module installed
+ * @param out_stream    stream to write to
+ * @return 0 in case of success, negative value in case of an error
+ */
+int anjay_access_control_journal_compact(anjay_t *anjay,
+                                         avs_stream_abstract_t *out_stream);
+
+/**
+ * Tries to restore Access Control Object Instances from a journal. Changes that
+ * were not completely appended to the journal are ignored.
+ *
+ * @param anjay         ANJAY object with the Access Control module installed
+ * @param in_stream     stream used for reading the journal
+ * @return 0 in case of success, negative value in case of an error
+ */
+int anjay_access_control_journal_restore(anjay_t *anjay,
+                                         avs_stream_abstract_t *in_stream);
+
+/**
+ * Checks whether the Access Control journal should be rewritten using
+ * @ref anjay_access_control_journal_compact .
+ */
+bool anjay_access_control_journal_needs_compaction(anjay_t *anjay);
+
 /**
  * Assign permissions for Instance /OID/IID to a particular server.
  *
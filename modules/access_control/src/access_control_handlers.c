@@ -403,6 +403,7 @@ static int remove_ac_instance_by_target(anjay_t *anjay,
             }
             AVS_LIST_CLEAR(&(*it)->acl);
             AVS_LIST_DELETE(it);
+            _anjay_access_control_invalidate_index(ac);
         }
     }
     return 0;
@@ -512,16 +513,6 @@ static int ac_transaction_begin(anjay_t *anjay, obj_ptr_t obj_ptr) {
     return 0;
 }
 
-static int acl_target_cmp(const void *left_, const void *right_) {
-    const acl_target_t *left = (const acl_target_t *) left_;
-    const acl_target_t *right = (const acl_target_t *) right_;
-    if (left->oid != right->oid) {
-        return left->oid - right->oid;
-    } else {
-        return left->iid - right->iid;
-    }
-}
-
 static int validate_inst_ref(anjay_t *anjay,
                              AVS_RBTREE(acl_target_t) encountered_refs,
                              const acl_target_t *target) {
@@ -609,7 +600,9 @@ static int ac_transaction_validate(anjay_t *anjay, obj_ptr_t obj_ptr) {
     AVS_RBTREE(acl_target_t) encountered_refs = NULL;
     AVS_RBTREE(anjay_ssid_t) ssids_used = NULL;
     if (access_control->needs_validation) {
-        if (!(encountered_refs = AVS_RBTREE_NEW(acl_target_t, acl_target_cmp))
+        if (!(encountered_refs =
+                      AVS_RBTREE_NEW(acl_target_t,
+                                     _anjay_access_control_target_cmp))
                 || !(ssids_used =
                              AVS_RBTREE_NEW(anjay_ssid_t, anjay_ssid_cmp))) {
             ac_log(ERROR, "Out of memory");
@@ -661,6 +654,7 @@ static int ac_transaction_rollback(anjay_t *anjay, obj_ptr_t obj_ptr) {
     ac->current = ac->saved_state;
     memset(&ac->saved_state, 0, sizeof(ac->saved_state));
     ac->needs_validation = false;
+    _anjay_access_control_invalidate_index(ac);
     return 0;
 }
 
@@ -669,6 +663,8 @@ static void ac_delete(anjay_t *anjay, void *access_control_) {
     access_control_t *access_control = (access_control_t *) access_control_;
     _anjay_access_control_clear_state(&access_control->current);
     _anjay_access_control_clear_state(&access_control->saved_state);
+    _anjay_access_control_index_cleanup(access_control);
+    _anjay_journal_cleanup(&access_control->journal);
     avs_free(access_control);
 }
 
@@ -689,8 +685,72 @@ bool anjay_access_control_is_modified(anjay_t *anjay) {
     return _anjay_access_control_get(anjay)->current.modified_since_persist;
 }
 
+bool anjay_access_control_journal_needs_compaction(anjay_t *anjay) {
+    assert(anjay);
+    return _anjay_journal_needs_compaction(
+            &_anjay_access_control_get(anjay)->journal);
+}
+
+static anjay_access_mask_t
+instance_access_mask(const access_control_instance_t *inst, anjay_ssid_t ssid) {
+    if (!inst->acl) {
+        // empty ACL - the owner has full access to the instance
+        return inst->owner == ssid
+                       ? (ANJAY_ACCESS_MASK_FULL & ~ANJAY_ACCESS_MASK_CREATE)
+                       : ANJAY_ACCESS_MASK_NONE;
+    }
+    anjay_access_mask_t result = ANJAY_ACCESS_MASK_NONE;
+    acl_entry_t *entry;
+    AVS_LIST_FOREACH(entry, inst->acl) {
+        if (entry->ssid == ssid) {
+            return entry->mask;
+        } else if (entry->ssid == ANJAY_SSID_ANY) {
+            result = entry->mask;
+        }
+    }
+    return result;
+}
+
+static int ac_get_access_mask(anjay_t *anjay,
+                              void *access_control_,
+                              anjay_oid_t oid,
+                              anjay_iid_t iid,
+                              anjay_ssid_t ssid,
+                              anjay_access_mask_t *out_mask) {
+    access_control_t *access_control = (access_control_t *) access_control_;
+    access_control_instance_t *inst;
+    if (_anjay_dm_find_object_by_oid(anjay, ANJAY_DM_OID_ACCESS_CONTROL)
+                    != &access_control->obj_def
+            || _anjay_access_control_find_by_target(access_control, oid, iid,
+                                                    &inst)) {
+        return -1;
+    }
+    *out_mask = inst ? instance_access_mask(inst, ssid)
+                     : ANJAY_ACCESS_MASK_NONE;
+    return 0;
+}
+
+static int ac_get_access_owner(anjay_t *anjay,
+                               void *access_control_,
+                               anjay_iid_t ac_iid,
+                               anjay_ssid_t *out_owner) {
+    access_control_t *access_control = (access_control_t *) access_control_;
+    if (_anjay_dm_find_object_by_oid(anjay, ANJAY_DM_OID_ACCESS_CONTROL)
+            != &access_control->obj_def) {
+        return -1;
+    }
+    access_control_instance_t *inst = find_instance(access_control, ac_iid);
+    if (!inst) {
+        return -1;
+    }
+    *out_owner = inst->owner;
+    return 0;
+}
+
 static const anjay_dm_module_t ACCESS_CONTROL_MODULE = {
     .notify_callback = sync_on_notify,
+    .get_access_mask = ac_get_access_mask,
+    .get_access_owner = ac_get_access_owner,
     .deleter = ac_delete
 };
 
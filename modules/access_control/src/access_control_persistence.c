@@ -153,6 +153,7 @@ restore(anjay_t *anjay, access_control_t *ac, avs_stream_abstract_t *in) {
     }
     _anjay_access_control_clear_state(&ac->current);
     ac->current = state;
+    _anjay_access_control_invalidate_index(ac);
 finish:
     avs_persistence_context_delete(restore_ctx);
     avs_persistence_context_delete(ignore_ctx);
@@ -215,6 +216,111 @@ int anjay_access_control_restore(anjay_t *anjay, avs_stream_abstract_t *in) {
     return retval;
 }
 
+static int write_journal(anjay_t *anjay,
+                         avs_stream_abstract_t *out,
+                         bool compact) {
+    access_control_t *ac = _anjay_access_control_get(anjay);
+    if (!ac) {
+        ac_log(ERROR, "Access Control not installed in this Anjay object");
+        return -1;
+    }
+
+    anjay_journal_writer_t writer;
+    int retval = _anjay_journal_writer_init(&writer, &ac->journal, out,
+                                            MAGIC, compact);
+    if (!retval) {
+        AVS_LIST(access_control_instance_t) instance;
+        AVS_LIST_FOREACH(instance, ac->current.instances) {
+            if ((retval = _anjay_journal_writer_put(&writer, instance->iid,
+                                                    persist_instance, instance,
+                                                    NULL))) {
+                break;
+            }
+        }
+    }
+    if (!(retval = _anjay_journal_writer_finish(&writer, retval))) {
+        ac_log(INFO, "Access Control journal %s",
+               compact ? "compacted" : "updated");
+        _anjay_access_control_clear_modified(ac);
+    }
+    return retval;
+}
+
+int anjay_access_control_journal_append(anjay_t *anjay,
+                                        avs_stream_abstract_t *out) {
+    return write_journal(anjay, out, false);
+}
+
+int anjay_access_control_journal_compact(anjay_t *anjay,
+                                         avs_stream_abstract_t *out) {
+    return write_journal(anjay, out, true);
+}
+
+typedef struct {
+    anjay_t *anjay;
+    AVS_LIST(access_control_instance_t) *tail;
+} journal_restore_args_t;
+
+static int restore_journal_instance(avs_persistence_context_t *ctx,
+                                    uint32_t key,
+                                    void *args_) {
+    journal_restore_args_t *args = (journal_restore_args_t *) args_;
+    access_control_instance_t instance;
+    memset(&instance, 0, sizeof(instance));
+    int retval = avs_persistence_u16(ctx, &instance.target.oid);
+    if (retval || !is_object_registered(args->anjay, instance.target.oid)) {
+        // instances targeting unregistered Objects are dropped, just like in
+        // anjay_access_control_restore()
+        return retval;
+    }
+
+    AVS_LIST(access_control_instance_t) entry =
+            AVS_LIST_NEW_ELEMENT(access_control_instance_t);
+    if (!entry) {
+        ac_log(ERROR, "out of memory");
+        return -1;
+    }
+    *entry = instance;
+    AVS_LIST_INSERT(args->tail, entry);
+    AVS_LIST_ADVANCE_PTR(&args->tail);
+    if (!(retval = restore_instance(entry, ctx)) && entry->iid != key) {
+        ac_log(ERROR, "journal record key mismatch");
+        retval = -1;
+    }
+    return retval;
+}
+
+int anjay_access_control_journal_restore(anjay_t *anjay,
+                                         avs_stream_abstract_t *in) {
+    access_control_t *ac = _anjay_access_control_get(anjay);
+    if (!ac) {
+        ac_log(ERROR, "Access Control not installed in this Anjay object");
+        return -1;
+    }
+
+    access_control_state_t state = { NULL };
+    anjay_journal_t journal = { NULL };
+    journal_restore_args_t args = {
+        .anjay = anjay,
+        .tail = &state.instances
+    };
+    int retval = _anjay_journal_restore(&journal, in, MAGIC,
+                                        restore_journal_instance, &args);
+    if (retval) {
+        _anjay_access_control_clear_state(&state);
+        _anjay_journal_cleanup(&journal);
+        return retval;
+    }
+    _anjay_access_control_clear_state(&ac->current);
+    ac->current = state;
+    _anjay_access_control_invalidate_index(ac);
+    _anjay_journal_cleanup(&ac->journal);
+    ac->journal = journal;
+    _anjay_access_control_clear_modified(ac);
+    ac_log(INFO, "Access Control state restored from journal");
+    return 0;
+}
+
 #    ifdef ANJAY_TEST
 #        include "test/persistence.c"
 #    endif // ANJAY_TEST
@@ -235,4 +341,28 @@ int anjay_access_control_restore(anjay_t *anjay, avs_stream_abstract_t *in) {
     return -1;
 }
 
+int anjay_access_control_journal_append(anjay_t *anjay,
+                                        avs_stream_abstract_t *out) {
+    (void) anjay;
+    (void) out;
+    ac_log(ERROR, "Persistence not compiled in");
+    return -1;
+}
+
+int anjay_access_control_journal_compact(anjay_t *anjay,
+                                         avs_stream_abstract_t *out) {
+    (void) anjay;
+    (void) out;
+    ac_log(ERROR, "Persistence not compiled in");
+    return -1;
+}
+
+int anjay_access_control_journal_restore(anjay_t *anjay,
+                                         avs_stream_abstract_t *in) {
+    (void) anjay;
+    (void) in;
+    ac_log(ERROR, "Persistence not compiled in");
+    return -1;
+}
+
 #endif // WITH_AVS_PERSISTENCE
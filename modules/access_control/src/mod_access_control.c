@@ -39,6 +39,78 @@ void _anjay_access_control_clear_state(access_control_state_t *state) {
     state->modified_since_persist = false;
 }
 
+int _anjay_access_control_target_cmp(const void *left_, const void *right_) {
+    const acl_target_t *left = (const acl_target_t *) left_;
+    const acl_target_t *right = (const acl_target_t *) right_;
+    if (left->oid != right->oid) {
+        return left->oid - right->oid;
+    } else {
+        return left->iid - right->iid;
+    }
+}
+
+//// INDEX /////////////////////////////////////////////////////////////////////
+void _anjay_access_control_index_cleanup(access_control_t *access_control) {
+    AVS_RBTREE_DELETE(&access_control->index);
+    access_control->index_valid = false;
+}
+
+static int rebuild_index(access_control_t *access_control) {
+    _anjay_access_control_index_cleanup(access_control);
+    access_control->index_valid = true;
+    if (!(access_control->index =
+                  AVS_RBTREE_NEW(access_control_index_entry_t,
+                                 _anjay_access_control_target_cmp))) {
+        ac_log(ERROR, "Out of memory");
+        return -1;
+    }
+    AVS_LIST(access_control_instance_t) it;
+    AVS_LIST_FOREACH(it, access_control->current.instances) {
+        if (!_anjay_access_control_target_iid_valid(it->target.iid)) {
+            // unset target, may only happen during a transaction
+            goto unusable;
+        }
+        AVS_RBTREE_ELEM(access_control_index_entry_t) entry =
+                AVS_RBTREE_ELEM_NEW(access_control_index_entry_t);
+        if (!entry) {
+            ac_log(ERROR, "Out of memory");
+            goto unusable;
+        }
+        entry->target = it->target;
+        entry->instance = it;
+        if (AVS_RBTREE_INSERT(access_control->index, entry) != entry) {
+            // duplicate target, may only happen during a transaction
+            AVS_RBTREE_ELEM_DELETE_DETACHED(&entry);
+            goto unusable;
+        }
+    }
+    return 0;
+unusable:
+    AVS_RBTREE_DELETE(&access_control->index);
+    return -1;
+}
+
+int _anjay_access_control_find_by_target(
+        access_control_t *access_control,
+        anjay_oid_t oid,
+        anjay_iid_t iid,
+        access_control_instance_t **out_instance) {
+    if (!access_control->index_valid) {
+        rebuild_index(access_control);
+    }
+    if (!access_control->index) {
+        return -1;
+    }
+    const acl_target_t key = {
+        .oid = oid,
+        .iid = iid
+    };
+    AVS_RBTREE_ELEM(access_control_index_entry_t) entry =
+            AVS_RBTREE_FIND(access_control->index, &key);
+    *out_instance = entry ? entry->instance : NULL;
+    return 0;
+}
+
 int _anjay_access_control_clone_state(access_control_state_t *dest,
                                       const access_control_state_t *src) {
     assert(!dest->instances);
@@ -149,6 +221,7 @@ int _anjay_access_control_add_instances_without_iids(
             }
             AVS_LIST_INSERT(insert_ptr, AVS_LIST_DETACH(instances_to_move));
             (*insert_ptr)->iid = proposed_iid;
+            _anjay_access_control_invalidate_index(access_control);
         }
         // proposed_iid cannot possibly be GREATER than (*insert_ptr)->iid
         assert(proposed_iid == (*insert_ptr)->iid);
@@ -190,6 +263,7 @@ int _anjay_access_control_add_instance(
     }
     if (!result) {
         AVS_LIST_INSERT(ptr, instance);
+        _anjay_access_control_invalidate_index(access_control);
     }
     return result;
 }
@@ -256,6 +330,7 @@ int _anjay_access_control_remove_orphaned_instances(
             }
             AVS_LIST_CLEAR(&(*curr)->acl);
             AVS_LIST_DELETE(curr);
+            _anjay_access_control_invalidate_index(access_control);
         } else {
             AVS_LIST(acl_entry_t) *entry;
             AVS_LIST_FOREACH_PTR(entry, &(*curr)->acl) {
@@ -281,6 +356,10 @@ int _anjay_access_control_remove_orphaned_instances(
 
 static access_control_instance_t *
 find_ac_instance(access_control_t *ac, anjay_oid_t oid, anjay_iid_t iid) {
+    access_control_instance_t *result;
+    if (!_anjay_access_control_find_by_target(ac, oid, iid, &result)) {
+        return result;
+    }
     AVS_LIST(access_control_instance_t) it;
     AVS_LIST_FOREACH(it, ac->current.instances) {
         if (it->target.oid == oid && it->target.iid == iid) {
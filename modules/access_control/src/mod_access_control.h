@@ -19,12 +19,14 @@
 
 #include <assert.h>
 
+#include <avsystem/commons/rbtree.h>
 #include <avsystem/commons/stream/stream_membuf.h>
 
 #include <anjay/access_control.h>
 
 #include <anjay_modules/dm_utils.h>
 #include <anjay_modules/notify.h>
+#include <anjay_modules/persistence_journal.h>
 #include <anjay_modules/utils_core.h>
 
 VISIBILITY_PRIVATE_HEADER_BEGIN
@@ -54,16 +56,46 @@ typedef struct {
     bool modified_since_persist;
 } access_control_state_t;
 
+/**
+ * Element of the (target OID, target IID) -> Access Control Instance index.
+ * The target is the first field, so that the tree may be searched using
+ * a plain @ref acl_target_t as the key.
+ */
+typedef struct {
+    acl_target_t target;
+    access_control_instance_t *instance;
+} access_control_index_entry_t;
+
 typedef struct {
     const anjay_dm_object_def_t *obj_def;
     access_control_state_t current;
     access_control_state_t saved_state;
     bool needs_validation;
     bool sync_in_progress;
+
+    /**
+     * Lazily built index of <c>current.instances</c>. It refers to the
+     * instances directly, so it only needs to be invalidated when instances
+     * are added, removed or retargeted - ACL and Owner changes are visible
+     * through it immediately. NULL while <c>index_valid</c> is true means
+     * that the index could not be built (e.g. because of duplicate or unset
+     * targets in the middle of a transaction) and a linear search shall be
+     * performed instead.
+     */
+    AVS_RBTREE(access_control_index_entry_t) index;
+    bool index_valid;
+
+    anjay_journal_t journal;
 } access_control_t;
 
+static inline void
+_anjay_access_control_invalidate_index(access_control_t *repr) {
+    repr->index_valid = false;
+}
+
 static inline void _anjay_access_control_mark_modified(access_control_t *repr) {
     repr->current.modified_since_persist = true;
+    _anjay_access_control_invalidate_index(repr);
 }
 
 static inline void
@@ -80,6 +112,24 @@ access_control_t *_anjay_access_control_get(anjay_t *anjay);
 
 void _anjay_access_control_clear_state(access_control_state_t *state);
 
+int _anjay_access_control_target_cmp(const void *left, const void *right);
+
+void _anjay_access_control_index_cleanup(access_control_t *access_control);
+
+/**
+ * Looks up the Access Control Instance targeting /@p oid/@p iid using the
+ * index, rebuilding it first if necessary.
+ *
+ * @returns 0 on success, in which case @p out_instance is set to the found
+ *          instance or NULL if there is none, or a negative value if the index
+ *          is not usable at the moment.
+ */
+int _anjay_access_control_find_by_target(
+        access_control_t *access_control,
+        anjay_oid_t oid,
+        anjay_iid_t iid,
+        access_control_instance_t **out_instance);
+
 int _anjay_access_control_clone_state(access_control_state_t *dest,
                                       const access_control_state_t *src);
 
@@ -130,3 +130,85 @@ AVS_UNIT_TEST(access_control, set_acl) {
 
     DM_TEST_FINISH;
 }
+
+AVS_UNIT_TEST(access_control, find_by_target) {
+    DM_TEST_INIT_WITH_OBJECTS(&FAKE_SECURITY, &TEST);
+    const anjay_iid_t iid = 1;
+    const anjay_ssid_t ssid = 1;
+
+    AVS_UNIT_ASSERT_SUCCESS(anjay_access_control_install(anjay));
+
+    // prevent sending Update, as that will fail in the test environment
+    _anjay_sched_del(anjay->sched,
+                     &anjay->servers->servers->next_action_handle);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+
+    access_control_t *ac = _anjay_access_control_get(anjay);
+    access_control_instance_t *inst = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(
+            _anjay_access_control_find_by_target(ac, TEST->oid, iid, &inst));
+    AVS_UNIT_ASSERT_NULL(inst);
+
+    AVS_UNIT_ASSERT_SUCCESS(anjay_access_control_set_acl(
+            anjay, TEST->oid, ANJAY_IID_INVALID, ssid,
+            ANJAY_ACCESS_MASK_CREATE));
+
+    // the index shall be rebuilt after adding an instance
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_access_control_find_by_target(
+            ac, TEST->oid, ANJAY_IID_INVALID, &inst));
+    AVS_UNIT_ASSERT_TRUE(inst == ac->current.instances);
+    AVS_UNIT_ASSERT_SUCCESS(
+            _anjay_access_control_find_by_target(ac, TEST->oid, iid, &inst));
+    AVS_UNIT_ASSERT_NULL(inst);
+
+    // duplicate targets make the index unusable
+    AVS_LIST(access_control_instance_t) duplicate =
+            _anjay_access_control_create_missing_ac_instance(
+                    ssid, &(const acl_target_t) {
+                        .oid = TEST->oid,
+                        .iid = ANJAY_IID_INVALID
+                    });
+    AVS_UNIT_ASSERT_NOT_NULL(duplicate);
+    AVS_UNIT_ASSERT_SUCCESS(
+            _anjay_access_control_add_instance(ac, duplicate, NULL));
+    AVS_UNIT_ASSERT_FAILED(_anjay_access_control_find_by_target(
+            ac, TEST->oid, ANJAY_IID_INVALID, &inst));
+
+    anjay_access_control_purge(anjay);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_access_control_find_by_target(
+            ac, TEST->oid, ANJAY_IID_INVALID, &inst));
+    AVS_UNIT_ASSERT_NULL(inst);
+
+    DM_TEST_FINISH;
+}
+
+AVS_UNIT_TEST(access_control, get_access_owner) {
+    DM_TEST_INIT_WITH_OBJECTS(&FAKE_SECURITY, &TEST);
+    const anjay_ssid_t ssid = 1;
+
+    AVS_UNIT_ASSERT_SUCCESS(anjay_access_control_install(anjay));
+
+    // prevent sending Update, as that will fail in the test environment
+    _anjay_sched_del(anjay->sched,
+                     &anjay->servers->servers->next_action_handle);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+
+    AVS_UNIT_ASSERT_SUCCESS(anjay_access_control_set_acl(
+            anjay, TEST->oid, ANJAY_IID_INVALID, ssid,
+            ANJAY_ACCESS_MASK_CREATE));
+
+    access_control_t *ac = _anjay_access_control_get(anjay);
+    AVS_UNIT_ASSERT_NOT_NULL(anjay->dm.modules);
+    const anjay_dm_module_t *module = anjay->dm.modules->def;
+    AVS_UNIT_ASSERT_NOT_NULL(module->get_access_owner);
+
+    anjay_ssid_t owner = 0;
+    AVS_UNIT_ASSERT_SUCCESS(module->get_access_owner(
+            anjay, ac, ac->current.instances->iid, &owner));
+    AVS_UNIT_ASSERT_EQUAL(owner, ANJAY_SSID_BOOTSTRAP);
+    AVS_UNIT_ASSERT_FAILED(module->get_access_owner(
+            anjay, ac, (anjay_iid_t) (ac->current.instances->iid + 1),
+            &owner));
+
+    DM_TEST_FINISH;
+}
@@ -249,3 +249,93 @@ AVS_UNIT_TEST(access_control_persistence, normal_usage) {
     avs_free((anjay_dm_object_def_t *) (intptr_t) mock_obj1);
     avs_free((anjay_dm_object_def_t *) (intptr_t) mock_obj2);
 }
+
+AVS_UNIT_TEST(access_control_persistence, journal_round_trip) {
+    anjay_t *anjay1 = ac_test_create_fake_anjay();
+    anjay_t *anjay2 = ac_test_create_fake_anjay();
+
+    storage_ctx_t ctx = {
+        .buffer = { 0 }
+    };
+    init_context(&ctx);
+
+    AVS_UNIT_ASSERT_SUCCESS(anjay_access_control_install(anjay1));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_access_control_install(anjay2));
+    access_control_t *ac1 = _anjay_access_control_get(anjay1);
+    access_control_t *ac2 = _anjay_access_control_get(anjay2);
+
+    // Object 64 is not registered in anjay2, so the Instance targeting it
+    // shall be dropped when restoring
+    const anjay_dm_object_def_t *mock_obj1 = make_mock_object(32);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_register_object(anjay1, &mock_obj1));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_register_object(anjay2, &mock_obj1));
+    const anjay_dm_object_def_t *mock_obj2 = make_mock_object(64);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_register_object(anjay1, &mock_obj2));
+
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_access_control_add_instance(
+            ac1,
+            _anjay_access_control_create_missing_ac_instance(
+                    ANJAY_ACCESS_LIST_OWNER_BOOTSTRAP,
+                    &(const acl_target_t) {
+                        .oid = mock_obj1->oid,
+                        .iid = ANJAY_IID_INVALID
+                    }),
+            NULL));
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_access_control_add_instance(
+            ac1,
+            _anjay_access_control_create_missing_ac_instance(
+                    ANJAY_ACCESS_LIST_OWNER_BOOTSTRAP,
+                    &(const acl_target_t) {
+                        .oid = mock_obj2->oid,
+                        .iid = ANJAY_IID_INVALID
+                    }),
+            NULL));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_access_control_journal_compact(
+            anjay1, (avs_stream_abstract_t *) &ctx.out));
+    const size_t compacted_size = avs_stream_outbuf_offset(&ctx.out);
+
+    AVS_LIST(access_control_instance_t) entry =
+            AVS_LIST_NEW_ELEMENT(access_control_instance_t);
+    AVS_UNIT_ASSERT_NOT_NULL(entry);
+    *entry = (access_control_instance_t) {
+        .target = {
+            .oid = 32,
+            .iid = 42
+        },
+        .iid = 3,
+        .owner = 23,
+        .has_acl = true,
+        .acl = AVS_LIST_NEW_ELEMENT(acl_entry_t)
+    };
+    AVS_UNIT_ASSERT_NOT_NULL(entry->acl);
+    *entry->acl = (acl_entry_t) {
+        .mask = 0xDEAD,
+        .ssid = 0xBABE
+    };
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_access_control_add_instance(ac1, entry,
+                                                               NULL));
+    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(ac1->current.instances), 3);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_access_control_journal_append(
+            anjay1, (avs_stream_abstract_t *) &ctx.out));
+    // only the new Instance is appended
+    const size_t appended_size =
+            avs_stream_outbuf_offset(&ctx.out) - compacted_size;
+    AVS_UNIT_ASSERT_TRUE(appended_size > 0);
+    AVS_UNIT_ASSERT_TRUE(appended_size < compacted_size);
+
+    ctx.in.buffer_size = avs_stream_outbuf_offset(&ctx.out);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_access_control_journal_restore(
+            anjay2, (avs_stream_abstract_t *) &ctx.in));
+
+    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(ac2->current.instances), 2);
+    AVS_UNIT_ASSERT_TRUE(instances_equal(ac2->current.instances,
+                                         ac1->current.instances));
+    AVS_UNIT_ASSERT_TRUE(
+            instances_equal(AVS_LIST_NEXT(ac2->current.instances), entry));
+
+    anjay_delete(anjay1);
+    anjay_delete(anjay2);
+
+    avs_free((anjay_dm_object_def_t *) (intptr_t) mock_obj1);
+    avs_free((anjay_dm_object_def_t *) (intptr_t) mock_obj2);
+}
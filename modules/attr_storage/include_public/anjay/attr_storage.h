@@ -110,6 +110,55 @@ int anjay_attr_storage_persist(anjay_t *anjay,
 int anjay_attr_storage_restore(anjay_t *anjay,
                                avs_stream_abstract_t *in_stream);
 
+/**
+ * Appends changes made to the Attribute Storage since the journal was last
+ * written to the @p out_stream . Records are written per Object Instance, and
+ * per Object for Object-level attributes, only for those whose attributes have
+ * changed; if nothing has changed, nothing is written at all.
+ *
+ * @p out_stream MUST be positioned at the end of the journal most recently
+ * created with @ref anjay_attr_storage_journal_compact or read with
+ * @ref anjay_attr_storage_journal_restore . If this function fails, the journal
+ * needs to be compacted before anything else can be appended.
+ *
+ * @param anjay         Anjay instance with the Attribute Storage installed.
+ * @param out_stream    Stream to append to.
+ * @return 0 in case of success, negative value in case of an error.
+ */
+int anjay_attr_storage_journal_append(anjay_t *anjay,
+                                      avs_stream_abstract_t *out_stream);
+
+/**
+ * Writes a new journal containing all set attributes to the @p out_stream . If
+ * this function fails, the old journal is still valid.
+ *
+ * @param anjay         Anjay instance with the Attribute Storage installed.
+ * @param out_stream    Stream to write to.
+ * @return 0 in case of success, negative value in case of an error.
+ */
+int anjay_attr_storage_journal_compact(anjay_t *anjay,
+                                       avs_stream_abstract_t *out_stream);
+
+/**
+ * Restores the Attribute Storage from a journal. Changes that were not
+ * completely appended to the journal are ignored.
+ *
+ * Unlike @ref anjay_attr_storage_restore, the Attribute Storage is left
+ * untouched if restoration fails.
+ *
+ * @param anjay     Anjay instance with the Attribute Storage installed.
+ * @param in_stream Stream to read from.
+ * @return 0 in case of success, negative value in case of an error.
+ */
+int anjay_attr_storage_journal_restore(anjay_t *anjay,
+                                       avs_stream_abstract_t *in_stream);
+
+/**
+ * Checks whether the Attribute Storage journal should be rewritten using
+ * @ref anjay_attr_storage_journal_compact .
+ */
+bool anjay_attr_storage_journal_needs_compaction(anjay_t *anjay);
+
 /**
  * Sets Object level attributes for the specified @p ssid.
  *
@@ -16,6 +16,7 @@
 
 #include <anjay_config.h>
 
+#include <assert.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -23,6 +24,7 @@
 
 #include <anjay_modules/dm_utils.h>
 #include <anjay_modules/io_utils.h>
+#include <anjay_modules/observe.h>
 #include <anjay_modules/raw_buffer.h>
 
 #include "mod_attr_storage.h"
@@ -33,6 +35,10 @@ VISIBILITY_SOURCE_BEGIN
     avs_persistence_list((Ctx), (AVS_LIST(void) *) (ListPtr), \
                          sizeof(**(ListPtr)), handle_##Type, UserPtr, NULL)
 
+#define HANDLE_TREE(Type, PathType, Ctx, TreePtr, UserPtr)                 \
+    handle_tree((Ctx), (AVS_RBTREE(void) *) (TreePtr), sizeof(***(TreePtr)), \
+                (PathType), handle_##Type, UserPtr)
+
 //// DATA STRUCTURE HANDLERS ///////////////////////////////////////////////////
 
 static int handle_dm_attributes(avs_persistence_context_t *ctx,
@@ -125,6 +131,54 @@ static int handle_resource_attrs(avs_persistence_context_t *ctx,
     return retval;
 }
 
+/**
+ * Equivalent of avs_persistence_list() for the trees of object, instance and
+ * resource entries; the serialized format is the same. When restoring, the
+ * entries are required to be sorted by ID, as they are always stored that way.
+ */
+static int handle_tree(avs_persistence_context_t *ctx,
+                       AVS_RBTREE(void) *tree_ptr,
+                       size_t element_size,
+                       anjay_uri_path_type_t type,
+                       avs_persistence_handler_collection_element_t *handler,
+                       void *user_ptr) {
+    uint32_t count = (uint32_t) (*tree_ptr ? AVS_RBTREE_SIZE(*tree_ptr) : 0);
+    int retval = avs_persistence_u32(ctx, &count);
+    if (retval) {
+        return retval;
+    }
+    if (avs_persistence_direction(ctx) == AVS_PERSISTENCE_STORE) {
+        AVS_RBTREE_ELEM(void) element;
+        FAS_TREE_FOREACH(element, *tree_ptr) {
+            if ((retval = handler(ctx, element, user_ptr))) {
+                return retval;
+            }
+        }
+        return 0;
+    }
+    assert(!*tree_ptr);
+    int32_t last_id = -1;
+    for (uint32_t i = 0; i < count; ++i) {
+        AVS_RBTREE_ELEM(void) element =
+                AVS_RBTREE_ELEM_NEW_BUFFER(element_size);
+        if (!element) {
+            fas_log(ERROR, "Out of memory");
+            return -1;
+        }
+        if ((retval = handler(ctx, element, user_ptr))
+                || (retval = (*(uint16_t *) element > last_id ? 0 : -1))
+                || (retval = (_anjay_attr_storage_insert_entry(tree_ptr,
+                                                               element)
+                                      ? 0
+                                      : -1))) {
+            _anjay_attr_storage_free_entry(type, &element);
+            return retval;
+        }
+        last_id = *(uint16_t *) element;
+    }
+    return 0;
+}
+
 static int handle_resource_entry(avs_persistence_context_t *ctx,
                                  void *resource_,
                                  void *version_as_ptr) {
@@ -144,8 +198,8 @@ static int handle_instance_entry(avs_persistence_context_t *ctx,
     (void) ((retval = avs_persistence_u16(ctx, &instance->iid))
             || (retval = HANDLE_LIST(default_attrs, ctx,
                                      &instance->default_attrs, version_as_ptr))
-            || (retval = HANDLE_LIST(resource_entry, ctx, &instance->resources,
-                                     version_as_ptr)));
+            || (retval = HANDLE_TREE(resource_entry, ANJAY_PATH_RESOURCE, ctx,
+                                     &instance->resources, version_as_ptr)));
     return retval;
 }
 
@@ -157,8 +211,8 @@ static int handle_object(avs_persistence_context_t *ctx,
     (void) ((retval = avs_persistence_u16(ctx, &object->oid))
             || (retval = HANDLE_LIST(default_attrs, ctx, &object->default_attrs,
                                      version_as_ptr))
-            || (retval = HANDLE_LIST(instance_entry, ctx, &object->instances,
-                                     version_as_ptr)));
+            || (retval = HANDLE_TREE(instance_entry, ANJAY_PATH_INSTANCE, ctx,
+                                     &object->instances, version_as_ptr)));
     return retval;
 }
 
@@ -218,14 +272,10 @@ static bool is_attrs_list_sane(AVS_LIST(void) attrs_list,
     return true;
 }
 
-static bool is_resources_list_sane(AVS_LIST(fas_resource_entry_t) resources) {
-    int32_t last_rid = -1;
-    AVS_LIST(fas_resource_entry_t) resource;
-    AVS_LIST_FOREACH(resource, resources) {
-        if (resource->rid <= last_rid) {
-            return false;
-        }
-        last_rid = resource->rid;
+static bool
+is_resources_tree_sane(AVS_RBTREE(fas_resource_entry_t) resources) {
+    AVS_RBTREE_ELEM(fas_resource_entry_t) resource;
+    FAS_TREE_FOREACH(resource, resources) {
         if (!is_attrs_list_sane(resource->attrs,
                                 offsetof(fas_resource_attrs_t, attrs),
                                 resource_attrs_empty)) {
@@ -235,18 +285,14 @@ static bool is_resources_list_sane(AVS_LIST(fas_resource_entry_t) resources) {
     return true;
 }
 
-static bool is_instances_list_sane(AVS_LIST(fas_instance_entry_t) instances) {
-    int32_t last_iid = -1;
-    AVS_LIST(fas_instance_entry_t) instance;
-    AVS_LIST_FOREACH(instance, instances) {
-        if (instance->iid <= last_iid) {
-            return false;
-        }
-        last_iid = instance->iid;
+static bool
+is_instances_tree_sane(AVS_RBTREE(fas_instance_entry_t) instances) {
+    AVS_RBTREE_ELEM(fas_instance_entry_t) instance;
+    FAS_TREE_FOREACH(instance, instances) {
         if (!is_attrs_list_sane(instance->default_attrs,
                                 offsetof(fas_default_attrs_t, attrs),
                                 default_attrs_empty)
-                || !is_resources_list_sane(instance->resources)) {
+                || !is_resources_tree_sane(instance->resources)) {
             return false;
         }
     }
@@ -257,19 +303,14 @@ static bool is_object_sane(fas_object_entry_t *object) {
     return is_attrs_list_sane(object->default_attrs,
                               offsetof(fas_default_attrs_t, attrs),
                               default_attrs_empty)
-           && is_instances_list_sane(object->instances);
+           && is_instances_tree_sane(object->instances);
 }
 
 static bool is_attr_storage_sane(anjay_attr_storage_t *fas) {
-    int32_t last_oid = -1;
-    AVS_LIST(fas_object_entry_t) *object_ptr;
-    AVS_LIST(fas_object_entry_t) object_helper;
-    AVS_LIST_DELETABLE_FOREACH_PTR(object_ptr, object_helper, &fas->objects) {
-        if ((*object_ptr)->oid <= last_oid) {
-            return false;
-        }
-        last_oid = (*object_ptr)->oid;
-        if (!is_object_sane(*object_ptr)) {
+    // ordering of the tree entries is already verified by handle_tree()
+    AVS_RBTREE_ELEM(fas_object_entry_t) object;
+    FAS_TREE_FOREACH(object, fas->objects) {
+        if (!is_object_sane(object)) {
             return false;
         }
     }
@@ -306,13 +347,13 @@ static int collect_existing_iids(anjay_t *anjay,
 
 static int clear_nonexistent_iids(anjay_t *anjay,
                                   anjay_attr_storage_t *fas,
-                                  AVS_LIST(fas_object_entry_t) *object_ptr,
+                                  AVS_RBTREE_ELEM(fas_object_entry_t) object,
                                   const anjay_dm_object_def_t *const *def_ptr) {
     AVS_LIST(anjay_iid_t) iids = NULL;
     int result = collect_existing_iids(anjay, &iids, def_ptr);
     if (!result) {
-        _anjay_attr_storage_remove_instances_not_on_sorted_list(
-                fas, *object_ptr, iids);
+        _anjay_attr_storage_remove_instances_not_on_sorted_list(fas, object,
+                                                                iids);
     }
     AVS_LIST_CLEAR(&iids);
     return result;
@@ -320,48 +361,47 @@ static int clear_nonexistent_iids(anjay_t *anjay,
 
 static int clear_nonexistent_rids(anjay_t *anjay,
                                   anjay_attr_storage_t *fas,
-                                  AVS_LIST(fas_object_entry_t) *object_ptr,
+                                  AVS_RBTREE_ELEM(fas_object_entry_t) object,
                                   const anjay_dm_object_def_t *const *def_ptr) {
-    AVS_LIST(fas_instance_entry_t) *instance_ptr;
-    AVS_LIST(fas_instance_entry_t) instance_helper;
-    AVS_LIST_DELETABLE_FOREACH_PTR(instance_ptr, instance_helper,
-                                   &(*object_ptr)->instances) {
-        AVS_LIST(fas_resource_entry_t) *resource_ptr;
-        AVS_LIST(fas_resource_entry_t) resource_helper;
-        AVS_LIST_DELETABLE_FOREACH_PTR(resource_ptr, resource_helper,
-                                       &(*instance_ptr)->resources) {
+    AVS_RBTREE_ELEM(fas_instance_entry_t) instance;
+    AVS_RBTREE_ELEM(fas_instance_entry_t) instance_helper;
+    FAS_TREE_DELETABLE_FOREACH(instance, instance_helper, object->instances) {
+        AVS_RBTREE_ELEM(fas_resource_entry_t) resource;
+        AVS_RBTREE_ELEM(fas_resource_entry_t) resource_helper;
+        FAS_TREE_DELETABLE_FOREACH(resource, resource_helper,
+                                   instance->resources) {
             int rid_present = _anjay_dm_resource_supported_and_present(
-                    anjay, def_ptr, (*instance_ptr)->iid, (*resource_ptr)->rid,
+                    anjay, def_ptr, instance->iid, resource->rid,
                     &_anjay_attr_storage_MODULE);
             if (rid_present < 0) {
                 return -1;
             } else if (!rid_present) {
-                remove_resource_entry(fas, resource_ptr);
+                (void) remove_resource_entry(fas, object->oid, instance,
+                                             resource);
             }
         }
-        remove_instance_if_empty(instance_ptr);
+        remove_instance_if_empty(object, instance);
     }
     return 0;
 }
 
 static int clear_nonexistent_entries(anjay_t *anjay,
                                      anjay_attr_storage_t *fas) {
-    AVS_LIST(fas_object_entry_t) *object_ptr;
-    AVS_LIST(fas_object_entry_t) object_helper;
-    AVS_LIST_DELETABLE_FOREACH_PTR(object_ptr, object_helper, &fas->objects) {
+    AVS_RBTREE_ELEM(fas_object_entry_t) object;
+    AVS_RBTREE_ELEM(fas_object_entry_t) object_helper;
+    FAS_TREE_DELETABLE_FOREACH(object, object_helper, fas->objects) {
         const anjay_dm_object_def_t *const *def_ptr =
-                _anjay_dm_find_object_by_oid(anjay, (*object_ptr)->oid);
+                _anjay_dm_find_object_by_oid(anjay, object->oid);
         if (!def_ptr) {
-            remove_object_entry(fas, object_ptr);
+            (void) remove_object_entry(fas, object);
         } else {
             int retval;
-            if ((retval = clear_nonexistent_iids(anjay, fas, object_ptr,
-                                                 def_ptr))
-                    || (retval = clear_nonexistent_rids(anjay, fas, object_ptr,
+            if ((retval = clear_nonexistent_iids(anjay, fas, object, def_ptr))
+                    || (retval = clear_nonexistent_rids(anjay, fas, object,
                                                         def_ptr))) {
                 return retval;
             }
-            remove_object_if_empty(object_ptr);
+            remove_object_if_empty(fas, object);
         }
     }
     return 0;
@@ -380,7 +420,8 @@ int _anjay_attr_storage_persist_inner(anjay_attr_storage_t *attr_storage,
         fas_log(ERROR, "Out of memory");
         return -1;
     }
-    retval = HANDLE_LIST(object, ctx, &attr_storage->objects, (void *) 2);
+    retval = HANDLE_TREE(object, ANJAY_PATH_OBJECT, ctx, &attr_storage->objects,
+                         (void *) 2);
     avs_persistence_context_delete(ctx);
     return retval;
 }
@@ -418,7 +459,8 @@ int _anjay_attr_storage_restore_inner(anjay_t *anjay,
     if (!ctx) {
         fas_log(ERROR, "Out of memory");
     } else {
-        (void) ((retval = HANDLE_LIST(object, ctx, &attr_storage->objects,
+        (void) ((retval = HANDLE_TREE(object, ANJAY_PATH_OBJECT, ctx,
+                                      &attr_storage->objects,
                                       (void *) version))
                 || (retval = (is_attr_storage_sane(attr_storage) ? 0 : -1))
                 || (retval = clear_nonexistent_entries(anjay, attr_storage)));
@@ -454,12 +496,207 @@ int anjay_attr_storage_restore(anjay_t *anjay, avs_stream_abstract_t *in) {
     }
     int retval = _anjay_attr_storage_restore_inner(anjay, fas, in);
     if (!retval) {
+        _anjay_observe_invalidate_attrs(anjay);
         fas_log(INFO, "Attribute Storage state restored");
     }
     fas->modified_since_persist = (retval != 0);
     return retval;
 }
 
+/*
+ * Journal records are keyed with (OID << 16) | IID, so that a change to a
+ * single Instance does not rewrite the attributes of the whole Object.
+ * Object-level attributes are stored under the IID of 0xFFFF, which is never a
+ * valid Instance ID, after all the Instances of the same Object.
+ */
+#define JOURNAL_OBJECT_DEFAULTS_IID ANJAY_IID_INVALID
+
+static uint32_t journal_key(anjay_oid_t oid, anjay_iid_t iid) {
+    return ((uint32_t) oid << 16) | iid;
+}
+
+static int handle_object_default_attrs(avs_persistence_context_t *ctx,
+                                       void *object_,
+                                       void *version_as_ptr) {
+    fas_object_entry_t *object = (fas_object_entry_t *) object_;
+    int retval;
+    (void) ((retval = avs_persistence_u16(ctx, &object->oid))
+            || (retval = HANDLE_LIST(default_attrs, ctx, &object->default_attrs,
+                                     version_as_ptr)));
+    return retval;
+}
+
+static int write_journal_object(anjay_journal_writer_t *writer,
+                                fas_object_entry_t *object) {
+    int retval = 0;
+    AVS_RBTREE_ELEM(fas_instance_entry_t) instance;
+    FAS_TREE_FOREACH(instance, object->instances) {
+        assert(instance->iid != JOURNAL_OBJECT_DEFAULTS_IID);
+        if ((retval = _anjay_journal_writer_put(
+                     writer, journal_key(object->oid, instance->iid),
+                     handle_instance_entry, instance, (void *) 2))) {
+            return retval;
+        }
+    }
+    if (object->default_attrs) {
+        retval = _anjay_journal_writer_put(
+                writer, journal_key(object->oid, JOURNAL_OBJECT_DEFAULTS_IID),
+                handle_object_default_attrs, object, (void *) 2);
+    }
+    return retval;
+}
+
+static int write_journal(anjay_t *anjay,
+                         avs_stream_abstract_t *out,
+                         bool compact) {
+    anjay_attr_storage_t *fas = _anjay_attr_storage_get(anjay);
+    if (!fas) {
+        fas_log(ERROR,
+                "Attribute Storage is not installed on this Anjay object");
+        return -1;
+    }
+    anjay_journal_writer_t writer;
+    int retval = _anjay_journal_writer_init(&writer, &fas->journal, out,
+                                            MAGIC_V2, compact);
+    if (!retval) {
+        AVS_RBTREE_ELEM(fas_object_entry_t) object;
+        FAS_TREE_FOREACH(object, fas->objects) {
+            if ((retval = write_journal_object(&writer, object))) {
+                break;
+            }
+        }
+    }
+    if (!(retval = _anjay_journal_writer_finish(&writer, retval))) {
+        fas->modified_since_persist = false;
+        fas_log(INFO, "Attribute Storage journal %s",
+                compact ? "compacted" : "updated");
+    }
+    return retval;
+}
+
+int anjay_attr_storage_journal_append(anjay_t *anjay,
+                                      avs_stream_abstract_t *out) {
+    return write_journal(anjay, out, false);
+}
+
+int anjay_attr_storage_journal_compact(anjay_t *anjay,
+                                       avs_stream_abstract_t *out) {
+    return write_journal(anjay, out, true);
+}
+
+static AVS_RBTREE_ELEM(fas_object_entry_t)
+get_restored_object(anjay_attr_storage_t *attr_storage, anjay_oid_t oid) {
+    AVS_RBTREE_ELEM(fas_object_entry_t) object = NULL;
+    if (attr_storage->objects) {
+        // entries are compared by the ID at their beginning
+        object = (fas_object_entry_t *) AVS_RBTREE_FIND(
+                (AVS_RBTREE(void)) attr_storage->objects, &oid);
+    }
+    if (!object) {
+        if (!(object = AVS_RBTREE_ELEM_NEW(fas_object_entry_t))) {
+            fas_log(ERROR, "Out of memory");
+            return NULL;
+        }
+        object->oid = oid;
+        if (!_anjay_attr_storage_insert_entry(
+                    (AVS_RBTREE(void) *) &attr_storage->objects, object)) {
+            AVS_RBTREE_ELEM_DELETE_DETACHED(&object);
+        }
+    }
+    return object;
+}
+
+static int restore_journal_default_attrs(avs_persistence_context_t *ctx,
+                                         fas_object_entry_t *object) {
+    fas_object_entry_t restored;
+    memset(&restored, 0, sizeof(restored));
+    int retval;
+    if ((retval = handle_object_default_attrs(ctx, &restored, (void *) 2))
+            || (retval = (restored.oid == object->oid
+                                          && restored.default_attrs
+                                          && !object->default_attrs
+                                  ? 0
+                                  : -1))) {
+        AVS_LIST_CLEAR(&restored.default_attrs);
+        return retval;
+    }
+    object->default_attrs = restored.default_attrs;
+    return 0;
+}
+
+static int restore_journal_instance(avs_persistence_context_t *ctx,
+                                    fas_object_entry_t *object,
+                                    anjay_iid_t iid) {
+    AVS_RBTREE_ELEM(fas_instance_entry_t) instance =
+            AVS_RBTREE_ELEM_NEW(fas_instance_entry_t);
+    if (!instance) {
+        fas_log(ERROR, "Out of memory");
+        return -1;
+    }
+    int retval;
+    if ((retval = handle_instance_entry(ctx, instance, (void *) 2))
+            || (retval = (instance->iid == iid ? 0 : -1))
+            || (retval = (_anjay_attr_storage_insert_entry(
+                                  (AVS_RBTREE(void) *) &object->instances,
+                                  instance)
+                                          == instance
+                                  ? 0
+                                  : -1))) {
+        _anjay_attr_storage_free_entry(ANJAY_PATH_INSTANCE,
+                                       (AVS_RBTREE_ELEM(void) *) &instance);
+    }
+    return retval;
+}
+
+static int restore_journal_entry(avs_persistence_context_t *ctx,
+                                 uint32_t key,
+                                 void *attr_storage_) {
+    anjay_attr_storage_t *attr_storage = (anjay_attr_storage_t *) attr_storage_;
+    const anjay_iid_t iid = (anjay_iid_t) (key & 0xFFFF);
+    AVS_RBTREE_ELEM(fas_object_entry_t) object =
+            get_restored_object(attr_storage, (anjay_oid_t) (key >> 16));
+    if (!object) {
+        return -1;
+    }
+    if (iid == JOURNAL_OBJECT_DEFAULTS_IID) {
+        return restore_journal_default_attrs(ctx, object);
+    }
+    return restore_journal_instance(ctx, object, iid);
+}
+
+int anjay_attr_storage_journal_restore(anjay_t *anjay,
+                                       avs_stream_abstract_t *in) {
+    anjay_attr_storage_t *fas = _anjay_attr_storage_get(anjay);
+    if (!fas) {
+        fas_log(ERROR,
+                "Attribute Storage is not installed on this Anjay object");
+        return -1;
+    }
+    // unlike anjay_attr_storage_restore(), the state is restored aside, so
+    // that the current one is retained on failure
+    anjay_attr_storage_t restored;
+    memset(&restored, 0, sizeof(restored));
+    int retval;
+    (void) ((retval = _anjay_journal_restore(&restored.journal, in, MAGIC_V2,
+                                             restore_journal_entry,
+                                             &restored))
+            || (retval = (is_attr_storage_sane(&restored) ? 0 : -1))
+            || (retval = clear_nonexistent_entries(anjay, &restored)));
+    if (retval) {
+        _anjay_attr_storage_clear(&restored);
+        _anjay_journal_cleanup(&restored.journal);
+        return retval;
+    }
+    _anjay_attr_storage_clear(fas);
+    fas->objects = restored.objects;
+    _anjay_journal_cleanup(&fas->journal);
+    fas->journal = restored.journal;
+    fas->modified_since_persist = false;
+    _anjay_observe_invalidate_attrs(anjay);
+    fas_log(INFO, "Attribute Storage state restored from journal");
+    return 0;
+}
+
 #ifdef ANJAY_TEST
 #    include "test/persistence.c"
 #endif // ANJAY_TEST
@@ -21,9 +21,9 @@
 #include <math.h>
 #include <string.h>
 
-#include <avsystem/commons/stream/stream_membuf.h>
-
 #include <anjay_modules/dm_utils.h>
+#include <anjay_modules/notify.h>
+#include <anjay_modules/observe.h>
 #include <anjay_modules/raw_buffer.h>
 
 #include "mod_attr_storage.h"
@@ -34,7 +34,6 @@ VISIBILITY_SOURCE_BEGIN
 
 static anjay_dm_object_read_default_attrs_t object_read_default_attrs;
 static anjay_dm_object_write_default_attrs_t object_write_default_attrs;
-static anjay_dm_instance_it_t instance_it;
 static anjay_dm_instance_present_t instance_present;
 static anjay_dm_instance_remove_t instance_remove;
 static anjay_dm_instance_read_default_attrs_t instance_read_default_attrs;
@@ -46,12 +45,14 @@ static anjay_dm_transaction_begin_t transaction_begin;
 static anjay_dm_transaction_commit_t transaction_commit;
 static anjay_dm_transaction_rollback_t transaction_rollback;
 
+static anjay_notify_callback_t fas_on_notify;
+
 static void fas_delete(anjay_t *anjay, void *fas_) {
     (void) anjay;
     anjay_attr_storage_t *fas = (anjay_attr_storage_t *) fas_;
     assert(fas);
     _anjay_attr_storage_clear(fas);
-    avs_stream_cleanup(&fas->saved_state.persist_data);
+    _anjay_journal_cleanup(&fas->journal);
     avs_free(fas);
 }
 
@@ -59,7 +60,6 @@ const anjay_dm_module_t _anjay_attr_storage_MODULE = {
     .overlay_handlers = {
         .object_read_default_attrs = object_read_default_attrs,
         .object_write_default_attrs = object_write_default_attrs,
-        .instance_it = instance_it,
         .instance_present = instance_present,
         .instance_remove = instance_remove,
         .instance_read_default_attrs = instance_read_default_attrs,
@@ -71,6 +71,7 @@ const anjay_dm_module_t _anjay_attr_storage_MODULE = {
         .transaction_commit = transaction_commit,
         .transaction_rollback = transaction_rollback
     },
+    .notify_callback = fas_on_notify,
     .deleter = fas_delete
 };
 
@@ -86,22 +87,13 @@ int anjay_attr_storage_install(anjay_t *anjay) {
         fas_log(ERROR, "out of memory");
         return -1;
     }
-    if (!(fas->saved_state.persist_data = avs_stream_membuf_create())
-            || _anjay_dm_module_install(anjay, &_anjay_attr_storage_MODULE,
-                                        fas)) {
-        avs_stream_cleanup(&fas->saved_state.persist_data);
+    if (_anjay_dm_module_install(anjay, &_anjay_attr_storage_MODULE, fas)) {
         avs_free(fas);
         return -1;
     }
     return 0;
 }
 
-static void reset_it_state(fas_iteration_state_t *it) {
-    it->oid = UINT16_MAX;
-    AVS_LIST_CLEAR(&it->iids);
-    it->last_cookie = NULL;
-}
-
 bool anjay_attr_storage_is_modified(anjay_t *anjay) {
     anjay_attr_storage_t *fas = _anjay_attr_storage_get(anjay);
     if (!fas) {
@@ -111,10 +103,70 @@ bool anjay_attr_storage_is_modified(anjay_t *anjay) {
     return fas->modified_since_persist;
 }
 
+bool anjay_attr_storage_journal_needs_compaction(anjay_t *anjay) {
+    anjay_attr_storage_t *fas = _anjay_attr_storage_get(anjay);
+    if (!fas) {
+        fas_log(ERROR, "Attribute Storage is not installed");
+        return false;
+    }
+    return _anjay_journal_needs_compaction(&fas->journal);
+}
+
+static void clear_entry(anjay_uri_path_type_t type, void *entry) {
+    switch (type) {
+    case ANJAY_PATH_OBJECT: {
+        fas_object_entry_t *object = (fas_object_entry_t *) entry;
+        AVS_LIST_CLEAR(&object->default_attrs);
+        AVS_RBTREE_DELETE(&object->instances) {
+            clear_entry(ANJAY_PATH_INSTANCE, *object->instances);
+        }
+        break;
+    }
+    case ANJAY_PATH_INSTANCE: {
+        fas_instance_entry_t *instance = (fas_instance_entry_t *) entry;
+        AVS_LIST_CLEAR(&instance->default_attrs);
+        AVS_RBTREE_DELETE(&instance->resources) {
+            clear_entry(ANJAY_PATH_RESOURCE, *instance->resources);
+        }
+        break;
+    }
+    case ANJAY_PATH_RESOURCE:
+        AVS_LIST_CLEAR(&((fas_resource_entry_t *) entry)->attrs);
+        break;
+    default:
+        AVS_UNREACHABLE("Invalid attribute storage entry type");
+    }
+}
+
+void _anjay_attr_storage_free_entry(anjay_uri_path_type_t type,
+                                    AVS_RBTREE_ELEM(void) *entry_ptr) {
+    clear_entry(type, *entry_ptr);
+    AVS_RBTREE_ELEM_DELETE_DETACHED(entry_ptr);
+}
+
+static void free_undo_entry(fas_undo_entry_t *change) {
+    if (!change->old_entry) {
+        return;
+    }
+    if (change->is_attrs) {
+        AVS_LIST_CLEAR((AVS_LIST(void) *) &change->old_entry);
+    } else {
+        _anjay_attr_storage_free_entry(change->path.type, &change->old_entry);
+    }
+}
+
+static void undo_log_discard(anjay_attr_storage_t *fas) {
+    AVS_LIST_CLEAR(&fas->saved_state.undo_log) {
+        free_undo_entry(fas->saved_state.undo_log);
+    }
+}
+
 void _anjay_attr_storage_clear(anjay_attr_storage_t *fas) {
-    reset_it_state(&fas->iteration);
-    while (fas->objects) {
-        remove_object_entry(fas, &fas->objects);
+    // the state is being replaced as a whole, so whatever happened earlier
+    // in the current transaction can no longer be undone
+    undo_log_discard(fas);
+    AVS_RBTREE_DELETE(&fas->objects) {
+        clear_entry(ANJAY_PATH_OBJECT, *fas->objects);
     }
 }
 
@@ -126,6 +178,7 @@ void anjay_attr_storage_purge(anjay_t *anjay) {
     }
     _anjay_attr_storage_clear(fas);
     _anjay_attr_storage_mark_modified(fas);
+    _anjay_observe_invalidate_attrs(anjay);
 }
 
 //// HELPERS ///////////////////////////////////////////////////////////////////
@@ -162,13 +215,6 @@ static bool implements_any_resource_attrs_handlers(
                       offsetof(anjay_dm_handlers_t, resource_write_attrs));
 }
 
-static void
-remove_resource_if_empty(AVS_LIST(fas_resource_entry_t) *entry_ptr) {
-    if (!(*entry_ptr)->attrs) {
-        AVS_LIST_DELETE(entry_ptr);
-    }
-}
-
 anjay_attr_storage_t *_anjay_attr_storage_get(anjay_t *anjay) {
     return (anjay_attr_storage_t *) _anjay_dm_module_get_arg(
             anjay, &_anjay_attr_storage_MODULE);
@@ -185,97 +231,295 @@ AVS_STATIC_ASSERT(offsetof(fas_object_entry_t, oid) == 0, object_id_offset);
 AVS_STATIC_ASSERT(offsetof(fas_instance_entry_t, iid) == 0, instance_id_offset);
 AVS_STATIC_ASSERT(offsetof(fas_resource_entry_t, rid) == 0, resource_id_offset);
 
-static AVS_LIST(void) *
-find_or_create_entry_impl(AVS_LIST(void) *children_list_ptr,
-                          size_t entry_size,
-                          uint16_t id,
-                          bool allow_create) {
+static int compare_entry_ids(const void *a, const void *b) {
+    return *(const uint16_t *) a - *(const uint16_t *) b;
+}
+
+AVS_RBTREE_ELEM(void)
+_anjay_attr_storage_insert_entry(AVS_RBTREE(void) *tree_ptr,
+                                 AVS_RBTREE_ELEM(void) entry) {
+    if (!*tree_ptr
+            && !(*tree_ptr = AVS_RBTREE_NEW(void, compare_entry_ids))) {
+        fas_log(ERROR, "Out of memory");
+        return NULL;
+    }
+    return AVS_RBTREE_INSERT(*tree_ptr, entry);
+}
+
+/**
+ * Returns a pointer to the first attribute entry with SSID not smaller than
+ * @p ssid, or to the end of the list.
+ */
+static AVS_LIST(void) *find_position(AVS_LIST(void) *list_ptr,
+                                     anjay_ssid_t ssid) {
     AVS_LIST(void) *entry_ptr;
-    AVS_LIST_FOREACH_PTR(entry_ptr, children_list_ptr) {
-        if (*(uint16_t *) *entry_ptr >= id) {
+    AVS_LIST_FOREACH_PTR(entry_ptr, list_ptr) {
+        if (*get_ssid_ptr(*entry_ptr) >= ssid) {
             break;
         }
     }
-    if (!*entry_ptr || *(uint16_t *) *entry_ptr != id) {
-        if (allow_create) {
-            AVS_LIST(void) new_entry = AVS_LIST_NEW_BUFFER(entry_size);
-            if (!new_entry) {
-                fas_log(ERROR, "Out of memory");
-                return NULL;
-            }
-            *(uint16_t *) new_entry = id;
-            AVS_LIST_INSERT(entry_ptr, new_entry);
-        } else {
+    return entry_ptr;
+}
+
+static AVS_RBTREE_ELEM(void)
+find_or_create_entry_impl(AVS_RBTREE(void) *tree_ptr,
+                          size_t entry_size,
+                          uint16_t id,
+                          bool allow_create) {
+    AVS_RBTREE_ELEM(void) entry =
+            (*tree_ptr ? AVS_RBTREE_FIND(*tree_ptr, &id) : NULL);
+    if (!entry && allow_create) {
+        if (!(entry = AVS_RBTREE_ELEM_NEW_BUFFER(entry_size))) {
+            fas_log(ERROR, "Out of memory");
             return NULL;
         }
+        *(uint16_t *) entry = id;
+        if (!_anjay_attr_storage_insert_entry(tree_ptr, entry)) {
+            AVS_RBTREE_ELEM_DELETE_DETACHED(&entry);
+        }
     }
-    return entry_ptr;
+    return entry;
 }
 
-static inline AVS_LIST(fas_object_entry_t) *
+static inline AVS_RBTREE_ELEM(fas_object_entry_t)
 find_object(anjay_attr_storage_t *parent, anjay_oid_t id) {
-    return (AVS_LIST(fas_object_entry_t) *) find_or_create_entry_impl(
-            (AVS_LIST(void) *) &parent->objects, sizeof(fas_object_entry_t), id,
-            false);
+    return (fas_object_entry_t *) find_or_create_entry_impl(
+            (AVS_RBTREE(void) *) &parent->objects, sizeof(fas_object_entry_t),
+            id, false);
 }
 
-static inline AVS_LIST(fas_object_entry_t) *
+static inline AVS_RBTREE_ELEM(fas_object_entry_t)
 find_or_create_object(anjay_attr_storage_t *parent, anjay_oid_t id) {
-    return (AVS_LIST(fas_object_entry_t) *) find_or_create_entry_impl(
-            (AVS_LIST(void) *) &parent->objects, sizeof(fas_object_entry_t), id,
-            true);
+    return (fas_object_entry_t *) find_or_create_entry_impl(
+            (AVS_RBTREE(void) *) &parent->objects, sizeof(fas_object_entry_t),
+            id, true);
 }
 
-static inline AVS_LIST(fas_instance_entry_t) *
+static inline AVS_RBTREE_ELEM(fas_instance_entry_t)
 find_instance(fas_object_entry_t *parent, anjay_iid_t id) {
-    return (AVS_LIST(fas_instance_entry_t) *) find_or_create_entry_impl(
-            (AVS_LIST(void) *) &parent->instances, sizeof(fas_instance_entry_t),
-            id, false);
+    return (fas_instance_entry_t *) find_or_create_entry_impl(
+            (AVS_RBTREE(void) *) &parent->instances,
+            sizeof(fas_instance_entry_t), id, false);
 }
 
-static inline AVS_LIST(fas_instance_entry_t) *
+static inline AVS_RBTREE_ELEM(fas_instance_entry_t)
 find_or_create_instance(fas_object_entry_t *parent, anjay_iid_t id) {
-    return (AVS_LIST(fas_instance_entry_t) *) find_or_create_entry_impl(
-            (AVS_LIST(void) *) &parent->instances, sizeof(fas_instance_entry_t),
-            id, true);
+    return (fas_instance_entry_t *) find_or_create_entry_impl(
+            (AVS_RBTREE(void) *) &parent->instances,
+            sizeof(fas_instance_entry_t), id, true);
 }
 
-static inline AVS_LIST(fas_resource_entry_t) *
+static inline AVS_RBTREE_ELEM(fas_resource_entry_t)
 find_resource(fas_instance_entry_t *parent, anjay_rid_t id) {
-    return (AVS_LIST(fas_resource_entry_t) *) find_or_create_entry_impl(
-            (AVS_LIST(void) *) &parent->resources, sizeof(fas_resource_entry_t),
-            id, false);
+    return (fas_resource_entry_t *) find_or_create_entry_impl(
+            (AVS_RBTREE(void) *) &parent->resources,
+            sizeof(fas_resource_entry_t), id, false);
 }
 
-static inline AVS_LIST(fas_resource_entry_t) *
+static inline AVS_RBTREE_ELEM(fas_resource_entry_t)
 find_or_create_resource(fas_instance_entry_t *parent, anjay_rid_t id) {
-    return (AVS_LIST(fas_resource_entry_t) *) find_or_create_entry_impl(
-            (AVS_LIST(void) *) &parent->resources, sizeof(fas_resource_entry_t),
-            id, true);
+    return (fas_resource_entry_t *) find_or_create_entry_impl(
+            (AVS_RBTREE(void) *) &parent->resources,
+            sizeof(fas_resource_entry_t), id, true);
+}
+
+//// UNDO LOG //////////////////////////////////////////////////////////////////
+
+static int undo_log_add(anjay_attr_storage_t *fas,
+                        const anjay_uri_path_t *path,
+                        bool is_attrs,
+                        void *old_entry,
+                        anjay_ssid_t ssid) {
+    AVS_LIST(fas_undo_entry_t) entry = AVS_LIST_NEW_ELEMENT(fas_undo_entry_t);
+    if (!entry) {
+        fas_log(ERROR, "Out of memory");
+        return -1;
+    }
+    entry->path = *path;
+    entry->is_attrs = is_attrs;
+    entry->old_entry = old_entry;
+    entry->ssid = ssid;
+    AVS_LIST_INSERT(&fas->saved_state.undo_log, entry);
+    return 0;
+}
+
+int _anjay_attr_storage_remove_entry(anjay_attr_storage_t *fas,
+                                     const anjay_uri_path_t *path,
+                                     AVS_RBTREE(void) *tree_ptr,
+                                     AVS_RBTREE_ELEM(void) entry) {
+    if (fas->saved_state.depth && undo_log_add(fas, path, false, entry, 0)) {
+        return -1;
+    }
+    AVS_RBTREE_DETACH(*tree_ptr, entry);
+    if (!fas->saved_state.depth) {
+        _anjay_attr_storage_free_entry(path->type, &entry);
+    }
+    if (!AVS_RBTREE_FIRST(*tree_ptr)) {
+        AVS_RBTREE_DELETE(tree_ptr);
+    }
+    _anjay_attr_storage_mark_modified(fas);
+    return 0;
+}
+
+static int remove_attrs_entry(anjay_attr_storage_t *fas,
+                              const anjay_uri_path_t *path,
+                              AVS_LIST(void) *attrs_ptr) {
+    if (!fas->saved_state.depth) {
+        AVS_LIST_DELETE(attrs_ptr);
+    } else if (undo_log_add(fas, path, true, *attrs_ptr, 0)) {
+        return -1;
+    } else {
+        AVS_LIST_DETACH(attrs_ptr);
+    }
+    _anjay_attr_storage_mark_modified(fas);
+    return 0;
+}
+
+/**
+ * Records that the attribute entry at @p attrs_ptr is about to be modified in
+ * place or, if it does not exist yet, created for @p ssid.
+ */
+static int log_attrs_change(anjay_attr_storage_t *fas,
+                            const anjay_uri_path_t *path,
+                            AVS_LIST(void) *attrs_ptr,
+                            size_t element_size,
+                            anjay_ssid_t ssid) {
+    if (!fas->saved_state.depth) {
+        return 0;
+    }
+    AVS_LIST(void) old_entry = NULL;
+    if (*attrs_ptr && *get_ssid_ptr(*attrs_ptr) == ssid) {
+        if (!(old_entry = AVS_LIST_NEW_BUFFER(element_size))) {
+            fas_log(ERROR, "Out of memory");
+            return -1;
+        }
+        memcpy(old_entry, *attrs_ptr, element_size);
+    }
+    if (undo_log_add(fas, path, true, old_entry, ssid)) {
+        AVS_LIST_CLEAR(&old_entry);
+        return -1;
+    }
+    return 0;
+}
+
+static int undo_entry_change(AVS_RBTREE(void) *tree_ptr,
+                             fas_undo_entry_t *change) {
+    AVS_RBTREE_ELEM(void) existing =
+            _anjay_attr_storage_insert_entry(tree_ptr, change->old_entry);
+    if (!existing) {
+        return -1;
+    }
+    if (existing != change->old_entry) {
+        // an entry with the same ID has been created after the removal
+        AVS_RBTREE_DETACH(*tree_ptr, existing);
+        _anjay_attr_storage_free_entry(change->path.type, &existing);
+        AVS_RBTREE_INSERT(*tree_ptr, change->old_entry);
+    }
+    change->old_entry = NULL;
+    return 0;
+}
+
+static void undo_attrs_change(AVS_LIST(void) *list_ptr,
+                              fas_undo_entry_t *change) {
+    anjay_ssid_t ssid = change->old_entry ? *get_ssid_ptr(change->old_entry)
+                                          : change->ssid;
+    AVS_LIST(void) *entry_ptr = find_position(list_ptr, ssid);
+    if (*entry_ptr && *get_ssid_ptr(*entry_ptr) == ssid) {
+        AVS_LIST_DELETE(entry_ptr);
+    }
+    if (change->old_entry) {
+        AVS_LIST_INSERT(entry_ptr, change->old_entry);
+        change->old_entry = NULL;
+    }
+}
+
+static int undo_change(anjay_attr_storage_t *fas, fas_undo_entry_t *change) {
+    const anjay_uri_path_t *path = &change->path;
+    const bool is_attrs = change->is_attrs;
+    AVS_RBTREE_ELEM(fas_object_entry_t) object = NULL;
+    AVS_RBTREE_ELEM(fas_instance_entry_t) instance = NULL;
+    AVS_RBTREE_ELEM(fas_resource_entry_t) resource = NULL;
+    AVS_RBTREE(void) *tree_ptr = NULL;
+    AVS_LIST(void) *list_ptr = NULL;
+
+    // recreate the containers the entry shall be put back into; they are
+    // removed again below if it turns out that they are not needed
+    if (!is_attrs && path->type == ANJAY_PATH_OBJECT) {
+        tree_ptr = (AVS_RBTREE(void) *) &fas->objects;
+    } else if ((object = find_or_create_object(fas, path->oid))) {
+        if (is_attrs && path->type == ANJAY_PATH_OBJECT) {
+            list_ptr = (AVS_LIST(void) *) &object->default_attrs;
+        } else if (!is_attrs && path->type == ANJAY_PATH_INSTANCE) {
+            tree_ptr = (AVS_RBTREE(void) *) &object->instances;
+        } else if ((instance = find_or_create_instance(object, path->iid))) {
+            if (is_attrs && path->type == ANJAY_PATH_INSTANCE) {
+                list_ptr = (AVS_LIST(void) *) &instance->default_attrs;
+            } else if (!is_attrs) {
+                tree_ptr = (AVS_RBTREE(void) *) &instance->resources;
+            } else if ((resource =
+                                find_or_create_resource(instance, path->rid))) {
+                list_ptr = (AVS_LIST(void) *) &resource->attrs;
+            }
+        }
+    }
+
+    int result = -1;
+    if (tree_ptr) {
+        // only removals of non-attribute entries are ever logged
+        assert(change->old_entry);
+        result = undo_entry_change(tree_ptr, change);
+    } else if (list_ptr) {
+        undo_attrs_change(list_ptr, change);
+        result = 0;
+    }
+
+    if (resource) {
+        remove_resource_if_empty(instance, resource);
+    }
+    if (instance) {
+        remove_instance_if_empty(object, instance);
+    }
+    if (object) {
+        remove_object_if_empty(fas, object);
+    }
+    return result;
+}
+
+static int undo_log_rollback(anjay_attr_storage_t *fas) {
+    int result = 0;
+    AVS_LIST_CLEAR(&fas->saved_state.undo_log) {
+        fas_undo_entry_t *change = fas->saved_state.undo_log;
+        if (undo_change(fas, change)) {
+            result = -1;
+        }
+        free_undo_entry(change);
+    }
+    return result;
 }
 
+//// PROXY HELPERS /////////////////////////////////////////////////////////////
+
 static void remove_instance(anjay_attr_storage_t *fas,
-                            AVS_LIST(fas_object_entry_t) *object_ptr,
+                            AVS_RBTREE_ELEM(fas_object_entry_t) object,
                             anjay_iid_t iid) {
-    AVS_LIST(fas_instance_entry_t) *instance_ptr =
-            find_instance(*object_ptr, iid);
-    if (instance_ptr && *instance_ptr) {
-        remove_instance_entry(fas, instance_ptr);
+    AVS_RBTREE_ELEM(fas_instance_entry_t) instance = find_instance(object, iid);
+    if (instance) {
+        (void) remove_instance_entry(fas, object, instance);
     }
-    remove_object_if_empty(object_ptr);
+    remove_object_if_empty(fas, object);
 }
 
 static void remove_resource(anjay_attr_storage_t *fas,
-                            AVS_LIST(fas_object_entry_t) *object_ptr,
-                            AVS_LIST(fas_instance_entry_t) *instance_ptr,
+                            AVS_RBTREE_ELEM(fas_object_entry_t) object,
+                            AVS_RBTREE_ELEM(fas_instance_entry_t) instance,
                             anjay_rid_t rid) {
-    AVS_LIST(fas_resource_entry_t) *resource_ptr =
-            find_resource(*instance_ptr, rid);
-    if (resource_ptr) {
-        remove_resource_entry(fas, resource_ptr);
+    AVS_RBTREE_ELEM(fas_resource_entry_t) resource =
+            find_resource(instance, rid);
+    if (resource) {
+        (void) remove_resource_entry(fas, object->oid, instance, resource);
     }
-    remove_instance_if_empty(instance_ptr);
-    remove_object_if_empty(object_ptr);
+    remove_instance_if_empty(object, instance);
+    remove_object_if_empty(fas, object);
 }
 
 static inline bool is_ssid_reference_object(anjay_oid_t oid) {
@@ -310,13 +554,8 @@ query_ssid(anjay_t *anjay, anjay_oid_t oid, anjay_iid_t iid) {
     return (anjay_ssid_t) ssid;
 }
 
-static void remove_attrs_entry(anjay_attr_storage_t *fas,
-                               AVS_LIST(void) *attrs_ptr) {
-    AVS_LIST_DELETE(attrs_ptr);
-    _anjay_attr_storage_mark_modified(fas);
-}
-
 static void remove_attrs_for_server(anjay_attr_storage_t *fas,
+                                    const anjay_uri_path_t *path,
                                     AVS_LIST(void) *attrs_ptr,
                                     void *ssid_ptr) {
     anjay_ssid_t ssid = *(anjay_ssid_t *) ssid_ptr;
@@ -325,8 +564,7 @@ static void remove_attrs_for_server(anjay_attr_storage_t *fas,
                || *get_ssid_ptr(*attrs_ptr)
                           < *get_ssid_ptr(*AVS_LIST_NEXT_PTR(attrs_ptr)));
         if (*get_ssid_ptr(*attrs_ptr) == ssid) {
-            remove_attrs_entry(fas, attrs_ptr);
-            assert(!*attrs_ptr || ssid < *get_ssid_ptr(*attrs_ptr));
+            (void) remove_attrs_entry(fas, path, attrs_ptr);
             return;
         } else if (*get_ssid_ptr(*attrs_ptr) > ssid) {
             break;
@@ -335,12 +573,16 @@ static void remove_attrs_for_server(anjay_attr_storage_t *fas,
 }
 
 static void remove_attrs_for_servers_not_on_list(anjay_attr_storage_t *fas,
+                                                 const anjay_uri_path_t *path,
                                                  AVS_LIST(void) *attrs_ptr,
                                                  void *ssid_list_ptr) {
     AVS_LIST(anjay_ssid_t) ssid_ptr = *(AVS_LIST(anjay_ssid_t) *) ssid_list_ptr;
     while (*attrs_ptr) {
         if (!ssid_ptr || *get_ssid_ptr(*attrs_ptr) < *ssid_ptr) {
-            remove_attrs_entry(fas, attrs_ptr);
+            if (remove_attrs_entry(fas, path, attrs_ptr)) {
+                // out of memory; leave the entry and carry on
+                AVS_LIST_ADVANCE_PTR(&attrs_ptr);
+            }
         } else {
             while (ssid_ptr && *get_ssid_ptr(*attrs_ptr) > *ssid_ptr) {
                 AVS_LIST_ADVANCE(&ssid_ptr);
@@ -354,35 +596,37 @@ static void remove_attrs_for_servers_not_on_list(anjay_attr_storage_t *fas,
 }
 
 typedef void remove_attrs_func_t(anjay_attr_storage_t *fas,
+                                 const anjay_uri_path_t *path,
                                  AVS_LIST(void) *attrs_ptr,
                                  void *ssid_ref_ptr);
 
 static void remove_servers(anjay_attr_storage_t *fas,
                            remove_attrs_func_t *remove_attrs_func,
                            void *ssid_ref) {
-    AVS_LIST(fas_object_entry_t) *object_ptr;
-    AVS_LIST(fas_object_entry_t) object_helper;
-    AVS_LIST_DELETABLE_FOREACH_PTR(object_ptr, object_helper, &fas->objects) {
-        remove_attrs_func(fas, (AVS_LIST(void) *) &(*object_ptr)->default_attrs,
-                          ssid_ref);
-        AVS_LIST(fas_instance_entry_t) *instance_ptr;
-        AVS_LIST(fas_instance_entry_t) instance_helper;
-        AVS_LIST_DELETABLE_FOREACH_PTR(instance_ptr, instance_helper,
-                                       &(*object_ptr)->instances) {
-            remove_attrs_func(
-                    fas, (AVS_LIST(void) *) &(*instance_ptr)->default_attrs,
-                    ssid_ref);
-            AVS_LIST(fas_resource_entry_t) *res_ptr;
-            AVS_LIST(fas_resource_entry_t) res_helper;
-            AVS_LIST_DELETABLE_FOREACH_PTR(res_ptr, res_helper,
-                                           &(*instance_ptr)->resources) {
-                remove_attrs_func(fas, (AVS_LIST(void) *) &(*res_ptr)->attrs,
-                                  ssid_ref);
-                remove_resource_if_empty(res_ptr);
+    AVS_RBTREE_ELEM(fas_object_entry_t) object;
+    AVS_RBTREE_ELEM(fas_object_entry_t) object_helper;
+    FAS_TREE_DELETABLE_FOREACH(object, object_helper, fas->objects) {
+        const anjay_oid_t oid = object->oid;
+        remove_attrs_func(fas, &MAKE_OBJECT_PATH(oid),
+                          (AVS_LIST(void) *) &object->default_attrs, ssid_ref);
+        AVS_RBTREE_ELEM(fas_instance_entry_t) instance;
+        AVS_RBTREE_ELEM(fas_instance_entry_t) instance_helper;
+        FAS_TREE_DELETABLE_FOREACH(instance, instance_helper,
+                                   object->instances) {
+            const anjay_iid_t iid = instance->iid;
+            remove_attrs_func(fas, &MAKE_INSTANCE_PATH(oid, iid),
+                              (AVS_LIST(void) *) &instance->default_attrs,
+                              ssid_ref);
+            AVS_RBTREE_ELEM(fas_resource_entry_t) res;
+            AVS_RBTREE_ELEM(fas_resource_entry_t) res_helper;
+            FAS_TREE_DELETABLE_FOREACH(res, res_helper, instance->resources) {
+                remove_attrs_func(fas, &MAKE_RESOURCE_PATH(oid, iid, res->rid),
+                                  (AVS_LIST(void) *) &res->attrs, ssid_ref);
+                remove_resource_if_empty(instance, res);
             }
-            remove_instance_if_empty(instance_ptr);
+            remove_instance_if_empty(object, instance);
         }
-        remove_object_if_empty(object_ptr);
+        remove_object_if_empty(fas, object);
     }
 }
 
@@ -394,68 +638,24 @@ int _anjay_attr_storage_compare_u16ids(const void *a,
     return *(const uint16_t *) a - *(const uint16_t *) b;
 }
 
-static int remove_servers_after_iteration(anjay_t *anjay,
-                                          anjay_attr_storage_t *fas) {
-    AVS_LIST(anjay_ssid_t) ssids = NULL;
-    AVS_LIST(anjay_iid_t) iid;
-    AVS_LIST_FOREACH(iid, fas->iteration.iids) {
-        anjay_ssid_t ssid = query_ssid(anjay, fas->iteration.oid, *iid);
-        if (!ssid) {
-            continue;
-        }
-        AVS_LIST(anjay_ssid_t) ssid_entry = AVS_LIST_NEW_ELEMENT(anjay_ssid_t);
-        if (!ssid_entry) {
-            return ANJAY_ERR_INTERNAL;
-        }
-        *ssid_entry = ssid;
-        AVS_LIST_INSERT(&ssids, ssid_entry);
-    }
-
-    AVS_LIST_SORT(&ssids, _anjay_attr_storage_compare_u16ids);
-    remove_servers(fas, remove_attrs_for_servers_not_on_list, &ssids);
-    AVS_LIST_CLEAR(&ssids);
-    return 0;
-}
-
 void _anjay_attr_storage_remove_instances_not_on_sorted_list(
         anjay_attr_storage_t *fas,
         fas_object_entry_t *object,
         AVS_LIST(anjay_iid_t) iids) {
     AVS_LIST(anjay_iid_t) iid = iids;
-    AVS_LIST(fas_instance_entry_t) *instance_ptr = &object->instances;
-    while (*instance_ptr) {
-        if (!iid || (*instance_ptr)->iid < *iid) {
-            remove_instance_entry(fas, instance_ptr);
-        } else {
-            while (iid && (*instance_ptr)->iid > *iid) {
-                AVS_LIST_ADVANCE(&iid);
-            }
-            if (iid && (*instance_ptr)->iid == *iid) {
-                AVS_LIST_ADVANCE(&iid);
-                AVS_LIST_ADVANCE_PTR(&instance_ptr);
-            }
+    AVS_RBTREE_ELEM(fas_instance_entry_t) instance;
+    AVS_RBTREE_ELEM(fas_instance_entry_t) helper;
+    FAS_TREE_DELETABLE_FOREACH(instance, helper, object->instances) {
+        while (iid && *iid < instance->iid) {
+            AVS_LIST_ADVANCE(&iid);
+        }
+        if (!iid || *iid != instance->iid) {
+            // on failure (out of memory), the entry is left in place
+            (void) remove_instance_entry(fas, object, instance);
         }
     }
 }
 
-static int remove_instances_after_iteration(anjay_t *anjay,
-                                            anjay_attr_storage_t *fas) {
-    int result = 0;
-    AVS_LIST(fas_object_entry_t) *object_ptr =
-            find_object(fas, fas->iteration.oid);
-    if (object_ptr) {
-        AVS_LIST_SORT(&fas->iteration.iids, _anjay_attr_storage_compare_u16ids);
-        _anjay_attr_storage_remove_instances_not_on_sorted_list(
-                fas, *object_ptr, fas->iteration.iids);
-        remove_object_if_empty(object_ptr);
-    }
-    if (is_ssid_reference_object(fas->iteration.oid)) {
-        result = remove_servers_after_iteration(anjay, fas);
-    }
-    reset_it_state(&fas->iteration);
-    return result;
-}
-
 static void read_default_attrs(AVS_LIST(fas_default_attrs_t) attrs,
                                anjay_ssid_t ssid,
                                anjay_dm_internal_attrs_t *out) {
@@ -485,6 +685,7 @@ static void read_resource_attrs(AVS_LIST(fas_resource_attrs_t) attrs,
 }
 
 static int write_attrs_impl(anjay_attr_storage_t *fas,
+                            const anjay_uri_path_t *path,
                             AVS_LIST(void) *out_attrs,
                             size_t element_size,
                             size_t attrs_field_offset,
@@ -501,13 +702,17 @@ static int write_attrs_impl(anjay_attr_storage_t *fas,
     bool filled = !is_empty_func(attrs);
     if (filled) {
         // writing non-empty set of attributes
-        if (!found) {
+        AVS_LIST(void) new_attrs = NULL;
+        if (!found && !(new_attrs = AVS_LIST_NEW_BUFFER(element_size))) {
+            fas_log(ERROR, "Out of memory");
+            return ANJAY_ERR_INTERNAL;
+        }
+        if (log_attrs_change(fas, path, out_attrs, element_size, ssid)) {
+            AVS_LIST_CLEAR(&new_attrs);
+            return ANJAY_ERR_INTERNAL;
+        }
+        if (new_attrs) {
             // entry does not exist, creating
-            AVS_LIST(void) new_attrs = AVS_LIST_NEW_BUFFER(element_size);
-            if (!new_attrs) {
-                fas_log(ERROR, "Out of memory");
-                return ANJAY_ERR_INTERNAL;
-            }
             *get_ssid_ptr(new_attrs) = ssid;
             AVS_LIST_INSERT(out_attrs, new_attrs);
         }
@@ -517,14 +722,17 @@ static int write_attrs_impl(anjay_attr_storage_t *fas,
     } else if (found) {
         // entry exists, but writing EMPTY set of attributes
         // hence - removing
-        remove_attrs_entry(fas, (AVS_LIST(void) *) out_attrs);
+        if (remove_attrs_entry(fas, path, out_attrs)) {
+            return ANJAY_ERR_INTERNAL;
+        }
     }
     return 0;
 }
 
-#define WRITE_ATTRS(Fas, OutAttrs, IsEmptyFunc, Ssid, Attrs)                  \
+#define WRITE_ATTRS(Fas, Path, OutAttrs, IsEmptyFunc, Ssid, Attrs)            \
     write_attrs_impl(                                                         \
-            (Fas), (AVS_LIST(void) *) (OutAttrs), sizeof(**(OutAttrs)),       \
+            (Fas), (Path), (AVS_LIST(void) *) (OutAttrs),                     \
+            sizeof(**(OutAttrs)),                                             \
             (size_t) ((char *) &(*(OutAttrs))->attrs - (char *) *(OutAttrs)), \
             sizeof((*(OutAttrs))->attrs), (IsEmptyFunc), (Ssid), (Attrs))
 
@@ -537,14 +745,15 @@ static int write_object_attrs(anjay_t *anjay,
         fas_log(ERROR, "Attribute Storage module is not installed");
         return -1;
     }
-    AVS_LIST(fas_object_entry_t) *object_ptr =
+    AVS_RBTREE_ELEM(fas_object_entry_t) object =
             find_or_create_object(fas, (*obj_ptr)->oid);
-    if (!object_ptr) {
+    if (!object) {
         return -1;
     }
-    int result = WRITE_ATTRS(fas, &(*object_ptr)->default_attrs,
-                             default_attrs_empty, ssid, attrs);
-    remove_object_if_empty(object_ptr);
+    int result = WRITE_ATTRS(fas, &MAKE_OBJECT_PATH((*obj_ptr)->oid),
+                             &object->default_attrs, default_attrs_empty, ssid,
+                             attrs);
+    remove_object_if_empty(fas, object);
     return result;
 }
 
@@ -558,25 +767,26 @@ static int write_instance_attrs(anjay_t *anjay,
         fas_log(ERROR, "Attribute Storage module is not installed");
         return -1;
     }
-    AVS_LIST(fas_object_entry_t) *object_ptr =
+    AVS_RBTREE_ELEM(fas_object_entry_t) object =
             find_or_create_object(fas, (*obj_ptr)->oid);
-    if (!object_ptr) {
+    if (!object) {
         return -1;
     }
     int result = 0;
-    AVS_LIST(fas_instance_entry_t) *instance_ptr =
-            find_or_create_instance(*object_ptr, iid);
-    if (!instance_ptr) {
+    AVS_RBTREE_ELEM(fas_instance_entry_t) instance =
+            find_or_create_instance(object, iid);
+    if (!instance) {
         result = -1;
     }
     if (!result) {
-        result = WRITE_ATTRS(fas, &(*instance_ptr)->default_attrs,
-                             default_attrs_empty, ssid, attrs);
+        result = WRITE_ATTRS(fas, &MAKE_INSTANCE_PATH((*obj_ptr)->oid, iid),
+                             &instance->default_attrs, default_attrs_empty,
+                             ssid, attrs);
     }
-    if (instance_ptr) {
-        remove_instance_if_empty(instance_ptr);
+    if (instance) {
+        remove_instance_if_empty(object, instance);
     }
-    remove_object_if_empty(object_ptr);
+    remove_object_if_empty(fas, object);
     return result;
 }
 
@@ -591,33 +801,35 @@ static int write_resource_attrs(anjay_t *anjay,
         fas_log(ERROR, "Attribute Storage module is not installed");
         return -1;
     }
-    AVS_LIST(fas_object_entry_t) *object_ptr =
+    AVS_RBTREE_ELEM(fas_object_entry_t) object =
             find_or_create_object(fas, (*obj_ptr)->oid);
-    if (!object_ptr) {
+    if (!object) {
         return -1;
     }
     int result = 0;
-    AVS_LIST(fas_instance_entry_t) *instance_ptr =
-            find_or_create_instance(*object_ptr, iid);
-    if (!instance_ptr) {
+    AVS_RBTREE_ELEM(fas_instance_entry_t) instance =
+            find_or_create_instance(object, iid);
+    if (!instance) {
         result = -1;
     }
-    AVS_LIST(fas_resource_entry_t) *resource_ptr =
-            result ? NULL : find_or_create_resource(*instance_ptr, rid);
-    if (!resource_ptr) {
+    AVS_RBTREE_ELEM(fas_resource_entry_t) resource =
+            result ? NULL : find_or_create_resource(instance, rid);
+    if (!resource) {
         result = -1;
     }
     if (!result) {
-        result = WRITE_ATTRS(fas, &(*resource_ptr)->attrs, resource_attrs_empty,
-                             ssid, attrs);
+        result = WRITE_ATTRS(fas,
+                             &MAKE_RESOURCE_PATH((*obj_ptr)->oid, iid, rid),
+                             &resource->attrs, resource_attrs_empty, ssid,
+                             attrs);
     }
-    if (resource_ptr) {
-        remove_resource_if_empty(resource_ptr);
+    if (resource) {
+        remove_resource_if_empty(instance, resource);
     }
-    if (instance_ptr) {
-        remove_instance_if_empty(instance_ptr);
+    if (instance) {
+        remove_instance_if_empty(object, instance);
     }
-    remove_object_if_empty(object_ptr);
+    remove_object_if_empty(fas, object);
     return result;
 }
 
@@ -633,10 +845,9 @@ object_read_default_attrs(anjay_t *anjay,
         return _anjay_dm_object_read_default_attrs(anjay, obj_ptr, ssid, out,
                                                    &_anjay_attr_storage_MODULE);
     }
-    AVS_LIST(fas_object_entry_t) *object_ptr =
+    AVS_RBTREE_ELEM(fas_object_entry_t) object =
             find_object(get_fas(anjay), (*obj_ptr)->oid);
-    read_default_attrs(object_ptr ? (*object_ptr)->default_attrs : NULL, ssid,
-                       out);
+    read_default_attrs(object ? object->default_attrs : NULL, ssid, out);
     return 0;
 }
 
@@ -666,12 +877,11 @@ instance_read_default_attrs(anjay_t *anjay,
         return _anjay_dm_instance_read_default_attrs(
                 anjay, obj_ptr, iid, ssid, out, &_anjay_attr_storage_MODULE);
     }
-    AVS_LIST(fas_object_entry_t) *object_ptr =
+    AVS_RBTREE_ELEM(fas_object_entry_t) object =
             find_object(get_fas(anjay), (*obj_ptr)->oid);
-    AVS_LIST(fas_instance_entry_t) *instance_ptr =
-            object_ptr ? find_instance(*object_ptr, iid) : NULL;
-    read_default_attrs(instance_ptr ? (*instance_ptr)->default_attrs : NULL,
-                       ssid, out);
+    AVS_RBTREE_ELEM(fas_instance_entry_t) instance =
+            object ? find_instance(object, iid) : NULL;
+    read_default_attrs(instance ? instance->default_attrs : NULL, ssid, out);
     return 0;
 }
 
@@ -703,13 +913,13 @@ static int resource_read_attrs(anjay_t *anjay,
         return _anjay_dm_resource_read_attrs(anjay, obj_ptr, iid, rid, ssid,
                                              out, &_anjay_attr_storage_MODULE);
     }
-    AVS_LIST(fas_object_entry_t) *object_ptr =
+    AVS_RBTREE_ELEM(fas_object_entry_t) object =
             find_object(get_fas(anjay), (*obj_ptr)->oid);
-    AVS_LIST(fas_instance_entry_t) *instance_ptr =
-            object_ptr ? find_instance(*object_ptr, iid) : NULL;
-    AVS_LIST(fas_resource_entry_t) *res_ptr =
-            instance_ptr ? find_resource(*instance_ptr, rid) : NULL;
-    read_resource_attrs(res_ptr ? (*res_ptr)->attrs : NULL, ssid, out);
+    AVS_RBTREE_ELEM(fas_instance_entry_t) instance =
+            object ? find_instance(object, iid) : NULL;
+    AVS_RBTREE_ELEM(fas_resource_entry_t) resource =
+            instance ? find_resource(instance, rid) : NULL;
+    read_resource_attrs(resource ? resource->attrs : NULL, ssid, out);
     return 0;
 }
 
@@ -733,47 +943,6 @@ static int resource_write_attrs(anjay_t *anjay,
 
 //// ACTIVE PROXY HANDLERS /////////////////////////////////////////////////////
 
-static int instance_it(anjay_t *anjay,
-                       const anjay_dm_object_def_t *const *obj_ptr,
-                       anjay_iid_t *out,
-                       void **cookie) {
-    // we have three cases here:
-    // * we're called with *cookie == NULL
-    //   - it means a start of iteration, so we reset our state
-    // * we're called with consecutive cookie values
-    //   (*cookie unchanged since after last call to backend->instance_it)
-    //   - it means we're continuing last iteration; we do our processing,
-    //     which ends with calling remove_instances_after_iteration()
-    // * we're called with some unrelated cookie
-    //   - it means parallel or nested iterations; we don't support it, so we
-    //     reset our state and ignore it
-    anjay_attr_storage_t *fas = get_fas(anjay);
-    void *orig_cookie = *cookie;
-    if (!orig_cookie) {
-        reset_it_state(&fas->iteration);
-        fas->iteration.oid = (*obj_ptr)->oid;
-    }
-    int result = _anjay_dm_instance_it(anjay, obj_ptr, out, cookie,
-                                       &_anjay_attr_storage_MODULE);
-    if (result || fas->iteration.oid != (*obj_ptr)->oid
-            || fas->iteration.last_cookie != orig_cookie) {
-        reset_it_state(&fas->iteration);
-    } else {
-        fas->iteration.last_cookie = *cookie;
-        if (*out == ANJAY_IID_INVALID) {
-            result = remove_instances_after_iteration(anjay, fas);
-        } else {
-            anjay_iid_t *new_iid = AVS_LIST_NEW_ELEMENT(anjay_iid_t);
-            if (!new_iid) {
-                return ANJAY_ERR_INTERNAL;
-            }
-            *new_iid = *out;
-            AVS_LIST_INSERT(&fas->iteration.iids, new_iid);
-        }
-    }
-    return result;
-}
-
 static int instance_present(anjay_t *anjay,
                             const anjay_dm_object_def_t *const *obj_ptr,
                             anjay_iid_t iid) {
@@ -781,10 +950,10 @@ static int instance_present(anjay_t *anjay,
                                             &_anjay_attr_storage_MODULE);
     if (result == 0) {
         anjay_attr_storage_t *fas = get_fas(anjay);
-        AVS_LIST(fas_object_entry_t) *object_ptr =
+        AVS_RBTREE_ELEM(fas_object_entry_t) object =
                 find_object(fas, (*obj_ptr)->oid);
-        if (object_ptr) {
-            remove_instance(fas, object_ptr, iid);
+        if (object) {
+            remove_instance(fas, object, iid);
         }
     }
     return result;
@@ -798,10 +967,10 @@ static int instance_remove(anjay_t *anjay,
                                            &_anjay_attr_storage_MODULE);
     if (result == 0) {
         anjay_attr_storage_t *fas = get_fas(anjay);
-        AVS_LIST(fas_object_entry_t) *object_ptr =
+        AVS_RBTREE_ELEM(fas_object_entry_t) object =
                 find_object(fas, (*obj_ptr)->oid);
-        if (object_ptr) {
-            remove_instance(fas, object_ptr, iid);
+        if (object) {
+            remove_instance(fas, object, iid);
         }
         if (ssid) {
             remove_servers(fas, remove_attrs_for_server, &ssid);
@@ -818,55 +987,161 @@ static int resource_present(anjay_t *anjay,
                                             &_anjay_attr_storage_MODULE);
     if (result == 0) {
         anjay_attr_storage_t *fas = get_fas(anjay);
-        AVS_LIST(fas_object_entry_t) *object_ptr =
+        AVS_RBTREE_ELEM(fas_object_entry_t) object =
                 find_object(fas, (*obj_ptr)->oid);
-        AVS_LIST(fas_instance_entry_t) *instance_ptr =
-                object_ptr ? find_instance(*object_ptr, iid) : NULL;
-        if (instance_ptr) {
-            remove_resource(fas, object_ptr, instance_ptr, rid);
+        AVS_RBTREE_ELEM(fas_instance_entry_t) instance =
+                object ? find_instance(object, iid) : NULL;
+        if (instance) {
+            remove_resource(fas, object, instance, rid);
         }
     }
     return result;
 }
 
-static void saved_state_reset(anjay_attr_storage_t *fas) {
-    avs_stream_reset(fas->saved_state.persist_data);
-    avs_stream_membuf_fit(fas->saved_state.persist_data);
+//// NOTIFICATION HANDLING /////////////////////////////////////////////////////
+
+static void remove_instances_on_list(anjay_attr_storage_t *fas,
+                                     AVS_RBTREE_ELEM(fas_object_entry_t) object,
+                                     AVS_LIST(anjay_iid_t) iids) {
+    AVS_LIST(anjay_iid_t) iid;
+    AVS_LIST_FOREACH(iid, iids) {
+        AVS_RBTREE_ELEM(fas_instance_entry_t) instance =
+                find_instance(object, *iid);
+        if (instance) {
+            (void) remove_instance_entry(fas, object, instance);
+        }
+    }
 }
 
-static int saved_state_save(anjay_attr_storage_t *fas) {
-    fas->saved_state.modified_since_persist = fas->modified_since_persist;
-    return _anjay_attr_storage_persist_inner(fas,
-                                             fas->saved_state.persist_data);
+static int
+remove_vanished_instances(anjay_t *anjay,
+                          anjay_attr_storage_t *fas,
+                          AVS_RBTREE_ELEM(fas_object_entry_t) object) {
+    const anjay_dm_object_def_t *const *def_ptr =
+            _anjay_dm_find_object_by_oid(anjay, object->oid);
+    if (!def_ptr) {
+        return 0;
+    }
+    AVS_RBTREE_ELEM(fas_instance_entry_t) instance;
+    AVS_RBTREE_ELEM(fas_instance_entry_t) helper;
+    FAS_TREE_DELETABLE_FOREACH(instance, helper, object->instances) {
+        int present = _anjay_dm_instance_present(anjay, def_ptr, instance->iid,
+                                                 &_anjay_attr_storage_MODULE);
+        if (present < 0) {
+            return present;
+        }
+        if (!present) {
+            // on failure (out of memory), the entry is left in place
+            (void) remove_instance_entry(fas, object, instance);
+        }
+    }
+    return 0;
 }
 
-static int saved_state_restore(anjay_t *anjay, anjay_attr_storage_t *fas) {
-    int result =
-            _anjay_attr_storage_restore_inner(anjay, fas,
-                                              fas->saved_state.persist_data);
-    fas->modified_since_persist =
-            (result ? true : fas->saved_state.modified_since_persist);
+static int collect_ssid(anjay_t *anjay,
+                        const anjay_dm_object_def_t *const *obj_ptr,
+                        anjay_iid_t iid,
+                        void *ssids_ptr) {
+    anjay_ssid_t ssid = query_ssid(anjay, (*obj_ptr)->oid, iid);
+    if (ssid) {
+        AVS_LIST(anjay_ssid_t) ssid_entry = AVS_LIST_NEW_ELEMENT(anjay_ssid_t);
+        if (!ssid_entry) {
+            fas_log(ERROR, "Out of memory");
+            return ANJAY_ERR_INTERNAL;
+        }
+        *ssid_entry = ssid;
+        AVS_LIST_INSERT((AVS_LIST(anjay_ssid_t) *) ssids_ptr, ssid_entry);
+    }
+    return ANJAY_FOREACH_CONTINUE;
+}
+
+static int remove_vanished_servers(anjay_t *anjay,
+                                   anjay_attr_storage_t *fas,
+                                   anjay_oid_t oid) {
+    const anjay_dm_object_def_t *const *def_ptr =
+            _anjay_dm_find_object_by_oid(anjay, oid);
+    if (!def_ptr) {
+        return 0;
+    }
+    AVS_LIST(anjay_ssid_t) ssids = NULL;
+    int result = _anjay_dm_foreach_instance(anjay, def_ptr, collect_ssid,
+                                            &ssids);
+    if (!result) {
+        AVS_LIST_SORT(&ssids, _anjay_attr_storage_compare_u16ids);
+        remove_servers(fas, remove_attrs_for_servers_not_on_list, &ssids);
+    }
+    AVS_LIST_CLEAR(&ssids);
+    return result;
+}
+
+/**
+ * Removes attributes of instances that ceased to exist and, if Security or
+ * Server instances have been removed, of servers that ceased to exist.
+ * Removals performed through the data model are already handled by the
+ * instance_remove handler, so this mostly deals with changes made by the
+ * application and reported through anjay_notify_instances_changed().
+ */
+static int fas_on_notify(anjay_t *anjay,
+                         anjay_notify_queue_t queue,
+                         void *fas_) {
+    anjay_attr_storage_t *fas = (anjay_attr_storage_t *) fas_;
+    int result = 0;
+    AVS_LIST(anjay_notify_queue_object_entry_t) entry;
+    AVS_LIST_FOREACH(entry, queue) {
+        const anjay_notify_queue_instance_entry_t *changes =
+                &entry->instance_set_changes;
+        if (!changes->instance_set_changed
+                || (!changes->unknown_change
+                    && !changes->known_removed_iids)) {
+            continue;
+        }
+        int partial_result = 0;
+        AVS_RBTREE_ELEM(fas_object_entry_t) object =
+                find_object(fas, entry->oid);
+        if (object) {
+            if (changes->unknown_change) {
+                partial_result = remove_vanished_instances(anjay, fas, object);
+            } else {
+                remove_instances_on_list(fas, object,
+                                         changes->known_removed_iids);
+            }
+            remove_object_if_empty(fas, object);
+        }
+        if (!partial_result && is_ssid_reference_object(entry->oid)) {
+            partial_result = remove_vanished_servers(anjay, fas, entry->oid);
+        }
+        if (!result) {
+            result = partial_result;
+        }
+    }
     return result;
 }
 
+//// TRANSACTION HANDLERS //////////////////////////////////////////////////////
+
 static int transaction_begin(anjay_t *anjay,
                              const anjay_dm_object_def_t *const *obj_ptr) {
     anjay_attr_storage_t *fas = get_fas(anjay);
     if (fas->saved_state.depth++ == 0) {
-        if (saved_state_save(fas)) {
-            --fas->saved_state.depth;
-            return ANJAY_ERR_INTERNAL;
-        }
+        assert(!fas->saved_state.undo_log);
+        fas->saved_state.modified_since_persist = fas->modified_since_persist;
     }
     int result =
             _anjay_dm_delegate_transaction_begin(anjay, obj_ptr,
                                                  &_anjay_attr_storage_MODULE);
-    if (result) {
-        saved_state_reset(fas);
+    if (result && --fas->saved_state.depth == 0) {
+        undo_log_discard(fas);
     }
     return result;
 }
 
+static int saved_state_restore(anjay_attr_storage_t *fas) {
+    int result = undo_log_rollback(fas);
+    fas->modified_since_persist =
+            (result ? true : fas->saved_state.modified_since_persist);
+    return result;
+}
+
 static int transaction_commit(anjay_t *anjay,
                               const anjay_dm_object_def_t *const *obj_ptr) {
     anjay_attr_storage_t *fas = get_fas(anjay);
@@ -874,10 +1149,10 @@ static int transaction_commit(anjay_t *anjay,
             _anjay_dm_delegate_transaction_commit(anjay, obj_ptr,
                                                   &_anjay_attr_storage_MODULE);
     if (--fas->saved_state.depth == 0) {
-        if (result && saved_state_restore(anjay, fas)) {
+        if (result && saved_state_restore(fas)) {
             result = ANJAY_ERR_INTERNAL;
         }
-        saved_state_reset(fas);
+        undo_log_discard(fas);
     }
     return result;
 }
@@ -887,11 +1162,8 @@ static int transaction_rollback(anjay_t *anjay,
     anjay_attr_storage_t *fas = get_fas(anjay);
     int result = _anjay_dm_delegate_transaction_rollback(
             anjay, obj_ptr, &_anjay_attr_storage_MODULE);
-    if (--fas->saved_state.depth == 0) {
-        if (saved_state_restore(anjay, fas)) {
-            result = ANJAY_ERR_INTERNAL;
-        }
-        saved_state_reset(fas);
+    if (--fas->saved_state.depth == 0 && saved_state_restore(fas)) {
+        result = ANJAY_ERR_INTERNAL;
     }
     return result;
 }
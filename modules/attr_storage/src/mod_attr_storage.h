@@ -20,6 +20,10 @@
 #include <anjay/attr_storage.h>
 #include <anjay/core.h>
 
+#include <avsystem/commons/rbtree.h>
+
+#include <anjay_modules/dm_utils.h>
+#include <anjay_modules/persistence_journal.h>
 #include <anjay_modules/utils_core.h>
 
 VISIBILITY_PRIVATE_HEADER_BEGIN
@@ -36,6 +40,16 @@ typedef struct {
     anjay_dm_internal_res_attrs_t attrs;
 } fas_resource_attrs_t;
 
+/*
+ * Object, Instance and Resource entries are kept in red-black trees sorted by
+ * ID, so that attributes may be looked up in logarithmic time regardless of
+ * the number of stored entries. Empty trees are not allocated at all, i.e. an
+ * entry without children always has a NULL tree pointer.
+ *
+ * Attribute entries are kept on lists sorted by SSID, as there is at most one
+ * of them per server.
+ */
+
 typedef struct {
     anjay_rid_t rid;
     AVS_LIST(fas_resource_attrs_t) attrs;
@@ -44,34 +58,65 @@ typedef struct {
 typedef struct {
     anjay_iid_t iid;
     AVS_LIST(fas_default_attrs_t) default_attrs;
-    AVS_LIST(fas_resource_entry_t) resources;
+    AVS_RBTREE(fas_resource_entry_t) resources;
 } fas_instance_entry_t;
 
 typedef struct {
     anjay_oid_t oid;
     AVS_LIST(fas_default_attrs_t) default_attrs;
-    AVS_LIST(fas_instance_entry_t) instances;
+    AVS_RBTREE(fas_instance_entry_t) instances;
 } fas_object_entry_t;
 
 typedef struct {
-    anjay_oid_t oid;
-    AVS_LIST(anjay_iid_t) iids;
-    void *last_cookie;
-} fas_iteration_state_t;
+    /**
+     * Path of the entry that has been changed - or, for attribute entries, of
+     * the object, instance or resource entry they belong to.
+     */
+    anjay_uri_path_t path;
+    bool is_attrs;
+    /**
+     * Entry detached from the tree (or a copy of an attribute entry as it was
+     * before being modified in place), to be put back on rollback. It is an
+     * AVS_LIST element for attribute entries and an AVS_RBTREE element
+     * otherwise. NULL if an attribute entry for @ref ssid has been created and
+     * shall be removed.
+     */
+    void *old_entry;
+    anjay_ssid_t ssid;
+} fas_undo_entry_t;
 
 typedef struct {
     size_t depth;
-    avs_stream_abstract_t *persist_data;
+    /* changes made during the current transaction, most recent first */
+    AVS_LIST(fas_undo_entry_t) undo_log;
     bool modified_since_persist;
 } fas_saved_state_t;
 
 typedef struct {
-    AVS_LIST(fas_object_entry_t) objects;
+    AVS_RBTREE(fas_object_entry_t) objects;
     bool modified_since_persist;
-    fas_iteration_state_t iteration;
     fas_saved_state_t saved_state;
+    anjay_journal_t journal;
 } anjay_attr_storage_t;
 
+/**
+ * Equivalent of AVS_RBTREE_FIRST() that also accepts a NULL (empty) tree.
+ */
+#define FAS_TREE_FIRST(Tree) ((Tree) ? AVS_RBTREE_FIRST(Tree) : NULL)
+
+#define FAS_TREE_FOREACH(Elem, Tree)            \
+    for ((Elem) = FAS_TREE_FIRST(Tree); (Elem); \
+         (Elem) = AVS_RBTREE_ELEM_NEXT(Elem))
+
+/**
+ * Iterates over a tree, allowing the current element to be removed from it -
+ * even if that causes the tree itself to be deleted.
+ */
+#define FAS_TREE_DELETABLE_FOREACH(Elem, Helper, Tree)            \
+    for ((Elem) = FAS_TREE_FIRST(Tree);                           \
+         (Elem) && ((Helper) = AVS_RBTREE_ELEM_NEXT(Elem), true); \
+         (Elem) = (Helper))
+
 extern const anjay_dm_module_t _anjay_attr_storage_MODULE;
 
 void _anjay_attr_storage_clear(anjay_attr_storage_t *fas);
@@ -88,43 +133,99 @@ _anjay_attr_storage_mark_modified(anjay_attr_storage_t *fas) {
     fas->modified_since_persist = true;
 }
 
-static void remove_resource_entry(anjay_attr_storage_t *fas,
-                                  AVS_LIST(fas_resource_entry_t) *entry_ptr) {
-    AVS_LIST_CLEAR(&(*entry_ptr)->attrs);
-    AVS_LIST_DELETE(entry_ptr);
-    _anjay_attr_storage_mark_modified(fas);
+/**
+ * Inserts a detached @p entry into the tree pointed to by @p tree_ptr,
+ * allocating the tree first if necessary.
+ *
+ * @returns @p entry on success, an already existing entry with the same ID
+ *          (in which case @p entry is not inserted), or NULL if the tree could
+ *          not be allocated.
+ */
+AVS_RBTREE_ELEM(void)
+_anjay_attr_storage_insert_entry(AVS_RBTREE(void) *tree_ptr,
+                                 AVS_RBTREE_ELEM(void) entry);
+
+/**
+ * Frees a detached object, instance or resource entry along with all its
+ * children.
+ */
+void _anjay_attr_storage_free_entry(anjay_uri_path_type_t type,
+                                    AVS_RBTREE_ELEM(void) *entry_ptr);
+
+/**
+ * Removes an object, instance or resource @p entry, identified by @p path, from
+ * the tree pointed to by @p tree_ptr, along with all its children.
+ *
+ * During a transaction, the entry is moved to the undo log instead of being
+ * freed. If that is not possible due to lack of memory, the tree is left
+ * unchanged and a negative value is returned.
+ */
+int _anjay_attr_storage_remove_entry(anjay_attr_storage_t *fas,
+                                     const anjay_uri_path_t *path,
+                                     AVS_RBTREE(void) *tree_ptr,
+                                     AVS_RBTREE_ELEM(void) entry);
+
+static inline int
+remove_resource_entry(anjay_attr_storage_t *fas,
+                      anjay_oid_t oid,
+                      fas_instance_entry_t *instance,
+                      AVS_RBTREE_ELEM(fas_resource_entry_t) resource) {
+    return _anjay_attr_storage_remove_entry(
+            fas, &MAKE_RESOURCE_PATH(oid, instance->iid, resource->rid),
+            (AVS_RBTREE(void) *) &instance->resources, resource);
+}
+
+static inline int
+remove_instance_entry(anjay_attr_storage_t *fas,
+                      fas_object_entry_t *object,
+                      AVS_RBTREE_ELEM(fas_instance_entry_t) instance) {
+    return _anjay_attr_storage_remove_entry(
+            fas, &MAKE_INSTANCE_PATH(object->oid, instance->iid),
+            (AVS_RBTREE(void) *) &object->instances, instance);
+}
+
+static inline int
+remove_object_entry(anjay_attr_storage_t *fas,
+                    AVS_RBTREE_ELEM(fas_object_entry_t) object) {
+    return _anjay_attr_storage_remove_entry(
+            fas, &MAKE_OBJECT_PATH(object->oid),
+            (AVS_RBTREE(void) *) &fas->objects, object);
 }
 
-static void remove_instance_entry(anjay_attr_storage_t *fas,
-                                  AVS_LIST(fas_instance_entry_t) *entry_ptr) {
-    AVS_LIST_CLEAR(&(*entry_ptr)->default_attrs);
-    while ((*entry_ptr)->resources) {
-        remove_resource_entry(fas, &(*entry_ptr)->resources);
+/**
+ * Deletes an @p entry that has no children from the tree pointed to by
+ * @p tree_ptr, and the tree itself if it becomes empty.
+ */
+static inline void delete_empty_entry(AVS_RBTREE(void) *tree_ptr,
+                                      AVS_RBTREE_ELEM(void) entry) {
+    AVS_RBTREE_DELETE_ELEM(*tree_ptr, &entry);
+    if (!AVS_RBTREE_FIRST(*tree_ptr)) {
+        AVS_RBTREE_DELETE(tree_ptr);
     }
-    AVS_LIST_DELETE(entry_ptr);
-    _anjay_attr_storage_mark_modified(fas);
 }
 
-static void remove_object_entry(anjay_attr_storage_t *fas,
-                                AVS_LIST(fas_object_entry_t) *entry_ptr) {
-    AVS_LIST_CLEAR(&(*entry_ptr)->default_attrs);
-    while ((*entry_ptr)->instances) {
-        remove_instance_entry(fas, &(*entry_ptr)->instances);
+static inline void remove_resource_if_empty(
+        fas_instance_entry_t *instance,
+        AVS_RBTREE_ELEM(fas_resource_entry_t) resource) {
+    if (!resource->attrs) {
+        delete_empty_entry((AVS_RBTREE(void) *) &instance->resources,
+                           resource);
     }
-    AVS_LIST_DELETE(entry_ptr);
-    _anjay_attr_storage_mark_modified(fas);
 }
 
-static void
-remove_instance_if_empty(AVS_LIST(fas_instance_entry_t) *entry_ptr) {
-    if (!(*entry_ptr)->default_attrs && !(*entry_ptr)->resources) {
-        AVS_LIST_DELETE(entry_ptr);
+static inline void remove_instance_if_empty(
+        fas_object_entry_t *object,
+        AVS_RBTREE_ELEM(fas_instance_entry_t) instance) {
+    if (!instance->default_attrs && !instance->resources) {
+        delete_empty_entry((AVS_RBTREE(void) *) &object->instances, instance);
     }
 }
 
-static void remove_object_if_empty(AVS_LIST(fas_object_entry_t) *entry_ptr) {
-    if (!(*entry_ptr)->default_attrs && !(*entry_ptr)->instances) {
-        AVS_LIST_DELETE(entry_ptr);
+static inline void
+remove_object_if_empty(anjay_attr_storage_t *fas,
+                       AVS_RBTREE_ELEM(fas_object_entry_t) object) {
+    if (!object->default_attrs && !object->instances) {
+        delete_empty_entry((AVS_RBTREE(void) *) &fas->objects, object);
     }
 }
 
@@ -20,6 +20,7 @@
 #include <anjay/core.h>
 
 #include <anjay_modules/dm/execute.h>
+#include <anjay_modules/notify.h>
 
 #include <anjay_test/dm.h>
 
@@ -133,13 +134,14 @@ AVS_UNIT_TEST(attr_storage, resource_dim) {
 
 //// ACTIVE PROXY HANDLERS /////////////////////////////////////////////////////
 
-AVS_UNIT_TEST(attr_storage, instance_it) {
+AVS_UNIT_TEST(attr_storage, notify_instances_changed) {
     DM_ATTR_STORAGE_TEST_INIT;
-    anjay_iid_t iid;
-    void *cookie = NULL;
+    anjay_notify_queue_t queue = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(
+            _anjay_notify_queue_instance_set_unknown_change(&queue, 42));
 
     // prepare initial state
-    AVS_LIST_APPEND(
+    test_insert_entry(
             &get_fas(anjay)->objects,
             test_object_entry(
                     42,
@@ -197,34 +199,32 @@ AVS_UNIT_TEST(attr_storage, instance_it) {
                             NULL),
                     NULL));
 
+    // iterating doesn't affect the stored attributes
+    anjay_iid_t iid;
+    void *cookie = NULL;
     _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 0, 0, 7);
     AVS_UNIT_ASSERT_SUCCESS(
             _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie, NULL));
     AVS_UNIT_ASSERT_EQUAL(iid, 7);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 1, 0, 2);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 2);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 2, 0, 13);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 13);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 3, 0, 3);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 3);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 4, 0, 42);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 42);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 5, 0, ANJAY_IID_INVALID);
+    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 1, 0, ANJAY_IID_INVALID);
     AVS_UNIT_ASSERT_SUCCESS(
             _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie, NULL));
     AVS_UNIT_ASSERT_EQUAL(iid, ANJAY_IID_INVALID);
+    AVS_UNIT_ASSERT_EQUAL(
+            TREE_SIZE(find_object(get_fas(anjay), 42)->instances), 5);
+    AVS_UNIT_ASSERT_FALSE(anjay_attr_storage_is_modified(anjay));
+
+    // stored instances are checked on instance set change notification
+    _anjay_mock_dm_expect_instance_present(anjay, &OBJ, 1, 0);
+    _anjay_mock_dm_expect_instance_present(anjay, &OBJ, 2, 1);
+    _anjay_mock_dm_expect_instance_present(anjay, &OBJ, 4, 0);
+    _anjay_mock_dm_expect_instance_present(anjay, &OBJ, 7, 1);
+    _anjay_mock_dm_expect_instance_present(anjay, &OBJ, 8, 0);
+    AVS_UNIT_ASSERT_SUCCESS(fas_on_notify(anjay, queue, get_fas(anjay)));
 
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(get_fas(anjay)->objects), 1);
+    AVS_UNIT_ASSERT_EQUAL(TREE_SIZE(get_fas(anjay)->objects), 1);
     assert_object_equal(
-            get_fas(anjay)->objects,
+            FAS_TREE_FIRST(get_fas(anjay)->objects),
             test_object_entry(
                     42,
                     NULL,
@@ -252,12 +252,20 @@ AVS_UNIT_TEST(attr_storage, instance_it) {
 
     // error
     get_fas(anjay)->modified_since_persist = false;
-    cookie = NULL;
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 0, -11, 7);
-    AVS_UNIT_ASSERT_EQUAL(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie, NULL), -11);
-    AVS_UNIT_ASSERT_EQUAL(iid, 7);
+    _anjay_mock_dm_expect_instance_present(anjay, &OBJ, 2, -11);
+    AVS_UNIT_ASSERT_EQUAL(fas_on_notify(anjay, queue, get_fas(anjay)), -11);
     AVS_UNIT_ASSERT_FALSE(anjay_attr_storage_is_modified(anjay));
+
+    // known removals don't need querying the data model
+    _anjay_notify_clear_queue(&queue);
+    AVS_UNIT_ASSERT_SUCCESS(
+            _anjay_notify_queue_instance_removed(&queue, 42, 7));
+    AVS_UNIT_ASSERT_SUCCESS(fas_on_notify(anjay, queue, get_fas(anjay)));
+    AVS_UNIT_ASSERT_EQUAL(
+            TREE_SIZE(find_object(get_fas(anjay), 42)->instances), 1);
+    AVS_UNIT_ASSERT_TRUE(anjay_attr_storage_is_modified(anjay));
+
+    _anjay_notify_clear_queue(&queue);
     DM_ATTR_STORAGE_TEST_FINISH;
 }
 
@@ -265,7 +273,7 @@ AVS_UNIT_TEST(attr_storage, instance_present) {
     DM_ATTR_STORAGE_TEST_INIT;
 
     // prepare initial state
-    AVS_LIST_APPEND(
+    test_insert_entry(
             &get_fas(anjay)->objects,
             test_object_entry(
                     42, NULL,
@@ -283,21 +291,21 @@ AVS_UNIT_TEST(attr_storage, instance_present) {
     _anjay_mock_dm_expect_instance_present(anjay, &OBJ, 42, 1);
     AVS_UNIT_ASSERT_EQUAL(_anjay_dm_instance_present(anjay, &OBJ, 42, NULL), 1);
     AVS_UNIT_ASSERT_EQUAL(
-            AVS_LIST_SIZE((*find_object(get_fas(anjay), 42))->instances), 4);
+            TREE_SIZE(find_object(get_fas(anjay), 42)->instances), 4);
     AVS_UNIT_ASSERT_FALSE(anjay_attr_storage_is_modified(anjay));
     _anjay_mock_dm_expect_instance_present(anjay, &OBJ, 21, -1);
     AVS_UNIT_ASSERT_EQUAL(_anjay_dm_instance_present(anjay, &OBJ, 21, NULL),
                           -1);
     AVS_UNIT_ASSERT_EQUAL(
-            AVS_LIST_SIZE((*find_object(get_fas(anjay), 42))->instances), 4);
+            TREE_SIZE(find_object(get_fas(anjay), 42)->instances), 4);
     AVS_UNIT_ASSERT_FALSE(anjay_attr_storage_is_modified(anjay));
     _anjay_mock_dm_expect_instance_present(anjay, &OBJ, 4, 0);
     AVS_UNIT_ASSERT_EQUAL(_anjay_dm_instance_present(anjay, &OBJ, 4, NULL), 0);
 
     // verification
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(get_fas(anjay)->objects), 1);
+    AVS_UNIT_ASSERT_EQUAL(TREE_SIZE(get_fas(anjay)->objects), 1);
     assert_object_equal(
-            get_fas(anjay)->objects,
+            FAS_TREE_FIRST(get_fas(anjay)->objects),
             test_object_entry(
                     42, NULL,
                     test_instance_entry(7, NULL, test_resource_entry(11, NULL),
@@ -315,7 +323,7 @@ AVS_UNIT_TEST(attr_storage, instance_remove) {
     DM_ATTR_STORAGE_TEST_INIT;
 
     // prepare initial state
-    AVS_LIST_APPEND(
+    test_insert_entry(
             &get_fas(anjay)->objects,
             test_object_entry(
                     42, NULL,
@@ -331,21 +339,21 @@ AVS_UNIT_TEST(attr_storage, instance_remove) {
     _anjay_mock_dm_expect_instance_remove(anjay, &OBJ, 42, 0);
     AVS_UNIT_ASSERT_EQUAL(_anjay_dm_instance_remove(anjay, &OBJ, 42, NULL), 0);
     AVS_UNIT_ASSERT_EQUAL(
-            AVS_LIST_SIZE((*find_object(get_fas(anjay), 42))->instances), 2);
+            TREE_SIZE(find_object(get_fas(anjay), 42)->instances), 2);
     AVS_UNIT_ASSERT_TRUE(anjay_attr_storage_is_modified(anjay));
     get_fas(anjay)->modified_since_persist = false;
     _anjay_mock_dm_expect_instance_remove(anjay, &OBJ, 2, 0);
     AVS_UNIT_ASSERT_EQUAL(_anjay_dm_instance_remove(anjay, &OBJ, 2, NULL), 0);
     AVS_UNIT_ASSERT_EQUAL(
-            AVS_LIST_SIZE((*find_object(get_fas(anjay), 42))->instances), 2);
+            TREE_SIZE(find_object(get_fas(anjay), 42)->instances), 2);
     AVS_UNIT_ASSERT_FALSE(anjay_attr_storage_is_modified(anjay));
     _anjay_mock_dm_expect_instance_remove(anjay, &OBJ, 7, -44);
     AVS_UNIT_ASSERT_EQUAL(_anjay_dm_instance_remove(anjay, &OBJ, 7, NULL), -44);
 
     // verification
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(get_fas(anjay)->objects), 1);
+    AVS_UNIT_ASSERT_EQUAL(TREE_SIZE(get_fas(anjay)->objects), 1);
     assert_object_equal(
-            get_fas(anjay)->objects,
+            FAS_TREE_FIRST(get_fas(anjay)->objects),
             test_object_entry(
                     42, NULL,
                     test_instance_entry(4, NULL, test_resource_entry(33, NULL),
@@ -357,11 +365,72 @@ AVS_UNIT_TEST(attr_storage, instance_remove) {
     DM_ATTR_STORAGE_TEST_FINISH;
 }
 
+AVS_UNIT_TEST(attr_storage, instance_remove_rollback) {
+    DM_ATTR_STORAGE_TEST_INIT;
+
+    // prepare initial state
+    test_insert_entry(
+            &get_fas(anjay)->objects,
+            test_object_entry(
+                    42, NULL,
+                    test_instance_entry(
+                            4,
+                            test_default_attrlist(
+                                    test_default_attrs(
+                                            1, 2, 514,
+                                            ANJAY_DM_CON_ATTR_DEFAULT),
+                                    NULL),
+                            test_resource_entry(
+                                    33,
+                                    test_resource_attrs(
+                                            1, 7, ANJAY_ATTRIB_PERIOD_NONE,
+                                            42.0, ANJAY_ATTRIB_VALUE_NONE,
+                                            ANJAY_ATTRIB_VALUE_NONE,
+                                            ANJAY_DM_CON_ATTR_DEFAULT),
+                                    NULL),
+                            NULL),
+                    NULL));
+
+    // tests
+    _anjay_mock_dm_expect_instance_remove(anjay, &OBJ, 4, 0);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_dm_instance_remove(anjay, &OBJ, 4, NULL));
+    AVS_UNIT_ASSERT_NULL(get_fas(anjay)->objects);
+    AVS_UNIT_ASSERT_TRUE(anjay_attr_storage_is_modified(anjay));
+    AVS_UNIT_ASSERT_FAILED(_anjay_dm_transaction_finish(anjay, -1));
+
+    // verification
+    AVS_UNIT_ASSERT_EQUAL(TREE_SIZE(get_fas(anjay)->objects), 1);
+    assert_object_equal(
+            FAS_TREE_FIRST(get_fas(anjay)->objects),
+            test_object_entry(
+                    42, NULL,
+                    test_instance_entry(
+                            4,
+                            test_default_attrlist(
+                                    test_default_attrs(
+                                            1, 2, 514,
+                                            ANJAY_DM_CON_ATTR_DEFAULT),
+                                    NULL),
+                            test_resource_entry(
+                                    33,
+                                    test_resource_attrs(
+                                            1, 7, ANJAY_ATTRIB_PERIOD_NONE,
+                                            42.0, ANJAY_ATTRIB_VALUE_NONE,
+                                            ANJAY_ATTRIB_VALUE_NONE,
+                                            ANJAY_DM_CON_ATTR_DEFAULT),
+                                    NULL),
+                            NULL),
+                    NULL));
+    AVS_UNIT_ASSERT_FALSE(anjay_attr_storage_is_modified(anjay));
+    _anjay_dm_transaction_begin(anjay);
+    DM_ATTR_STORAGE_TEST_FINISH;
+}
+
 AVS_UNIT_TEST(attr_storage, resource_present) {
     DM_ATTR_STORAGE_TEST_INIT;
 
     // prepare initial state
-    AVS_LIST_APPEND(
+    test_insert_entry(
             &get_fas(anjay)->objects,
             test_object_entry(
                     42, NULL,
@@ -396,7 +465,7 @@ AVS_UNIT_TEST(attr_storage, resource_present) {
     AVS_UNIT_ASSERT_TRUE(anjay_attr_storage_is_modified(anjay));
     get_fas(anjay)->modified_since_persist = false;
     AVS_UNIT_ASSERT_EQUAL(
-            AVS_LIST_SIZE((*find_object(get_fas(anjay), 42))->instances), 4);
+            TREE_SIZE(find_object(get_fas(anjay), 42)->instances), 4);
     _anjay_mock_dm_expect_resource_present(anjay, &OBJ, 7, 11, 0);
     AVS_UNIT_ASSERT_EQUAL(_anjay_dm_resource_present(anjay, &OBJ, 7, 11, NULL),
                           0);
@@ -408,9 +477,9 @@ AVS_UNIT_TEST(attr_storage, resource_present) {
     AVS_UNIT_ASSERT_TRUE(anjay_attr_storage_is_modified(anjay));
 
     // verification
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(get_fas(anjay)->objects), 1);
+    AVS_UNIT_ASSERT_EQUAL(TREE_SIZE(get_fas(anjay)->objects), 1);
     assert_object_equal(
-            get_fas(anjay)->objects,
+            FAS_TREE_FIRST(get_fas(anjay)->objects),
             test_object_entry(
                     42, NULL,
                     test_instance_entry(4, NULL, test_resource_entry(11, NULL),
@@ -605,7 +674,7 @@ AVS_UNIT_TEST(attr_storage, object_default_attrs) {
     get_fas(anjay)->modified_since_persist = false;
 
     assert_object_equal(
-            get_fas(anjay)->objects,
+            FAS_TREE_FIRST(get_fas(anjay)->objects),
             test_object_entry(
                     69,
                     test_default_attrlist(
@@ -827,9 +896,9 @@ AVS_UNIT_TEST(attr_storage, instance_default_attrs) {
     AVS_UNIT_ASSERT_TRUE(anjay_attr_storage_is_modified(anjay));
     get_fas(anjay)->modified_since_persist = false;
 
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(get_fas(anjay)->objects), 1);
+    AVS_UNIT_ASSERT_EQUAL(TREE_SIZE(get_fas(anjay)->objects), 1);
     assert_object_equal(
-            get_fas(anjay)->objects,
+            FAS_TREE_FIRST(get_fas(anjay)->objects),
             test_object_entry(
                     69, NULL,
                     test_instance_entry(
@@ -1075,19 +1144,20 @@ AVS_UNIT_TEST(attr_storage, write_resource_attrs_proxy) {
 AVS_UNIT_TEST(attr_storage, read_resource_attrs) {
     DM_ATTR_STORAGE_TEST_INIT;
 
-    AVS_LIST_APPEND(&get_fas(anjay)->objects,
-                    test_object_entry(
-                            69, NULL,
-                            test_instance_entry(
-                                    3, NULL,
-                                    test_resource_entry(
-                                            1,
-                                            test_resource_attrs(
-                                                    42, 1, 2, 3.0, 4.0, 5.0,
-                                                    ANJAY_DM_CON_ATTR_DEFAULT),
-                                            NULL),
+    test_insert_entry(
+            &get_fas(anjay)->objects,
+            test_object_entry(
+                    69, NULL,
+                    test_instance_entry(
+                            3, NULL,
+                            test_resource_entry(
+                                    1,
+                                    test_resource_attrs(
+                                            42, 1, 2, 3.0, 4.0, 5.0,
+                                            ANJAY_DM_CON_ATTR_DEFAULT),
                                     NULL),
-                            NULL));
+                            NULL),
+                    NULL));
 
     anjay_dm_internal_res_attrs_t attrs;
     AVS_UNIT_ASSERT_SUCCESS(_anjay_dm_resource_read_attrs(anjay, &OBJ2, 3, 1,
@@ -1143,9 +1213,9 @@ AVS_UNIT_TEST(attr_storage, write_resource_attrs) {
     AVS_UNIT_ASSERT_TRUE(anjay_attr_storage_is_modified(anjay));
     get_fas(anjay)->modified_since_persist = false;
 
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(get_fas(anjay)->objects), 1);
+    AVS_UNIT_ASSERT_EQUAL(TREE_SIZE(get_fas(anjay)->objects), 1);
     assert_object_equal(
-            get_fas(anjay)->objects,
+            FAS_TREE_FIRST(get_fas(anjay)->objects),
             test_object_entry(
                     69, NULL,
                     test_instance_entry(
@@ -1196,9 +1266,9 @@ AVS_UNIT_TEST(attr_storage, write_resource_attrs) {
     AVS_UNIT_ASSERT_TRUE(anjay_attr_storage_is_modified(anjay));
     get_fas(anjay)->modified_since_persist = false;
 
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(get_fas(anjay)->objects), 1);
+    AVS_UNIT_ASSERT_EQUAL(TREE_SIZE(get_fas(anjay)->objects), 1);
     assert_object_equal(
-            get_fas(anjay)->objects,
+            FAS_TREE_FIRST(get_fas(anjay)->objects),
             test_object_entry(
                     69, NULL,
                     test_instance_entry(
@@ -1246,9 +1316,9 @@ AVS_UNIT_TEST(attr_storage, write_resource_attrs) {
     AVS_UNIT_ASSERT_TRUE(anjay_attr_storage_is_modified(anjay));
     get_fas(anjay)->modified_since_persist = false;
 
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(get_fas(anjay)->objects), 1);
+    AVS_UNIT_ASSERT_EQUAL(TREE_SIZE(get_fas(anjay)->objects), 1);
     assert_object_equal(
-            get_fas(anjay)->objects,
+            FAS_TREE_FIRST(get_fas(anjay)->objects),
             test_object_entry(
                     69, NULL,
                     test_instance_entry(
@@ -1272,9 +1342,9 @@ AVS_UNIT_TEST(attr_storage, write_resource_attrs) {
     AVS_UNIT_ASSERT_TRUE(anjay_attr_storage_is_modified(anjay));
     get_fas(anjay)->modified_since_persist = false;
 
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(get_fas(anjay)->objects), 1);
+    AVS_UNIT_ASSERT_EQUAL(TREE_SIZE(get_fas(anjay)->objects), 1);
     assert_object_equal(
-            get_fas(anjay)->objects,
+            FAS_TREE_FIRST(get_fas(anjay)->objects),
             test_object_entry(
                     69, NULL,
                     test_instance_entry(
@@ -1307,9 +1377,9 @@ AVS_UNIT_TEST(attr_storage, write_resource_attrs) {
     AVS_UNIT_ASSERT_TRUE(anjay_attr_storage_is_modified(anjay));
     get_fas(anjay)->modified_since_persist = false;
 
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(get_fas(anjay)->objects), 1);
+    AVS_UNIT_ASSERT_EQUAL(TREE_SIZE(get_fas(anjay)->objects), 1);
     assert_object_equal(
-            get_fas(anjay)->objects,
+            FAS_TREE_FIRST(get_fas(anjay)->objects),
             test_object_entry(
                     69, NULL,
                     test_instance_entry(
@@ -1336,7 +1406,7 @@ AVS_UNIT_TEST(attr_storage, write_resource_attrs) {
 
 //// SSID HANDLING /////////////////////////////////////////////////////////////
 
-AVS_UNIT_TEST(attr_storage, ssid_it) {
+AVS_UNIT_TEST(attr_storage, notify_servers_changed) {
     DM_ATTR_STORAGE_TEST_INIT;
 
     // server mapping:
@@ -1349,7 +1419,7 @@ AVS_UNIT_TEST(attr_storage, ssid_it) {
     // /1/10/0 == 2
     // /1/11/0 == -5 (invalid)
 
-    AVS_LIST_APPEND(
+    test_insert_entry(
             &get_fas(anjay)->objects,
             test_object_entry(
                     42,
@@ -1413,48 +1483,35 @@ AVS_UNIT_TEST(attr_storage, ssid_it) {
                             NULL),
                     NULL));
 
-    anjay_iid_t iid;
-    void *cookie = NULL;
+    anjay_notify_queue_t queue = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_notify_queue_instance_set_unknown_change(
+            &queue, ANJAY_DM_OID_SECURITY));
     _anjay_mock_dm_expect_instance_it(anjay, &FAKE_SECURITY2, 0, 0, 514);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &FAKE_SECURITY2, &iid, &cookie, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 514);
+    _anjay_mock_dm_expect_resource_present(anjay, &FAKE_SECURITY2, 514, 10, 1);
+    _anjay_mock_dm_expect_resource_read(anjay, &FAKE_SECURITY2, 514, 10, 0,
+                                        ANJAY_MOCK_DM_INT(0, -4));
     _anjay_mock_dm_expect_instance_it(anjay, &FAKE_SECURITY2, 1, 0, 7);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &FAKE_SECURITY2, &iid, &cookie, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 7);
+    _anjay_mock_dm_expect_resource_present(anjay, &FAKE_SECURITY2, 7, 10, 1);
+    _anjay_mock_dm_expect_resource_read(anjay, &FAKE_SECURITY2, 7, 10, 0,
+                                        ANJAY_MOCK_DM_INT(0, 514));
     _anjay_mock_dm_expect_instance_it(anjay, &FAKE_SECURITY2, 2, 0, 42);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &FAKE_SECURITY2, &iid, &cookie, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 42);
+    _anjay_mock_dm_expect_resource_present(anjay, &FAKE_SECURITY2, 42, 10, 1);
+    _anjay_mock_dm_expect_resource_read(anjay, &FAKE_SECURITY2, 42, 10, 0,
+                                        ANJAY_MOCK_DM_INT(0, 2));
     _anjay_mock_dm_expect_instance_it(anjay, &FAKE_SECURITY2, 3, 0, 4);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &FAKE_SECURITY2, &iid, &cookie, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 4);
-    AVS_UNIT_ASSERT_FALSE(anjay_attr_storage_is_modified(anjay));
-    _anjay_mock_dm_expect_instance_it(anjay, &FAKE_SECURITY2, 4, 0,
-                                      ANJAY_IID_INVALID);
     _anjay_mock_dm_expect_resource_present(anjay, &FAKE_SECURITY2, 4, 10, 1);
     _anjay_mock_dm_expect_resource_read(anjay, &FAKE_SECURITY2, 4, 10, 0,
                                         ANJAY_MOCK_DM_INT(0, 3));
-    _anjay_mock_dm_expect_resource_present(anjay, &FAKE_SECURITY2, 42, 10, 1);
-    _anjay_mock_dm_expect_resource_read(anjay, &FAKE_SECURITY2, 42, 10, 0,
-                                        ANJAY_MOCK_DM_INT(0, 2));
-    _anjay_mock_dm_expect_resource_present(anjay, &FAKE_SECURITY2, 7, 10, 1);
-    _anjay_mock_dm_expect_resource_read(anjay, &FAKE_SECURITY2, 7, 10, 0,
-                                        ANJAY_MOCK_DM_INT(0, 514));
-    _anjay_mock_dm_expect_resource_present(anjay, &FAKE_SECURITY2, 514, 10, 1);
-    _anjay_mock_dm_expect_resource_read(anjay, &FAKE_SECURITY2, 514, 10, 0,
-                                        ANJAY_MOCK_DM_INT(0, -4));
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &FAKE_SECURITY2, &iid, &cookie, NULL));
+    _anjay_mock_dm_expect_instance_it(anjay, &FAKE_SECURITY2, 4, 0,
+                                      ANJAY_IID_INVALID);
+    AVS_UNIT_ASSERT_SUCCESS(fas_on_notify(anjay, queue, get_fas(anjay)));
+    _anjay_notify_clear_queue(&queue);
     AVS_UNIT_ASSERT_TRUE(anjay_attr_storage_is_modified(anjay));
     get_fas(anjay)->modified_since_persist = false;
-    AVS_UNIT_ASSERT_EQUAL(iid, ANJAY_IID_INVALID);
 
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(get_fas(anjay)->objects), 1);
+    AVS_UNIT_ASSERT_EQUAL(TREE_SIZE(get_fas(anjay)->objects), 1);
     assert_object_equal(
-            get_fas(anjay)->objects,
+            FAS_TREE_FIRST(get_fas(anjay)->objects),
             test_object_entry(
                     42,
                     test_default_attrlist(
@@ -1477,40 +1534,30 @@ AVS_UNIT_TEST(attr_storage, ssid_it) {
                             NULL),
                     NULL));
 
-    cookie = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_notify_queue_instance_removed(
+            &queue, ANJAY_DM_OID_SERVER, 12));
     _anjay_mock_dm_expect_instance_it(anjay, &FAKE_SERVER, 0, 0, 11);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &FAKE_SERVER, &iid, &cookie, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 11);
+    _anjay_mock_dm_expect_resource_present(anjay, &FAKE_SERVER, 11, 0, 1);
+    _anjay_mock_dm_expect_resource_read(anjay, &FAKE_SERVER, 11, 0, 0,
+                                        ANJAY_MOCK_DM_INT(0, -5));
     _anjay_mock_dm_expect_instance_it(anjay, &FAKE_SERVER, 1, 0, 9);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &FAKE_SERVER, &iid, &cookie, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 9);
+    _anjay_mock_dm_expect_resource_present(anjay, &FAKE_SERVER, 9, 0, 1);
+    _anjay_mock_dm_expect_resource_read(anjay, &FAKE_SERVER, 9, 0, 0,
+                                        ANJAY_MOCK_DM_INT(0, 514));
     _anjay_mock_dm_expect_instance_it(anjay, &FAKE_SERVER, 2, 0, 10);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &FAKE_SERVER, &iid, &cookie, NULL));
-    AVS_UNIT_ASSERT_FALSE(anjay_attr_storage_is_modified(anjay));
-    AVS_UNIT_ASSERT_EQUAL(iid, 10);
-    _anjay_mock_dm_expect_instance_it(anjay, &FAKE_SERVER, 3, 0,
-                                      ANJAY_IID_INVALID);
     _anjay_mock_dm_expect_resource_present(anjay, &FAKE_SERVER, 10, 0, 1);
     _anjay_mock_dm_expect_resource_read(anjay, &FAKE_SERVER, 10, 0, 0,
                                         ANJAY_MOCK_DM_INT(0, 2));
-    _anjay_mock_dm_expect_resource_present(anjay, &FAKE_SERVER, 9, 0, 1);
-    _anjay_mock_dm_expect_resource_read(anjay, &FAKE_SERVER, 9, 0, 0,
-                                        ANJAY_MOCK_DM_INT(0, 514));
-    _anjay_mock_dm_expect_resource_present(anjay, &FAKE_SERVER, 11, 0, 1);
-    _anjay_mock_dm_expect_resource_read(anjay, &FAKE_SERVER, 11, 0, 0,
-                                        ANJAY_MOCK_DM_INT(0, -5));
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &FAKE_SERVER, &iid, &cookie, NULL));
+    _anjay_mock_dm_expect_instance_it(anjay, &FAKE_SERVER, 3, 0,
+                                      ANJAY_IID_INVALID);
+    AVS_UNIT_ASSERT_SUCCESS(fas_on_notify(anjay, queue, get_fas(anjay)));
+    _anjay_notify_clear_queue(&queue);
     AVS_UNIT_ASSERT_TRUE(anjay_attr_storage_is_modified(anjay));
     get_fas(anjay)->modified_since_persist = false;
-    AVS_UNIT_ASSERT_EQUAL(iid, ANJAY_IID_INVALID);
 
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(get_fas(anjay)->objects), 1);
+    AVS_UNIT_ASSERT_EQUAL(TREE_SIZE(get_fas(anjay)->objects), 1);
     assert_object_equal(
-            get_fas(anjay)->objects,
+            FAS_TREE_FIRST(get_fas(anjay)->objects),
             test_object_entry(
                     42,
                     test_default_attrlist(
@@ -1533,7 +1580,7 @@ AVS_UNIT_TEST(attr_storage, ssid_it) {
 AVS_UNIT_TEST(attr_storage, ssid_remove) {
     DM_ATTR_STORAGE_TEST_INIT;
 
-    AVS_LIST_APPEND(
+    test_insert_entry(
             &get_fas(anjay)->objects,
             test_object_entry(
                     42,
@@ -1607,9 +1654,9 @@ AVS_UNIT_TEST(attr_storage, ssid_remove) {
     AVS_UNIT_ASSERT_TRUE(anjay_attr_storage_is_modified(anjay));
     get_fas(anjay)->modified_since_persist = false;
 
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(get_fas(anjay)->objects), 1);
+    AVS_UNIT_ASSERT_EQUAL(TREE_SIZE(get_fas(anjay)->objects), 1);
     assert_object_equal(
-            get_fas(anjay)->objects,
+            FAS_TREE_FIRST(get_fas(anjay)->objects),
             test_object_entry(
                     42,
                     test_default_attrlist(
@@ -1680,9 +1727,9 @@ AVS_UNIT_TEST(attr_storage, ssid_remove) {
     AVS_UNIT_ASSERT_TRUE(anjay_attr_storage_is_modified(anjay));
     get_fas(anjay)->modified_since_persist = false;
 
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(get_fas(anjay)->objects), 1);
+    AVS_UNIT_ASSERT_EQUAL(TREE_SIZE(get_fas(anjay)->objects), 1);
     assert_object_equal(
-            get_fas(anjay)->objects,
+            FAS_TREE_FIRST(get_fas(anjay)->objects),
             test_object_entry(
                     42,
                     test_default_attrlist(
@@ -1737,128 +1784,6 @@ AVS_UNIT_TEST(attr_storage, ssid_remove) {
     DM_ATTR_STORAGE_TEST_FINISH;
 }
 
-AVS_UNIT_TEST(attr_storage, nested_iterations) {
-    DM_ATTR_STORAGE_TEST_INIT;
-    anjay_iid_t iid;
-
-    // prepare initial state
-    AVS_LIST_APPEND(
-            &get_fas(anjay)->objects,
-            test_object_entry(42, NULL, test_instance_entry(1, NULL, NULL),
-                              test_instance_entry(2, NULL, NULL),
-                              test_instance_entry(3, NULL, NULL),
-                              test_instance_entry(4, NULL, NULL),
-                              test_instance_entry(5, NULL, NULL), NULL));
-
-    void *cookie1 = NULL;
-    void *cookie2 = NULL;
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 0, 0, 1);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie1, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 1);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 1, 0, 2);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie1, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 2);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 0, 0, 1);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie2, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 1);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 1, 0, 2);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie2, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 2);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 2, 0, 3);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie2, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 3);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 3, 0, ANJAY_IID_INVALID);
-    AVS_UNIT_ASSERT_FALSE(anjay_attr_storage_is_modified(anjay));
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie2, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, ANJAY_IID_INVALID);
-    AVS_UNIT_ASSERT_TRUE(anjay_attr_storage_is_modified(anjay));
-    get_fas(anjay)->modified_since_persist = false;
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 2, 0, 3);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie1, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 3);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 3, 0, ANJAY_IID_INVALID);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie1, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, ANJAY_IID_INVALID);
-
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(get_fas(anjay)->objects), 1);
-    assert_object_equal(
-            get_fas(anjay)->objects,
-            test_object_entry(42, NULL, test_instance_entry(1, NULL, NULL),
-                              test_instance_entry(2, NULL, NULL),
-                              test_instance_entry(3, NULL, NULL), NULL));
-
-    DM_ATTR_STORAGE_TEST_FINISH;
-}
-
-AVS_UNIT_TEST(attr_storage, parallel_iterations) {
-    DM_ATTR_STORAGE_TEST_INIT;
-    anjay_iid_t iid;
-
-    // prepare initial state
-    AVS_LIST_APPEND(
-            &get_fas(anjay)->objects,
-            test_object_entry(42, NULL, test_instance_entry(1, NULL, NULL),
-                              test_instance_entry(2, NULL, NULL),
-                              test_instance_entry(3, NULL, NULL),
-                              test_instance_entry(4, NULL, NULL),
-                              test_instance_entry(5, NULL, NULL), NULL));
-
-    void *cookie1 = NULL;
-    void *cookie2 = NULL;
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 0, 0, 1);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie1, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 1);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 0, 0, 1);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie2, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 1);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 1, 0, 2);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie1, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 2);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 1, 0, 2);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie2, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 2);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 2, 0, 3);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie1, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 3);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 2, 0, 3);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie2, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, 3);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 3, 0, ANJAY_IID_INVALID);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie1, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, ANJAY_IID_INVALID);
-    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 3, 0, ANJAY_IID_INVALID);
-    AVS_UNIT_ASSERT_SUCCESS(
-            _anjay_dm_instance_it(anjay, &OBJ, &iid, &cookie2, NULL));
-    AVS_UNIT_ASSERT_EQUAL(iid, ANJAY_IID_INVALID);
-
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(get_fas(anjay)->objects), 1);
-    assert_object_equal(
-            get_fas(anjay)->objects,
-            test_object_entry(42, NULL, test_instance_entry(1, NULL, NULL),
-                              test_instance_entry(2, NULL, NULL),
-                              test_instance_entry(3, NULL, NULL),
-                              test_instance_entry(4, NULL, NULL),
-                              test_instance_entry(5, NULL, NULL), NULL));
-    AVS_UNIT_ASSERT_FALSE(anjay_attr_storage_is_modified(anjay));
-
-    DM_ATTR_STORAGE_TEST_FINISH;
-}
-
 AVS_UNIT_TEST(set_attribs, fail_on_null_attribs) {
     DM_TEST_INIT_WITH_OBJECTS(&OBJ_NOATTRS, &FAKE_SECURITY2);
     AVS_UNIT_ASSERT_SUCCESS(anjay_attr_storage_install(anjay));
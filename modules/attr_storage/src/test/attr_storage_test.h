@@ -18,12 +18,22 @@
 #define ATTR_STORAGE_TEST_H
 
 #include <avsystem/commons/list.h>
+#include <avsystem/commons/rbtree.h>
 #include <avsystem/commons/unit/test.h>
 
 #include <anjay_test/utils.h>
 
 #include "../mod_attr_storage.h"
 
+#define TREE_SIZE(Tree) ((Tree) ? AVS_RBTREE_SIZE(Tree) : 0)
+
+
+static void test_insert_entry(void *tree_ptr, void *entry) {
+    AVS_UNIT_ASSERT_TRUE(_anjay_attr_storage_insert_entry(
+                                 (AVS_RBTREE(void) *) tree_ptr, entry)
+                         == entry);
+}
+
 static fas_resource_attrs_t *test_resource_attrs(anjay_ssid_t ssid,
                                                  int32_t min_period,
                                                  int32_t max_period,
@@ -50,7 +60,7 @@ static fas_resource_attrs_t *test_resource_attrs(anjay_ssid_t ssid,
 static fas_resource_entry_t *test_resource_entry(unsigned /*anjay_rid_t*/ rid,
                                                  ...) {
     assert(rid <= UINT16_MAX);
-    fas_resource_entry_t *resource = AVS_LIST_NEW_ELEMENT(fas_resource_entry_t);
+    fas_resource_entry_t *resource = AVS_RBTREE_ELEM_NEW(fas_resource_entry_t);
     AVS_UNIT_ASSERT_NOT_NULL(resource);
     resource->rid = (anjay_rid_t) rid;
     va_list ap;
@@ -93,7 +103,7 @@ test_default_attrlist(fas_default_attrs_t *entry, ...) {
 
 static fas_instance_entry_t *test_instance_entry(
         anjay_iid_t iid, AVS_LIST(fas_default_attrs_t) default_attrs, ...) {
-    fas_instance_entry_t *instance = AVS_LIST_NEW_ELEMENT(fas_instance_entry_t);
+    fas_instance_entry_t *instance = AVS_RBTREE_ELEM_NEW(fas_instance_entry_t);
     AVS_UNIT_ASSERT_NOT_NULL(instance);
     instance->iid = iid;
     instance->default_attrs = default_attrs;
@@ -101,7 +111,7 @@ static fas_instance_entry_t *test_instance_entry(
     va_start(ap, default_attrs);
     fas_resource_entry_t *resource;
     while ((resource = va_arg(ap, fas_resource_entry_t *))) {
-        AVS_LIST_APPEND(&instance->resources, resource);
+        test_insert_entry(&instance->resources, resource);
     }
     va_end(ap);
     return instance;
@@ -109,7 +119,7 @@ static fas_instance_entry_t *test_instance_entry(
 
 static fas_object_entry_t *test_object_entry(
         anjay_oid_t oid, AVS_LIST(fas_default_attrs_t) default_attrs, ...) {
-    fas_object_entry_t *object = AVS_LIST_NEW_ELEMENT(fas_object_entry_t);
+    fas_object_entry_t *object = AVS_RBTREE_ELEM_NEW(fas_object_entry_t);
     AVS_UNIT_ASSERT_NOT_NULL(object);
     object->oid = oid;
     object->default_attrs = default_attrs;
@@ -117,7 +127,7 @@ static fas_object_entry_t *test_object_entry(
     va_start(ap, default_attrs);
     fas_instance_entry_t *instance;
     while ((instance = va_arg(ap, fas_instance_entry_t *))) {
-        AVS_LIST_APPEND(&object->instances, instance);
+        test_insert_entry(&object->instances, instance);
     }
     va_end(ap);
     return object;
@@ -175,7 +185,7 @@ static void assert_resource_equal(fas_resource_entry_t *actual,
         attrs = AVS_LIST_NEXT(attrs);
     }
 
-    AVS_LIST_DELETE(&tmp_expected);
+    AVS_RBTREE_ELEM_DELETE_DETACHED(&tmp_expected);
 }
 
 static void assert_instance_equal(fas_instance_entry_t *actual,
@@ -191,16 +201,20 @@ static void assert_instance_equal(fas_instance_entry_t *actual,
         default_attrs = AVS_LIST_NEXT(default_attrs);
     }
 
-    count = AVS_LIST_SIZE(tmp_expected->resources);
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(actual->resources), count);
-    AVS_LIST(fas_resource_entry_t) resource = actual->resources;
-    while (count--) {
+    AVS_UNIT_ASSERT_EQUAL(TREE_SIZE(actual->resources),
+                          TREE_SIZE(tmp_expected->resources));
+    AVS_RBTREE_ELEM(fas_resource_entry_t) resource =
+            FAS_TREE_FIRST(actual->resources);
+    AVS_RBTREE_ELEM(fas_resource_entry_t) expected_resource;
+    while ((expected_resource = FAS_TREE_FIRST(tmp_expected->resources))) {
         assert_resource_equal(resource,
-                              AVS_LIST_DETACH(&tmp_expected->resources));
-        resource = AVS_LIST_NEXT(resource);
+                              AVS_RBTREE_DETACH(tmp_expected->resources,
+                                                expected_resource));
+        resource = AVS_RBTREE_ELEM_NEXT(resource);
     }
 
-    AVS_LIST_DELETE(&tmp_expected);
+    AVS_RBTREE_DELETE(&tmp_expected->resources);
+    AVS_RBTREE_ELEM_DELETE_DETACHED(&tmp_expected);
 }
 
 static void assert_object_equal(fas_object_entry_t *actual,
@@ -215,16 +229,20 @@ static void assert_object_equal(fas_object_entry_t *actual,
         default_attrs = AVS_LIST_NEXT(default_attrs);
     }
 
-    count = AVS_LIST_SIZE(tmp_expected->instances);
-    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(actual->instances), count);
-    AVS_LIST(fas_instance_entry_t) instance = actual->instances;
-    while (count--) {
+    AVS_UNIT_ASSERT_EQUAL(TREE_SIZE(actual->instances),
+                          TREE_SIZE(tmp_expected->instances));
+    AVS_RBTREE_ELEM(fas_instance_entry_t) instance =
+            FAS_TREE_FIRST(actual->instances);
+    AVS_RBTREE_ELEM(fas_instance_entry_t) expected_instance;
+    while ((expected_instance = FAS_TREE_FIRST(tmp_expected->instances))) {
         assert_instance_equal(instance,
-                              AVS_LIST_DETACH(&tmp_expected->instances));
-        instance = AVS_LIST_NEXT(instance);
+                              AVS_RBTREE_DETACH(tmp_expected->instances,
+                                                expected_instance));
+        instance = AVS_RBTREE_ELEM_NEXT(instance);
     }
 
-    AVS_LIST_DELETE(&tmp_expected);
+    AVS_RBTREE_DELETE(&tmp_expected->instances);
+    AVS_RBTREE_ELEM_DELETE_DETACHED(&tmp_expected);
 }
 
 #endif /* ATTR_STORAGE_TEST_H */
@@ -283,9 +283,9 @@ AVS_UNIT_TEST(attr_storage_persistence, restore_one_object) {
             anjay, (avs_stream_abstract_t *) &inbuf));
 
     AVS_UNIT_ASSERT_EQUAL(
-            AVS_LIST_SIZE(_anjay_attr_storage_get(anjay)->objects), 1);
+            TREE_SIZE(_anjay_attr_storage_get(anjay)->objects), 1);
     assert_object_equal(
-            _anjay_attr_storage_get(anjay)->objects,
+            FAS_TREE_FIRST(_anjay_attr_storage_get(anjay)->objects),
             test_object_entry(
                     42, NULL,
                     test_instance_entry(
@@ -346,11 +346,11 @@ AVS_UNIT_TEST(attr_storage_persistence, restore_all_objects) {
             anjay, (avs_stream_abstract_t *) &inbuf));
 
     AVS_UNIT_ASSERT_EQUAL(
-            AVS_LIST_SIZE(_anjay_attr_storage_get(anjay)->objects), 3);
+            TREE_SIZE(_anjay_attr_storage_get(anjay)->objects), 3);
 
     // object 4
     assert_object_equal(
-            _anjay_attr_storage_get(anjay)->objects,
+            FAS_TREE_FIRST(_anjay_attr_storage_get(anjay)->objects),
             test_object_entry(
                     4,
                     test_default_attrlist(
@@ -363,7 +363,8 @@ AVS_UNIT_TEST(attr_storage_persistence, restore_all_objects) {
 
     // object 42
     assert_object_equal(
-            AVS_LIST_NEXT(_anjay_attr_storage_get(anjay)->objects),
+            AVS_RBTREE_ELEM_NEXT(
+                    FAS_TREE_FIRST(_anjay_attr_storage_get(anjay)->objects)),
             test_object_entry(
                     42, NULL,
                     test_instance_entry(
@@ -397,7 +398,8 @@ AVS_UNIT_TEST(attr_storage_persistence, restore_all_objects) {
 
     // object 517
     assert_object_equal(
-            AVS_LIST_NTH(_anjay_attr_storage_get(anjay)->objects, 2),
+            AVS_RBTREE_ELEM_NEXT(AVS_RBTREE_ELEM_NEXT(
+                    FAS_TREE_FIRST(_anjay_attr_storage_get(anjay)->objects))),
             test_object_entry(
                     517, NULL,
                     test_instance_entry(
@@ -755,4 +757,107 @@ AVS_UNIT_TEST(attr_storage_persistence, restore_duplicate_oid) {
     PERSISTENCE_TEST_FINISH;
 }
 
+AVS_UNIT_TEST(attr_storage_persistence, journal_round_trip) {
+    PERSIST_TEST_INIT(1024);
+    INSTALL_FAKE_OBJECT(4, 3);
+    INSTALL_FAKE_OBJECT(42, 3);
+    INSTALL_FAKE_OBJECT(69, 3);
+    write_obj_attrs(anjay, 4, 14,
+                    &(const anjay_dm_internal_attrs_t) {
+                            _ANJAY_DM_CUSTOM_ATTRS_INITIALIZER.standard = {
+                                .min_period = ANJAY_ATTRIB_PERIOD_NONE,
+                                .max_period = 3
+                            } });
+    write_inst_attrs(anjay, 42, 1, 2,
+                     &(const anjay_dm_internal_attrs_t) {
+                             _ANJAY_DM_CUSTOM_ATTRS_INITIALIZER.standard = {
+                                 .min_period = 7,
+                                 .max_period = 13
+                             } });
+    write_res_attrs(anjay, 42, 1, 3, 2,
+                    &(const anjay_dm_internal_res_attrs_t) {
+                            _ANJAY_DM_CUSTOM_ATTRS_INITIALIZER.standard = {
+                                .common = {
+                                    .min_period = 1,
+                                    .max_period = 14
+                                },
+                                .greater_than = ANJAY_ATTRIB_VALUE_NONE,
+                                .less_than = ANJAY_ATTRIB_VALUE_NONE,
+                                .step = ANJAY_ATTRIB_VALUE_NONE
+                            } });
+    write_inst_attrs(anjay, 42, 2, 2,
+                     &(const anjay_dm_internal_attrs_t) {
+                             _ANJAY_DM_CUSTOM_ATTRS_INITIALIZER.standard = {
+                                 .min_period = 5,
+                                 .max_period = 10
+                             } });
+    write_inst_attrs(anjay, 69, 1, 2,
+                     &(const anjay_dm_internal_attrs_t) {
+                             _ANJAY_DM_CUSTOM_ATTRS_INITIALIZER.standard = {
+                                 .min_period = 1,
+                                 .max_period = 2
+                             } });
+    AVS_UNIT_ASSERT_SUCCESS(anjay_attr_storage_journal_compact(
+            anjay, (avs_stream_abstract_t *) &outbuf));
+    const size_t compacted_size = avs_stream_outbuf_offset(&outbuf);
+
+    write_inst_attrs(anjay, 42, 1, 2,
+                     &(const anjay_dm_internal_attrs_t) {
+                             _ANJAY_DM_CUSTOM_ATTRS_INITIALIZER.standard = {
+                                 .min_period = 8,
+                                 .max_period = 16
+                             } });
+    AVS_UNIT_ASSERT_SUCCESS(anjay_attr_storage_journal_append(
+            anjay, (avs_stream_abstract_t *) &outbuf));
+    // only the record for /42/1 (13 bytes of framing and 62 bytes of payload)
+    // is appended, followed by a 13-byte commit record
+    AVS_UNIT_ASSERT_EQUAL(avs_stream_outbuf_offset(&outbuf) - compacted_size,
+                          88);
+
+    // Object 69 is not registered in anjay2, Instance /42/2 and Resource
+    // /42/1/3 are not present there
+    anjay_t *anjay2 = _anjay_test_dm_init(DM_TEST_CONFIGURATION());
+    AVS_UNIT_ASSERT_SUCCESS(anjay_attr_storage_install(anjay2));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_register_object(anjay2, &OBJ4));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_register_object(anjay2, &OBJ42));
+
+    avs_stream_inbuf_t inbuf = AVS_STREAM_INBUF_STATIC_INITIALIZER;
+    avs_stream_inbuf_set_buffer(&inbuf, buf, avs_stream_outbuf_offset(&outbuf));
+    _anjay_mock_dm_expect_instance_it(anjay2, &OBJ4, 0, 0, ANJAY_IID_INVALID);
+    _anjay_mock_dm_expect_instance_it(anjay2, &OBJ42, 0, 0, 1);
+    _anjay_mock_dm_expect_instance_it(anjay2, &OBJ42, 1, 0, ANJAY_IID_INVALID);
+    _anjay_mock_dm_expect_resource_present(anjay2, &OBJ42, 1, 3, 0);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_attr_storage_journal_restore(
+            anjay2, (avs_stream_abstract_t *) &inbuf));
+
+    AVS_UNIT_ASSERT_EQUAL(
+            TREE_SIZE(_anjay_attr_storage_get(anjay2)->objects), 2);
+    assert_object_equal(
+            FAS_TREE_FIRST(_anjay_attr_storage_get(anjay2)->objects),
+            test_object_entry(
+                    4,
+                    test_default_attrlist(
+                            test_default_attrs(14, ANJAY_ATTRIB_PERIOD_NONE, 3,
+                                               ANJAY_DM_CON_ATTR_DEFAULT),
+                            NULL),
+                    NULL));
+    assert_object_equal(
+            AVS_RBTREE_ELEM_NEXT(
+                    FAS_TREE_FIRST(_anjay_attr_storage_get(anjay2)->objects)),
+            test_object_entry(
+                    42, NULL,
+                    test_instance_entry(
+                            1,
+                            test_default_attrlist(
+                                    test_default_attrs(
+                                            2, 8, 16,
+                                            ANJAY_DM_CON_ATTR_DEFAULT),
+                                    NULL),
+                            NULL),
+                    NULL));
+    _anjay_mock_dm_expect_clean();
+    anjay_delete(anjay2);
+    PERSISTENCE_TEST_FINISH;
+}
+
 // TODO: Actually test removing nonexistent IIDs and RIDs
@@ -123,6 +123,72 @@ int anjay_security_object_restore(anjay_t *anjay,
  */
 bool anjay_security_object_is_modified(anjay_t *anjay);
 
+/**
+ * Appends changes made to the Security Object since the journal was last
+ * written to the @p out_stream .
+ *
+ * The journal is an alternative to @ref anjay_security_object_persist suitable
+ * for storage that shall not be rewritten after every change, e.g. flash
+ * memory. Only records for Instances that have been added, modified or removed
+ * are written; if nothing has changed, nothing is written at all.
+ *
+ * @p out_stream MUST be positioned at the end of the journal most recently
+ * created with @ref anjay_security_object_journal_compact or read with
+ * @ref anjay_security_object_journal_restore .
+ *
+ * Note: if this function fails, the journal may contain a partially written
+ * record and it needs to be compacted before anything else can be appended.
+ *
+ * @param anjay         Anjay instance with Security Object installed.
+ * @param out_stream    Stream to append to.
+ * @return 0 in case of success, negative value in case of an error.
+ */
+int anjay_security_object_journal_append(anjay_t *anjay,
+                                         avs_stream_abstract_t *out_stream);
+
+/**
+ * Writes a new journal containing the current state of the Security Object to
+ * the @p out_stream . Subsequent calls to
+ * @ref anjay_security_object_journal_append will append to this journal.
+ *
+ * @p out_stream SHOULD refer to new storage which atomically replaces the old
+ * journal once this function succeeds. If it fails, the old journal is still
+ * valid and can be appended to.
+ *
+ * @param anjay         Anjay instance with Security Object installed.
+ * @param out_stream    Stream to write to.
+ * @return 0 in case of success, negative value in case of an error.
+ */
+int anjay_security_object_journal_compact(anjay_t *anjay,
+                                          avs_stream_abstract_t *out_stream);
+
+/**
+ * Restores Security Object Instances from a journal written with
+ * @ref anjay_security_object_journal_compact and
+ * @ref anjay_security_object_journal_append .
+ *
+ * Changes that were not completely appended to the journal (e.g. because of
+ * a power loss) are ignored. In such case, the journal needs to be compacted,
+ * see @ref anjay_security_object_journal_needs_compaction .
+ *
+ * Note: if restore fails, then Security Object will be left untouched, on
+ * success though all Instances stored within the Object will be purged.
+ *
+ * @param anjay     Anjay instance with Security Object installed.
+ * @param in_stream Stream to read from.
+ * @return 0 in case of success, negative value in case of an error.
+ */
+int anjay_security_object_journal_restore(anjay_t *anjay,
+                                          avs_stream_abstract_t *in_stream);
+
+/**
+ * Checks whether the Security Object journal should be rewritten using
+ * @ref anjay_security_object_journal_compact - either because it contains more
+ * obsolete records than actual data, or because it cannot be appended to (it
+ * has not been created yet, is damaged, or appending to it failed).
+ */
+bool anjay_security_object_journal_needs_compaction(anjay_t *anjay);
+
 /**
  * Installs the Security Object in an Anjay instance.
  *
@@ -153,6 +153,10 @@ static int add_instance(sec_repr_t *repr,
         new_instance->has_ssid = true;
     }
 
+    if (_anjay_sec_transaction_save_instance(repr, new_instance->iid)) {
+        goto error;
+    }
+
     AVS_LIST(sec_instance_t) *ptr;
     AVS_LIST_FOREACH_PTR(ptr, &repr->instances) {
         if ((*ptr)->iid > new_instance->iid) {
@@ -181,10 +185,11 @@ static int del_instance(sec_repr_t *repr, anjay_iid_t iid) {
     AVS_LIST(sec_instance_t) *it;
     AVS_LIST_FOREACH_PTR(it, &repr->instances) {
         if ((*it)->iid == iid) {
-            AVS_LIST(sec_instance_t) element = AVS_LIST_DETACH(it);
-            _anjay_sec_destroy_instances(&element);
-            _anjay_sec_mark_modified(repr);
-            return 0;
+            int retval = _anjay_sec_transaction_remove_instance(repr, it);
+            if (!retval) {
+                _anjay_sec_mark_modified(repr);
+            }
+            return retval;
         }
     }
 
@@ -292,6 +297,9 @@ static int sec_write(anjay_t *anjay,
     int retval;
     assert(inst);
 
+    if ((retval = _anjay_sec_transaction_save_instance(repr, iid))) {
+        return retval;
+    }
     _anjay_sec_mark_modified(repr);
 
     switch ((security_resource_t) rid) {
@@ -383,6 +391,10 @@ static int sec_instance_create(anjay_t *anjay,
     if (*inout_iid == ANJAY_IID_INVALID && assign_iid(repr, inout_iid)) {
         return ANJAY_ERR_INTERNAL;
     }
+    int retval = _anjay_sec_transaction_save_instance(repr, *inout_iid);
+    if (retval) {
+        return retval;
+    }
 
     AVS_LIST(sec_instance_t) created = AVS_LIST_NEW_ELEMENT(sec_instance_t);
     if (!created) {
@@ -441,9 +453,14 @@ static int sec_instance_reset(anjay_t *anjay,
                               const anjay_dm_object_def_t *const *obj_ptr,
                               anjay_iid_t iid) {
     (void) anjay;
-    sec_instance_t *inst = find_instance(_anjay_sec_get(obj_ptr), iid);
+    sec_repr_t *repr = _anjay_sec_get(obj_ptr);
+    sec_instance_t *inst = find_instance(repr, iid);
     assert(inst);
 
+    int retval = _anjay_sec_transaction_save_instance(repr, iid);
+    if (retval) {
+        return retval;
+    }
     _anjay_sec_destroy_instance_fields(inst);
     memset(inst, 0, sizeof(sec_instance_t));
     inst->iid = iid;
@@ -526,12 +543,13 @@ static void security_purge(sec_repr_t *repr) {
         _anjay_sec_mark_modified(repr);
     }
     _anjay_sec_destroy_instances(&repr->instances);
-    _anjay_sec_destroy_instances(&repr->saved_instances);
+    _anjay_sec_transaction_clear_saved(repr);
 }
 
 static void security_delete(anjay_t *anjay, void *repr) {
     (void) anjay;
     security_purge((sec_repr_t *) repr);
+    _anjay_journal_cleanup(&((sec_repr_t *) repr)->journal);
     avs_free(repr);
 }
 
@@ -557,6 +575,14 @@ bool anjay_security_object_is_modified(anjay_t *anjay) {
     return _anjay_sec_get(sec_obj)->modified_since_persist;
 }
 
+bool anjay_security_object_journal_needs_compaction(anjay_t *anjay) {
+    assert(anjay);
+
+    const anjay_dm_object_def_t *const *sec_obj =
+            _anjay_dm_find_object_by_oid(anjay, SECURITY.oid);
+    return _anjay_journal_needs_compaction(&_anjay_sec_get(sec_obj)->journal);
+}
+
 static const anjay_dm_module_t SECURITY_MODULE = {
     .deleter = security_delete
 };
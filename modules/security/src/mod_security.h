@@ -24,6 +24,7 @@
 
 #include <anjay/security.h>
 
+#include <anjay_modules/persistence_journal.h>
 #include <anjay_modules/raw_buffer.h>
 #include <anjay_modules/utils_core.h>
 
@@ -71,12 +72,24 @@ typedef struct {
     bool has_ssid;
 } sec_instance_t;
 
+typedef struct {
+    anjay_iid_t iid;
+    /**
+     * Instance as it was before the current transaction, to be put back on
+     * rollback. NULL if the instance did not exist then.
+     */
+    AVS_LIST(sec_instance_t) instance;
+} sec_saved_instance_t;
+
 typedef struct {
     const anjay_dm_object_def_t *def;
     AVS_LIST(sec_instance_t) instances;
-    AVS_LIST(sec_instance_t) saved_instances;
+    /* instances changed during the current transaction, sorted by IID */
+    AVS_LIST(sec_saved_instance_t) saved_instances;
+    bool in_transaction;
     bool modified_since_persist;
     bool saved_modified_since_persist;
+    anjay_journal_t journal;
 } sec_repr_t;
 
 static inline void _anjay_sec_mark_modified(sec_repr_t *repr) {
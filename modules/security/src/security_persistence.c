@@ -198,6 +198,97 @@ int anjay_security_object_restore(anjay_t *anjay,
     return retval;
 }
 
+static sec_repr_t *get_repr(anjay_t *anjay) {
+    assert(anjay);
+    return _anjay_sec_get(
+            _anjay_dm_find_object_by_oid(anjay, ANJAY_DM_OID_SECURITY));
+}
+
+static int write_journal(anjay_t *anjay,
+                         avs_stream_abstract_t *out_stream,
+                         bool compact) {
+    sec_repr_t *repr = get_repr(anjay);
+    if (!repr) {
+        return -1;
+    }
+    anjay_journal_writer_t writer;
+    int retval = _anjay_journal_writer_init(&writer, &repr->journal,
+                                            out_stream, MAGIC_V1, compact);
+    if (!retval) {
+        AVS_LIST(sec_instance_t) instance;
+        AVS_LIST_FOREACH(instance, repr->instances) {
+            if ((retval = _anjay_journal_writer_put(&writer, instance->iid,
+                                                    handle_instance, instance,
+                                                    (void *) (intptr_t) 1))) {
+                break;
+            }
+        }
+    }
+    if (!(retval = _anjay_journal_writer_finish(&writer, retval))) {
+        _anjay_sec_clear_modified(repr);
+        persistence_log(INFO, "Security Object journal %s",
+                        compact ? "compacted" : "updated");
+    }
+    return retval;
+}
+
+int anjay_security_object_journal_append(anjay_t *anjay,
+                                         avs_stream_abstract_t *out_stream) {
+    return write_journal(anjay, out_stream, false);
+}
+
+int anjay_security_object_journal_compact(anjay_t *anjay,
+                                          avs_stream_abstract_t *out_stream) {
+    return write_journal(anjay, out_stream, true);
+}
+
+static int restore_journal_instance(avs_persistence_context_t *ctx,
+                                    uint32_t key,
+                                    void *tail_ptr_) {
+    AVS_LIST(sec_instance_t) **tail_ptr =
+            (AVS_LIST(sec_instance_t) **) tail_ptr_;
+    AVS_LIST(sec_instance_t) instance = AVS_LIST_NEW_ELEMENT(sec_instance_t);
+    if (!instance) {
+        persistence_log(ERROR, "Out of memory");
+        return -1;
+    }
+    AVS_LIST_INSERT(*tail_ptr, instance);
+    AVS_LIST_ADVANCE_PTR(tail_ptr);
+    int retval = handle_instance(ctx, instance, (void *) (intptr_t) 1);
+    if (!retval && instance->iid != key) {
+        persistence_log(ERROR, "Journal record key mismatch");
+        retval = -1;
+    }
+    return retval;
+}
+
+int anjay_security_object_journal_restore(anjay_t *anjay,
+                                          avs_stream_abstract_t *in_stream) {
+    sec_repr_t *repr = get_repr(anjay);
+    if (!repr) {
+        return -1;
+    }
+    sec_repr_t backup = *repr;
+
+    anjay_journal_t journal = { NULL };
+    AVS_LIST(sec_instance_t) *tail = &repr->instances;
+    repr->instances = NULL;
+    int retval = _anjay_journal_restore(&journal, in_stream, MAGIC_V1,
+                                        restore_journal_instance, &tail);
+    if (retval || (retval = _anjay_sec_object_validate(repr))) {
+        _anjay_sec_destroy_instances(&repr->instances);
+        repr->instances = backup.instances;
+        _anjay_journal_cleanup(&journal);
+    } else {
+        _anjay_sec_destroy_instances(&backup.instances);
+        _anjay_journal_cleanup(&repr->journal);
+        repr->journal = journal;
+        _anjay_sec_clear_modified(repr);
+        persistence_log(INFO, "Security Object state restored from journal");
+    }
+    return retval;
+}
+
 #    ifdef ANJAY_TEST
 #        include "test/persistence.c"
 #    endif
@@ -220,4 +311,28 @@ int anjay_security_object_restore(anjay_t *anjay,
     return -1;
 }
 
+int anjay_security_object_journal_append(anjay_t *anjay,
+                                         avs_stream_abstract_t *out_stream) {
+    (void) anjay;
+    (void) out_stream;
+    persistence_log(ERROR, "Persistence not compiled in");
+    return -1;
+}
+
+int anjay_security_object_journal_compact(anjay_t *anjay,
+                                          avs_stream_abstract_t *out_stream) {
+    (void) anjay;
+    (void) out_stream;
+    persistence_log(ERROR, "Persistence not compiled in");
+    return -1;
+}
+
+int anjay_security_object_journal_restore(anjay_t *anjay,
+                                          avs_stream_abstract_t *in_stream) {
+    (void) anjay;
+    (void) in_stream;
+    persistence_log(ERROR, "Persistence not compiled in");
+    return -1;
+}
+
 #endif // WITH_AVS_PERSISTENCE
@@ -161,18 +161,99 @@ finish:
     return result;
 }
 
-int _anjay_sec_transaction_begin_impl(sec_repr_t *repr) {
-    assert(!repr->saved_instances);
-    repr->saved_instances = _anjay_sec_clone_instances(repr);
-    if (!repr->saved_instances && repr->instances) {
+static AVS_LIST(sec_instance_t) *
+find_instance_ptr(AVS_LIST(sec_instance_t) *instances_ptr, anjay_iid_t iid) {
+    AVS_LIST(sec_instance_t) *ptr;
+    AVS_LIST_FOREACH_PTR(ptr, instances_ptr) {
+        if ((*ptr)->iid >= iid) {
+            break;
+        }
+    }
+    return ptr;
+}
+
+/**
+ * Returns the place where the saved state of Instance @p iid shall be inserted,
+ * or NULL if it does not need to be saved.
+ */
+static AVS_LIST(sec_saved_instance_t) *
+saved_instance_insert_ptr(sec_repr_t *repr, anjay_iid_t iid) {
+    if (!repr->in_transaction) {
+        return NULL;
+    }
+    AVS_LIST(sec_saved_instance_t) *ptr;
+    AVS_LIST_FOREACH_PTR(ptr, &repr->saved_instances) {
+        if ((*ptr)->iid == iid) {
+            return NULL;
+        } else if ((*ptr)->iid > iid) {
+            break;
+        }
+    }
+    return ptr;
+}
+
+int _anjay_sec_transaction_save_instance(sec_repr_t *repr, anjay_iid_t iid) {
+    AVS_LIST(sec_saved_instance_t) *saved_ptr =
+            saved_instance_insert_ptr(repr, iid);
+    if (!saved_ptr) {
+        return 0;
+    }
+    AVS_LIST(sec_saved_instance_t) saved =
+            AVS_LIST_NEW_ELEMENT(sec_saved_instance_t);
+    if (!saved) {
+        security_log(ERROR, "Out of memory");
+        return ANJAY_ERR_INTERNAL;
+    }
+    saved->iid = iid;
+    AVS_LIST(sec_instance_t) *instance_ptr =
+            find_instance_ptr(&repr->instances, iid);
+    if (*instance_ptr && (*instance_ptr)->iid == iid
+            && !(saved->instance = _anjay_sec_clone_instance(*instance_ptr))) {
+        AVS_LIST_DELETE(&saved);
+        return ANJAY_ERR_INTERNAL;
+    }
+    AVS_LIST_INSERT(saved_ptr, saved);
+    return 0;
+}
+
+int _anjay_sec_transaction_remove_instance(
+        sec_repr_t *repr, AVS_LIST(sec_instance_t) *instance_ptr) {
+    AVS_LIST(sec_saved_instance_t) *saved_ptr =
+            saved_instance_insert_ptr(repr, (*instance_ptr)->iid);
+    if (!saved_ptr) {
+        AVS_LIST(sec_instance_t) instance = AVS_LIST_DETACH(instance_ptr);
+        _anjay_sec_destroy_instances(&instance);
+        return 0;
+    }
+    AVS_LIST(sec_saved_instance_t) saved =
+            AVS_LIST_NEW_ELEMENT(sec_saved_instance_t);
+    if (!saved) {
+        security_log(ERROR, "Out of memory");
         return ANJAY_ERR_INTERNAL;
     }
+    saved->iid = (*instance_ptr)->iid;
+    saved->instance = AVS_LIST_DETACH(instance_ptr);
+    AVS_LIST_INSERT(saved_ptr, saved);
+    return 0;
+}
+
+void _anjay_sec_transaction_clear_saved(sec_repr_t *repr) {
+    AVS_LIST_CLEAR(&repr->saved_instances) {
+        _anjay_sec_destroy_instances(&repr->saved_instances->instance);
+    }
+}
+
+int _anjay_sec_transaction_begin_impl(sec_repr_t *repr) {
+    assert(!repr->in_transaction);
+    assert(!repr->saved_instances);
+    repr->in_transaction = true;
     repr->saved_modified_since_persist = repr->modified_since_persist;
     return 0;
 }
 
 int _anjay_sec_transaction_commit_impl(sec_repr_t *repr) {
-    _anjay_sec_destroy_instances(&repr->saved_instances);
+    _anjay_sec_transaction_clear_saved(repr);
+    repr->in_transaction = false;
     return 0;
 }
 
@@ -181,9 +262,21 @@ int _anjay_sec_transaction_validate_impl(sec_repr_t *repr) {
 }
 
 int _anjay_sec_transaction_rollback_impl(sec_repr_t *repr) {
-    _anjay_sec_destroy_instances(&repr->instances);
-    repr->instances = repr->saved_instances;
-    repr->saved_instances = NULL;
+    /* both lists are sorted by IID, so they can be merged in a single pass */
+    AVS_LIST(sec_instance_t) *instance_ptr = &repr->instances;
+    AVS_LIST_CLEAR(&repr->saved_instances) {
+        sec_saved_instance_t *saved = repr->saved_instances;
+        instance_ptr = find_instance_ptr(instance_ptr, saved->iid);
+        if (*instance_ptr && (*instance_ptr)->iid == saved->iid) {
+            AVS_LIST(sec_instance_t) changed = AVS_LIST_DETACH(instance_ptr);
+            _anjay_sec_destroy_instances(&changed);
+        }
+        if (saved->instance) {
+            AVS_LIST_INSERT(instance_ptr, saved->instance);
+            saved->instance = NULL;
+        }
+    }
+    repr->in_transaction = false;
     repr->modified_since_persist = repr->saved_modified_since_persist;
     return 0;
 }
@@ -29,6 +29,30 @@ int _anjay_sec_transaction_commit_impl(sec_repr_t *repr);
 int _anjay_sec_transaction_validate_impl(sec_repr_t *repr);
 int _anjay_sec_transaction_rollback_impl(sec_repr_t *repr);
 
+/**
+ * Saves the state of Instance @p iid so that it can be restored on rollback.
+ * Shall be called before the Instance is created or modified in place.
+ *
+ * Does nothing outside of a transaction, or if the Instance has already been
+ * saved during the current one - so only Instances that are actually changed
+ * are ever copied.
+ */
+int _anjay_sec_transaction_save_instance(sec_repr_t *repr, anjay_iid_t iid);
+
+/**
+ * Detaches the Instance pointed to by @p instance_ptr from the list. If it has
+ * not been saved during the current transaction, it is moved to the saved
+ * Instances without copying; otherwise it is freed.
+ */
+int _anjay_sec_transaction_remove_instance(
+        sec_repr_t *repr, AVS_LIST(sec_instance_t) *instance_ptr);
+
+/**
+ * Frees all saved Instances. Changes made so far during the current
+ * transaction can no longer be rolled back afterwards.
+ */
+void _anjay_sec_transaction_clear_saved(sec_repr_t *repr);
+
 VISIBILITY_PRIVATE_HEADER_END
 
 #endif /* SECURITY_TRANSACTION_H */
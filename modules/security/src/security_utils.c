@@ -115,8 +115,8 @@ void _anjay_sec_destroy_instances(AVS_LIST(sec_instance_t) *instances_ptr) {
     }
 }
 
-static int _anjay_sec_clone_instance(sec_instance_t *dest,
-                                     const sec_instance_t *src) {
+static int clone_instance_fields(sec_instance_t *dest,
+                                 const sec_instance_t *src) {
     *dest = *src;
     dest->public_cert_or_psk_identity = ANJAY_RAW_BUFFER_EMPTY;
     dest->private_cert_or_psk_key = ANJAY_RAW_BUFFER_EMPTY;
@@ -164,6 +164,18 @@ static int _anjay_sec_clone_instance(sec_instance_t *dest,
     return 0;
 }
 
+AVS_LIST(sec_instance_t) _anjay_sec_clone_instance(const sec_instance_t *src) {
+    AVS_LIST(sec_instance_t) retval = AVS_LIST_NEW_ELEMENT(sec_instance_t);
+    if (!retval) {
+        security_log(ERROR, "Out of memory");
+        return NULL;
+    }
+    if (clone_instance_fields(retval, src)) {
+        _anjay_sec_destroy_instances(&retval);
+    }
+    return retval;
+}
+
 AVS_LIST(sec_instance_t) _anjay_sec_clone_instances(const sec_repr_t *repr) {
     AVS_LIST(sec_instance_t) retval = NULL;
     AVS_LIST(sec_instance_t) current;
@@ -172,7 +184,7 @@ AVS_LIST(sec_instance_t) _anjay_sec_clone_instances(const sec_repr_t *repr) {
 
     AVS_LIST_FOREACH(current, repr->instances) {
         if (AVS_LIST_INSERT_NEW(sec_instance_t, last)) {
-            if (_anjay_sec_clone_instance(*last, current)) {
+            if (clone_instance_fields(*last, current)) {
                 security_log(ERROR, "Cannot clone Security Object Instances");
                 _anjay_sec_destroy_instances(&retval);
                 return NULL;
@@ -65,6 +65,12 @@ void _anjay_sec_destroy_instance_fields(sec_instance_t *instance);
  */
 void _anjay_sec_destroy_instances(AVS_LIST(sec_instance_t) *instances_ptr);
 
+/**
+ * Creates a deep copy of a single Security Object instance @p src . Returns
+ * NULL if an error has occurred.
+ */
+AVS_LIST(sec_instance_t) _anjay_sec_clone_instance(const sec_instance_t *src);
+
 /**
  * Clones all instances of the given Security Object @p repr . Return NULL
  * if either there was nothing to clone or an error has occurred.
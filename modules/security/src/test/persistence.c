@@ -239,3 +239,38 @@ AVS_UNIT_TEST(security_persistence, modification_flag_purge) {
     anjay_security_object_purge(env->anjay_stored);
     AVS_UNIT_ASSERT_TRUE(anjay_security_object_is_modified(env->anjay_stored));
 }
+
+AVS_UNIT_TEST(security_persistence, journal_store_restore) {
+    SCOPED_SECURITY_PERSISTENCE_TEST_ENV(env);
+    AVS_UNIT_ASSERT_TRUE(
+            anjay_security_object_journal_needs_compaction(env->anjay_stored));
+    AVS_UNIT_ASSERT_FAILED(anjay_security_object_journal_append(
+            env->anjay_stored, env->stream));
+
+    anjay_iid_t iid = ANJAY_IID_INVALID;
+    AVS_UNIT_ASSERT_SUCCESS(anjay_security_object_add_instance(
+            env->anjay_stored, &BOOTSTRAP_INSTANCE, &iid));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_security_object_journal_compact(
+            env->anjay_stored, env->stream));
+    AVS_UNIT_ASSERT_FALSE(anjay_security_object_is_modified(env->anjay_stored));
+    AVS_UNIT_ASSERT_FALSE(
+            anjay_security_object_journal_needs_compaction(env->anjay_stored));
+
+    const anjay_security_instance_t server_instance = {
+        .ssid = 1,
+        .server_uri = "coap://some.server",
+        .security_mode = ANJAY_UDP_SECURITY_NOSEC
+    };
+    iid = ANJAY_IID_INVALID;
+    AVS_UNIT_ASSERT_SUCCESS(anjay_security_object_add_instance(
+            env->anjay_stored, &server_instance, &iid));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_security_object_journal_append(
+            env->anjay_stored, env->stream));
+    AVS_UNIT_ASSERT_FALSE(anjay_security_object_is_modified(env->anjay_stored));
+
+    AVS_UNIT_ASSERT_SUCCESS(anjay_security_object_journal_restore(
+            env->anjay_restored, env->stream));
+    assert_objects_equal(env->stored_repr, env->restored_repr);
+    AVS_UNIT_ASSERT_FALSE(anjay_security_object_journal_needs_compaction(
+            env->anjay_restored));
+}
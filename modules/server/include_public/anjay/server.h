@@ -104,6 +104,60 @@ int anjay_server_object_restore(anjay_t *anjay,
  */
 bool anjay_server_object_is_modified(anjay_t *anjay);
 
+/**
+ * Appends changes made to the Server Object since the journal was last written
+ * to the @p out_stream .
+ *
+ * Only records for Instances that have been added, modified or removed are
+ * written; if nothing has changed, nothing is written at all. The journal
+ * format is shared with the Security, Access Control and Attribute Storage
+ * modules.
+ *
+ * @p out_stream MUST be positioned at the end of the journal most recently
+ * created with @ref anjay_server_object_journal_compact or read with
+ * @ref anjay_server_object_journal_restore .
+ *
+ * Note: if this function fails, the journal needs to be compacted before
+ * anything else can be appended.
+ *
+ * @param anjay         Anjay instance with Server Object installed.
+ * @param out_stream    Stream to append to.
+ * @return 0 in case of success, negative value in case of an error.
+ */
+int anjay_server_object_journal_append(anjay_t *anjay,
+                                       avs_stream_abstract_t *out_stream);
+
+/**
+ * Writes a new journal containing the current state of the Server Object to the
+ * @p out_stream . If this function fails, the old journal is still valid.
+ *
+ * @param anjay         Anjay instance with Server Object installed.
+ * @param out_stream    Stream to write to.
+ * @return 0 in case of success, negative value in case of an error.
+ */
+int anjay_server_object_journal_compact(anjay_t *anjay,
+                                        avs_stream_abstract_t *out_stream);
+
+/**
+ * Restores Server Object Instances from a journal. Changes that were not
+ * completely appended to the journal are ignored.
+ *
+ * Note: if restore fails, then Server Object will be left untouched, on
+ * success though all Instances stored within the Object will be purged.
+ *
+ * @param anjay     Anjay instance with Server Object installed.
+ * @param in_stream Stream to read from.
+ * @return 0 in case of success, negative value in case of an error.
+ */
+int anjay_server_object_journal_restore(anjay_t *anjay,
+                                        avs_stream_abstract_t *in_stream);
+
+/**
+ * Checks whether the Server Object journal should be rewritten using
+ * @ref anjay_server_object_journal_compact .
+ */
+bool anjay_server_object_journal_needs_compaction(anjay_t *anjay);
+
 /**
  * Installs the Server Object in an Anjay instance.
  *
@@ -112,7 +112,8 @@ static int add_instance(server_repr_t *repr,
     new_instance->has_ssid = true;
     new_instance->has_lifetime = true;
     new_instance->has_notification_storing = true;
-    if (insert_created_instance(repr, new_instance)) {
+    if (_anjay_serv_transaction_save_instance(repr, new_instance->iid)
+            || insert_created_instance(repr, new_instance)) {
         AVS_LIST_CLEAR(&new_instance);
         return -1;
     }
@@ -125,9 +126,11 @@ static int del_instance(server_repr_t *repr, anjay_iid_t iid) {
     AVS_LIST(server_instance_t) *it;
     AVS_LIST_FOREACH_PTR(it, &repr->instances) {
         if ((*it)->iid == iid) {
-            AVS_LIST_DELETE(it);
-            _anjay_serv_mark_modified(repr);
-            return 0;
+            int retval = _anjay_serv_transaction_remove_instance(repr, it);
+            if (!retval) {
+                _anjay_serv_mark_modified(repr);
+            }
+            return retval;
         } else if ((*it)->iid > iid) {
             break;
         }
@@ -186,6 +189,10 @@ static int serv_instance_create(anjay_t *anjay,
         server_log(ERROR, "Cannot assign new Instance id");
         return ANJAY_ERR_INTERNAL;
     }
+    int retval = _anjay_serv_transaction_save_instance(repr, *inout_iid);
+    if (retval) {
+        return retval;
+    }
     AVS_LIST(server_instance_t) created =
             AVS_LIST_NEW_ELEMENT(server_instance_t);
     if (!created) {
@@ -212,9 +219,14 @@ static int serv_instance_reset(anjay_t *anjay,
                                const anjay_dm_object_def_t *const *obj_ptr,
                                anjay_iid_t iid) {
     (void) anjay;
-    server_instance_t *inst = find_instance(_anjay_serv_get(obj_ptr), iid);
+    server_repr_t *repr = _anjay_serv_get(obj_ptr);
+    server_instance_t *inst = find_instance(repr, iid);
     assert(inst);
 
+    int retval = _anjay_serv_transaction_save_instance(repr, iid);
+    if (retval) {
+        return retval;
+    }
     bool has_ssid = inst->has_ssid;
     anjay_ssid_t ssid = inst->data.ssid;
     reset_instance_resources(inst);
@@ -329,6 +341,9 @@ static int serv_write(anjay_t *anjay,
     assert(inst);
     int retval;
 
+    if ((retval = _anjay_serv_transaction_save_instance(repr, iid))) {
+        return retval;
+    }
     _anjay_serv_mark_modified(repr);
 
     switch ((server_rid_t) rid) {
@@ -508,12 +523,13 @@ static void server_purge(server_repr_t *repr) {
         _anjay_serv_mark_modified(repr);
     }
     _anjay_serv_destroy_instances(&repr->instances);
-    _anjay_serv_destroy_instances(&repr->saved_instances);
+    _anjay_serv_transaction_clear_saved(repr);
 }
 
 static void server_delete(anjay_t *anjay, void *repr) {
     (void) anjay;
     server_purge((server_repr_t *) repr);
+    _anjay_journal_cleanup(&((server_repr_t *) repr)->journal);
     avs_free(repr);
 }
 
@@ -539,6 +555,15 @@ bool anjay_server_object_is_modified(anjay_t *anjay) {
     return _anjay_serv_get(server_obj)->modified_since_persist;
 }
 
+bool anjay_server_object_journal_needs_compaction(anjay_t *anjay) {
+    assert(anjay);
+
+    const anjay_dm_object_def_t *const *server_obj =
+            _anjay_dm_find_object_by_oid(anjay, SERVER.oid);
+    return _anjay_journal_needs_compaction(
+            &_anjay_serv_get(server_obj)->journal);
+}
+
 static const anjay_dm_module_t SERVER_MODULE = {
     .deleter = server_delete
 };
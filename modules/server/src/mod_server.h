@@ -21,6 +21,7 @@
 #include <anjay/core.h>
 #include <anjay/server.h>
 
+#include <anjay_modules/persistence_journal.h>
 #include <anjay_modules/utils_core.h>
 
 VISIBILITY_PRIVATE_HEADER_BEGIN
@@ -47,12 +48,24 @@ typedef struct {
     bool has_notification_storing;
 } server_instance_t;
 
+typedef struct {
+    anjay_iid_t iid;
+    /**
+     * Instance as it was before the current transaction, to be put back on
+     * rollback. NULL if the instance did not exist then.
+     */
+    AVS_LIST(server_instance_t) instance;
+} server_saved_instance_t;
+
 typedef struct {
     const anjay_dm_object_def_t *def;
     AVS_LIST(server_instance_t) instances;
-    AVS_LIST(server_instance_t) saved_instances;
+    /* instances changed during the current transaction, sorted by IID */
+    AVS_LIST(server_saved_instance_t) saved_instances;
+    bool in_transaction;
     bool modified_since_persist;
     bool saved_modified_since_persist;
+    anjay_journal_t journal;
 } server_repr_t;
 
 static inline void _anjay_serv_mark_modified(server_repr_t *repr) {
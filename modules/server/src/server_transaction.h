@@ -29,6 +29,28 @@ int _anjay_serv_transaction_commit_impl(server_repr_t *repr);
 int _anjay_serv_transaction_validate_impl(server_repr_t *repr);
 int _anjay_serv_transaction_rollback_impl(server_repr_t *repr);
 
+/**
+ * Saves the state of Instance @p iid so that it can be restored on rollback.
+ * Shall be called before the Instance is created or modified in place. Does
+ * nothing outside of a transaction, or if the Instance has already been saved
+ * during the current one.
+ */
+int _anjay_serv_transaction_save_instance(server_repr_t *repr,
+                                          anjay_iid_t iid);
+
+/**
+ * Detaches the Instance pointed to by @p instance_ptr from the list, and
+ * either moves it to the saved Instances or frees it.
+ */
+int _anjay_serv_transaction_remove_instance(
+        server_repr_t *repr, AVS_LIST(server_instance_t) *instance_ptr);
+
+/**
+ * Frees all saved Instances, so that the changes made so far during the
+ * current transaction can no longer be rolled back.
+ */
+void _anjay_serv_transaction_clear_saved(server_repr_t *repr);
+
 VISIBILITY_PRIVATE_HEADER_END
 
 #endif /* SERVER_TRANSACTION_H */
@@ -51,8 +51,18 @@ int _anjay_serv_fetch_binding(anjay_input_ctx_t *ctx,
 }
 
 AVS_LIST(server_instance_t)
-_anjay_serv_clone_instances(const server_repr_t *repr) {
-    return AVS_LIST_SIMPLE_CLONE(repr->instances);
+_anjay_serv_clone_instance(const server_instance_t *src) {
+    AVS_LIST(server_instance_t) retval =
+            AVS_LIST_NEW_ELEMENT(server_instance_t);
+    if (!retval) {
+        server_log(ERROR, "Out of memory");
+        return NULL;
+    }
+    *retval = *src;
+    if (src->data.binding) {
+        retval->data.binding = retval->binding_buf;
+    }
+    return retval;
 }
 
 void _anjay_serv_destroy_instances(AVS_LIST(server_instance_t) *instances) {
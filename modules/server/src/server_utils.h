@@ -39,7 +39,7 @@ int _anjay_serv_fetch_binding(anjay_input_ctx_t *ctx,
                               anjay_binding_mode_t *out_binding);
 
 AVS_LIST(server_instance_t)
-_anjay_serv_clone_instances(const server_repr_t *repr);
+_anjay_serv_clone_instance(const server_instance_t *src);
 void _anjay_serv_destroy_instances(AVS_LIST(server_instance_t) *instances);
 
 VISIBILITY_PRIVATE_HEADER_END
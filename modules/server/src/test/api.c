@@ -87,3 +87,66 @@ AVS_UNIT_TEST(server_object_api, add_instances_with_duplicated_ssids) {
     AVS_UNIT_ASSERT_FAILED(
             anjay_server_object_add_instance(env->anjay, &instance2, &iid));
 }
+
+AVS_UNIT_TEST(server_object_api, transaction_rollback) {
+    SCOPED_SERVER_TEST_ENV(env);
+    anjay_iid_t iid = 1;
+    AVS_UNIT_ASSERT_SUCCESS(
+            anjay_server_object_add_instance(env->anjay, &instance1, &iid));
+    iid = 2;
+    AVS_UNIT_ASSERT_SUCCESS(
+            anjay_server_object_add_instance(env->anjay, &instance2, &iid));
+
+    const anjay_dm_object_def_t *const *obj_ptr =
+            _anjay_dm_find_object_by_oid(env->anjay, ANJAY_DM_OID_SERVER);
+    server_repr_t *repr = _anjay_serv_get(obj_ptr);
+    server_instance_t *removed = AVS_LIST_NEXT(repr->instances);
+
+    AVS_UNIT_ASSERT_SUCCESS(serv_transaction_begin(env->anjay, obj_ptr));
+    AVS_UNIT_ASSERT_NULL(repr->saved_instances);
+
+    // each changed instance is saved only once
+    AVS_UNIT_ASSERT_SUCCESS(serv_instance_reset(env->anjay, obj_ptr, 1));
+    AVS_UNIT_ASSERT_SUCCESS(serv_instance_reset(env->anjay, obj_ptr, 1));
+    iid = 7;
+    AVS_UNIT_ASSERT_SUCCESS(
+            serv_instance_create(env->anjay, obj_ptr, &iid, 0));
+    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(repr->saved_instances), 2);
+
+    // removed instances are saved without copying
+    AVS_UNIT_ASSERT_SUCCESS(serv_instance_remove(env->anjay, obj_ptr, 2));
+    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(repr->saved_instances), 3);
+    server_saved_instance_t *saved = AVS_LIST_NEXT(repr->saved_instances);
+    AVS_UNIT_ASSERT_EQUAL(saved->iid, 2);
+    AVS_UNIT_ASSERT_TRUE(saved->instance == removed);
+
+    AVS_UNIT_ASSERT_SUCCESS(serv_transaction_rollback(env->anjay, obj_ptr));
+    AVS_UNIT_ASSERT_NULL(repr->saved_instances);
+    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(repr->instances), 2);
+    AVS_UNIT_ASSERT_EQUAL(repr->instances->iid, 1);
+    AVS_UNIT_ASSERT_EQUAL(repr->instances->data.lifetime, instance1.lifetime);
+    // the restored copy must not refer to the binding of the reset instance
+    AVS_UNIT_ASSERT_TRUE(repr->instances->data.binding
+                         == repr->instances->binding_buf);
+    AVS_UNIT_ASSERT_EQUAL_STRING(repr->instances->data.binding,
+                                 instance1.binding);
+    AVS_UNIT_ASSERT_TRUE(AVS_LIST_NEXT(repr->instances) == removed);
+}
+
+AVS_UNIT_TEST(server_object_api, transaction_commit) {
+    SCOPED_SERVER_TEST_ENV(env);
+    anjay_iid_t iid = 1;
+    AVS_UNIT_ASSERT_SUCCESS(
+            anjay_server_object_add_instance(env->anjay, &instance1, &iid));
+
+    const anjay_dm_object_def_t *const *obj_ptr =
+            _anjay_dm_find_object_by_oid(env->anjay, ANJAY_DM_OID_SERVER);
+    server_repr_t *repr = _anjay_serv_get(obj_ptr);
+
+    AVS_UNIT_ASSERT_SUCCESS(serv_transaction_begin(env->anjay, obj_ptr));
+    AVS_UNIT_ASSERT_SUCCESS(serv_instance_remove(env->anjay, obj_ptr, 1));
+    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(repr->saved_instances), 1);
+    AVS_UNIT_ASSERT_SUCCESS(serv_transaction_commit(env->anjay, obj_ptr));
+    AVS_UNIT_ASSERT_NULL(repr->saved_instances);
+    AVS_UNIT_ASSERT_NULL(repr->instances);
+}
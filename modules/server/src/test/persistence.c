@@ -192,3 +192,44 @@ AVS_UNIT_TEST(server_persistence, modification_flag_purge) {
     anjay_server_object_purge(env->anjay_stored);
     AVS_UNIT_ASSERT_TRUE(anjay_server_object_is_modified(env->anjay_stored));
 }
+
+AVS_UNIT_TEST(server_persistence, journal_store_restore) {
+    SCOPED_SERVER_PERSISTENCE_TEST_ENV(env);
+    AVS_UNIT_ASSERT_TRUE(
+            anjay_server_object_journal_needs_compaction(env->anjay_stored));
+    AVS_UNIT_ASSERT_FAILED(
+            anjay_server_object_journal_append(env->anjay_stored, env->stream));
+
+    const anjay_server_instance_t instance = {
+        .ssid = 42,
+        .lifetime = 9001,
+        .default_min_period = -1,
+        .default_max_period = -1,
+        .disable_timeout = -1,
+        .binding = "U",
+        .notification_storing = true
+    };
+    anjay_iid_t iid = 1;
+    AVS_UNIT_ASSERT_SUCCESS(anjay_server_object_add_instance(
+            env->anjay_stored, &instance, &iid));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_server_object_journal_compact(
+            env->anjay_stored, env->stream));
+    AVS_UNIT_ASSERT_FALSE(anjay_server_object_is_modified(env->anjay_stored));
+    AVS_UNIT_ASSERT_FALSE(
+            anjay_server_object_journal_needs_compaction(env->anjay_stored));
+
+    env->stored_repr->instances->data.lifetime = 86400;
+    _anjay_serv_mark_modified(env->stored_repr);
+    AVS_UNIT_ASSERT_SUCCESS(
+            anjay_server_object_journal_append(env->anjay_stored, env->stream));
+    AVS_UNIT_ASSERT_FALSE(anjay_server_object_is_modified(env->anjay_stored));
+
+    AVS_UNIT_ASSERT_SUCCESS(anjay_server_object_journal_restore(
+            env->anjay_restored, env->stream));
+    AVS_UNIT_ASSERT_EQUAL(1, AVS_LIST_SIZE(env->restored_repr->instances));
+    assert_instances_equal(env->stored_repr->instances,
+                           env->restored_repr->instances);
+    AVS_UNIT_ASSERT_EQUAL(env->restored_repr->instances->data.lifetime, 86400);
+    AVS_UNIT_ASSERT_FALSE(
+            anjay_server_object_journal_needs_compaction(env->anjay_restored));
+}
@@ -16,6 +16,8 @@
 
 #include <anjay_config.h>
 
+#include <avsystem/commons/memory.h>
+
 #include <anjay_modules/raw_buffer.h>
 
 #include "access_utils.h"
@@ -75,36 +77,75 @@ static int read_resources(anjay_t *anjay,
     return 0;
 }
 
-static int get_mask_from_ctx(anjay_input_ctx_t *ctx,
-                             anjay_ssid_t *inout_ssid,
-                             anjay_access_mask_t *out_mask) {
-    anjay_input_ctx_t *array_ctx = anjay_get_array(ctx);
-    if (!array_ctx) {
-        return -1;
-    }
-
+static void get_mask_from_acl(const anjay_riid_t *acl_ssids,
+                              const int64_t *acl_masks,
+                              size_t acl_size,
+                              anjay_ssid_t *inout_ssid,
+                              anjay_access_mask_t *out_mask) {
     anjay_ssid_t ssid_lookup = *inout_ssid;
-    int32_t num_iterations = 0;
-    int result = 0;
-    uint16_t current_ssid;
-    int32_t current_mask;
     *out_mask = ANJAY_ACCESS_MASK_NONE;
-    while (!(result = anjay_get_array_index(array_ctx, &current_ssid))
-           && !(result = anjay_get_i32(array_ctx, &current_mask))) {
-        if (current_ssid == ssid_lookup || current_ssid == 0) {
+    for (size_t i = 0; i < acl_size; ++i) {
+        if (acl_ssids[i] == ssid_lookup || acl_ssids[i] == 0) {
             // Found an entry for the given ssid or the default ACL entry
-            *inout_ssid = current_ssid;
-            *out_mask = (anjay_access_mask_t) current_mask;
-            if (current_ssid) {
+            *inout_ssid = acl_ssids[i];
+            *out_mask = (anjay_access_mask_t) acl_masks[i];
+            if (acl_ssids[i]) {
                 // not the default
-                return 0;
+                return;
             }
         }
-        ++num_iterations;
     }
     // use the invalid SSID as a result if the ACL is empty
-    *inout_ssid = (num_iterations ? 0 : UINT16_MAX);
-    return result == ANJAY_GET_INDEX_END ? 0 : result;
+    *inout_ssid = (acl_size ? 0 : UINT16_MAX);
+}
+
+// number of ACL entries that may be read without allocating memory
+#define ACL_STATIC_CAPACITY 16
+
+static int read_acl(anjay_t *anjay,
+                    anjay_iid_t ac_iid,
+                    anjay_ssid_t *inout_ssid,
+                    anjay_access_mask_t *out_mask) {
+    const anjay_uri_path_t path =
+            MAKE_RESOURCE_PATH(ANJAY_DM_OID_ACCESS_CONTROL,
+                               (anjay_iid_t) ac_iid,
+                               ANJAY_DM_RID_ACCESS_CONTROL_ACL);
+
+    anjay_riid_t static_ssids[ACL_STATIC_CAPACITY];
+    int64_t static_masks[ACL_STATIC_CAPACITY];
+    anjay_riid_t *acl_ssids = static_ssids;
+    int64_t *acl_masks = static_masks;
+    size_t acl_size;
+    int result = _anjay_dm_res_read_i64_array(anjay, &path, acl_ssids,
+                                              acl_masks, ACL_STATIC_CAPACITY,
+                                              &acl_size);
+    if (!result && acl_size > ACL_STATIC_CAPACITY) {
+        // unusually large ACL, read it again into heap-allocated arrays
+        const size_t capacity = acl_size;
+        if (!(acl_ssids = (anjay_riid_t *) avs_malloc(capacity
+                                                      * sizeof(*acl_ssids)))
+                || !(acl_masks = (int64_t *) avs_malloc(
+                             capacity * sizeof(*acl_masks)))) {
+            anjay_log(ERROR, "Out of memory");
+            result = -1;
+        } else if (!(result = _anjay_dm_res_read_i64_array(
+                             anjay, &path, acl_ssids, acl_masks, capacity,
+                             &acl_size))
+                   && acl_size > capacity) {
+            result = -1;
+        }
+    }
+    if (!result) {
+        get_mask_from_acl(acl_ssids, acl_masks, acl_size, inout_ssid,
+                          out_mask);
+    }
+    if (acl_ssids != static_ssids) {
+        avs_free(acl_ssids);
+    }
+    if (acl_masks != static_masks) {
+        avs_free(acl_masks);
+    }
+    return result;
 }
 
 static int get_mask(anjay_t *anjay,
@@ -125,21 +166,9 @@ static int get_mask(anjay_t *anjay,
         return ANJAY_FOREACH_CONTINUE;
     }
 
-    const anjay_uri_path_t path =
-            MAKE_RESOURCE_PATH(ANJAY_DM_OID_ACCESS_CONTROL,
-                               (anjay_iid_t) ac_iid,
-                               ANJAY_DM_RID_ACCESS_CONTROL_ACL);
-
-    anjay_input_ctx_t *ctx = _anjay_dm_read_as_input_ctx(anjay, &path);
-    if (!ctx) {
-        return -1;
-    }
-
     anjay_ssid_t found_ssid = data->ssid;
     anjay_access_mask_t mask;
-    int result = get_mask_from_ctx(ctx, &found_ssid, &mask);
-    _anjay_input_ctx_destroy(&ctx);
-
+    int result = read_acl(anjay, ac_iid, &found_ssid, &mask);
     if (result) {
         anjay_log(ERROR, "failed to read ACL!");
         return result;
@@ -163,6 +192,19 @@ static int get_mask(anjay_t *anjay,
     return ANJAY_FOREACH_CONTINUE;
 }
 
+static int get_mask_from_modules(anjay_t *anjay, get_mask_data_t *data) {
+    AVS_LIST(anjay_dm_installed_module_t) module;
+    AVS_LIST_FOREACH(module, anjay->dm.modules) {
+        if (module->def->get_access_mask
+                && !module->def->get_access_mask(anjay, module->arg, data->oid,
+                                                 data->oiid, data->ssid,
+                                                 &data->result)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
 static anjay_access_mask_t
 access_control_mask(anjay_t *anjay, const anjay_action_info_t *info) {
     get_mask_data_t data = {
@@ -172,6 +214,9 @@ access_control_mask(anjay_t *anjay, const anjay_action_info_t *info) {
         .result = ANJAY_ACCESS_MASK_NONE
     };
 
+    if (!get_mask_from_modules(anjay, &data)) {
+        return data.result;
+    }
     const anjay_dm_object_def_t *const *obj =
             _anjay_dm_find_object_by_oid(anjay, ANJAY_DM_OID_ACCESS_CONTROL);
     if (_anjay_dm_foreach_instance(anjay, obj, get_mask, &data)) {
@@ -188,14 +233,35 @@ static bool can_instantiate(anjay_t *anjay, const anjay_action_info_t *info) {
         .result = ANJAY_ACCESS_MASK_NONE
     };
 
-    const anjay_dm_object_def_t *const *obj =
-            _anjay_dm_find_object_by_oid(anjay, ANJAY_DM_OID_ACCESS_CONTROL);
-    if (_anjay_dm_foreach_instance(anjay, obj, get_mask, &data)) {
-        return false;
+    if (get_mask_from_modules(anjay, &data)) {
+        const anjay_dm_object_def_t *const *obj = _anjay_dm_find_object_by_oid(
+                anjay, ANJAY_DM_OID_ACCESS_CONTROL);
+        if (_anjay_dm_foreach_instance(anjay, obj, get_mask, &data)) {
+            return false;
+        }
     }
     return data.result & ANJAY_ACCESS_MASK_CREATE;
 }
 
+static int
+read_owner(anjay_t *anjay, anjay_iid_t ac_iid, anjay_ssid_t *out_owner) {
+    AVS_LIST(anjay_dm_installed_module_t) module;
+    AVS_LIST_FOREACH(module, anjay->dm.modules) {
+        if (module->def->get_access_owner
+                && !module->def->get_access_owner(anjay, module->arg, ac_iid,
+                                                  out_owner)) {
+            return 0;
+        }
+    }
+    uint32_t owner;
+    int result = read_u32(anjay, ac_iid, ANJAY_DM_RID_ACCESS_CONTROL_OWNER,
+                          &owner);
+    if (!result) {
+        *out_owner = (anjay_ssid_t) owner;
+    }
+    return result;
+}
+
 typedef struct {
     anjay_oid_t oid;
     anjay_iid_t iid;
@@ -246,12 +312,11 @@ bool _anjay_instance_action_allowed(anjay_t *anjay,
                    || info->action == ANJAY_ACTION_DELETE) {
             return false;
         }
-        uint32_t owner;
-        if (read_u32(anjay, info->iid, ANJAY_DM_RID_ACCESS_CONTROL_OWNER,
-                     &owner)) {
+        anjay_ssid_t owner;
+        if (read_owner(anjay, info->iid, &owner)) {
             return false;
         }
-        return (anjay_ssid_t) owner == info->ssid;
+        return owner == info->ssid;
     }
 
     if (info->action == ANJAY_ACTION_CREATE) {
@@ -50,6 +50,25 @@
 
 VISIBILITY_SOURCE_BEGIN
 
+static int handle_exchange_response(anjay_t *anjay,
+                                    const avs_coap_msg_t *msg) {
+    const anjay_connection_key_t key = {
+        .ssid = _anjay_dm_current_ssid(anjay),
+        .type = anjay->current_connection.conn_type
+    };
+    return _anjay_exchange_handle_response(anjay, key, msg);
+}
+
+static void handle_unmatched_response(const avs_coap_msg_t *msg,
+                                      void *anjay) {
+    // replies to Confirmable notifications that arrive while waiting for
+    // a response to a blocking request, e.g. Update
+    if (handle_exchange_response((anjay_t *) anjay, msg)) {
+        anjay_log(DEBUG, "unexpected message ID %" PRIu16 " received",
+                  avs_coap_msg_get_id(msg));
+    }
+}
+
 static int init(anjay_t *anjay, const anjay_configuration_t *config) {
     _anjay_bootstrap_init(&anjay->bootstrap,
                           !config->disable_server_initiated_bootstrap);
@@ -121,17 +140,44 @@ static int init(anjay_t *anjay, const anjay_configuration_t *config) {
         avs_coap_ctx_cleanup(&anjay->coap_ctx);
         return -1;
     }
+    _anjay_coap_stream_set_unmatched_response_handler(
+            anjay->comm_stream, handle_unmatched_response, anjay);
 
     anjay->sched = _anjay_sched_new(anjay);
     if (!anjay->sched) {
         anjay_log(ERROR, "Out of memory");
         return -1;
     }
+#ifdef WITH_POOL_ALLOCATOR
+    if (_anjay_sched_init_pool(anjay->sched, config->sched_pool_block_size,
+                               config->sched_pool_block_count)) {
+        return -1;
+    }
+#endif // WITH_POOL_ALLOCATOR
+    _anjay_exchanges_init(&anjay->exchanges);
+    anjay->dm.cache_server_iids = config->cache_server_iids;
+    anjay->dm.precompute_tlv_sizes = config->precompute_tlv_sizes;
+    anjay->registration_objects.enabled = config->track_registration_objects;
 
     if (_anjay_observe_init(&anjay->observe,
-                            config->confirmable_notifications)) {
+                            config->confirmable_notifications,
+                            config->coalesce_notifications,
+                            config->cache_notification_attrs,
+                            config->share_notification_reads,
+                            config->notification_digests)) {
         return -1;
     }
+    _anjay_observe_set_queue_limits(&anjay->observe,
+                                    config->notify_queue_connection_limit,
+                                    config->notify_queue_total_limit,
+                                    config->notify_queue_drop_policy);
+#if defined(WITH_OBSERVE) && defined(WITH_POOL_ALLOCATOR)
+    if (_anjay_observe_init_pool(&anjay->observe,
+                                 config->observe_pool_block_size,
+                                 config->observe_pool_block_count)) {
+        return -1;
+    }
+#endif // defined(WITH_OBSERVE) && defined(WITH_POOL_ALLOCATOR)
 
     if ((config->sms_driver != NULL) != (config->local_msisdn != NULL)) {
         anjay_log(ERROR,
@@ -197,6 +243,7 @@ static void anjay_delete_impl(anjay_t *anjay, bool deregister) {
     // we want to clear this now so that notifications won't be sent during
     // _anjay_sched_delete()
     _anjay_observe_cleanup(&anjay->observe, anjay->sched);
+    _anjay_exchanges_cleanup(anjay);
 
     _anjay_sched_del(anjay->sched, &anjay->reload_servers_sched_job_handle);
     _anjay_sched_del(anjay->sched, &anjay->scheduled_notify.handle);
@@ -219,6 +266,7 @@ static void anjay_delete_impl(anjay_t *anjay, bool deregister) {
     avs_stream_cleanup(&anjay->comm_stream);
 
     _anjay_dm_cleanup(anjay);
+    _anjay_registration_objects_cleanup(anjay);
     _anjay_notify_clear_queue(&anjay->scheduled_notify.queue);
 
     avs_free(anjay->in_buffer);
@@ -736,12 +784,37 @@ static int handle_incoming_message(anjay_t *anjay) {
         } else if (result == AVS_COAP_CTX_ERR_MSG_WAS_PING) {
             anjay_log(TRACE, "received CoAP ping");
             return 0;
+        } else if (result == AVS_COAP_CTX_ERR_TIMEOUT) {
+            anjay_log(TRACE, "no message received");
+            return result;
         } else {
             anjay_log(ERROR, "received packet is not a valid CoAP message");
             return result;
         }
     }
 
+    avs_coap_msg_type_t msg_type = avs_coap_msg_get_type(request_msg);
+    if (!avs_coap_msg_is_request(request_msg)) {
+        if (!handle_exchange_response(anjay, request_msg)) {
+            return 0;
+        } else if (msg_type == AVS_COAP_MSG_ACKNOWLEDGEMENT) {
+            anjay_log(DEBUG, "unexpected Acknowledgement received");
+            return 0;
+        } else if (msg_type != AVS_COAP_MSG_RESET) {
+            anjay_log(DEBUG, "unexpected response received");
+            if (msg_type == AVS_COAP_MSG_CONFIRMABLE) {
+                avs_coap_ctx_send_empty(anjay->coap_ctx,
+                                        _anjay_connection_get_online_socket(
+                                                anjay->current_connection),
+                                        AVS_COAP_MSG_RESET,
+                                        avs_coap_msg_get_id(request_msg));
+            }
+            return 0;
+        }
+        // unmatched Reset may still refer to a Non-confirmable notification,
+        // which is handled as Cancel Observe below
+    }
+
     avs_coap_msg_identity_t request_identity = AVS_COAP_MSG_IDENTITY_EMPTY;
     anjay_request_t request;
     if (_anjay_coap_stream_get_request_identity(anjay->comm_stream,
@@ -802,7 +875,73 @@ void _anjay_release_server_stream(anjay_t *anjay) {
     _anjay_release_server_stream_without_scheduling_queue(anjay);
 }
 
-static int udp_serve(anjay_t *anjay, avs_net_abstract_socket_t *ready_socket) {
+static int set_recv_timeout(avs_net_abstract_socket_t *socket,
+                            avs_time_duration_t timeout) {
+    return avs_net_socket_set_opt(socket, AVS_NET_SOCKET_OPT_RECV_TIMEOUT,
+                                  (avs_net_socket_opt_value_t) {
+                                      .recv_timeout = timeout
+                                  });
+}
+
+/**
+ * Checks whether handling further messages queued on a socket makes no sense
+ * after @p result has been returned from @ref handle_incoming_message - either
+ * because there are no more messages, or because the socket is broken.
+ */
+static bool ends_batch(int result) {
+    return result == AVS_COAP_CTX_ERR_TIMEOUT
+           || result == AVS_COAP_CTX_ERR_NETWORK;
+}
+
+/**
+ * Handles up to @p max_msgs messages that are already queued on @p socket,
+ * which needs to be currently bound to the comm stream. Receive timeout is
+ * temporarily set to zero, so that this never blocks.
+ *
+ * Errors related to single messages (e.g. malformed datagrams) do not stop
+ * the loop; the first one is returned after all messages have been handled.
+ */
+static int drain_queued_messages(anjay_t *anjay,
+                                 avs_net_abstract_socket_t *socket,
+                                 size_t max_msgs) {
+    avs_net_socket_opt_value_t original_recv_timeout;
+    if (avs_net_socket_get_opt(socket, AVS_NET_SOCKET_OPT_RECV_TIMEOUT,
+                               &original_recv_timeout)
+            || set_recv_timeout(socket, AVS_TIME_DURATION_ZERO)) {
+        anjay_log(WARNING, "could not make socket non-blocking, not draining "
+                           "queued messages");
+        return 0;
+    }
+
+    int result = 0;
+    for (size_t i = 0; i < max_msgs; ++i) {
+        avs_stream_reset(anjay->comm_stream);
+        int msg_result = handle_incoming_message(anjay);
+        if (msg_result == AVS_COAP_CTX_ERR_TIMEOUT) {
+            // no more messages queued
+            break;
+        }
+        if (msg_result) {
+            anjay_log(DEBUG, "could not handle queued message: %d",
+                      msg_result);
+            if (!result) {
+                result = msg_result;
+            }
+            if (ends_batch(msg_result)) {
+                break;
+            }
+        }
+    }
+
+    if (set_recv_timeout(socket, original_recv_timeout.recv_timeout)) {
+        anjay_log(ERROR, "could not restore socket recv timeout");
+    }
+    return result;
+}
+
+static int udp_serve(anjay_t *anjay,
+                     avs_net_abstract_socket_t *ready_socket,
+                     size_t max_msgs) {
     anjay_connection_ref_t connection = {
         .server = _anjay_servers_find_by_udp_socket(anjay, ready_socket),
         .conn_type = ANJAY_CONNECTION_UDP
@@ -812,19 +951,32 @@ static int udp_serve(anjay_t *anjay, avs_net_abstract_socket_t *ready_socket) {
     }
 
     int result = handle_incoming_message(anjay);
+    if (max_msgs != 1 && !ends_batch(result)) {
+        int drain_result =
+                drain_queued_messages(anjay, ready_socket,
+                                      max_msgs ? max_msgs - 1 : SIZE_MAX);
+        if (!result) {
+            result = drain_result;
+        }
+    }
     _anjay_release_server_stream(anjay);
     return result;
 }
 
-
 int anjay_serve(anjay_t *anjay, avs_net_abstract_socket_t *ready_socket) {
+    return anjay_serve_batch(anjay, ready_socket, 1);
+}
+
+int anjay_serve_batch(anjay_t *anjay,
+                      avs_net_abstract_socket_t *ready_socket,
+                      size_t max_msgs) {
 #ifdef WITH_DOWNLOADER
     if (!_anjay_downloader_handle_packet(&anjay->downloader, ready_socket)) {
         return 0;
     }
 #endif // WITH_DOWNLOADER
 
-    return udp_serve(anjay, ready_socket);
+    return udp_serve(anjay, ready_socket, max_msgs);
 }
 
 int anjay_sched_time_to_next(anjay_t *anjay, avs_time_duration_t *out_delay) {
@@ -856,6 +1008,7 @@ int anjay_sched_calculate_wait_time_ms(anjay_t *anjay, int limit_ms) {
 
 int anjay_sched_run(anjay_t *anjay) {
     ssize_t tasks_executed = _anjay_sched_run(anjay->sched);
+    _anjay_observe_clear_read_cache(&anjay->observe);
     if (tasks_executed < 0) {
         anjay_log(ERROR, "sched_run failed");
         return -1;
@@ -931,6 +1084,47 @@ uint64_t anjay_get_num_outgoing_retransmissions(anjay_t *anjay) {
 #endif
 }
 
+int anjay_get_pool_stats(anjay_t *anjay,
+                         anjay_pool_id_t pool,
+                         anjay_pool_stats_t *out_stats) {
+#ifdef WITH_POOL_ALLOCATOR
+    switch (pool) {
+    case ANJAY_POOL_SCHED:
+        *out_stats = *_anjay_sched_pool_stats(anjay->sched);
+        return 0;
+#    ifdef WITH_OBSERVE
+    case ANJAY_POOL_OBSERVE:
+        *out_stats = anjay->observe.value_pool.stats;
+        return 0;
+#    endif // WITH_OBSERVE
+    default:
+        anjay_log(ERROR, "unknown memory pool: %d", (int) pool);
+        return -1;
+    }
+#else  // WITH_POOL_ALLOCATOR
+    (void) anjay;
+    (void) pool;
+    (void) out_stats;
+    anjay_log(ERROR, "memory pool support disabled");
+    return -1;
+#endif // WITH_POOL_ALLOCATOR
+}
+
+int anjay_get_notify_queue_stats(anjay_t *anjay,
+                                 anjay_ssid_t ssid,
+                                 anjay_notify_queue_stats_t *out_stats) {
+#ifdef WITH_OBSERVE
+    _anjay_observe_queue_stats(&anjay->observe, ssid, out_stats);
+    return 0;
+#else  // WITH_OBSERVE
+    (void) anjay;
+    (void) ssid;
+    (void) out_stats;
+    anjay_log(ERROR, "Observe support disabled");
+    return -1;
+#endif // WITH_OBSERVE
+}
+
 
 #ifdef ANJAY_TEST
 #    include "test/anjay.c"
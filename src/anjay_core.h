@@ -25,7 +25,9 @@
 #include "observe/observe_core.h"
 
 #include "downloader.h"
+#include "exchange.h"
 #include "interface/bootstrap_core.h"
+#include "pool.h"
 #include "servers.h"
 #include "utils_core.h"
 
@@ -62,6 +64,8 @@ struct anjay_struct {
     avs_stream_abstract_t *comm_stream;
     anjay_connection_ref_t current_connection;
     anjay_scheduled_notify_t scheduled_notify;
+    anjay_registration_objects_t registration_objects;
+    anjay_exchanges_t exchanges;
 
     const char *endpoint_name;
     anjay_transaction_state_t transaction_state;
@@ -102,6 +106,19 @@ void _anjay_release_server_stream(anjay_t *anjay);
  */
 anjay_sched_t *_anjay_sched_new(anjay_t *anjay);
 
+#ifdef WITH_POOL_ALLOCATOR
+/**
+ * Preallocates a pool of @p block_count blocks, @p block_size bytes each (or
+ * a default size, if 0), used for scheduler jobs. MUST be called before any
+ * job is scheduled.
+ */
+int _anjay_sched_init_pool(anjay_sched_t *sched,
+                           size_t block_size,
+                           size_t block_count);
+
+const anjay_pool_stats_t *_anjay_sched_pool_stats(anjay_sched_t *sched);
+#endif // WITH_POOL_ALLOCATOR
+
 VISIBILITY_PRIVATE_HEADER_END
 
 #endif /* ANJAY_CORE_H */
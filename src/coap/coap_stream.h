@@ -76,6 +76,51 @@ int _anjay_coap_stream_setup_request(avs_stream_abstract_t *stream,
                                      const anjay_msg_details_t *details,
                                      const avs_coap_token_t *token);
 
+/**
+ * Finishes the request set up with @ref _anjay_coap_stream_setup_request.
+ * Unlike @ref avs_stream_finish_message, does not wait for the response to
+ * a Confirmable request - in that case, the sent message is returned via
+ * @p out_msg and it's up to the caller to handle retransmissions. The pointer
+ * is only valid until the stream is reset. @p out_msg is set to NULL if the
+ * request has been handled synchronously, e.g. when it is Non-confirmable or
+ * sent using a block-wise transfer.
+ */
+int _anjay_coap_stream_finish_request_async(avs_stream_abstract_t *stream,
+                                            const avs_coap_msg_t **out_msg);
+
+/**
+ * Sends a Non-confirmable request with @p payload as a single message, without
+ * switching the stream into client mode. Intended for sending many short
+ * messages in a row, e.g. queued notifications. The sent message uses
+ * @p token, which must not be NULL, and its identity is returned via
+ * @p out_identity. No message ID is used up if the payload does not fit.
+ *
+ * @returns 0 on success, a negative value in case of error, or a positive
+ *          value if @p payload does not fit in a single message - in that case
+ *          nothing is sent and the caller is expected to fall back to
+ *          @ref _anjay_coap_stream_setup_request .
+ */
+int _anjay_coap_stream_send_nonconfirmable(
+        avs_stream_abstract_t *stream,
+        const anjay_msg_details_t *details,
+        const avs_coap_token_t *token,
+        const void *payload,
+        size_t payload_size,
+        avs_coap_msg_identity_t *out_identity);
+
+/**
+ * Called for Acknowledgement and Reset messages that do not match the request
+ * which is currently being handled by the stream in client mode, e.g. replies
+ * to Confirmable notifications that arrive during a blocking Update.
+ */
+typedef void anjay_coap_unmatched_response_handler_t(const avs_coap_msg_t *msg,
+                                                     void *arg);
+
+void _anjay_coap_stream_set_unmatched_response_handler(
+        avs_stream_abstract_t *stream,
+        anjay_coap_unmatched_response_handler_t *handler,
+        void *handler_arg);
+
 int _anjay_coap_stream_set_error(avs_stream_abstract_t *stream, uint8_t code);
 
 /** NOTE: Pointer acquired with this function is only valid until receiving next
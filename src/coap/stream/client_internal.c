@@ -180,6 +180,15 @@ static check_result_t check_response(coap_client_t *client,
     return CHECK_INVALID_RESPONSE;
 }
 
+static bool is_unmatched_response(coap_client_t *client,
+                                  const avs_coap_msg_t *msg) {
+    avs_coap_msg_type_t type = avs_coap_msg_get_type(msg);
+    return client->common.unmatched_response_handler
+           && (type == AVS_COAP_MSG_ACKNOWLEDGEMENT
+               || type == AVS_COAP_MSG_RESET)
+           && avs_coap_msg_get_id(msg) != client->last_request_identity.msg_id;
+}
+
 static int process_received(const avs_coap_msg_t *response,
                             void *client_,
                             bool *out_wait_for_next,
@@ -198,6 +207,10 @@ static int process_received(const avs_coap_msg_t *response,
         break;
 
     case CHECK_INVALID_RESPONSE:
+        if (is_unmatched_response(client, response)) {
+            client->common.unmatched_response_handler(
+                    response, client->common.unmatched_response_handler_arg);
+        }
         break;
 
     case CHECK_OK:
@@ -359,6 +372,24 @@ int _anjay_coap_client_finish_request(coap_client_t *client) {
     }
 }
 
+int _anjay_coap_client_finish_request_async(coap_client_t *client,
+                                            const avs_coap_msg_t **out_msg) {
+    *out_msg = NULL;
+    if (client->state != COAP_CLIENT_STATE_HAS_REQUEST_HEADER
+            || has_block_ctx(client)) {
+        return _anjay_coap_client_finish_request(client);
+    }
+
+    const avs_coap_msg_t *msg = _anjay_coap_out_build_msg(&client->common.out);
+    int result = avs_coap_ctx_send(client->common.coap_ctx,
+                                   client->common.socket, msg);
+    if (!result && avs_coap_msg_get_type(msg) == AVS_COAP_MSG_CONFIRMABLE) {
+        client->state = COAP_CLIENT_STATE_REQUEST_SENT;
+        *out_msg = msg;
+    }
+    return result;
+}
+
 int _anjay_coap_client_read(coap_client_t *client,
                             size_t *out_bytes_read,
                             char *out_message_finished,
@@ -114,6 +114,16 @@ int _anjay_coap_client_get_or_receive_msg(coap_client_t *client,
  */
 int _anjay_coap_client_finish_request(coap_client_t *client);
 
+/**
+ * Works like @ref _anjay_coap_client_finish_request, except that Confirmable
+ * messages are only sent once, without waiting for the response. In that case,
+ * @p out_msg is set to the sent message, so that the caller may take care of
+ * retransmissions. It remains valid until the client is reset. Otherwise,
+ * @p out_msg is set to NULL.
+ */
+int _anjay_coap_client_finish_request_async(coap_client_t *client,
+                                            const avs_coap_msg_t **out_msg);
+
 int _anjay_coap_client_read(coap_client_t *client,
                             size_t *out_bytes_read,
                             char *out_message_finished,
@@ -35,6 +35,9 @@ typedef struct coap_stream_common {
 
     coap_input_buffer_t in;
     coap_output_buffer_t out;
+
+    anjay_coap_unmatched_response_handler_t *unmatched_response_handler;
+    void *unmatched_response_handler_arg;
 } coap_stream_common_t;
 
 int _anjay_coap_common_fill_msg_info(avs_coap_msg_info_t *info,
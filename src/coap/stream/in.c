@@ -39,7 +39,9 @@ int _anjay_coap_in_get_next_message(coap_input_buffer_t *in,
                                    in->buffer_size);
     if (result) {
         int error = avs_net_socket_errno(socket);
-        if (error) {
+        if (result == AVS_COAP_CTX_ERR_TIMEOUT) {
+            coap_log(TRACE, "recv timed out");
+        } else if (error) {
             coap_log(ERROR, "recv returned %d (%s)", result, strerror(error));
         } else {
             coap_log(TRACE, "recv returned %d", result);
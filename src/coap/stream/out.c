@@ -125,9 +125,12 @@ int _anjay_coap_out_update_msg_header(coap_output_buffer_t *out,
     }
 
     out->info.identity = *id;
-    uint16_t option_num = avs_coap_opt_num_from_block_type(block->type);
-    avs_coap_msg_info_opt_remove_by_number(&out->info, option_num);
-    int result = avs_coap_msg_info_opt_block(&out->info, block);
+    int result = 0;
+    if (block) {
+        uint16_t option_num = avs_coap_opt_num_from_block_type(block->type);
+        avs_coap_msg_info_opt_remove_by_number(&out->info, option_num);
+        result = avs_coap_msg_info_opt_block(&out->info, block);
+    }
 
     if (!result) {
         result = avs_coap_msg_builder_reset(&out->builder, &out->info);
@@ -135,6 +138,12 @@ int _anjay_coap_out_update_msg_header(coap_output_buffer_t *out,
     return result;
 }
 
+bool _anjay_coap_out_payload_fits(const coap_output_buffer_t *out,
+                                  size_t payload_size) {
+    return avs_coap_msg_info_get_packet_storage_size(&out->info, payload_size)
+           <= effective_buffer_capacity(out);
+}
+
 size_t _anjay_coap_out_write(coap_output_buffer_t *out,
                              const void *data,
                              size_t data_length) {
@@ -99,7 +99,7 @@ int _anjay_coap_out_setup_msg(coap_output_buffer_t *out,
  *
  * @param out   Buffer to operate on.
  * @param id    Message identity.
- * @param block Block to acknowledge.
+ * @param block Block to acknowledge, or NULL to leave BLOCK options intact.
  *
  * @returns 0 on success, a negative value in case of error.
  */
@@ -107,6 +107,17 @@ int _anjay_coap_out_update_msg_header(coap_output_buffer_t *out,
                                       const avs_coap_msg_identity_t *id,
                                       const avs_coap_block_info_t *block);
 
+/**
+ * @param out          Buffer with a message set up using
+ *                     @ref _anjay_coap_out_setup_msg .
+ * @param payload_size Number of payload bytes to check.
+ *
+ * @returns true if a payload of @p payload_size bytes fits in the message
+ *          without exceeding the buffer capacity or the socket MTU.
+ */
+bool _anjay_coap_out_payload_fits(const coap_output_buffer_t *out,
+                                  size_t payload_size);
+
 /**
  * Writes a message payload.
  *
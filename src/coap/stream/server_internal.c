@@ -230,9 +230,12 @@ static process_result_t process_initial_request(coap_server_t *server,
 
     avs_coap_msg_type_t type = avs_coap_msg_get_type(msg);
     if (!avs_coap_msg_is_request(msg)
-            // incoming Reset may still require some kind of reaction,
-            // so it should be handled by upper layers
-            && type != AVS_COAP_MSG_RESET) {
+            // incoming Reset, Acknowledgement or Separate Response may refer
+            // to a message sent asynchronously, so it should be handled by
+            // upper layers
+            && type != AVS_COAP_MSG_RESET
+            && type != AVS_COAP_MSG_ACKNOWLEDGEMENT
+            && avs_coap_msg_get_code(msg) == AVS_COAP_CODE_EMPTY) {
         coap_log(DEBUG, "invalid request: %s",
                  AVS_COAP_CODE_STRING(avs_coap_msg_get_code(msg)));
         return PROCESS_INITIAL_INVALID_REQUEST;
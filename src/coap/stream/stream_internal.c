@@ -391,6 +391,85 @@ int _anjay_coap_stream_setup_request(avs_stream_abstract_t *stream_,
     return result;
 }
 
+int _anjay_coap_stream_finish_request_async(avs_stream_abstract_t *stream_,
+                                            const avs_coap_msg_t **out_msg) {
+    coap_stream_t *stream = (coap_stream_t *) stream_;
+    assert(stream->vtable == &COAP_STREAM_VTABLE);
+
+    if (stream->state != STREAM_STATE_CLIENT) {
+        coap_log(ERROR, "finish_request_async called while not in CLIENT "
+                        "state");
+        return -1;
+    }
+    return _anjay_coap_client_finish_request_async(get_client(stream), out_msg);
+}
+
+int _anjay_coap_stream_send_nonconfirmable(
+        avs_stream_abstract_t *stream_,
+        const anjay_msg_details_t *details,
+        const avs_coap_token_t *token,
+        const void *payload,
+        size_t payload_size,
+        avs_coap_msg_identity_t *out_identity) {
+    coap_stream_t *stream = (coap_stream_t *) stream_;
+    assert(stream->vtable == &COAP_STREAM_VTABLE);
+    assert(details->msg_type == AVS_COAP_MSG_NON_CONFIRMABLE);
+    assert(token);
+
+    switch (stream->state) {
+    case STREAM_STATE_SERVER:
+        coap_log(ERROR, "send_nonconfirmable called while in SERVER state");
+        return -1;
+    case STREAM_STATE_CLIENT:
+        reset(stream);
+        // fall-through
+    case STREAM_STATE_IDLE:
+        break;
+    }
+
+    avs_coap_msg_identity_t identity = AVS_COAP_MSG_IDENTITY_EMPTY;
+    identity.token = *token;
+
+    coap_stream_common_t *common = &stream->data.common;
+    _anjay_coap_out_setup_mtu(&common->out, common->socket);
+    int result = _anjay_coap_out_setup_msg(&common->out, &identity, details,
+                                           NULL);
+    if (!result && !_anjay_coap_out_payload_fits(&common->out, payload_size)) {
+        result = 1;
+    }
+    if (!result) {
+        // the message ID does not affect the message size, so it is only
+        // taken once it is known that there will be no block-wise fallback,
+        // which would take its own
+        identity.msg_id = _anjay_coap_id_source_get(stream->id_source).msg_id;
+        result = _anjay_coap_out_update_msg_header(&common->out, &identity,
+                                                   NULL);
+    }
+    if (!result
+            && _anjay_coap_out_write(&common->out, payload, payload_size)
+                           != payload_size) {
+        result = -1;
+    }
+    if (!result) {
+        *out_identity = identity;
+        result = avs_coap_ctx_send(common->coap_ctx, common->socket,
+                                   _anjay_coap_out_build_msg(&common->out));
+    }
+    _anjay_coap_out_reset(&common->out);
+    return result;
+}
+
+void _anjay_coap_stream_set_unmatched_response_handler(
+        avs_stream_abstract_t *stream_,
+        anjay_coap_unmatched_response_handler_t *handler,
+        void *handler_arg) {
+    coap_stream_t *stream = (coap_stream_t *) stream_;
+    assert(stream->vtable == &COAP_STREAM_VTABLE);
+
+    stream->data.common.unmatched_response_handler = handler;
+    stream->data.common.unmatched_response_handler_arg = handler_arg;
+}
+
 int _anjay_coap_stream_set_error(avs_stream_abstract_t *stream_, uint8_t code) {
     coap_stream_t *stream = (coap_stream_t *) stream_;
     assert(stream->vtable == &COAP_STREAM_VTABLE);
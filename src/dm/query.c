@@ -16,6 +16,10 @@
 
 #include <anjay_config.h>
 
+#include <stdlib.h>
+
+#include <avsystem/commons/memory.h>
+
 #include <anjay_modules/time_defs.h>
 
 #include "query.h"
@@ -51,19 +55,113 @@ static int find_server_iid_handler(anjay_t *anjay,
     return 0;
 }
 
+static int index_server_iid_handler(anjay_t *anjay,
+                                    const anjay_dm_object_def_t *const *obj,
+                                    anjay_iid_t iid,
+                                    void *dm_) {
+    (void) obj;
+    anjay_dm_t *dm = (anjay_dm_t *) dm_;
+    int64_t ssid;
+    const anjay_uri_path_t ssid_path =
+            MAKE_RESOURCE_PATH(ANJAY_DM_OID_SERVER, iid,
+                               ANJAY_DM_RID_SERVER_SSID);
+
+    if (_anjay_dm_res_read_i64(anjay, &ssid_path, &ssid)) {
+        return -1;
+    }
+    if (ssid < 0 || ssid > UINT16_MAX) {
+        // cannot match any SSID anyway
+        return ANJAY_FOREACH_CONTINUE;
+    }
+    if (dm->server_iids_count == dm->server_iids_capacity) {
+        size_t new_capacity =
+                dm->server_iids_capacity ? 2 * dm->server_iids_capacity : 4;
+        anjay_dm_server_iid_t *new_server_iids =
+                (anjay_dm_server_iid_t *) avs_realloc(
+                        dm->server_iids,
+                        new_capacity * sizeof(*dm->server_iids));
+        if (!new_server_iids) {
+            anjay_log(ERROR, "out of memory");
+            return -1;
+        }
+        dm->server_iids = new_server_iids;
+        dm->server_iids_capacity = new_capacity;
+    }
+    dm->server_iids[dm->server_iids_count].ssid = (anjay_ssid_t) ssid;
+    dm->server_iids[dm->server_iids_count].iid = iid;
+    ++dm->server_iids_count;
+    return ANJAY_FOREACH_CONTINUE;
+}
+
+static int server_iid_cmp(const void *left_, const void *right_) {
+    const anjay_dm_server_iid_t *left = (const anjay_dm_server_iid_t *) left_;
+    const anjay_dm_server_iid_t *right = (const anjay_dm_server_iid_t *) right_;
+    if (left->ssid != right->ssid) {
+        return left->ssid < right->ssid ? -1 : 1;
+    }
+    return left->iid < right->iid ? -1 : (left->iid > right->iid ? 1 : 0);
+}
+
+static int index_server_iids(anjay_t *anjay) {
+    const anjay_dm_object_def_t *const *obj =
+            _anjay_dm_find_object_by_oid(anjay, ANJAY_DM_OID_SERVER);
+    anjay->dm.server_iids_count = 0;
+    if (_anjay_dm_foreach_instance(anjay, obj, index_server_iid_handler,
+                                   &anjay->dm)) {
+        return -1;
+    }
+    if (anjay->dm.server_iids_count) {
+        qsort(anjay->dm.server_iids, anjay->dm.server_iids_count,
+              sizeof(*anjay->dm.server_iids), server_iid_cmp);
+    }
+    anjay->dm.server_iids_valid = true;
+    return 0;
+}
+
+static int find_indexed_server_iid(anjay_t *anjay,
+                                   anjay_ssid_t ssid,
+                                   anjay_iid_t *out_iid) {
+    if (!anjay->dm.server_iids_valid && index_server_iids(anjay)) {
+        return -1;
+    }
+    // lower bound, so that the lowest IID is found if the SSID is duplicated,
+    // as it would be when iterating over the instances
+    size_t begin = 0;
+    size_t end = anjay->dm.server_iids_count;
+    while (begin < end) {
+        size_t mid = begin + (end - begin) / 2;
+        if (anjay->dm.server_iids[mid].ssid < ssid) {
+            begin = mid + 1;
+        } else {
+            end = mid;
+        }
+    }
+    if (begin >= anjay->dm.server_iids_count
+            || anjay->dm.server_iids[begin].ssid != ssid) {
+        return -1;
+    }
+    *out_iid = anjay->dm.server_iids[begin].iid;
+    return 0;
+}
+
 int _anjay_find_server_iid(anjay_t *anjay,
                            anjay_ssid_t ssid,
                            anjay_iid_t *out_iid) {
+    if (ssid == ANJAY_SSID_ANY || ssid == ANJAY_SSID_BOOTSTRAP) {
+        return -1;
+    }
+    if (anjay->dm.cache_server_iids) {
+        return find_indexed_server_iid(anjay, ssid, out_iid);
+    }
+
     find_iid_args_t args = {
         .ssid = ssid,
         .out_iid = ANJAY_IID_INVALID
     };
-
     const anjay_dm_object_def_t *const *obj =
             _anjay_dm_find_object_by_oid(anjay, ANJAY_DM_OID_SERVER);
-    if (ssid == ANJAY_SSID_ANY || ssid == ANJAY_SSID_BOOTSTRAP
-            || _anjay_dm_foreach_instance(anjay, obj, find_server_iid_handler,
-                                          &args)
+    if (_anjay_dm_foreach_instance(anjay, obj, find_server_iid_handler,
+                                   &args)
             || args.out_iid == ANJAY_IID_INVALID) {
         return -1;
     }
@@ -71,6 +169,10 @@ int _anjay_find_server_iid(anjay_t *anjay,
     return 0;
 }
 
+void _anjay_dm_invalidate_server_iids(anjay_t *anjay) {
+    anjay->dm.server_iids_valid = false;
+}
+
 static int security_iid_find_helper(anjay_t *anjay,
                                     const anjay_dm_object_def_t *const *obj,
                                     anjay_iid_t iid,
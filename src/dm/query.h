@@ -25,6 +25,13 @@ int _anjay_find_server_iid(anjay_t *anjay,
                            anjay_ssid_t ssid,
                            anjay_iid_t *out_iid);
 
+/**
+ * Discards the cached mapping of SSIDs to Server Object Instance IDs used by
+ * @ref _anjay_find_server_iid . Shall be called whenever the Server Object
+ * might have changed.
+ */
+void _anjay_dm_invalidate_server_iids(anjay_t *anjay);
+
 int _anjay_find_security_iid(anjay_t *anjay,
                              anjay_ssid_t ssid,
                              anjay_iid_t *out_iid);
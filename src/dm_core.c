@@ -24,13 +24,13 @@
 
 #include <anjay/core.h>
 #include <avsystem/commons/stream.h>
-#include <avsystem/commons/stream/stream_membuf.h>
 #include <avsystem/commons/stream_v_table.h>
 #include <avsystem/commons/utils.h>
 
 #include <anjay_modules/notify.h>
 
 #include <avsystem/commons/coap/msg.h>
+#include <avsystem/commons/memory.h>
 
 #include "coap/content_format.h"
 
@@ -86,6 +86,40 @@ static int validate_version(const anjay_dm_object_def_t *obj_def) {
     return 0;
 }
 
+/**
+ * @returns Index of the first registered object with OID not less than @p oid,
+ *          or <c>objects_count</c> if there is no such object.
+ */
+static size_t objects_lower_bound(const anjay_dm_t *dm, anjay_oid_t oid) {
+    size_t begin = 0;
+    size_t end = dm->objects_count;
+    while (begin < end) {
+        size_t mid = begin + (end - begin) / 2;
+        assert(dm->objects[mid] && *dm->objects[mid]);
+        if ((*dm->objects[mid])->oid < oid) {
+            begin = mid + 1;
+        } else {
+            end = mid;
+        }
+    }
+    return begin;
+}
+
+static int reserve_object_slot(anjay_dm_t *dm) {
+    if (dm->objects_count < dm->objects_capacity) {
+        return 0;
+    }
+    size_t new_capacity = dm->objects_capacity ? 2 * dm->objects_capacity : 8;
+    anjay_dm_object_ptr_t *new_objects = (anjay_dm_object_ptr_t *) avs_realloc(
+            dm->objects, new_capacity * sizeof(*new_objects));
+    if (!new_objects) {
+        return -1;
+    }
+    dm->objects = new_objects;
+    dm->objects_capacity = new_capacity;
+    return 0;
+}
+
 int anjay_register_object(anjay_t *anjay,
                           const anjay_dm_object_def_t *const *def_ptr) {
     assert(!anjay->transaction_state.depth);
@@ -96,17 +130,9 @@ int anjay_register_object(anjay_t *anjay,
         return -1;
     }
 
-    AVS_LIST(const anjay_dm_object_def_t *const *) *obj_iter;
-
-    AVS_LIST_FOREACH_PTR(obj_iter, &anjay->dm.objects) {
-        assert(*obj_iter && **obj_iter);
-
-        if ((***obj_iter)->oid >= (*def_ptr)->oid) {
-            break;
-        }
-    }
-
-    if (*obj_iter && (***obj_iter)->oid == (*def_ptr)->oid) {
+    size_t index = objects_lower_bound(&anjay->dm, (*def_ptr)->oid);
+    if (index < anjay->dm.objects_count
+            && (*anjay->dm.objects[index])->oid == (*def_ptr)->oid) {
         anjay_log(ERROR, "data model object /%u already registered",
                   (*def_ptr)->oid);
         return -1;
@@ -116,20 +142,20 @@ int anjay_register_object(anjay_t *anjay,
         return -1;
     }
 
-    AVS_LIST(const anjay_dm_object_def_t *const *) new_elem =
-            AVS_LIST_NEW_ELEMENT(const anjay_dm_object_def_t *const *);
-    if (!new_elem) {
+    if (reserve_object_slot(&anjay->dm)) {
         anjay_log(ERROR, "out of memory");
         return -1;
     }
 
-    *new_elem = def_ptr;
-    AVS_LIST_INSERT(obj_iter, new_elem);
+    memmove(&anjay->dm.objects[index + 1], &anjay->dm.objects[index],
+            (anjay->dm.objects_count - index) * sizeof(*anjay->dm.objects));
+    anjay->dm.objects[index] = def_ptr;
+    ++anjay->dm.objects_count;
 
-    anjay_log(INFO, "successfully registered object /%u", (**new_elem)->oid);
-    if (anjay_notify_instances_changed(anjay, (**new_elem)->oid)) {
+    anjay_log(INFO, "successfully registered object /%u", (*def_ptr)->oid);
+    if (anjay_notify_instances_changed(anjay, (*def_ptr)->oid)) {
         anjay_log(WARNING, "anjay_notify_instances_changed() failed on /%u",
-                  (**new_elem)->oid);
+                  (*def_ptr)->oid);
     }
     if (anjay_schedule_registration_update(anjay, ANJAY_SSID_ANY)) {
         anjay_log(WARNING, "anjay_schedule_registration_update() failed");
@@ -161,20 +187,14 @@ int anjay_unregister_object(anjay_t *anjay,
         return -1;
     }
 
-    AVS_LIST(const anjay_dm_object_def_t *const *) *obj_iter;
-    AVS_LIST_FOREACH_PTR(obj_iter, &anjay->dm.objects) {
-        assert(*obj_iter && **obj_iter);
-        if ((***obj_iter)->oid >= (*def_ptr)->oid) {
-            break;
-        }
-    }
-
-    if (!*obj_iter || (***obj_iter)->oid != (*def_ptr)->oid) {
+    size_t index = objects_lower_bound(&anjay->dm, (*def_ptr)->oid);
+    if (index >= anjay->dm.objects_count
+            || (*anjay->dm.objects[index])->oid != (*def_ptr)->oid) {
         anjay_log(ERROR, "object %" PRIu16 " is not currently registered",
                   (*def_ptr)->oid);
         return -1;
     }
-    if (**obj_iter != def_ptr) {
+    if (anjay->dm.objects[index] != def_ptr) {
         anjay_log(ERROR,
                   "object %" PRIu16 " that is registered is not "
                   "the same as the object passed for unregister",
@@ -182,8 +202,9 @@ int anjay_unregister_object(anjay_t *anjay,
         return -1;
     }
 
-    AVS_LIST(const anjay_dm_object_def_t *const *) detached =
-            AVS_LIST_DETACH(obj_iter);
+    --anjay->dm.objects_count;
+    memmove(&anjay->dm.objects[index], &anjay->dm.objects[index + 1],
+            (anjay->dm.objects_count - index) * sizeof(*anjay->dm.objects));
 
     anjay_notify_queue_t notify = NULL;
     if (_anjay_notify_queue_instance_set_unknown_change(&notify,
@@ -202,7 +223,6 @@ int anjay_unregister_object(anjay_t *anjay,
                                  (*def_ptr)->oid);
 #endif // WITH_BOOTSTRAP
     anjay_log(INFO, "successfully unregistered object /%u", (*def_ptr)->oid);
-    AVS_LIST_DELETE(&detached);
     if (anjay_schedule_registration_update(anjay, ANJAY_SSID_ANY)) {
         anjay_log(WARNING, "anjay_schedule_registration_update() failed");
     }
@@ -216,37 +236,30 @@ void _anjay_dm_cleanup(anjay_t *anjay) {
         }
     }
 
-    AVS_LIST_CLEAR(&anjay->dm.objects);
+    avs_free(anjay->dm.objects);
+    anjay->dm.objects = NULL;
+    anjay->dm.objects_count = 0;
+    anjay->dm.objects_capacity = 0;
+
+    avs_free(anjay->dm.server_iids);
+    anjay->dm.server_iids = NULL;
+    anjay->dm.server_iids_count = 0;
+    anjay->dm.server_iids_capacity = 0;
+    anjay->dm.server_iids_valid = false;
 }
 
 const anjay_dm_object_def_t *const *
 _anjay_dm_find_object_by_oid(anjay_t *anjay, anjay_oid_t oid) {
-    AVS_LIST(const anjay_dm_object_def_t *const *) obj;
-    AVS_LIST_FOREACH(obj, anjay->dm.objects) {
-        assert(*obj && **obj);
-        if ((**obj)->oid == oid) {
-            return *obj;
-        }
+    size_t index = objects_lower_bound(&anjay->dm, oid);
+    if (index < anjay->dm.objects_count
+            && (*anjay->dm.objects[index])->oid == oid) {
+        return anjay->dm.objects[index];
     }
     anjay_log(TRACE, "could not found object: /%u not registered", oid);
 
     return NULL;
 }
 
-static anjay_input_ctx_constructor_t *
-input_ctx_for_action(anjay_request_action_t action) {
-    switch (action) {
-    case ANJAY_ACTION_WRITE:
-    case ANJAY_ACTION_WRITE_UPDATE:
-    case ANJAY_ACTION_CREATE:
-        return _anjay_input_dynamic_create;
-    case ANJAY_ACTION_EXECUTE:
-        return _anjay_input_text_create;
-    default:
-        return NULL;
-    }
-}
-
 static uint8_t make_success_response_code(anjay_request_action_t action) {
     switch (action) {
     case ANJAY_ACTION_READ:
@@ -272,20 +285,28 @@ static uint8_t make_success_response_code(anjay_request_action_t action) {
 }
 
 static int prepare_input_context(avs_stream_abstract_t *stream,
-                                 anjay_request_action_t action,
+                                 const anjay_request_t *request,
                                  anjay_input_ctx_t **out_in_ctx) {
     *out_in_ctx = NULL;
 
-    anjay_input_ctx_constructor_t *constructor = input_ctx_for_action(action);
-    if (constructor) {
-        int result = constructor(out_in_ctx, &stream, false);
-        if (result) {
-            anjay_log(ERROR, "could not create input context");
-            return result;
-        }
+    int result = 0;
+    switch (request->action) {
+    case ANJAY_ACTION_WRITE:
+    case ANJAY_ACTION_WRITE_UPDATE:
+    case ANJAY_ACTION_CREATE:
+        result = _anjay_input_dynamic_create(out_in_ctx, &stream, false,
+                                             &request->uri);
+        break;
+    case ANJAY_ACTION_EXECUTE:
+        result = _anjay_input_text_create(out_in_ctx, &stream, false);
+        break;
+    default:
+        break;
     }
-
-    return 0;
+    if (result) {
+        anjay_log(ERROR, "could not create input context");
+    }
+    return result;
 }
 
 const char *_anjay_debug_make_path__(char *buffer,
@@ -411,14 +432,45 @@ static int read_instance(anjay_t *anjay,
     return 0;
 }
 
+/**
+ * Performs a dry run of reading the Instance, to calculate its size in the TLV
+ * format without buffering it.
+ */
+static int measure_instance(anjay_t *anjay,
+                            const anjay_dm_object_def_t *const *obj,
+                            anjay_iid_t iid,
+                            size_t *out_size) {
+    anjay_output_ctx_t *measure_ctx = _anjay_output_tlv_measure_create();
+    if (!measure_ctx) {
+        anjay_log(ERROR, "Out of memory");
+        return ANJAY_ERR_INTERNAL;
+    }
+    int result = read_instance(anjay, obj, iid, measure_ctx);
+    if (!result) {
+        *out_size = _anjay_output_tlv_measured_size(measure_ctx);
+    }
+    int finish_result = _anjay_output_ctx_destroy(&measure_ctx);
+    return result ? result : finish_result;
+}
+
 static int read_instance_wrapped(anjay_t *anjay,
                                  const anjay_dm_object_def_t *const *obj,
                                  anjay_iid_t iid,
-                                 anjay_output_ctx_t *out_ctx) {
+                                 anjay_output_ctx_t *out_ctx,
+                                 bool measure) {
     int result = _anjay_output_set_id(out_ctx, ANJAY_ID_IID, iid);
     if (result) {
         return result;
     }
+    if (measure) {
+        size_t size;
+        if ((result = measure_instance(anjay, obj, iid, &size))) {
+            return result;
+        }
+        // if the output context cannot make use of the size, the Instance is
+        // buffered as usual
+        (void) _anjay_output_set_next_size(out_ctx, size);
+    }
     anjay_output_ctx_t *instance_ctx = _anjay_output_object_start(out_ctx);
     if (!instance_ctx) {
         return ANJAY_ERR_INTERNAL;
@@ -442,6 +494,12 @@ static int read_object(anjay_t *anjay,
         .ssid = details->ssid,
         .action = ANJAY_ACTION_READ
     };
+    // Object reads default to TLV, see dm_read_spawn_ctx()
+    const uint16_t format =
+            _anjay_translate_legacy_content_format(details->requested_format);
+    const bool measure = anjay->dm.precompute_tlv_sizes
+                         && (format == AVS_COAP_FORMAT_NONE
+                             || format == ANJAY_COAP_FORMAT_TLV);
 
     while (!result
            && !(result = _anjay_dm_instance_it(anjay, obj, &iid, &cookie, NULL))
@@ -450,7 +508,7 @@ static int read_object(anjay_t *anjay,
         if (!_anjay_instance_action_allowed(anjay, &info)) {
             continue;
         }
-        result = read_instance_wrapped(anjay, obj, iid, out_ctx);
+        result = read_instance_wrapped(anjay, obj, iid, out_ctx, measure);
     }
     return result;
 }
@@ -469,11 +527,18 @@ dm_read_spawn_ctx(avs_stream_abstract_t *stream,
                                                  ANJAY_COAP_FORMAT_JSON);
         }
 #endif
+#ifdef WITH_SENML_CBOR
+        if (ret) {
+            ret = _anjay_handle_requested_format(&requested_format,
+                                                 ANJAY_COAP_FORMAT_SENML_CBOR);
+        }
+#endif // WITH_SENML_CBOR
         if (ret) {
             *errno_ptr = ret;
             anjay_log(ERROR,
                       "Got option: Accept: %" PRIu16 ", but reads on "
-                      "non-resource paths only support TLV and JSON formats",
+                      "non-resource paths only support TLV, JSON and "
+                      "SenML CBOR formats",
                       details->requested_format);
             return NULL;
         }
@@ -566,15 +631,14 @@ dm_observe_spawn_ctx(avs_stream_abstract_t *stream,
     return NULL;
 }
 
-ssize_t _anjay_dm_read_for_observe(anjay_t *anjay,
-                                   const anjay_dm_object_def_t *const *obj,
-                                   const anjay_dm_read_args_t *details,
-                                   anjay_msg_details_t *out_details,
-                                   double *out_numeric,
-                                   char *buffer,
-                                   size_t size) {
-    anjay_observe_stream_t out = _anjay_new_observe_stream(out_details);
-    avs_stream_outbuf_set_buffer(&out.outbuf, buffer, size);
+int _anjay_dm_read_for_observe(anjay_t *anjay,
+                               const anjay_dm_object_def_t *const *obj,
+                               const anjay_dm_read_args_t *details,
+                               anjay_msg_details_t *out_details,
+                               double *out_numeric,
+                               anjay_observe_buffer_t *out_buffer) {
+    anjay_observe_stream_t out =
+            _anjay_new_observe_stream(out_details, out_buffer);
     int out_ctx_errno = 0;
     anjay_output_ctx_t *out_ctx =
             dm_observe_spawn_ctx((avs_stream_abstract_t *) &out, &out_ctx_errno,
@@ -584,11 +648,9 @@ ssize_t _anjay_dm_read_for_observe(anjay_t *anjay,
     }
     int result = dm_read(anjay, obj, details, out_ctx);
     if (out_ctx_errno < 0) {
-        return (ssize_t) out_ctx_errno;
-    } else if (result < 0) {
-        return (ssize_t) result;
+        return out_ctx_errno;
     }
-    return (ssize_t) avs_stream_outbuf_offset(&out.outbuf);
+    return result < 0 ? result : 0;
 }
 
 static int dm_observe(anjay_t *anjay,
@@ -597,31 +659,30 @@ static int dm_observe(anjay_t *anjay,
                       const anjay_request_t *request) {
     anjay_log(DEBUG, "Observe %s", ANJAY_DEBUG_MAKE_PATH(&request->uri));
     assert(_anjay_uri_path_has_oid(&request->uri));
-    char buf[ANJAY_MAX_OBSERVABLE_RESOURCE_SIZE];
+    anjay_observe_buffer_t *buf = &anjay->observe.read_buffer;
     double numeric = NAN;
     anjay_msg_details_t observe_details;
-    ssize_t size = _anjay_dm_read_for_observe(
+    int result = _anjay_dm_read_for_observe(
             anjay, obj, &REQUEST_TO_DM_READ_ARGS(anjay, request),
-            &observe_details, &numeric, buf, sizeof(buf));
-    if (size < 0) {
-        return (int) size;
+            &observe_details, &numeric, buf);
+    if (result) {
+        return result;
     }
     anjay_observe_key_t key;
     build_observe_key(anjay, &key, request);
     int put_entry_result =
             _anjay_observe_put_entry(anjay, &key, &observe_details,
-                                     request_identity, numeric, buf,
-                                     (size_t) size);
+                                     request_identity, numeric, buf->data,
+                                     buf->size);
     if (put_entry_result) {
         // we are unable to create the observation entry, but we can still
         // process the request as usual; compare RFC 7641, section 4.1
         observe_details.observe_serial = false;
     }
-    int result;
     if ((result = _anjay_coap_stream_setup_response(anjay->comm_stream,
                                                     &observe_details))
-            || (result = avs_stream_write(anjay->comm_stream, buf,
-                                          (size_t) size))) {
+            || (result = avs_stream_write(anjay->comm_stream, buf->data,
+                                          buf->size))) {
         if (!put_entry_result) {
             _anjay_observe_remove_entry(anjay, &key);
         }
@@ -1026,6 +1087,7 @@ static int dm_write_attributes(anjay_t *anjay,
 #ifdef WITH_OBSERVE
     if (!result) {
         // ensure that new attributes are "seen" by the observe code
+        _anjay_observe_invalidate_attrs(anjay);
         anjay_observe_key_t key;
         build_observe_key(anjay, &key, request);
         key.format = AVS_COAP_FORMAT_NONE;
@@ -1337,7 +1399,7 @@ int _anjay_dm_perform_action(anjay_t *anjay,
 
     anjay_input_ctx_t *in_ctx = NULL;
     int result;
-    if ((result = prepare_input_context(anjay->comm_stream, request->action,
+    if ((result = prepare_input_context(anjay->comm_stream, request,
                                         &in_ctx))
             || (result = _anjay_coap_stream_setup_response(anjay->comm_stream,
                                                            &msg_details))) {
@@ -1368,17 +1430,17 @@ int _anjay_dm_perform_action(anjay_t *anjay,
 int _anjay_dm_foreach_object(anjay_t *anjay,
                              anjay_dm_foreach_object_handler_t *handler,
                              void *data) {
-    AVS_LIST(const anjay_dm_object_def_t *const *) obj;
-    AVS_LIST_FOREACH(obj, anjay->dm.objects) {
-        assert(*obj && **obj);
+    for (size_t i = 0; i < anjay->dm.objects_count; ++i) {
+        const anjay_dm_object_def_t *const *obj = anjay->dm.objects[i];
+        assert(obj && *obj);
 
-        int result = handler(anjay, *obj, data);
+        int result = handler(anjay, obj, data);
         if (result == ANJAY_FOREACH_BREAK) {
-            anjay_log(DEBUG, "foreach_object: break on /%u", (**obj)->oid);
+            anjay_log(DEBUG, "foreach_object: break on /%u", (*obj)->oid);
             return 0;
         } else if (result) {
             anjay_log(ERROR, "foreach_object_handler failed for /%u (%d)",
-                      (**obj)->oid, result);
+                      (*obj)->oid, result);
             return result;
         }
     }
@@ -1420,11 +1482,9 @@ int _anjay_dm_foreach_instance(anjay_t *anjay,
     return result;
 }
 
-int _anjay_dm_res_read(anjay_t *anjay,
-                       const anjay_uri_path_t *path,
-                       char *buffer,
-                       size_t buffer_size,
-                       size_t *out_bytes_read) {
+static int read_resource_value(anjay_t *anjay,
+                               const anjay_uri_path_t *path,
+                               anjay_output_value_ctx_t *ctx) {
     ASSERT_RESOURCE_PATH(*path);
     const anjay_dm_object_def_t *const *obj =
             _anjay_dm_find_object_by_oid(anjay, path->oid);
@@ -1432,65 +1492,55 @@ int _anjay_dm_res_read(anjay_t *anjay,
         anjay_log(ERROR, "unregistered Object ID: %u", path->oid);
         return -1;
     }
-
-    avs_stream_outbuf_t stream = AVS_STREAM_OUTBUF_STATIC_INITIALIZER;
-    avs_stream_outbuf_set_buffer(&stream, buffer, buffer_size);
-
-    anjay_output_buf_ctx_t ctx = _anjay_output_buf_ctx_init(&stream);
-
     int result = ensure_resource_supported_and_present(anjay, obj, path->iid,
                                                        path->rid);
     if (result) {
         return result;
     }
-    result = read_resource_internal(anjay, obj, path->iid, path->rid,
-                                    (anjay_output_ctx_t *) &ctx);
+    return read_resource_internal(anjay, obj, path->iid, path->rid,
+                                  (anjay_output_ctx_t *) ctx);
+}
+
+int _anjay_dm_res_read(anjay_t *anjay,
+                       const anjay_uri_path_t *path,
+                       char *buffer,
+                       size_t buffer_size,
+                       size_t *out_bytes_read) {
+    anjay_output_value_ctx_t ctx =
+            _anjay_output_value_ctx_init(ANJAY_OUTPUT_VALUE_BYTES, buffer,
+                                         NULL, buffer_size);
+    int result = read_resource_value(anjay, path, &ctx);
     if (out_bytes_read) {
-        *out_bytes_read = avs_stream_outbuf_offset(&stream);
+        *out_bytes_read = ctx.count;
     }
     return result;
 }
 
-struct anjay_dm_multires_read_ctx_struct {
-    anjay_input_ctx_t *input_ctx;
-};
-
-static avs_stream_abstract_t *read_tlv_to_membuf(anjay_t *anjay,
-                                                 const anjay_uri_path_t *path) {
-    ASSERT_RESOURCE_PATH(*path);
-    const anjay_dm_object_def_t *const *obj =
-            _anjay_dm_find_object_by_oid(anjay, path->oid);
-    if (!obj) {
-        anjay_log(ERROR, "unregistered Object ID: %u", path->oid);
-        return NULL;
-    }
-    avs_stream_abstract_t *membuf = avs_stream_membuf_create();
-    if (!membuf) {
-        return NULL;
-    }
-    anjay_output_ctx_t *out = _anjay_output_raw_tlv_create(membuf);
-    if (!out || read_resource(anjay, obj, path->iid, path->rid, out)) {
-        avs_stream_cleanup(&membuf);
-    }
-    _anjay_output_ctx_destroy(&out);
-    return membuf;
+int _anjay_dm_res_read_i64_array(anjay_t *anjay,
+                                 const anjay_uri_path_t *path,
+                                 anjay_riid_t *out_riids,
+                                 int64_t *out_values,
+                                 size_t capacity,
+                                 size_t *out_count) {
+    anjay_output_value_ctx_t ctx =
+            _anjay_output_value_ctx_init(ANJAY_OUTPUT_VALUE_I64, out_values,
+                                         out_riids, capacity);
+    int result = read_resource_value(anjay, path, &ctx);
+    *out_count = ctx.count;
+    return result;
 }
 
-anjay_input_ctx_t *_anjay_dm_read_as_input_ctx(anjay_t *anjay,
-                                               const anjay_uri_path_t *path) {
-    ASSERT_RESOURCE_PATH(*path);
-    avs_stream_abstract_t *membuf = read_tlv_to_membuf(anjay, path);
-    if (!membuf) {
-        return NULL;
-    }
-    anjay_input_ctx_t *out = NULL;
-    if (_anjay_input_tlv_create(&out, &membuf, true)) {
-        anjay_log(ERROR, "could not create the input context");
-        avs_stream_cleanup(&membuf);
-        return NULL;
-    }
-    assert(!membuf);
-    return out;
+int _anjay_dm_res_read_bool(anjay_t *anjay,
+                            const anjay_uri_path_t *path,
+                            bool *out_value) {
+    anjay_output_value_ctx_t ctx =
+            _anjay_output_value_ctx_init(ANJAY_OUTPUT_VALUE_BOOL, out_value,
+                                         NULL, 1);
+    int result = read_resource_value(anjay, path, &ctx);
+    if (result) {
+        return result;
+    }
+    return ctx.count != 1;
 }
 
 anjay_ssid_t _anjay_dm_current_ssid(anjay_t *anjay) {
@@ -36,9 +36,38 @@ typedef struct {
     void *arg;
 } anjay_dm_installed_module_t;
 
+typedef const anjay_dm_object_def_t *const *anjay_dm_object_ptr_t;
+
+typedef struct {
+    anjay_ssid_t ssid;
+    anjay_iid_t iid;
+} anjay_dm_server_iid_t;
+
 struct anjay_dm {
-    AVS_LIST(const anjay_dm_object_def_t *const *) objects;
+    /**
+     * Registered objects, sorted by OID, so that they can be looked up using
+     * binary search.
+     */
+    anjay_dm_object_ptr_t *objects;
+    size_t objects_count;
+    size_t objects_capacity;
     AVS_LIST(anjay_dm_installed_module_t) modules;
+
+    /**
+     * Server Object Instances, sorted by SSID and then IID. Only used if
+     * cache_server_iids is true; filled on first use and discarded whenever
+     * a change to the Server Object is reported.
+     */
+    bool cache_server_iids;
+    bool server_iids_valid;
+    anjay_dm_server_iid_t *server_iids;
+    size_t server_iids_count;
+    size_t server_iids_capacity;
+    /**
+     * If true, sizes of Object Instances in TLV responses are calculated in a
+     * separate pass, so that they can be streamed without being buffered.
+     */
+    bool precompute_tlv_sizes;
 };
 
 void _anjay_dm_cleanup(anjay_t *anjay);
@@ -166,22 +195,22 @@ static inline int _anjay_dm_transaction_rollback(anjay_t *anjay) {
 }
 
 #ifdef WITH_OBSERVE
-ssize_t _anjay_dm_read_for_observe(anjay_t *anjay,
-                                   const anjay_dm_object_def_t *const *obj,
-                                   const anjay_dm_read_args_t *details,
-                                   anjay_msg_details_t *out_details,
-                                   double *out_numeric,
-                                   char *buffer,
-                                   size_t size);
+/**
+ * Serializes the value at the path specified in @p details into
+ * @p out_buffer, replacing its previous contents.
+ */
+int _anjay_dm_read_for_observe(anjay_t *anjay,
+                               const anjay_dm_object_def_t *const *obj,
+                               const anjay_dm_read_args_t *details,
+                               anjay_msg_details_t *out_details,
+                               double *out_numeric,
+                               anjay_observe_buffer_t *out_buffer);
 #endif // WITH_OBSERVE
 
 int _anjay_dm_perform_action(anjay_t *anjay,
                              const avs_coap_msg_identity_t *request_identity,
                              const anjay_request_t *request);
 
-anjay_input_ctx_t *_anjay_dm_read_as_input_ctx(anjay_t *anjay,
-                                               const anjay_uri_path_t *path);
-
 const char *_anjay_debug_make_path__(char *buffer,
                                      size_t buffer_size,
                                      const anjay_uri_path_t *uri);
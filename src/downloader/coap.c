@@ -16,6 +16,7 @@
 
 #include <anjay_config.h>
 
+#include <assert.h>
 #include <inttypes.h>
 
 #include <avsystem/commons/coap/msg_builder.h>
@@ -40,6 +41,43 @@ AVS_STATIC_ASSERT(offsetof(anjay_etag_t, value)
 AVS_STATIC_ASSERT(AVS_ALIGNOF(anjay_etag_t) == AVS_ALIGNOF(anjay_coap_etag_t),
                   coap_etag_alignment_compatible);
 
+typedef enum {
+    /* slot not in use */
+    BLOCK_REQUEST_IDLE,
+    /* request sent, retransmission job scheduled */
+    BLOCK_REQUEST_SENT,
+    /* Separate ACK received, abort job scheduled */
+    BLOCK_REQUEST_SEPARATE,
+    /* response received out of order and stored in the reorder buffer */
+    BLOCK_REQUEST_RECEIVED,
+    /* the block could not be retrieved - the download will be aborted as soon
+     * as all the preceding blocks are passed to the user */
+    BLOCK_REQUEST_FAILED
+} coap_block_request_state_t;
+
+typedef struct {
+    coap_block_request_state_t state;
+    avs_coap_msg_identity_t id;
+    /* offset of the first byte of the requested block */
+    size_t offset;
+
+    /*
+     * BLOCK_REQUEST_SENT: handle to retransmission job.
+     * BLOCK_REQUEST_SEPARATE: handle to a job aborting the transfer if no
+     * Separate Response was received.
+     */
+    anjay_sched_handle_t sched_job;
+    avs_coap_retry_state_t retry_state;
+
+    /* valid in BLOCK_REQUEST_RECEIVED state */
+    size_t payload_size;
+    bool has_more;
+
+    /* valid in BLOCK_REQUEST_FAILED state */
+    int result;
+    int errno_value;
+} coap_block_request_t;
+
 typedef struct {
     anjay_download_ctx_common_t common;
 
@@ -51,26 +89,92 @@ typedef struct {
     avs_net_abstract_socket_t *socket;
     avs_net_resolved_endpoint_t preferred_endpoint;
     char dtls_session_buffer[ANJAY_DTLS_SESSION_BUFFER_SIZE];
-    avs_coap_msg_identity_t last_req_id;
 
     /*
-     * After calling @ref _anjay_downloader_download:
-     *     handle to a job that sends the initial request.
-     * During the download (after sending the initial request):
-     *     handle to retransmission job.
-     * After receiving a separate ACK:
-     *     handle to a job aborting the transfer if no Separate Response was
-     *     received.
+     * Handle to a job that (re)starts requesting blocks from
+     * bytes_downloaded - scheduled by @ref _anjay_downloader_download and
+     * after reconnecting the socket.
      */
     anjay_sched_handle_t sched_job;
-    avs_coap_retry_state_t retry_state;
     avs_coap_tx_params_t tx_params;
+
+    /*
+     * Set after the first response is received. Until then, the block size
+     * that the server is going to use is not known, so only a single request
+     * is sent at a time.
+     */
+    bool block_size_known;
+    /* offset of the next block to request; only valid if num_requests > 0 */
+    size_t next_offset;
+    /* offset past which there is no more data; SIZE_MAX until known */
+    size_t end_offset;
+
+    /*
+     * Responses received out of order are stored here, reorder_stride bytes
+     * per request slot. Allocated on first use, i.e. only if more than one
+     * request is ever in flight.
+     */
+    uint8_t *reorder_buffer;
+    size_t reorder_stride;
+
+    /*
+     * Ring buffer of requests for consecutive blocks, starting at index
+     * first_request. The first one always refers to the block that contains
+     * the byte at bytes_downloaded.
+     */
+    size_t first_request;
+    size_t num_requests;
+    size_t max_requests;
+    coap_block_request_t requests[];
 } anjay_coap_download_ctx_t;
 
+typedef struct {
+    uintptr_t id;
+    size_t request_index;
+} coap_block_request_job_args_t;
+
+static inline coap_block_request_t *
+nth_request(anjay_coap_download_ctx_t *ctx, size_t n) {
+    return &ctx->requests[(ctx->first_request + n) % ctx->max_requests];
+}
+
+static void release_request(anjay_downloader_t *dl,
+                            coap_block_request_t *request) {
+    _anjay_sched_del(_anjay_downloader_get_anjay(dl)->sched,
+                     &request->sched_job);
+    request->state = BLOCK_REQUEST_IDLE;
+}
+
+static void release_first_request(anjay_downloader_t *dl,
+                                  anjay_coap_download_ctx_t *ctx) {
+    assert(ctx->num_requests > 0);
+    release_request(dl, nth_request(ctx, 0));
+    ctx->first_request = (ctx->first_request + 1) % ctx->max_requests;
+    --ctx->num_requests;
+}
+
+/**
+ * Releases all requests after the @p keep first ones.
+ */
+static void release_requests_after(anjay_downloader_t *dl,
+                                   anjay_coap_download_ctx_t *ctx,
+                                   size_t keep) {
+    for (size_t i = keep; i < ctx->num_requests; ++i) {
+        release_request(dl, nth_request(ctx, i));
+    }
+    if (keep < ctx->num_requests) {
+        ctx->num_requests = keep;
+    }
+}
+
 static void cleanup_coap_transfer(anjay_downloader_t *dl,
                                   AVS_LIST(anjay_download_ctx_t) *ctx_ptr) {
     anjay_coap_download_ctx_t *ctx = (anjay_coap_download_ctx_t *) *ctx_ptr;
     _anjay_sched_del(_anjay_downloader_get_anjay(dl)->sched, &ctx->sched_job);
+    for (size_t i = 0; i < ctx->max_requests; ++i) {
+        release_request(dl, &ctx->requests[i]);
+    }
+    avs_free(ctx->reorder_buffer);
     _anjay_url_cleanup(&ctx->uri);
 #ifndef ANJAY_TEST
     avs_net_socket_cleanup(&ctx->socket);
@@ -79,10 +183,11 @@ static void cleanup_coap_transfer(anjay_downloader_t *dl,
 }
 
 static int fill_coap_request_info(avs_coap_msg_info_t *req_info,
-                                  const anjay_coap_download_ctx_t *ctx) {
+                                  const anjay_coap_download_ctx_t *ctx,
+                                  const coap_block_request_t *request) {
     req_info->type = AVS_COAP_MSG_CONFIRMABLE;
     req_info->code = AVS_COAP_CODE_GET;
-    req_info->identity = ctx->last_req_id;
+    req_info->identity = request->id;
 
     AVS_LIST(const anjay_string_t) elem;
     AVS_LIST_FOREACH(elem, ctx->uri.uri_path) {
@@ -101,7 +206,7 @@ static int fill_coap_request_info(avs_coap_msg_info_t *req_info,
     avs_coap_block_info_t block2 = {
         .type = AVS_COAP_BLOCK2,
         .valid = true,
-        .seq_num = (uint32_t) (ctx->bytes_downloaded / ctx->block_size),
+        .seq_num = (uint32_t) (request->offset / ctx->block_size),
         .size = (uint16_t) ctx->block_size,
         .has_more = false
     };
@@ -112,29 +217,35 @@ static int fill_coap_request_info(avs_coap_msg_info_t *req_info,
     return 0;
 }
 
-static void request_coap_block_job(anjay_t *anjay, const void *id_ptr);
+static void request_coap_block_job(anjay_t *anjay, const void *args_ptr);
 
 static int schedule_coap_retransmission(anjay_downloader_t *dl,
-                                        anjay_coap_download_ctx_t *ctx) {
+                                        anjay_coap_download_ctx_t *ctx,
+                                        coap_block_request_t *request) {
     anjay_t *anjay = _anjay_downloader_get_anjay(dl);
+    const coap_block_request_job_args_t args = {
+        .id = ctx->common.id,
+        .request_index = (size_t) (request - ctx->requests)
+    };
 
-    avs_coap_update_retry_state(&ctx->retry_state, &ctx->tx_params,
+    avs_coap_update_retry_state(&request->retry_state, &ctx->tx_params,
                                 &dl->rand_seed);
-    _anjay_sched_del(anjay->sched, &ctx->sched_job);
-    return _anjay_sched(anjay->sched, &ctx->sched_job,
-                        ctx->retry_state.recv_timeout, request_coap_block_job,
-                        &ctx->common.id, sizeof(ctx->common.id));
+    _anjay_sched_del(anjay->sched, &request->sched_job);
+    return _anjay_sched(anjay->sched, &request->sched_job,
+                        request->retry_state.recv_timeout,
+                        request_coap_block_job, &args, sizeof(args));
 }
 
 static int request_coap_block(anjay_downloader_t *dl,
-                              anjay_coap_download_ctx_t *ctx) {
+                              anjay_coap_download_ctx_t *ctx,
+                              const coap_block_request_t *request) {
     anjay_t *anjay = _anjay_downloader_get_anjay(dl);
     avs_coap_msg_info_t info = avs_coap_msg_info_init();
     const avs_coap_msg_t *msg = NULL;
     size_t required_storage_size;
     int result = -1;
 
-    if (fill_coap_request_info(&info, (anjay_coap_download_ctx_t *) ctx)) {
+    if (fill_coap_request_info(&info, ctx, request)) {
         goto finish;
     }
 
@@ -164,27 +275,54 @@ finish:
     return result;
 }
 
-static void request_coap_block_job(anjay_t *anjay, const void *id_ptr) {
-    uintptr_t id = *(const uintptr_t *) id_ptr;
+/**
+ * Marks @p request as impossible to complete. If it is the first one, the
+ * download is aborted immediately; otherwise, the download continues until
+ * either the transfer finishes before reaching the failed block, or all the
+ * preceding blocks are passed to the user.
+ */
+static void fail_request(anjay_downloader_t *dl,
+                         AVS_LIST(anjay_download_ctx_t) *ctx_ptr,
+                         coap_block_request_t *request,
+                         int result,
+                         int errno_value) {
+    anjay_coap_download_ctx_t *ctx = (anjay_coap_download_ctx_t *) *ctx_ptr;
+    if (request == nth_request(ctx, 0)) {
+        _anjay_downloader_abort_transfer(dl, ctx_ptr, result, errno_value);
+    } else {
+        _anjay_sched_del(_anjay_downloader_get_anjay(dl)->sched,
+                         &request->sched_job);
+        request->state = BLOCK_REQUEST_FAILED;
+        request->result = result;
+        request->errno_value = errno_value;
+    }
+}
+
+static void request_coap_block_job(anjay_t *anjay, const void *args_ptr) {
+    const coap_block_request_job_args_t *args =
+            (const coap_block_request_job_args_t *) args_ptr;
 
     AVS_LIST(anjay_download_ctx_t) *ctx_ptr =
-            _anjay_downloader_find_ctx_ptr_by_id(&anjay->downloader, id);
+            _anjay_downloader_find_ctx_ptr_by_id(&anjay->downloader, args->id);
     if (!ctx_ptr) {
-        dl_log(DEBUG, "download id = %" PRIuPTR " not found (expired?)", id);
+        dl_log(DEBUG, "download id = %" PRIuPTR " not found (expired?)",
+               args->id);
         return;
     }
 
     anjay_coap_download_ctx_t *ctx = (anjay_coap_download_ctx_t *) *ctx_ptr;
-    if (ctx->retry_state.retry_count > ctx->tx_params.max_retransmit) {
+    coap_block_request_t *request = &ctx->requests[args->request_index];
+    assert(request->state == BLOCK_REQUEST_SENT);
+    if (request->retry_state.retry_count > ctx->tx_params.max_retransmit) {
         dl_log(ERROR,
                "Limit of retransmissions reached, aborting download "
                "id = %" PRIuPTR,
-               id);
-        _anjay_downloader_abort_transfer(&anjay->downloader, ctx_ptr,
-                                         ANJAY_DOWNLOAD_ERR_FAILED, ETIMEDOUT);
+               args->id);
+        fail_request(&anjay->downloader, ctx_ptr, request,
+                     ANJAY_DOWNLOAD_ERR_FAILED, ETIMEDOUT);
     } else {
-        request_coap_block(&anjay->downloader, ctx);
-        if (schedule_coap_retransmission(&anjay->downloader, ctx)) {
+        request_coap_block(&anjay->downloader, ctx, request);
+        if (schedule_coap_retransmission(&anjay->downloader, ctx, request)) {
             dl_log(WARNING,
                    "could not schedule retransmission for download "
                    "id = %" PRIuPTR,
@@ -206,22 +344,61 @@ static int map_coap_ctx_err_to_errno(int err) {
     }
 }
 
-static int request_next_coap_block(anjay_downloader_t *dl,
-                                   AVS_LIST(anjay_download_ctx_t) *ctx_ptr) {
-    anjay_coap_download_ctx_t *ctx = (anjay_coap_download_ctx_t *) *ctx_ptr;
-    ctx->last_req_id = _anjay_coap_id_source_get(dl->id_source);
-    memset(&ctx->retry_state, 0, sizeof(ctx->retry_state));
+static size_t requests_window_size(anjay_coap_download_ctx_t *ctx) {
+    if (!ctx->block_size_known || ctx->max_requests <= 1) {
+        return 1;
+    }
+    if (!ctx->reorder_buffer) {
+        assert(!ctx->num_requests);
+        ctx->reorder_stride = ctx->block_size;
+        if (!(ctx->reorder_buffer = (uint8_t *) avs_malloc(
+                      ctx->max_requests * ctx->reorder_stride))) {
+            dl_log(WARNING, "could not allocate reorder buffer, falling back "
+                            "to requesting one block at a time");
+            ctx->max_requests = 1;
+            return 1;
+        }
+    }
+    return ctx->max_requests;
+}
 
-    int result;
-    if ((result = request_coap_block(dl, ctx))
-            || (result = schedule_coap_retransmission(dl, ctx))) {
-        dl_log(WARNING,
-               "could not request block starting at %lu "
-               "for download id = %" PRIuPTR,
-               (unsigned long) ctx->bytes_downloaded, ctx->common.id);
-        _anjay_downloader_abort_transfer(dl, ctx_ptr, ANJAY_DOWNLOAD_ERR_FAILED,
-                                         map_coap_ctx_err_to_errno(result));
-        return -1;
+/**
+ * Sends requests for consecutive blocks until there are as many of them in
+ * flight as allowed, or the end of the resource is reached.
+ */
+static int request_next_coap_blocks(anjay_downloader_t *dl,
+                                    AVS_LIST(anjay_download_ctx_t) *ctx_ptr) {
+    anjay_coap_download_ctx_t *ctx = (anjay_coap_download_ctx_t *) *ctx_ptr;
+    if (!ctx->num_requests) {
+        ctx->next_offset =
+                ctx->bytes_downloaded / ctx->block_size * ctx->block_size;
+    }
+
+    const size_t window_size = requests_window_size(ctx);
+    while (ctx->num_requests < window_size
+           && ctx->next_offset < ctx->end_offset) {
+        coap_block_request_t *request = nth_request(ctx, ctx->num_requests);
+        assert(request->state == BLOCK_REQUEST_IDLE);
+        ++ctx->num_requests;
+
+        request->state = BLOCK_REQUEST_SENT;
+        request->id = _anjay_coap_id_source_get(dl->id_source);
+        request->offset = ctx->next_offset;
+        memset(&request->retry_state, 0, sizeof(request->retry_state));
+
+        int result;
+        if ((result = request_coap_block(dl, ctx, request))
+                || (result = schedule_coap_retransmission(dl, ctx, request))) {
+            dl_log(WARNING,
+                   "could not request block starting at %lu "
+                   "for download id = %" PRIuPTR,
+                   (unsigned long) request->offset, ctx->common.id);
+            _anjay_downloader_abort_transfer(dl, ctx_ptr,
+                                             ANJAY_DOWNLOAD_ERR_FAILED,
+                                             map_coap_ctx_err_to_errno(result));
+            return -1;
+        }
+        ctx->next_offset += ctx->block_size;
     }
 
     return 0;
@@ -234,7 +411,10 @@ static void request_next_coap_block_job(anjay_t *anjay, const void *id_ptr) {
     if (!ctx) {
         dl_log(DEBUG, "download id = %" PRIuPTR "expired", id);
     } else {
-        request_next_coap_block(&anjay->downloader, ctx);
+        // (re)start from bytes_downloaded
+        release_requests_after(&anjay->downloader,
+                               (anjay_coap_download_ctx_t *) *ctx, 0);
+        request_next_coap_blocks(&anjay->downloader, ctx);
     }
 }
 
@@ -287,6 +467,7 @@ static inline bool etag_matches(const anjay_coap_etag_t *a,
 
 static int parse_coap_response(const avs_coap_msg_t *msg,
                                anjay_coap_download_ctx_t *ctx,
+                               const coap_block_request_t *request,
                                avs_coap_block_info_t *out_block2,
                                anjay_coap_etag_t *out_etag) {
     if (read_etag(msg, out_etag)) {
@@ -311,8 +492,7 @@ static int parse_coap_response(const avs_coap_msg_t *msg,
         return -1;
     }
 
-    const size_t requested_seq_num = ctx->bytes_downloaded / ctx->block_size;
-    const size_t expected_offset = requested_seq_num * ctx->block_size;
+    const size_t expected_offset = request->offset;
     const size_t obtained_offset = out_block2->seq_num * out_block2->size;
     if (expected_offset != obtained_offset) {
         dl_log(DEBUG,
@@ -340,22 +520,104 @@ static int parse_coap_response(const avs_coap_msg_t *msg,
     return 0;
 }
 
+/**
+ * Passes the contents of the first block in flight to the user and releases
+ * its request.
+ *
+ * @returns 0 if the download shall continue, or a nonzero value if it has
+ *          been finished or aborted.
+ */
+static int deliver_first_block(anjay_downloader_t *dl,
+                               AVS_LIST(anjay_download_ctx_t) *ctx_ptr,
+                               const void *payload,
+                               size_t payload_size,
+                               bool has_more,
+                               const anjay_coap_etag_t *etag) {
+    anjay_coap_download_ctx_t *ctx = (anjay_coap_download_ctx_t *) *ctx_ptr;
+
+    // Resumption from a non-multiple block-size
+    const size_t offset =
+            ctx->bytes_downloaded - nth_request(ctx, 0)->offset;
+    if (offset <= payload_size) {
+        payload = (const char *) payload + offset;
+        payload_size -= offset;
+
+        if (ctx->common.on_next_block(_anjay_downloader_get_anjay(dl),
+                                      (const uint8_t *) payload, payload_size,
+                                      (const anjay_etag_t *) etag,
+                                      ctx->common.user_data)) {
+            _anjay_downloader_abort_transfer(
+                    dl, ctx_ptr, ANJAY_DOWNLOAD_ERR_FAILED, errno);
+            return -1;
+        }
+        ctx->bytes_downloaded += payload_size;
+    }
+
+    release_first_request(dl, ctx);
+    if (!has_more) {
+        dl_log(INFO, "transfer id = %" PRIuPTR " finished", ctx->common.id);
+        _anjay_downloader_abort_transfer(dl, ctx_ptr, 0, 0);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Passes all consecutive blocks already received out of order to the user.
+ */
+static int deliver_buffered_blocks(anjay_downloader_t *dl,
+                                   AVS_LIST(anjay_download_ctx_t) *ctx_ptr) {
+    anjay_coap_download_ctx_t *ctx = (anjay_coap_download_ctx_t *) *ctx_ptr;
+    int result = 0;
+    while (!result && ctx->num_requests > 0) {
+        coap_block_request_t *request = nth_request(ctx, 0);
+        if (request->state == BLOCK_REQUEST_FAILED) {
+            _anjay_downloader_abort_transfer(dl, ctx_ptr, request->result,
+                                             request->errno_value);
+            return -1;
+        } else if (request->state != BLOCK_REQUEST_RECEIVED) {
+            break;
+        }
+        const size_t index = (size_t) (request - ctx->requests);
+        result = deliver_first_block(
+                dl, ctx_ptr, &ctx->reorder_buffer[index * ctx->reorder_stride],
+                request->payload_size, request->has_more, &ctx->etag);
+    }
+    return result;
+}
+
+static void store_out_of_order_block(anjay_coap_download_ctx_t *ctx,
+                                     coap_block_request_t *request,
+                                     const void *payload,
+                                     size_t payload_size,
+                                     bool has_more) {
+    assert(payload_size <= ctx->reorder_stride);
+    const size_t index = (size_t) (request - ctx->requests);
+    memcpy(&ctx->reorder_buffer[index * ctx->reorder_stride], payload,
+           payload_size);
+    request->state = BLOCK_REQUEST_RECEIVED;
+    request->payload_size = payload_size;
+    request->has_more = has_more;
+}
+
 static void handle_coap_response(const avs_coap_msg_t *msg,
                                  anjay_downloader_t *dl,
-                                 AVS_LIST(anjay_download_ctx_t) *ctx_ptr) {
+                                 AVS_LIST(anjay_download_ctx_t) *ctx_ptr,
+                                 coap_block_request_t *request) {
     const uint8_t code = avs_coap_msg_get_code(msg);
     if (code != AVS_COAP_CODE_CONTENT) {
         dl_log(DEBUG, "server responded with %s (expected %s)",
                AVS_COAP_CODE_STRING(code),
                AVS_COAP_CODE_STRING(AVS_COAP_CODE_CONTENT));
-        _anjay_downloader_abort_transfer(dl, ctx_ptr, -code, ECONNREFUSED);
+        fail_request(dl, ctx_ptr, request, -code, ECONNREFUSED);
         return;
     }
 
     anjay_coap_download_ctx_t *ctx = (anjay_coap_download_ctx_t *) *ctx_ptr;
+    const size_t requested_block_size = ctx->block_size;
     avs_coap_block_info_t block2;
     anjay_coap_etag_t etag;
-    if (parse_coap_response(msg, ctx, &block2, &etag)) {
+    if (parse_coap_response(msg, ctx, request, &block2, &etag)) {
         _anjay_downloader_abort_transfer(dl, ctx_ptr, ANJAY_DOWNLOAD_ERR_FAILED,
                                          EINVAL);
         return;
@@ -369,54 +631,93 @@ static void handle_coap_response(const avs_coap_msg_t *msg,
                 dl, ctx_ptr, ANJAY_DOWNLOAD_ERR_EXPIRED, ECONNABORTED);
         return;
     }
+    ctx->block_size_known = true;
 
     const void *payload = avs_coap_msg_payload(msg);
     size_t payload_size = avs_coap_msg_payload_length(msg);
+    const bool is_first = (request == nth_request(ctx, 0));
+
+    if (ctx->block_size != requested_block_size) {
+        // all other requests in flight refer to blocks of the old size,
+        // so we need to start over after the first one
+        release_requests_after(dl, ctx, 1);
+        ctx->next_offset = nth_request(ctx, 0)->offset + ctx->block_size;
+        if (!is_first) {
+            request_next_coap_blocks(dl, ctx_ptr);
+            return;
+        }
+    }
 
-    // Resumption from a non-multiple block-size
-    size_t offset = ctx->bytes_downloaded % ctx->block_size;
-    if (offset) {
-        payload = (const char *) payload + offset;
-        payload_size -= offset;
+    if (!block2.has_more) {
+        // no need to wait for responses past the end of the resource
+        ctx->end_offset = request->offset + payload_size;
+        for (size_t i = 0; i < ctx->num_requests; ++i) {
+            if (nth_request(ctx, i) == request) {
+                release_requests_after(dl, ctx, i + 1);
+                break;
+            }
+        }
     }
 
-    if (ctx->common.on_next_block(_anjay_downloader_get_anjay(dl),
-                                  (const uint8_t *) payload, payload_size,
-                                  (const anjay_etag_t *) &etag,
-                                  ctx->common.user_data)) {
-        _anjay_downloader_abort_transfer(dl, ctx_ptr, ANJAY_DOWNLOAD_ERR_FAILED,
-                                         errno);
+    if (!is_first) {
+        if (payload_size > ctx->reorder_stride) {
+            dl_log(DEBUG, "malformed response: block larger than requested");
+            _anjay_downloader_abort_transfer(
+                    dl, ctx_ptr, ANJAY_DOWNLOAD_ERR_FAILED, EINVAL);
+            return;
+        }
+        dl_log(TRACE, "transfer id = %" PRIuPTR ": block at offset %lu "
+                      "received out of order",
+               ctx->common.id, (unsigned long) request->offset);
+        _anjay_sched_del(_anjay_downloader_get_anjay(dl)->sched,
+                         &request->sched_job);
+        store_out_of_order_block(ctx, request, payload, payload_size,
+                                 block2.has_more);
         return;
     }
 
-    ctx->bytes_downloaded += payload_size;
-    if (!block2.has_more) {
-        dl_log(INFO, "transfer id = %" PRIuPTR " finished", ctx->common.id);
-        _anjay_downloader_abort_transfer(dl, ctx_ptr, 0, 0);
-    } else if (!request_next_coap_block(dl, ctx_ptr)) {
+    if (!deliver_first_block(dl, ctx_ptr, payload, payload_size,
+                             block2.has_more, &etag)
+            && !deliver_buffered_blocks(dl, ctx_ptr)
+            && !request_next_coap_blocks(dl, ctx_ptr)) {
         dl_log(TRACE, "transfer id = %" PRIuPTR ": %lu B downloaded",
                ctx->common.id, (unsigned long) ctx->bytes_downloaded);
     }
 }
 
-static void abort_transfer_job(anjay_t *anjay, const void *ctx_) {
-    AVS_LIST(anjay_download_ctx_t) ctx =
-            *(AVS_LIST(anjay_download_ctx_t) const *) ctx_;
+static void abort_transfer_job(anjay_t *anjay, const void *args_ptr) {
+    const coap_block_request_job_args_t *args =
+            (const coap_block_request_job_args_t *) args_ptr;
     AVS_LIST(anjay_download_ctx_t) *ctx_ptr =
-            // IAR compiler does not support typeof, so AVS_LIST_FIND_PTR
-            // returns void**, which is not implicitly-convertible
-            (AVS_LIST(anjay_download_ctx_t) *) AVS_LIST_FIND_PTR(
-                    &anjay->downloader.downloads, ctx);
+            _anjay_downloader_find_ctx_ptr_by_id(&anjay->downloader, args->id);
 
     if (!ctx_ptr) {
         anjay_log(WARNING, "transfer already aborted");
     } else {
         anjay_log(WARNING, "aborting download: response not received");
-        _anjay_downloader_abort_transfer(&anjay->downloader, ctx_ptr,
-                                         ANJAY_DOWNLOAD_ERR_FAILED, ETIMEDOUT);
+        anjay_coap_download_ctx_t *ctx = (anjay_coap_download_ctx_t *) *ctx_ptr;
+        fail_request(&anjay->downloader, ctx_ptr,
+                     &ctx->requests[args->request_index],
+                     ANJAY_DOWNLOAD_ERR_FAILED, ETIMEDOUT);
     }
 }
 
+static coap_block_request_t *find_request(anjay_coap_download_ctx_t *ctx,
+                                          const avs_coap_msg_t *msg,
+                                          bool msg_id_must_match) {
+    for (size_t i = 0; i < ctx->num_requests; ++i) {
+        coap_block_request_t *request = nth_request(ctx, i);
+        if ((request->state == BLOCK_REQUEST_SENT
+             || request->state == BLOCK_REQUEST_SEPARATE)
+                && avs_coap_msg_token_matches(msg, &request->id)
+                && (!msg_id_must_match
+                    || avs_coap_msg_get_id(msg) == request->id.msg_id)) {
+            return request;
+        }
+    }
+    return NULL;
+}
+
 static void handle_coap_message(anjay_downloader_t *dl,
                                 AVS_LIST(anjay_download_ctx_t) *ctx_ptr) {
     anjay_t *anjay = _anjay_downloader_get_anjay(dl);
@@ -450,17 +751,15 @@ static void handle_coap_message(anjay_downloader_t *dl,
         return;
     }
 
-    if (!avs_coap_msg_token_matches(msg, &ctx->last_req_id)) {
-        dl_log(DEBUG, "token mismatch, ignoring");
+    coap_block_request_t *request = find_request(ctx, msg, msg_id_must_match);
+    if (!request) {
+        dl_log(DEBUG, "no matching request for msg id %u, ignoring",
+               avs_coap_msg_get_id(msg));
         return;
     }
 
     if (msg_id_must_match) {
-        if (avs_coap_msg_get_id(msg) != ctx->last_req_id.msg_id) {
-            dl_log(DEBUG, "msg id mismatch (got %u, expected %u), ignoring",
-                   avs_coap_msg_get_id(msg), ctx->last_req_id.msg_id);
-            return;
-        } else if (type == AVS_COAP_MSG_RESET) {
+        if (type == AVS_COAP_MSG_RESET) {
             dl_log(DEBUG, "Reset response, aborting transfer");
             _anjay_downloader_abort_transfer(
                     dl, ctx_ptr, ANJAY_DOWNLOAD_ERR_FAILED, ECONNREFUSED);
@@ -474,9 +773,14 @@ static void handle_coap_message(anjay_downloader_t *dl,
                    "%" PRId64 ".%09" PRId32 " for response",
                    abort_delay.seconds, abort_delay.nanoseconds);
 
-            _anjay_sched_del(anjay->sched, &ctx->sched_job);
-            _anjay_sched(anjay->sched, &ctx->sched_job, abort_delay,
-                         abort_transfer_job, ctx_ptr, sizeof(*ctx_ptr));
+            const coap_block_request_job_args_t args = {
+                .id = ctx->common.id,
+                .request_index = (size_t) (request - ctx->requests)
+            };
+            request->state = BLOCK_REQUEST_SEPARATE;
+            _anjay_sched_del(anjay->sched, &request->sched_job);
+            _anjay_sched(anjay->sched, &request->sched_job, abort_delay,
+                         abort_transfer_job, &args, sizeof(args));
             return;
         }
     } else {
@@ -486,7 +790,7 @@ static void handle_coap_message(anjay_downloader_t *dl,
                                 avs_coap_msg_get_id(msg));
     }
 
-    handle_coap_response(msg, dl, ctx_ptr);
+    handle_coap_response(msg, dl, ctx_ptr, request);
 }
 
 static int get_coap_socket(anjay_downloader_t *dl,
@@ -560,12 +864,22 @@ int _anjay_downloader_coap_ctx_new(anjay_downloader_t *dl,
                                    uintptr_t id) {
     anjay_t *anjay = _anjay_downloader_get_anjay(dl);
     assert(!*out_dl_ctx);
+    const size_t max_requests =
+            cfg->coap_max_blocks_in_flight ? cfg->coap_max_blocks_in_flight : 1;
+    if (max_requests > (SIZE_MAX - sizeof(anjay_coap_download_ctx_t))
+                               / sizeof(coap_block_request_t)) {
+        dl_log(ERROR, "invalid download config: too many blocks in flight");
+        return -EINVAL;
+    }
     AVS_LIST(anjay_coap_download_ctx_t) ctx =
-            AVS_LIST_NEW_ELEMENT(anjay_coap_download_ctx_t);
+            (AVS_LIST(anjay_coap_download_ctx_t)) AVS_LIST_NEW_BUFFER(
+                    sizeof(anjay_coap_download_ctx_t)
+                    + max_requests * sizeof(coap_block_request_t));
     if (!ctx) {
         dl_log(ERROR, "out of memory");
         return -ENOMEM;
     }
+    ctx->max_requests = max_requests;
 
     avs_net_ssl_configuration_t ssl_config;
     int result = 0;
@@ -652,6 +966,7 @@ int _anjay_downloader_coap_ctx_new(anjay_downloader_t *dl,
     ctx->common.user_data = cfg->user_data;
     ctx->bytes_downloaded = cfg->start_offset;
     ctx->block_size = get_max_acceptable_block_size(anjay->in_buffer_size);
+    ctx->end_offset = SIZE_MAX;
     if (cfg->etag) {
         ctx->etag.size = cfg->etag->size;
         memcpy(ctx->etag.value, cfg->etag->value, ctx->etag.size);
@@ -350,6 +350,65 @@ AVS_UNIT_TEST(downloader, coap_download_multiple_blocks) {
     teardown_simple();
 }
 
+AVS_UNIT_TEST(downloader, coap_download_pipelined_out_of_order) {
+    static const size_t BLOCK_SIZE = 32;
+
+    setup_simple("coap://127.0.0.1:5683");
+    SIMPLE_ENV.cfg.coap_max_blocks_in_flight = 2;
+
+    const avs_coap_msg_t *req0 = COAP_MSG(CON, GET, ID(0), BLOCK2(0, 1024, ""));
+    const avs_coap_msg_t *res0 =
+            COAP_MSG(ACK, CONTENT, ID(0), BLOCK2(0, BLOCK_SIZE, DESPAIR));
+    const avs_coap_msg_t *req1 =
+            COAP_MSG(CON, GET, ID(1), BLOCK2(1, BLOCK_SIZE, ""));
+    const avs_coap_msg_t *res1 =
+            COAP_MSG(ACK, CONTENT, ID(1), BLOCK2(1, BLOCK_SIZE, DESPAIR));
+    const avs_coap_msg_t *req2 =
+            COAP_MSG(CON, GET, ID(2), BLOCK2(2, BLOCK_SIZE, ""));
+    const avs_coap_msg_t *res2 =
+            COAP_MSG(ACK, CONTENT, ID(2), BLOCK2(2, BLOCK_SIZE, DESPAIR));
+    const avs_coap_msg_t *req3 =
+            COAP_MSG(CON, GET, ID(3), BLOCK2(3, BLOCK_SIZE, ""));
+    const avs_coap_msg_t *res3 =
+            COAP_MSG(ACK, CONTENT, ID(3), BLOCK2(3, BLOCK_SIZE, DESPAIR));
+    // past the end of the resource, but we don't know that yet
+    const avs_coap_msg_t *req4 =
+            COAP_MSG(CON, GET, ID(4), BLOCK2(4, BLOCK_SIZE, ""));
+
+    avs_unit_mocksock_expect_connect(SIMPLE_ENV.mocksock, "127.0.0.1", "5683");
+    avs_unit_mocksock_expect_output(SIMPLE_ENV.mocksock, &req0->content,
+                                    req0->length);
+    avs_unit_mocksock_input(SIMPLE_ENV.mocksock, &res0->content, res0->length);
+    avs_unit_mocksock_expect_output(SIMPLE_ENV.mocksock, &req1->content,
+                                    req1->length);
+    avs_unit_mocksock_expect_output(SIMPLE_ENV.mocksock, &req2->content,
+                                    req2->length);
+    avs_unit_mocksock_input(SIMPLE_ENV.mocksock, &res2->content, res2->length);
+    avs_unit_mocksock_input(SIMPLE_ENV.mocksock, &res1->content, res1->length);
+    avs_unit_mocksock_expect_output(SIMPLE_ENV.mocksock, &req3->content,
+                                    req3->length);
+    avs_unit_mocksock_expect_output(SIMPLE_ENV.mocksock, &req4->content,
+                                    req4->length);
+    avs_unit_mocksock_input(SIMPLE_ENV.mocksock, &res3->content, res3->length);
+
+    // blocks are still passed to the user in order
+    for (size_t i = 0; i * BLOCK_SIZE < sizeof(DESPAIR) - 1; ++i) {
+        on_next_block_args_t args = {
+            .data_size = AVS_MIN(BLOCK_SIZE,
+                                 sizeof(DESPAIR) - 1 - i * BLOCK_SIZE),
+            .result = 0
+        };
+        memcpy(args.data, &DESPAIR[i * BLOCK_SIZE], args.data_size);
+        expect_next_block(&SIMPLE_ENV.data, args);
+    }
+    expect_download_finished(&SIMPLE_ENV.data, 0);
+
+    perform_simple_download();
+    AVS_UNIT_ASSERT_NULL(SIMPLE_ENV.data.on_next_block_calls);
+
+    teardown_simple();
+}
+
 AVS_UNIT_TEST(downloader, download_abort_on_cleanup) {
     setup_simple("coap://127.0.0.1:5683");
 
@@ -0,0 +1,291 @@
+/*
+ * Copyright 2017-2018 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <anjay_config.h>
+
+#include <assert.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <avsystem/commons/coap/ctx.h>
+
+#include "anjay_core.h"
+#include "exchange.h"
+#include "servers_utils.h"
+
+VISIBILITY_SOURCE_BEGIN
+
+struct anjay_exchange {
+    anjay_connection_key_t key;
+    uint16_t msg_id;
+    avs_coap_retry_state_t retry_state;
+    // retransmission job, or Separate Response timeout job after the request
+    // has been acknowledged with an empty message
+    anjay_sched_handle_t job;
+    anjay_exchange_finished_t *on_finished;
+    avs_coap_msg_t *msg;
+};
+
+void _anjay_exchanges_init(anjay_exchanges_t *exchanges) {
+    exchanges->exchanges = NULL;
+    exchanges->rand_seed =
+            (anjay_rand_seed_t) avs_time_real_now().since_real_epoch.seconds;
+}
+
+static void delete_exchange(anjay_t *anjay,
+                            AVS_LIST(anjay_exchange_t) *exchange_ptr) {
+    _anjay_sched_del(anjay->sched, &(*exchange_ptr)->job);
+    avs_free((*exchange_ptr)->msg);
+    AVS_LIST_DELETE(exchange_ptr);
+}
+
+void _anjay_exchanges_cleanup(anjay_t *anjay) {
+    while (anjay->exchanges.exchanges) {
+        delete_exchange(anjay, &anjay->exchanges.exchanges);
+    }
+}
+
+static AVS_LIST(anjay_exchange_t) *
+find_exchange_ptr(anjay_t *anjay, anjay_connection_key_t key, uint16_t msg_id) {
+    AVS_LIST(anjay_exchange_t) *exchange_ptr;
+    AVS_LIST_FOREACH_PTR(exchange_ptr, &anjay->exchanges.exchanges) {
+        if ((*exchange_ptr)->msg_id == msg_id
+                && (*exchange_ptr)->key.ssid == key.ssid
+                && (*exchange_ptr)->key.type == key.type) {
+            return exchange_ptr;
+        }
+    }
+    return NULL;
+}
+
+static AVS_LIST(anjay_exchange_t) *
+find_request_exchange_ptr(anjay_t *anjay,
+                          anjay_connection_key_t key,
+                          const avs_coap_msg_t *response) {
+    const avs_coap_token_t token = avs_coap_msg_get_token(response);
+    AVS_LIST(anjay_exchange_t) *exchange_ptr;
+    AVS_LIST_FOREACH_PTR(exchange_ptr, &anjay->exchanges.exchanges) {
+        if ((*exchange_ptr)->key.ssid == key.ssid
+                && (*exchange_ptr)->key.type == key.type
+                && avs_coap_msg_is_request((*exchange_ptr)->msg)) {
+            const avs_coap_token_t request_token =
+                    avs_coap_msg_get_token((*exchange_ptr)->msg);
+            if (avs_coap_token_equal(&token, &request_token)) {
+                return exchange_ptr;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void finish_exchange(anjay_t *anjay,
+                            AVS_LIST(anjay_exchange_t) *exchange_ptr,
+                            anjay_exchange_result_t result,
+                            const avs_coap_msg_t *response) {
+    anjay_connection_key_t key = (*exchange_ptr)->key;
+    uint16_t msg_id = (*exchange_ptr)->msg_id;
+    anjay_exchange_finished_t *on_finished = (*exchange_ptr)->on_finished;
+    delete_exchange(anjay, exchange_ptr);
+    // the handler may start or cancel other exchanges, so it must only be
+    // called after we're done modifying the list
+    on_finished(anjay, key, msg_id, result, response);
+}
+
+static avs_net_abstract_socket_t *
+get_online_socket(anjay_t *anjay, anjay_connection_key_t key) {
+    const anjay_connection_ref_t ref = {
+        .server = _anjay_servers_find_active(anjay, key.ssid),
+        .conn_type = key.type
+    };
+    return ref.server ? _anjay_connection_get_online_socket(ref) : NULL;
+}
+
+static void retransmit_job(anjay_t *anjay, const void *exchange_ptr_);
+
+static int schedule_retransmission(anjay_t *anjay,
+                                   anjay_exchange_t *exchange) {
+    avs_coap_update_retry_state(
+            &exchange->retry_state,
+            _anjay_tx_params_for_conn_type(anjay, exchange->key.type),
+            &anjay->exchanges.rand_seed);
+    return _anjay_sched(anjay->sched, &exchange->job,
+                        exchange->retry_state.recv_timeout, retransmit_job,
+                        &exchange, sizeof(exchange));
+}
+
+static void retransmit_job(anjay_t *anjay, const void *exchange_ptr_) {
+    anjay_exchange_t *exchange = *(anjay_exchange_t *const *) exchange_ptr_;
+    AVS_LIST(anjay_exchange_t) *exchange_ptr =
+            find_exchange_ptr(anjay, exchange->key, exchange->msg_id);
+    assert(exchange_ptr && *exchange_ptr == exchange);
+
+    if (exchange->retry_state.retry_count
+            > _anjay_tx_params_for_conn_type(anjay, exchange->key.type)
+                      ->max_retransmit) {
+        anjay_log(DEBUG,
+                  "no response to message ID %" PRIu16 " for SSID %" PRIu16,
+                  exchange->msg_id, exchange->key.ssid);
+        finish_exchange(anjay, exchange_ptr, ANJAY_EXCHANGE_TIMEOUT, NULL);
+        return;
+    }
+
+    avs_net_abstract_socket_t *socket = get_online_socket(anjay, exchange->key);
+    if (!socket) {
+        anjay_log(DEBUG, "server SSID %" PRIu16 " is not online, abandoning "
+                         "message ID %" PRIu16,
+                  exchange->key.ssid, exchange->msg_id);
+        finish_exchange(anjay, exchange_ptr, ANJAY_EXCHANGE_FAILED, NULL);
+        return;
+    }
+
+    anjay_log(TRACE, "retransmitting message ID %" PRIu16, exchange->msg_id);
+    int result = avs_coap_ctx_send(anjay->coap_ctx, socket, exchange->msg);
+    if (result) {
+        anjay_log(DEBUG, "could not retransmit message ID %" PRIu16 ": %d",
+                  exchange->msg_id, result);
+    }
+    if (schedule_retransmission(anjay, exchange)) {
+        anjay_log(ERROR, "could not schedule retransmission");
+        finish_exchange(anjay, exchange_ptr, ANJAY_EXCHANGE_FAILED, NULL);
+    }
+}
+
+static void separate_response_timeout_job(anjay_t *anjay,
+                                          const void *exchange_ptr_) {
+    anjay_exchange_t *exchange = *(anjay_exchange_t *const *) exchange_ptr_;
+    AVS_LIST(anjay_exchange_t) *exchange_ptr =
+            find_exchange_ptr(anjay, exchange->key, exchange->msg_id);
+    assert(exchange_ptr && *exchange_ptr == exchange);
+
+    anjay_log(DEBUG,
+              "no Separate Response to message ID %" PRIu16
+              " for SSID %" PRIu16,
+              exchange->msg_id, exchange->key.ssid);
+    finish_exchange(anjay, exchange_ptr, ANJAY_EXCHANGE_TIMEOUT, NULL);
+}
+
+static void
+wait_for_separate_response(anjay_t *anjay,
+                           AVS_LIST(anjay_exchange_t) *exchange_ptr) {
+    anjay_exchange_t *exchange = *exchange_ptr;
+    anjay_log(TRACE, "empty Acknowledgement received for message ID %" PRIu16
+                     ", waiting for Separate Response",
+              exchange->msg_id);
+    _anjay_sched_del(anjay->sched, &exchange->job);
+    if (_anjay_sched(anjay->sched, &exchange->job,
+                     AVS_COAP_SEPARATE_RESPONSE_TIMEOUT,
+                     separate_response_timeout_job, &exchange,
+                     sizeof(exchange))) {
+        anjay_log(ERROR, "could not schedule Separate Response timeout");
+        finish_exchange(anjay, exchange_ptr, ANJAY_EXCHANGE_FAILED, NULL);
+    }
+}
+
+static int handle_separate_response(anjay_t *anjay,
+                                    anjay_connection_key_t key,
+                                    const avs_coap_msg_t *msg) {
+    // the Separate Response may also arrive before the empty Acknowledgement,
+    // if the latter got lost, so the state of the exchange is not checked
+    AVS_LIST(anjay_exchange_t) *exchange_ptr =
+            find_request_exchange_ptr(anjay, key, msg);
+    if (!exchange_ptr) {
+        return 1;
+    }
+    anjay_log(TRACE, "Separate Response received for message ID %" PRIu16,
+              (*exchange_ptr)->msg_id);
+    avs_net_abstract_socket_t *socket;
+    if (avs_coap_msg_get_type(msg) == AVS_COAP_MSG_CONFIRMABLE
+            && (socket = get_online_socket(anjay, key))) {
+        avs_coap_ctx_send_empty(anjay->coap_ctx, socket,
+                                AVS_COAP_MSG_ACKNOWLEDGEMENT,
+                                avs_coap_msg_get_id(msg));
+    }
+    finish_exchange(anjay, exchange_ptr, ANJAY_EXCHANGE_ACKED, msg);
+    return 0;
+}
+
+int _anjay_exchange_start(anjay_t *anjay,
+                          anjay_connection_key_t key,
+                          const avs_coap_msg_t *msg,
+                          anjay_exchange_finished_t *on_finished) {
+    assert(avs_coap_msg_get_type(msg) == AVS_COAP_MSG_CONFIRMABLE);
+    assert(on_finished);
+
+    const size_t msg_size = offsetof(avs_coap_msg_t, content) + msg->length;
+    AVS_LIST(anjay_exchange_t) exchange =
+            AVS_LIST_NEW_ELEMENT(anjay_exchange_t);
+    if (!exchange
+            || !(exchange->msg = (avs_coap_msg_t *) avs_malloc(msg_size))) {
+        anjay_log(ERROR, "Out of memory");
+        AVS_LIST_CLEAR(&exchange);
+        return -1;
+    }
+    memcpy(exchange->msg, msg, msg_size);
+    exchange->key = key;
+    exchange->msg_id = avs_coap_msg_get_id(msg);
+    exchange->on_finished = on_finished;
+
+    if (schedule_retransmission(anjay, exchange)) {
+        anjay_log(ERROR, "could not schedule retransmission");
+        avs_free(exchange->msg);
+        AVS_LIST_CLEAR(&exchange);
+        return -1;
+    }
+    AVS_LIST_INSERT(&anjay->exchanges.exchanges, exchange);
+    return 0;
+}
+
+void _anjay_exchange_cancel(anjay_t *anjay,
+                            anjay_connection_key_t key,
+                            uint16_t msg_id) {
+    AVS_LIST(anjay_exchange_t) *exchange_ptr =
+            find_exchange_ptr(anjay, key, msg_id);
+    if (exchange_ptr) {
+        delete_exchange(anjay, exchange_ptr);
+    }
+}
+
+int _anjay_exchange_handle_response(anjay_t *anjay,
+                                    anjay_connection_key_t key,
+                                    const avs_coap_msg_t *msg) {
+    assert(!avs_coap_msg_is_request(msg));
+    avs_coap_msg_type_t type = avs_coap_msg_get_type(msg);
+    if (type == AVS_COAP_MSG_CONFIRMABLE
+            || type == AVS_COAP_MSG_NON_CONFIRMABLE) {
+        return handle_separate_response(anjay, key, msg);
+    }
+
+    AVS_LIST(anjay_exchange_t) *exchange_ptr =
+            find_exchange_ptr(anjay, key, avs_coap_msg_get_id(msg));
+    if (!exchange_ptr) {
+        return 1;
+    }
+    if (type == AVS_COAP_MSG_ACKNOWLEDGEMENT
+            && avs_coap_msg_get_code(msg) == AVS_COAP_CODE_EMPTY
+            && avs_coap_msg_is_request((*exchange_ptr)->msg)) {
+        wait_for_separate_response(anjay, exchange_ptr);
+        return 0;
+    }
+    anjay_log(TRACE, "%s received for message ID %" PRIu16,
+              type == AVS_COAP_MSG_RESET ? "Reset" : "Acknowledgement",
+              (*exchange_ptr)->msg_id);
+    if (type == AVS_COAP_MSG_RESET) {
+        finish_exchange(anjay, exchange_ptr, ANJAY_EXCHANGE_RESET, NULL);
+    } else {
+        finish_exchange(anjay, exchange_ptr, ANJAY_EXCHANGE_ACKED, msg);
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2017-2018 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANJAY_EXCHANGE_H
+#define ANJAY_EXCHANGE_H
+
+#include <avsystem/commons/coap/msg.h>
+#include <avsystem/commons/coap/tx_params.h>
+#include <avsystem/commons/list.h>
+
+#include <anjay_modules/sched.h>
+
+#include "servers.h"
+#include "utils_core.h"
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+typedef enum {
+    /** The message has been acknowledged by the server */
+    ANJAY_EXCHANGE_ACKED,
+    /** The server responded with Reset */
+    ANJAY_EXCHANGE_RESET,
+    /** Retransmission limit has been reached without a response */
+    ANJAY_EXCHANGE_TIMEOUT,
+    /** Retransmission could not be performed, e.g. the server went offline */
+    ANJAY_EXCHANGE_FAILED
+} anjay_exchange_result_t;
+
+/**
+ * Called exactly once for each exchange started with
+ * @ref _anjay_exchange_start, unless it is cancelled earlier using
+ * @ref _anjay_exchange_cancel . The exchange is already removed from the
+ * table when this is called.
+ *
+ * There is no user data pointer on purpose - the exchange may easily outlive
+ * whatever state started it, so the handler is expected to look up its state
+ * using @p key and @p msg_id instead.
+ *
+ * @p response is the message that finished the exchange if @p result is
+ * ANJAY_EXCHANGE_ACKED - the Acknowledgement or, for requests, the Separate
+ * Response - and NULL otherwise. It is only valid during the call.
+ */
+typedef void anjay_exchange_finished_t(anjay_t *anjay,
+                                       anjay_connection_key_t key,
+                                       uint16_t msg_id,
+                                       anjay_exchange_result_t result,
+                                       const avs_coap_msg_t *response);
+
+typedef struct anjay_exchange anjay_exchange_t;
+
+typedef struct {
+    AVS_LIST(anjay_exchange_t) exchanges;
+    anjay_rand_seed_t rand_seed;
+} anjay_exchanges_t;
+
+void _anjay_exchanges_init(anjay_exchanges_t *exchanges);
+
+/**
+ * Cancels all pending exchanges without calling their finish handlers.
+ */
+void _anjay_exchanges_cleanup(anjay_t *anjay);
+
+/**
+ * Starts tracking a Confirmable message @p msg that has just been sent for
+ * the first time over the connection identified by @p key. Retransmissions are
+ * performed by scheduler jobs, according to the transmission parameters
+ * appropriate for the connection type, and the response is expected to be
+ * passed to @ref _anjay_exchange_handle_response from @ref anjay_serve .
+ *
+ * @p msg is copied, so it does not need to outlive the call.
+ *
+ * @returns 0 on success, negative value in case of error, in which case
+ *          @p on_finished will never be called.
+ */
+int _anjay_exchange_start(anjay_t *anjay,
+                          anjay_connection_key_t key,
+                          const avs_coap_msg_t *msg,
+                          anjay_exchange_finished_t *on_finished);
+
+/**
+ * Removes the exchange for message @p msg_id sent over @p key connection, if
+ * there is one, without calling its finish handler.
+ */
+void _anjay_exchange_cancel(anjay_t *anjay,
+                            anjay_connection_key_t key,
+                            uint16_t msg_id);
+
+/**
+ * Matches an incoming response message against pending exchanges on the @p key
+ * connection and finishes the matching one. Acknowledgement and Reset messages
+ * are matched by message ID, Confirmable and Non-confirmable ones by token, as
+ * Separate Responses to requests. An empty Acknowledgement to a request does
+ * not finish the exchange, but makes it wait for the Separate Response.
+ *
+ * @returns 0 if the message has been handled, or a positive value if there is
+ *          no exchange it is related to.
+ */
+int _anjay_exchange_handle_response(anjay_t *anjay,
+                                    anjay_connection_key_t key,
+                                    const avs_coap_msg_t *msg);
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif /* ANJAY_EXCHANGE_H */
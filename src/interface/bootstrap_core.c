@@ -610,7 +610,7 @@ static int invoke_action(anjay_t *anjay, const anjay_request_t *request) {
     switch (request->action) {
     case ANJAY_ACTION_WRITE:
         if ((result = _anjay_input_dynamic_create(&in_ctx, &anjay->comm_stream,
-                                                  false))) {
+                                                  false, &request->uri))) {
             anjay_log(ERROR, "could not create input context");
             return result;
         }
@@ -154,8 +154,62 @@ get_server_lifetime(anjay_t *anjay, anjay_ssid_t ssid, int64_t *out_lifetime) {
     return 0;
 }
 
+static AVS_LIST(anjay_dm_cache_object_t)
+objects_to_send(anjay_t *anjay, const anjay_update_parameters_t *params) {
+    return anjay->registration_objects.enabled
+                   ? anjay->registration_objects.objects
+                   : params->dm;
+}
+
+static int finish_registration_request(anjay_t *anjay,
+                                       anjay_exchange_finished_t *on_finished,
+                                       uint16_t *out_msg_id) {
+    const anjay_connection_key_t key = {
+        .ssid = _anjay_dm_current_ssid(anjay),
+        .type = anjay->current_connection.conn_type
+    };
+    avs_coap_msg_identity_t identity;
+    int result = _anjay_coap_stream_get_request_identity(anjay->comm_stream,
+                                                         &identity);
+    if (result) {
+        return result;
+    }
+    const uint16_t msg_id = identity.msg_id;
+    *out_msg_id = msg_id;
+
+    const avs_coap_msg_t *sent_con = NULL;
+    if (!(result = _anjay_coap_stream_finish_request_async(anjay->comm_stream,
+                                                           &sent_con))
+            && sent_con) {
+        return _anjay_exchange_start(anjay, key, sent_con, on_finished);
+    }
+
+    // block-wise requests are performed synchronously, so the outcome is
+    // already known - report it just like the exchange would
+    if (result == AVS_COAP_CTX_ERR_TIMEOUT) {
+        on_finished(anjay, key, msg_id, ANJAY_EXCHANGE_TIMEOUT, NULL);
+        return 0;
+    } else if (result > 0) {
+        on_finished(anjay, key, msg_id, ANJAY_EXCHANGE_RESET, NULL);
+        return 0;
+    } else if (result) {
+        return result;
+    }
+
+    const avs_coap_msg_t *response;
+    if ((result = _anjay_coap_stream_get_incoming_msg(anjay->comm_stream,
+                                                      &response))) {
+        anjay_log(ERROR, "could not get response");
+        return result;
+    }
+    on_finished(anjay, key, msg_id, ANJAY_EXCHANGE_ACKED, response);
+    return 0;
+}
+
 static int send_register(anjay_t *anjay,
-                         const anjay_update_parameters_t *params) {
+                         const anjay_update_parameters_t *params,
+                         anjay_exchange_finished_t *on_finished,
+                         uint16_t *out_msg_id) {
     const anjay_url_t *const connection_uri =
             _anjay_connection_uri(anjay->current_connection);
     anjay_msg_details_t details = {
@@ -184,8 +238,10 @@ static int send_register(anjay_t *anjay,
 
     if ((result = _anjay_coap_stream_setup_request(anjay->comm_stream, &details,
                                                    NULL))
-            || (result = send_objects_list(anjay->comm_stream, params->dm))
-            || (result = avs_stream_finish_message(anjay->comm_stream))) {
+            || (result = send_objects_list(anjay->comm_stream,
+                                           objects_to_send(anjay, params)))
+            || (result = finish_registration_request(anjay, on_finished,
+                                                     out_msg_id))) {
         anjay_log(ERROR, "could not send Register message");
     } else {
         anjay_log(INFO, "Register sent");
@@ -197,15 +253,9 @@ cleanup:
     return result;
 }
 
-static int
-check_register_response(avs_stream_abstract_t *stream,
-                        AVS_LIST(const anjay_string_t) *out_endpoint_path) {
-    const avs_coap_msg_t *response;
-    if (_anjay_coap_stream_get_incoming_msg(stream, &response)) {
-        anjay_log(ERROR, "could not get response");
-        return -1;
-    }
-
+int _anjay_register_check_response(
+        const avs_coap_msg_t *response,
+        AVS_LIST(const anjay_string_t) *out_endpoint_path) {
     if (avs_coap_msg_get_code(response) != AVS_COAP_CODE_CREATED) {
         anjay_log(ERROR, "server responded with %s (expected %s)",
                   AVS_COAP_CODE_STRING(avs_coap_msg_get_code(response)),
@@ -267,6 +317,26 @@ static int compare_iids(const void *left_, const void *right_, size_t size) {
     }
 }
 
+static int fill_dm_cache_object(anjay_t *anjay,
+                                const anjay_dm_object_def_t *const *obj,
+                                anjay_dm_cache_object_t *out_object) {
+    out_object->oid = (*obj)->oid;
+    if ((*obj)->version
+            && avs_simple_snprintf(out_object->version,
+                                   sizeof(out_object->version), "%s",
+                                   (*obj)->version)
+                           < 0) {
+        return -1;
+    }
+    AVS_LIST(anjay_iid_t) *instance_insert_ptr = &out_object->instances;
+    int retval = _anjay_dm_foreach_instance(anjay, obj, query_dm_instance,
+                                            &instance_insert_ptr);
+    if (!retval) {
+        AVS_LIST_SORT(&out_object->instances, compare_iids);
+    }
+    return retval;
+}
+
 static int query_dm_object(anjay_t *anjay,
                            const anjay_dm_object_def_t *const *obj,
                            void *cache_object_insert_ptr_) {
@@ -288,21 +358,7 @@ static int query_dm_object(anjay_t *anjay,
     AVS_LIST_INSERT(*cache_object_insert_ptr, new_object);
     AVS_LIST_ADVANCE_PTR(cache_object_insert_ptr);
 
-    new_object->oid = (*obj)->oid;
-    if ((*obj)->version
-            && avs_simple_snprintf(new_object->version,
-                                   sizeof(new_object->version), "%s",
-                                   (*obj)->version)
-                           < 0) {
-        return -1;
-    }
-    AVS_LIST(anjay_iid_t) *instance_insert_ptr = &new_object->instances;
-    int retval = _anjay_dm_foreach_instance(anjay, obj, query_dm_instance,
-                                            &instance_insert_ptr);
-    if (!retval) {
-        AVS_LIST_SORT(&new_object->instances, compare_iids);
-    }
-    return retval;
+    return fill_dm_cache_object(anjay, obj, new_object);
 }
 
 static int query_dm(anjay_t *anjay, AVS_LIST(anjay_dm_cache_object_t) *out) {
@@ -317,6 +373,202 @@ static int query_dm(anjay_t *anjay, AVS_LIST(anjay_dm_cache_object_t) *out) {
     return retval;
 }
 
+static bool iid_lists_equal(AVS_LIST(anjay_iid_t) left,
+                            AVS_LIST(anjay_iid_t) right) {
+    while (left && right) {
+        if (*left != *right) {
+            return false;
+        }
+        AVS_LIST_ADVANCE(&left);
+        AVS_LIST_ADVANCE(&right);
+    }
+    return !(left || right);
+}
+
+static bool dm_cache_objects_equal(const anjay_dm_cache_object_t *left,
+                                   const anjay_dm_cache_object_t *right) {
+    return left->oid == right->oid
+           && strcmp(left->version, right->version) == 0
+           && iid_lists_equal(left->instances, right->instances);
+}
+
+static bool dm_caches_equal(AVS_LIST(anjay_dm_cache_object_t) left,
+                            AVS_LIST(anjay_dm_cache_object_t) right) {
+    while (left && right) {
+        if (!dm_cache_objects_equal(left, right)) {
+            return false;
+        }
+        AVS_LIST_ADVANCE(&left);
+        AVS_LIST_ADVANCE(&right);
+    }
+    return !(left || right);
+}
+
+static void
+registration_objects_changed(anjay_registration_objects_t *tracked) {
+    if (!++tracked->generation) {
+        ++tracked->generation;
+    }
+}
+
+static void
+registration_objects_invalidate(anjay_registration_objects_t *tracked) {
+    clear_dm_cache(&tracked->objects);
+    tracked->valid = false;
+    registration_objects_changed(tracked);
+}
+
+static void
+delete_dm_cache_object(AVS_LIST(anjay_dm_cache_object_t) *object_ptr) {
+    AVS_LIST_CLEAR(&(*object_ptr)->instances);
+    AVS_LIST_DELETE(object_ptr);
+}
+
+static int
+requery_registration_object(anjay_t *anjay,
+                            AVS_LIST(anjay_dm_cache_object_t) *object_ptr,
+                            anjay_oid_t oid) {
+    const anjay_dm_object_def_t *const *obj =
+            _anjay_dm_find_object_by_oid(anjay, oid);
+    bool was_tracked = (*object_ptr && (*object_ptr)->oid == oid);
+    if (!obj) {
+        if (was_tracked) {
+            delete_dm_cache_object(object_ptr);
+            registration_objects_changed(&anjay->registration_objects);
+        }
+        return 0;
+    }
+
+    AVS_LIST(anjay_dm_cache_object_t) new_object =
+            AVS_LIST_NEW_ELEMENT(anjay_dm_cache_object_t);
+    if (!new_object) {
+        anjay_log(ERROR, "out of memory");
+        return -1;
+    }
+    if (fill_dm_cache_object(anjay, obj, new_object)) {
+        delete_dm_cache_object(&new_object);
+        return -1;
+    }
+    if (was_tracked) {
+        if (dm_cache_objects_equal(*object_ptr, new_object)) {
+            delete_dm_cache_object(&new_object);
+            return 0;
+        }
+        delete_dm_cache_object(object_ptr);
+    }
+    AVS_LIST_INSERT(object_ptr, new_object);
+    registration_objects_changed(&anjay->registration_objects);
+    return 0;
+}
+
+static int apply_known_instance_changes(
+        anjay_registration_objects_t *tracked,
+        anjay_dm_cache_object_t *object,
+        const anjay_notify_queue_instance_entry_t *changes) {
+    // both lists are sorted and disjoint, so they can be merged in a single
+    // pass over the sorted list of tracked instances
+    AVS_LIST(anjay_iid_t) added = changes->known_added_iids;
+    AVS_LIST(anjay_iid_t) removed = changes->known_removed_iids;
+    AVS_LIST(anjay_iid_t) *iid_ptr = &object->instances;
+    while (added || removed) {
+        bool is_added = (added && (!removed || *added < *removed));
+        anjay_iid_t iid = (is_added ? *added : *removed);
+        while (*iid_ptr && **iid_ptr < iid) {
+            AVS_LIST_ADVANCE_PTR(&iid_ptr);
+        }
+        bool present = (*iid_ptr && **iid_ptr == iid);
+        if (is_added) {
+            if (!present) {
+                if (!AVS_LIST_INSERT_NEW(anjay_iid_t, iid_ptr)) {
+                    anjay_log(ERROR, "out of memory");
+                    return -1;
+                }
+                **iid_ptr = iid;
+                registration_objects_changed(tracked);
+            }
+            AVS_LIST_ADVANCE(&added);
+        } else {
+            if (present) {
+                AVS_LIST_DELETE(iid_ptr);
+                registration_objects_changed(tracked);
+            }
+            AVS_LIST_ADVANCE(&removed);
+        }
+    }
+    return 0;
+}
+
+int _anjay_registration_objects_notify(anjay_t *anjay,
+                                       anjay_notify_queue_t queue) {
+    anjay_registration_objects_t *tracked = &anjay->registration_objects;
+    if (!tracked->valid) {
+        return 0;
+    }
+    AVS_LIST(anjay_dm_cache_object_t) *object_ptr = &tracked->objects;
+    AVS_LIST(anjay_notify_queue_object_entry_t) it;
+    AVS_LIST_FOREACH(it, queue) {
+        if (it->oid == ANJAY_DM_OID_SECURITY
+                || !it->instance_set_changes.instance_set_changed) {
+            continue;
+        }
+        while (*object_ptr && (*object_ptr)->oid < it->oid) {
+            AVS_LIST_ADVANCE_PTR(&object_ptr);
+        }
+        int result;
+        if (!it->instance_set_changes.unknown_change && *object_ptr
+                && (*object_ptr)->oid == it->oid) {
+            result = apply_known_instance_changes(tracked, *object_ptr,
+                                                  &it->instance_set_changes);
+        } else {
+            result = requery_registration_object(anjay, object_ptr, it->oid);
+        }
+        if (result) {
+            anjay_log(WARNING,
+                      "could not track changes in /%u, registration objects "
+                      "will be queried again",
+                      it->oid);
+            registration_objects_invalidate(tracked);
+            return result;
+        }
+    }
+    return 0;
+}
+
+void _anjay_registration_objects_cleanup(anjay_t *anjay) {
+    clear_dm_cache(&anjay->registration_objects.objects);
+    anjay->registration_objects.valid = false;
+}
+
+static int get_registration_objects(anjay_t *anjay,
+                                    uint32_t *out_generation) {
+    anjay_registration_objects_t *tracked = &anjay->registration_objects;
+    if (tracked->valid) {
+        // changes that are not flushed yet may already be visible in the data
+        // model; applying them now is harmless, as it is idempotent; if that
+        // fails, tracked objects are invalidated and queried again below
+        (void) _anjay_registration_objects_notify(
+                anjay, anjay->scheduled_notify.queue);
+    }
+    if (!tracked->valid) {
+        if (query_dm(anjay, &tracked->objects)) {
+            return -1;
+        }
+        tracked->valid = true;
+        registration_objects_changed(tracked);
+    }
+    *out_generation = tracked->generation;
+    return 0;
+}
+
+static bool dm_changed(anjay_t *anjay,
+                       const anjay_update_parameters_t *old_params,
+                       const anjay_update_parameters_t *new_params) {
+    if (anjay->registration_objects.enabled) {
+        return old_params->dm_generation != new_params->dm_generation;
+    }
+    return !dm_caches_equal(old_params->dm, new_params->dm);
+}
+
 void _anjay_update_parameters_cleanup(anjay_update_parameters_t *params) {
     clear_dm_cache(&params->dm);
 }
@@ -324,7 +576,10 @@ void _anjay_update_parameters_cleanup(anjay_update_parameters_t *params) {
 static int init_update_parameters(anjay_t *anjay,
                                   anjay_server_info_t *server,
                                   anjay_update_parameters_t *out_params) {
-    if (query_dm(anjay, &out_params->dm)) {
+    if (anjay->registration_objects.enabled
+                    ? get_registration_objects(anjay,
+                                               &out_params->dm_generation)
+                    : query_dm(anjay, &out_params->dm)) {
         goto error;
     }
     if (get_server_lifetime(anjay, _anjay_server_ssid(server),
@@ -354,81 +609,50 @@ int _anjay_registration_update_ctx_init(
     return init_update_parameters(anjay, server, &out_ctx->new_params);
 }
 
-static int bind_server_stream(anjay_registration_update_ctx_t *ctx) {
-    assert(ctx->server);
+static int bind_server_stream(anjay_t *anjay, anjay_server_info_t *server) {
+    assert(server);
     anjay_connection_ref_t connection = {
-        .server = ctx->server,
-        .conn_type = _anjay_server_primary_conn_type(ctx->server)
+        .server = server,
+        .conn_type = _anjay_server_primary_conn_type(server)
     };
     if (connection.conn_type == ANJAY_CONNECTION_UNSET) {
         anjay_log(ERROR, "no valid registration connection for server %u",
-                  _anjay_server_ssid(ctx->server));
+                  _anjay_server_ssid(server));
         return -1;
     }
-    if (_anjay_bind_server_stream(ctx->anjay, connection)) {
+    if (_anjay_bind_server_stream(anjay, connection)) {
         anjay_log(ERROR, "could not get stream for server %u",
-                  _anjay_server_ssid(ctx->server));
+                  _anjay_server_ssid(server));
         return -1;
     }
     return 0;
 }
 
-int _anjay_register(anjay_registration_update_ctx_t *ctx) {
-    AVS_LIST(const anjay_string_t) endpoint_path = NULL;
-    if (bind_server_stream(ctx)) {
+int _anjay_register(anjay_t *anjay,
+                    anjay_server_info_t *server,
+                    const anjay_update_parameters_t *params,
+                    anjay_exchange_finished_t *on_finished,
+                    uint16_t *out_msg_id) {
+    if (bind_server_stream(anjay, server)) {
         return -1;
     }
 
-    int result;
-    if ((result = send_register(ctx->anjay, &ctx->new_params))
-            || (result = check_register_response(ctx->anjay->comm_stream,
-                                                 &endpoint_path))) {
+    int result = send_register(anjay, params, on_finished, out_msg_id);
+    if (result) {
         anjay_log(ERROR, "could not register to server %u",
-                  _anjay_dm_current_ssid(ctx->anjay));
-        AVS_LIST_CLEAR(&endpoint_path);
-        goto finish;
+                  _anjay_server_ssid(server));
     }
 
-    _anjay_server_update_registration_info(
-            ctx->anjay->current_connection.server, &endpoint_path,
-            &ctx->new_params);
-    assert(!endpoint_path);
-
-finish:
-    _anjay_release_server_stream(ctx->anjay);
+    _anjay_release_server_stream(anjay);
     return result;
 }
 
-static bool iid_lists_equal(AVS_LIST(anjay_iid_t) left,
-                            AVS_LIST(anjay_iid_t) right) {
-    while (left && right) {
-        if (*left != *right) {
-            return false;
-        }
-        AVS_LIST_ADVANCE(&left);
-        AVS_LIST_ADVANCE(&right);
-    }
-    return !(left || right);
-}
-
-static bool dm_caches_equal(AVS_LIST(anjay_dm_cache_object_t) left,
-                            AVS_LIST(anjay_dm_cache_object_t) right) {
-    while (left && right) {
-        if (left->oid != right->oid
-                || strcmp(left->version, right->version) != 0
-                || !iid_lists_equal(left->instances, right->instances)) {
-            return false;
-        }
-        AVS_LIST_ADVANCE(&left);
-        AVS_LIST_ADVANCE(&right);
-    }
-    return !(left || right);
-}
-
 static int send_update(anjay_t *anjay,
                        AVS_LIST(const anjay_string_t) endpoint_path,
                        const anjay_update_parameters_t *old_params,
-                       const anjay_update_parameters_t *new_params) {
+                       const anjay_update_parameters_t *new_params,
+                       anjay_exchange_finished_t *on_finished,
+                       uint16_t *out_msg_id) {
     const int64_t *lifetime_s_ptr = NULL;
     assert(new_params->lifetime_s >= 0);
     if (new_params->lifetime_s != old_params->lifetime_s) {
@@ -441,7 +665,7 @@ static int send_update(anjay_t *anjay,
                     : new_params->binding_mode;
 
     bool dm_changed_since_last_update =
-            !dm_caches_equal(old_params->dm, new_params->dm);
+            dm_changed(anjay, old_params, new_params);
     anjay_msg_details_t details = {
         .msg_type = AVS_COAP_MSG_CONFIRMABLE,
         .msg_code = AVS_COAP_CODE_POST,
@@ -457,9 +681,11 @@ static int send_update(anjay_t *anjay,
     if ((result = _anjay_coap_stream_setup_request(anjay->comm_stream, &details,
                                                    NULL))
             || (dm_changed_since_last_update
-                && (result = send_objects_list(anjay->comm_stream,
-                                               new_params->dm)))
-            || (result = avs_stream_finish_message(anjay->comm_stream))) {
+                && (result = send_objects_list(
+                            anjay->comm_stream,
+                            objects_to_send(anjay, new_params))))
+            || (result = finish_registration_request(anjay, on_finished,
+                                                     out_msg_id))) {
         anjay_log(ERROR, "could not send Update message");
     } else {
         anjay_log(INFO, "Update sent");
@@ -470,13 +696,7 @@ static int send_update(anjay_t *anjay,
     return result;
 }
 
-static int check_update_response(avs_stream_abstract_t *stream) {
-    const avs_coap_msg_t *response;
-    if (_anjay_coap_stream_get_incoming_msg(stream, &response)) {
-        anjay_log(ERROR, "could not get response");
-        return -1;
-    }
-
+int _anjay_update_check_response(const avs_coap_msg_t *response) {
     const uint8_t code = avs_coap_msg_get_code(response);
     if (code == AVS_COAP_CODE_CHANGED) {
         anjay_log(INFO, "registration successfully updated");
@@ -496,8 +716,8 @@ static int check_update_response(avs_stream_abstract_t *stream) {
          *
          * Any other response is either an 5.xx (server error), in which case
          * retransmission may succeed, or an unexpected non-error response.
-         * However, as we don't do retransmissions, degenerating to Register
-         * seems the best thing we can do. */
+         * However, as we don't retransmit the Update after a response,
+         * degenerating to Register seems the best thing we can do. */
         anjay_log(DEBUG, "Update rejected: %s (expected %s)",
                   AVS_COAP_CODE_STRING(code),
                   AVS_COAP_CODE_STRING(AVS_COAP_CODE_CHANGED));
@@ -512,28 +732,27 @@ bool _anjay_needs_registration_update(anjay_registration_update_ctx_t *ctx) {
     return info->update_forced
            || old_params->lifetime_s != ctx->new_params.lifetime_s
            || strcmp(old_params->binding_mode, ctx->new_params.binding_mode)
-           || !dm_caches_equal(old_params->dm, ctx->new_params.dm);
+           || dm_changed(ctx->anjay, old_params, &ctx->new_params);
 }
 
-int _anjay_update_registration(anjay_registration_update_ctx_t *ctx) {
-    if (bind_server_stream(ctx)) {
+int _anjay_update_registration(anjay_t *anjay,
+                               anjay_server_info_t *server,
+                               const anjay_update_parameters_t *params,
+                               anjay_exchange_finished_t *on_finished,
+                               uint16_t *out_msg_id) {
+    if (bind_server_stream(anjay, server)) {
         return -1;
     }
-    const anjay_registration_info_t *old_info = _anjay_server_registration_info(
-            ctx->anjay->current_connection.server);
-    int retval = -1;
-    if ((retval = send_update(ctx->anjay, old_info->endpoint_path,
-                              &old_info->last_update_params, &ctx->new_params))
-            || (retval = check_update_response(ctx->anjay->comm_stream))) {
+    const anjay_registration_info_t *old_info =
+            _anjay_server_registration_info(server);
+    int retval = send_update(anjay, old_info->endpoint_path,
+                             &old_info->last_update_params, params,
+                             on_finished, out_msg_id);
+    if (retval) {
         anjay_log(ERROR, "could not update registration");
-        goto finish;
     }
 
-    _anjay_server_update_registration_info(
-            ctx->anjay->current_connection.server, NULL, &ctx->new_params);
-
-finish:
-    _anjay_release_server_stream(ctx->anjay);
+    _anjay_release_server_stream(anjay);
     return retval;
 }
 
@@ -18,6 +18,7 @@
 #define ANJAY_INTERFACE_REGISTER_H
 
 #include "../anjay_core.h"
+#include "../exchange.h"
 
 VISIBILITY_PRIVATE_HEADER_BEGIN
 
@@ -25,6 +26,19 @@ void _anjay_update_parameters_cleanup(anjay_update_parameters_t *params);
 
 void _anjay_registration_info_cleanup(anjay_registration_info_t *info);
 
+/**
+ * Applies changes to the sets of Object Instances, described by @p queue, to
+ * the list of objects tracked for Register and Update messages. Does nothing
+ * unless the list has already been queried from the data model.
+ *
+ * If the changes cannot be applied, the list is discarded, so that it will be
+ * queried again before the next Register or Update.
+ */
+int _anjay_registration_objects_notify(anjay_t *anjay,
+                                       anjay_notify_queue_t queue);
+
+void _anjay_registration_objects_cleanup(anjay_t *anjay);
+
 typedef struct {
     anjay_t *anjay;
     anjay_server_info_t *server;
@@ -36,20 +50,59 @@ int _anjay_registration_update_ctx_init(
         anjay_registration_update_ctx_t *out_ctx,
         anjay_server_info_t *server);
 
-int _anjay_register(anjay_registration_update_ctx_t *ctx);
+/**
+ * Sends the Register request to @p server, describing the client with
+ * @p params.
+ *
+ * The response is not waited for - the request is tracked by an exchange (see
+ * exchange.h), which calls @p on_finished when the response arrives or the
+ * request times out. Requests that need a block-wise transfer are still
+ * performed synchronously, in which case @p on_finished is called before
+ * returning. Either way, @p out_msg_id is set to the message ID passed to
+ * @p on_finished before it may be called.
+ *
+ * @returns 0 if @p on_finished has been or will be called, or a negative value
+ *          in case of error.
+ */
+int _anjay_register(anjay_t *anjay,
+                    anjay_server_info_t *server,
+                    const anjay_update_parameters_t *params,
+                    anjay_exchange_finished_t *on_finished,
+                    uint16_t *out_msg_id);
+
+/**
+ * Checks the response to the Register request and stores the Location-Path
+ * it carries in @p out_endpoint_path.
+ *
+ * @returns 0 on success, or a negative value if the registration has not been
+ *          accepted.
+ */
+int _anjay_register_check_response(
+        const avs_coap_msg_t *response,
+        AVS_LIST(const anjay_string_t) *out_endpoint_path);
 
 #define ANJAY_REGISTRATION_UPDATE_REJECTED 1
 
 bool _anjay_needs_registration_update(anjay_registration_update_ctx_t *ctx);
 
+/**
+ * Sends the Update request to @p server, including the parameters from
+ * @p params that differ from the last registered ones. Works like
+ * @ref _anjay_register otherwise.
+ */
+int _anjay_update_registration(anjay_t *anjay,
+                               anjay_server_info_t *server,
+                               const anjay_update_parameters_t *params,
+                               anjay_exchange_finished_t *on_finished,
+                               uint16_t *out_msg_id);
+
 /**
  * @returns:
- * - 0 on success,
- * - a negative value on error,
- * - ANJAY_REGISTRATION_UPDATE_REJECTED if the server responded with 4.xx error
- *   so the Update message should not be retransmitted.
+ * - 0 if the registration has been successfully updated,
+ * - ANJAY_REGISTRATION_UPDATE_REJECTED if the server responded with any other
+ *   code, so Register should be sent instead.
  */
-int _anjay_update_registration(anjay_registration_update_ctx_t *ctx);
+int _anjay_update_check_response(const avs_coap_msg_t *response);
 
 void _anjay_registration_update_ctx_release(
         anjay_registration_update_ctx_t *ctx);
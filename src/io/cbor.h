@@ -0,0 +1,68 @@
+/*
+ * Copyright 2017-2018 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANJAY_IO_CBOR_H
+#define ANJAY_IO_CBOR_H
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+/* CBOR major types (RFC 7049, section 2.1) */
+typedef enum {
+    CBOR_MAJOR_UINT = 0,
+    CBOR_MAJOR_NEGATIVE_INT = 1,
+    CBOR_MAJOR_BYTE_STRING = 2,
+    CBOR_MAJOR_TEXT_STRING = 3,
+    CBOR_MAJOR_ARRAY = 4,
+    CBOR_MAJOR_MAP = 5,
+    CBOR_MAJOR_TAG = 6,
+    CBOR_MAJOR_SIMPLE = 7
+} cbor_major_type_t;
+
+/* Values of the "additional information" field of the initial byte */
+#define CBOR_EXT_LENGTH_1BYTE 24
+#define CBOR_EXT_LENGTH_2BYTE 25
+#define CBOR_EXT_LENGTH_4BYTE 26
+#define CBOR_EXT_LENGTH_8BYTE 27
+#define CBOR_EXT_LENGTH_INDEFINITE 31
+
+#define CBOR_SIMPLE_FALSE 20
+#define CBOR_SIMPLE_TRUE 21
+#define CBOR_SIMPLE_HALF_FLOAT CBOR_EXT_LENGTH_2BYTE
+#define CBOR_SIMPLE_FLOAT CBOR_EXT_LENGTH_4BYTE
+#define CBOR_SIMPLE_DOUBLE CBOR_EXT_LENGTH_8BYTE
+
+#define CBOR_INITIAL_BYTE(MajorType, AdditionalInfo) \
+    ((uint8_t) (((MajorType) << 5) | (AdditionalInfo)))
+
+#define CBOR_BREAK CBOR_INITIAL_BYTE(CBOR_MAJOR_SIMPLE, \
+                                     CBOR_EXT_LENGTH_INDEFINITE)
+
+/* SenML labels (RFC 8428, section 6) used by the LwM2M data model mapping */
+typedef enum {
+    SENML_LABEL_BASE_NAME = -2,
+    SENML_LABEL_NAME = 0,
+    SENML_LABEL_VALUE = 2,
+    SENML_LABEL_VALUE_STRING = 3,
+    SENML_LABEL_VALUE_BOOL = 4,
+    SENML_LABEL_VALUE_OPAQUE = 8
+} senml_label_t;
+
+/* Object Link values are not covered by RFC 8428, LwM2M uses a text label */
+#define SENML_EXT_OBJLNK_LABEL "vlo"
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif /* ANJAY_IO_CBOR_H */
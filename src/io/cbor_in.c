@@ -0,0 +1,851 @@
+/*
+ * Copyright 2017-2018 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <anjay_config.h>
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <avsystem/commons/list.h>
+#include <avsystem/commons/memory.h>
+#include <avsystem/commons/stream.h>
+#include <avsystem/commons/utils.h>
+
+#include "../io_core.h"
+#include "../utils_core.h"
+#include "cbor.h"
+#include "vtable.h"
+
+#define cbor_log(level, ...) _anjay_log(senml_cbor, level, __VA_ARGS__)
+
+VISIBILITY_SOURCE_BEGIN
+
+#define MAX_NESTING_DEPTH 8
+#define MAX_PATH_LEN sizeof("/65535/65535/65535/65535")
+
+typedef enum {
+    SENML_VALUE_NONE,
+    SENML_VALUE_INT,
+    SENML_VALUE_DOUBLE,
+    SENML_VALUE_BOOL,
+    SENML_VALUE_STRING,
+    SENML_VALUE_OPAQUE,
+    SENML_VALUE_OBJLNK
+} senml_value_type_t;
+
+typedef struct {
+    const char *data;
+    size_t size;
+} senml_chunk_t;
+
+typedef struct {
+    /* anjay_id_type_t values are used as indices */
+    uint16_t path[4];
+    size_t num_path_elems;
+    senml_value_type_t type;
+    union {
+        int64_t i64;
+        double f64;
+        bool boolean;
+        /* STRING, OPAQUE and OBJLNK; points into cbor_in_t::payload */
+        senml_chunk_t chunk;
+    } value;
+} senml_record_t;
+
+typedef struct {
+    const anjay_input_ctx_vtable_t *vtable;
+    /* payload and records are owned by the top-level context; nested contexts
+     * only refer to a range of records */
+    bool owner;
+    char *payload;
+    AVS_LIST(senml_record_t) records;
+
+    /* Number of path elements common to all records in this context; IDs of
+     * the next level are returned by get_id. */
+    size_t level;
+    AVS_LIST(senml_record_t) current;
+    AVS_LIST(senml_record_t) end;
+    bool has_id;
+    size_t bytes_read;
+    anjay_input_ctx_t *child;
+} cbor_in_t;
+
+////////////////////////////////////////////////////////////////////// PARSING
+
+typedef struct {
+    const uint8_t *ptr;
+    const uint8_t *end;
+} cbor_cursor_t;
+
+typedef struct {
+    cbor_major_type_t major_type;
+    uint8_t additional_info;
+    bool indefinite;
+    /* length, integer value or bit pattern of a floating-point value */
+    uint64_t value;
+} cbor_header_t;
+
+static int read_header(cbor_cursor_t *cursor, cbor_header_t *out) {
+    if (cursor->ptr >= cursor->end) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    const uint8_t initial_byte = *cursor->ptr++;
+    const uint8_t additional_info = initial_byte & 0x1F;
+    out->major_type = (cbor_major_type_t) (initial_byte >> 5);
+    out->additional_info = additional_info;
+    out->indefinite = false;
+    out->value = 0;
+    size_t length;
+    if (additional_info < CBOR_EXT_LENGTH_1BYTE) {
+        out->value = additional_info;
+        return 0;
+    } else if (additional_info == CBOR_EXT_LENGTH_INDEFINITE) {
+        if (out->major_type == CBOR_MAJOR_UINT
+                || out->major_type == CBOR_MAJOR_NEGATIVE_INT
+                || out->major_type == CBOR_MAJOR_TAG) {
+            return ANJAY_ERR_BAD_REQUEST;
+        }
+        out->indefinite = true;
+        return 0;
+    } else if (additional_info > CBOR_EXT_LENGTH_8BYTE) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    length = (size_t) 1 << (additional_info - CBOR_EXT_LENGTH_1BYTE);
+    if ((size_t) (cursor->end - cursor->ptr) < length) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    for (size_t i = 0; i < length; ++i) {
+        out->value = (out->value << 8) | *cursor->ptr++;
+    }
+    return 0;
+}
+
+static bool at_break(const cbor_cursor_t *cursor) {
+    return cursor->ptr < cursor->end && *cursor->ptr == CBOR_BREAK;
+}
+
+static int read_chunk(cbor_cursor_t *cursor,
+                      cbor_major_type_t major_type,
+                      senml_chunk_t *out) {
+    cbor_header_t header;
+    int retval = read_header(cursor, &header);
+    if (retval) {
+        return retval;
+    }
+    if (header.major_type != major_type) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    if (header.indefinite) {
+        cbor_log(ERROR, "indefinite-length strings are not supported");
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    if (header.value > (uint64_t) (cursor->end - cursor->ptr)) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    out->data = (const char *) cursor->ptr;
+    out->size = (size_t) header.value;
+    cursor->ptr += out->size;
+    return 0;
+}
+
+static int skip_item(cbor_cursor_t *cursor, unsigned depth) {
+    cbor_header_t header;
+    int retval;
+    if (depth > MAX_NESTING_DEPTH) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    if ((retval = read_header(cursor, &header))) {
+        return retval;
+    }
+    switch (header.major_type) {
+    case CBOR_MAJOR_BYTE_STRING:
+    case CBOR_MAJOR_TEXT_STRING:
+        if (header.indefinite) {
+            while (!at_break(cursor)) {
+                senml_chunk_t chunk;
+                if ((retval = read_chunk(cursor, header.major_type, &chunk))) {
+                    return retval;
+                }
+            }
+            ++cursor->ptr;
+        } else if (header.value > (uint64_t) (cursor->end - cursor->ptr)) {
+            return ANJAY_ERR_BAD_REQUEST;
+        } else {
+            cursor->ptr += header.value;
+        }
+        return 0;
+    case CBOR_MAJOR_ARRAY:
+    case CBOR_MAJOR_MAP: {
+        const uint64_t items =
+                header.value * (header.major_type == CBOR_MAJOR_MAP ? 2 : 1);
+        for (uint64_t i = 0; header.indefinite || i < items; ++i) {
+            if (header.indefinite && at_break(cursor)) {
+                ++cursor->ptr;
+                break;
+            }
+            if ((retval = skip_item(cursor, depth + 1))) {
+                return retval;
+            }
+        }
+        return 0;
+    }
+    case CBOR_MAJOR_TAG:
+        return skip_item(cursor, depth + 1);
+    default:
+        return 0;
+    }
+}
+
+static double half_to_double(uint16_t half) {
+    const uint32_t sign = (uint32_t) (half & 0x8000) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1F;
+    const uint32_t mantissa = half & 0x3FF;
+    if (!exponent) {
+        // subnormal numbers are not representable as normalized halves, but
+        // mantissa * 2^-24 is always exact in double precision
+        const double value = (double) mantissa / (double) (1 << 24);
+        return sign ? -value : value;
+    }
+    // rebias the exponent (15 -> 127) and widen the mantissa (10 -> 23 bits)
+    const uint32_t single = sign
+                            | (exponent == 0x1F ? 0xFFu : exponent + 112) << 23
+                            | mantissa << 13;
+    return _anjay_ntohf(avs_convert_be32(single));
+}
+
+static int read_number(cbor_cursor_t *cursor, senml_record_t *record) {
+    cbor_header_t header;
+    int retval = read_header(cursor, &header);
+    if (retval) {
+        return retval;
+    }
+    switch (header.major_type) {
+    case CBOR_MAJOR_UINT:
+        if (header.value > INT64_MAX) {
+            record->type = SENML_VALUE_DOUBLE;
+            record->value.f64 = (double) header.value;
+        } else {
+            record->type = SENML_VALUE_INT;
+            record->value.i64 = (int64_t) header.value;
+        }
+        return 0;
+    case CBOR_MAJOR_NEGATIVE_INT:
+        if (header.value > INT64_MAX) {
+            record->type = SENML_VALUE_DOUBLE;
+            record->value.f64 = -1.0 - (double) header.value;
+        } else {
+            record->type = SENML_VALUE_INT;
+            record->value.i64 = -1 - (int64_t) header.value;
+        }
+        return 0;
+    case CBOR_MAJOR_SIMPLE:
+        record->type = SENML_VALUE_DOUBLE;
+        switch (header.additional_info) {
+        case CBOR_SIMPLE_HALF_FLOAT:
+            record->value.f64 = half_to_double((uint16_t) header.value);
+            return 0;
+        case CBOR_SIMPLE_FLOAT:
+            record->value.f64 = _anjay_ntohf(
+                    avs_convert_be32((uint32_t) header.value));
+            return 0;
+        case CBOR_SIMPLE_DOUBLE:
+            record->value.f64 = _anjay_ntohd(avs_convert_be64(header.value));
+            return 0;
+        default:
+            return ANJAY_ERR_BAD_REQUEST;
+        }
+    default:
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+}
+
+static int parse_id(const char **ptr, const char *end, uint16_t *out) {
+    uint32_t value = 0;
+    if (*ptr >= end || !(**ptr >= '0' && **ptr <= '9')) {
+        return -1;
+    }
+    while (*ptr < end && **ptr >= '0' && **ptr <= '9') {
+        value = 10 * value + (uint32_t) (*(*ptr)++ - '0');
+        if (value > UINT16_MAX) {
+            return -1;
+        }
+    }
+    *out = (uint16_t) value;
+    return 0;
+}
+
+static int parse_path(const senml_chunk_t *base_name,
+                      const senml_chunk_t *name,
+                      senml_record_t *record) {
+    char buf[MAX_PATH_LEN];
+    const size_t length = base_name->size + name->size;
+    if (length >= sizeof(buf)) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    if (base_name->size) {
+        memcpy(buf, base_name->data, base_name->size);
+    }
+    if (name->size) {
+        memcpy(buf + base_name->size, name->data, name->size);
+    }
+
+    const size_t max_path_elems = sizeof(record->path) / sizeof(*record->path);
+    const char *ptr = buf;
+    record->num_path_elems = 0;
+    while (ptr < buf + length) {
+        if (*ptr++ != '/' || record->num_path_elems >= max_path_elems
+                || parse_id(&ptr, buf + length,
+                            &record->path[record->num_path_elems++])) {
+            cbor_log(DEBUG, "invalid SenML name: %.*s", (int) length, buf);
+            return ANJAY_ERR_BAD_REQUEST;
+        }
+    }
+    return 0;
+}
+
+static int read_label(cbor_cursor_t *cursor,
+                      int64_t *out_label,
+                      bool *out_is_objlnk) {
+    *out_is_objlnk = false;
+    if (cursor->ptr < cursor->end
+            && (*cursor->ptr >> 5) == CBOR_MAJOR_TEXT_STRING) {
+        senml_chunk_t label;
+        int retval = read_chunk(cursor, CBOR_MAJOR_TEXT_STRING, &label);
+        if (retval) {
+            return retval;
+        }
+        *out_is_objlnk = (label.size == strlen(SENML_EXT_OBJLNK_LABEL)
+                          && !memcmp(label.data, SENML_EXT_OBJLNK_LABEL,
+                                     label.size));
+        // other text labels are not used by LwM2M and will be skipped
+        *out_label = INT64_MIN;
+        return 0;
+    }
+    senml_record_t number;
+    int retval = read_number(cursor, &number);
+    if (retval || number.type != SENML_VALUE_INT) {
+        return retval ? retval : ANJAY_ERR_BAD_REQUEST;
+    }
+    *out_label = number.value.i64;
+    return 0;
+}
+
+static int read_value(cbor_cursor_t *cursor,
+                      int64_t label,
+                      bool is_objlnk,
+                      senml_record_t *record) {
+    if (record->type != SENML_VALUE_NONE) {
+        cbor_log(DEBUG, "more than one value in a SenML record");
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    if (is_objlnk) {
+        record->type = SENML_VALUE_OBJLNK;
+        return read_chunk(cursor, CBOR_MAJOR_TEXT_STRING, &record->value.chunk);
+    }
+    switch (label) {
+    case SENML_LABEL_VALUE:
+        return read_number(cursor, record);
+    case SENML_LABEL_VALUE_STRING:
+        record->type = SENML_VALUE_STRING;
+        return read_chunk(cursor, CBOR_MAJOR_TEXT_STRING, &record->value.chunk);
+    case SENML_LABEL_VALUE_OPAQUE:
+        record->type = SENML_VALUE_OPAQUE;
+        return read_chunk(cursor, CBOR_MAJOR_BYTE_STRING, &record->value.chunk);
+    case SENML_LABEL_VALUE_BOOL: {
+        cbor_header_t header;
+        int retval = read_header(cursor, &header);
+        if (retval || header.major_type != CBOR_MAJOR_SIMPLE
+                || (header.additional_info != CBOR_SIMPLE_FALSE
+                    && header.additional_info != CBOR_SIMPLE_TRUE)) {
+            return retval ? retval : ANJAY_ERR_BAD_REQUEST;
+        }
+        record->type = SENML_VALUE_BOOL;
+        record->value.boolean =
+                (header.additional_info == CBOR_SIMPLE_TRUE);
+        return 0;
+    }
+    default:
+        AVS_UNREACHABLE("not a value label");
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+}
+
+static int path_cmp(const senml_record_t *left, const senml_record_t *right) {
+    for (size_t i = 0;
+         i < left->num_path_elems && i < right->num_path_elems;
+         ++i) {
+        if (left->path[i] != right->path[i]) {
+            return left->path[i] < right->path[i] ? -1 : 1;
+        }
+    }
+    return (int) left->num_path_elems - (int) right->num_path_elems;
+}
+
+/**
+ * Inserts the record keeping the list sorted by path, so that all entries
+ * referring to a single node of the data model tree are adjacent, regardless
+ * of the order in which the server sent them.
+ *
+ * @p inout_last points to the last record on the list. Records are usually
+ * sent in path order, in which case they are appended without walking the
+ * list.
+ */
+static int insert_record(AVS_LIST(senml_record_t) *records_ptr,
+                         AVS_LIST(senml_record_t) *inout_last,
+                         AVS_LIST(senml_record_t) record) {
+    if (*inout_last && path_cmp(*inout_last, record) < 0) {
+        AVS_LIST_INSERT(AVS_LIST_NEXT_PTR(inout_last), record);
+        *inout_last = record;
+        return 0;
+    }
+    AVS_LIST(senml_record_t) *insert_ptr = records_ptr;
+    while (*insert_ptr && path_cmp(*insert_ptr, record) < 0) {
+        AVS_LIST_ADVANCE_PTR(&insert_ptr);
+    }
+    if (*insert_ptr && !path_cmp(*insert_ptr, record)) {
+        cbor_log(DEBUG, "duplicate SenML record");
+        AVS_LIST_DELETE(&record);
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    AVS_LIST_INSERT(insert_ptr, record);
+    if (!AVS_LIST_NEXT(record)) {
+        *inout_last = record;
+    }
+    return 0;
+}
+
+static int parse_record(cbor_cursor_t *cursor,
+                        senml_chunk_t *inout_base_name,
+                        AVS_LIST(senml_record_t) *records_ptr,
+                        AVS_LIST(senml_record_t) *inout_last) {
+    cbor_header_t header;
+    int retval = read_header(cursor, &header);
+    if (retval || header.major_type != CBOR_MAJOR_MAP) {
+        return retval ? retval : ANJAY_ERR_BAD_REQUEST;
+    }
+    AVS_LIST(senml_record_t) record = AVS_LIST_NEW_ELEMENT(senml_record_t);
+    if (!record) {
+        cbor_log(ERROR, "out of memory");
+        return ANJAY_ERR_INTERNAL;
+    }
+    senml_chunk_t name = { NULL, 0 };
+    for (uint64_t i = 0; header.indefinite || i < header.value; ++i) {
+        if (header.indefinite && at_break(cursor)) {
+            ++cursor->ptr;
+            break;
+        }
+        int64_t label;
+        bool is_objlnk;
+        if ((retval = read_label(cursor, &label, &is_objlnk))) {
+            break;
+        }
+        if (label == SENML_LABEL_BASE_NAME) {
+            retval = read_chunk(cursor, CBOR_MAJOR_TEXT_STRING,
+                                inout_base_name);
+        } else if (label == SENML_LABEL_NAME) {
+            retval = read_chunk(cursor, CBOR_MAJOR_TEXT_STRING, &name);
+        } else if (is_objlnk || label == SENML_LABEL_VALUE
+                   || label == SENML_LABEL_VALUE_STRING
+                   || label == SENML_LABEL_VALUE_BOOL
+                   || label == SENML_LABEL_VALUE_OPAQUE) {
+            retval = read_value(cursor, label, is_objlnk, record);
+        } else {
+            retval = skip_item(cursor, 0);
+        }
+        if (retval) {
+            break;
+        }
+    }
+    if (!retval) {
+        retval = parse_path(inout_base_name, &name, record);
+    }
+    if (retval || record->type == SENML_VALUE_NONE) {
+        // records without a value carry no data for the data model
+        AVS_LIST_DELETE(&record);
+        return retval;
+    }
+    return insert_record(records_ptr, inout_last, record);
+}
+
+static int parse_payload(cbor_in_t *ctx, size_t payload_size) {
+    cbor_cursor_t cursor = {
+        .ptr = (const uint8_t *) ctx->payload,
+        .end = (const uint8_t *) ctx->payload + payload_size
+    };
+    senml_chunk_t base_name = { NULL, 0 };
+    AVS_LIST(senml_record_t) last = NULL;
+    cbor_header_t header;
+    int retval = read_header(&cursor, &header);
+    if (retval || header.major_type != CBOR_MAJOR_ARRAY) {
+        return retval ? retval : ANJAY_ERR_BAD_REQUEST;
+    }
+    for (uint64_t i = 0; header.indefinite || i < header.value; ++i) {
+        if (header.indefinite && at_break(&cursor)) {
+            ++cursor.ptr;
+            break;
+        }
+        if ((retval = parse_record(&cursor, &base_name, &ctx->records,
+                                   &last))) {
+            return retval;
+        }
+    }
+    return cursor.ptr == cursor.end ? 0 : ANJAY_ERR_BAD_REQUEST;
+}
+
+static int read_payload(avs_stream_abstract_t *stream,
+                        char **out_payload,
+                        size_t *out_size) {
+    size_t capacity = 0;
+    char message_finished = 0;
+    *out_size = 0;
+    while (!message_finished) {
+        if (*out_size == capacity) {
+            capacity = capacity ? 2 * capacity : 128;
+            char *new_payload = (char *) avs_realloc(*out_payload, capacity);
+            if (!new_payload) {
+                cbor_log(ERROR, "out of memory");
+                return ANJAY_ERR_INTERNAL;
+            }
+            *out_payload = new_payload;
+        }
+        size_t bytes_read;
+        int retval = avs_stream_read(stream, &bytes_read, &message_finished,
+                                     *out_payload + *out_size,
+                                     capacity - *out_size);
+        if (retval) {
+            return retval;
+        }
+        *out_size += bytes_read;
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////// DECODING
+
+static bool same_node(const senml_record_t *left,
+                      const senml_record_t *right,
+                      size_t num_path_elems) {
+    if (left->num_path_elems < num_path_elems
+            || right->num_path_elems < num_path_elems) {
+        return false;
+    }
+    return !memcmp(left->path, right->path,
+                   num_path_elems * sizeof(*left->path));
+}
+
+/**
+ * Returns the first record that does not refer to the same child node of the
+ * context as the current one.
+ */
+static AVS_LIST(senml_record_t) next_node(cbor_in_t *ctx) {
+    AVS_LIST(senml_record_t) record = ctx->current;
+    while (record != ctx->end
+           && same_node(ctx->current, record, ctx->level + 1)) {
+        record = AVS_LIST_NEXT(record);
+    }
+    return record;
+}
+
+static int get_record(cbor_in_t *ctx, const senml_record_t **out_record) {
+    if (ctx->current == ctx->end
+            || ctx->current->num_path_elems > ctx->level + 1) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    *out_record = ctx->current;
+    return 0;
+}
+
+static int cbor_get_some_bytes(anjay_input_ctx_t *ctx_,
+                               size_t *out_bytes_read,
+                               bool *out_message_finished,
+                               void *out_buf,
+                               size_t buf_size) {
+    cbor_in_t *ctx = (cbor_in_t *) ctx_;
+    const senml_record_t *record;
+    int retval = get_record(ctx, &record);
+    if (retval) {
+        return retval;
+    }
+    if (record->type != SENML_VALUE_OPAQUE
+            && record->type != SENML_VALUE_STRING) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    *out_bytes_read = AVS_MIN(buf_size,
+                              record->value.chunk.size - ctx->bytes_read);
+    if (*out_bytes_read) {
+        memcpy(out_buf, record->value.chunk.data + ctx->bytes_read,
+               *out_bytes_read);
+    }
+    ctx->bytes_read += *out_bytes_read;
+    *out_message_finished = (ctx->bytes_read == record->value.chunk.size);
+    return 0;
+}
+
+static int
+cbor_get_string(anjay_input_ctx_t *ctx_, char *out_buf, size_t buf_size) {
+    cbor_in_t *ctx = (cbor_in_t *) ctx_;
+    const senml_record_t *record;
+    int retval = get_record(ctx, &record);
+    if (retval) {
+        return retval;
+    }
+    if (record->type != SENML_VALUE_STRING || !buf_size) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    bool message_finished;
+    size_t bytes_read;
+    retval = cbor_get_some_bytes(ctx_, &bytes_read, &message_finished,
+                                 out_buf, buf_size - 1);
+    out_buf[bytes_read] = '\0';
+    if (!retval && !message_finished) {
+        retval = ANJAY_BUFFER_TOO_SHORT;
+    }
+    return retval;
+}
+
+static int get_integer(anjay_input_ctx_t *ctx_,
+                       int64_t min_value,
+                       int64_t max_value,
+                       int64_t *out) {
+    const senml_record_t *record;
+    int retval = get_record((cbor_in_t *) ctx_, &record);
+    if (retval) {
+        return retval;
+    }
+    if (record->type == SENML_VALUE_INT) {
+        *out = record->value.i64;
+    } else if (record->type == SENML_VALUE_DOUBLE
+               // (double) INT64_MAX rounds up to 2^63, so the bounds need to
+               // be checked against exact powers of two before the cast
+               && record->value.f64 >= -9223372036854775808.0
+               && record->value.f64 < 9223372036854775808.0
+               && (double) (int64_t) record->value.f64 == record->value.f64) {
+        *out = (int64_t) record->value.f64;
+    } else {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    return (*out < min_value || *out > max_value) ? ANJAY_ERR_BAD_REQUEST : 0;
+}
+
+static int cbor_get_i32(anjay_input_ctx_t *ctx, int32_t *out) {
+    int64_t value;
+    int retval = get_integer(ctx, INT32_MIN, INT32_MAX, &value);
+    if (!retval) {
+        *out = (int32_t) value;
+    }
+    return retval;
+}
+
+static int cbor_get_i64(anjay_input_ctx_t *ctx, int64_t *out) {
+    return get_integer(ctx, INT64_MIN, INT64_MAX, out);
+}
+
+static int cbor_get_double(anjay_input_ctx_t *ctx, double *out) {
+    const senml_record_t *record;
+    int retval = get_record((cbor_in_t *) ctx, &record);
+    if (retval) {
+        return retval;
+    }
+    switch (record->type) {
+    case SENML_VALUE_INT:
+        *out = (double) record->value.i64;
+        return 0;
+    case SENML_VALUE_DOUBLE:
+        *out = record->value.f64;
+        return 0;
+    default:
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+}
+
+static int cbor_get_float(anjay_input_ctx_t *ctx, float *out) {
+    double value;
+    int retval = cbor_get_double(ctx, &value);
+    if (!retval) {
+        *out = (float) value;
+    }
+    return retval;
+}
+
+static int cbor_get_bool(anjay_input_ctx_t *ctx, bool *out) {
+    const senml_record_t *record;
+    int retval = get_record((cbor_in_t *) ctx, &record);
+    if (retval) {
+        return retval;
+    }
+    if (record->type != SENML_VALUE_BOOL) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    *out = record->value.boolean;
+    return 0;
+}
+
+static int cbor_get_objlnk(anjay_input_ctx_t *ctx,
+                           anjay_oid_t *out_oid,
+                           anjay_iid_t *out_iid) {
+    const senml_record_t *record;
+    int retval = get_record((cbor_in_t *) ctx, &record);
+    if (retval) {
+        return retval;
+    }
+    if (record->type != SENML_VALUE_OBJLNK) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    const char *ptr = record->value.chunk.data;
+    const char *end = ptr + record->value.chunk.size;
+    if (parse_id(&ptr, end, out_oid) || ptr >= end || *ptr++ != ':'
+            || parse_id(&ptr, end, out_iid) || ptr != end) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    return 0;
+}
+
+static int cbor_get_id(anjay_input_ctx_t *ctx_,
+                       anjay_id_type_t *out_type,
+                       uint16_t *out_id) {
+    cbor_in_t *ctx = (cbor_in_t *) ctx_;
+    if (ctx->current == ctx->end) {
+        return ANJAY_GET_INDEX_END;
+    }
+    if (ctx->current->num_path_elems <= ctx->level) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    *out_type = (anjay_id_type_t) ctx->level;
+    *out_id = ctx->current->path[ctx->level];
+    ctx->has_id = true;
+    return 0;
+}
+
+static int cbor_next_entry(anjay_input_ctx_t *ctx_) {
+    cbor_in_t *ctx = (cbor_in_t *) ctx_;
+    if (ctx->has_id) {
+        ctx->current = next_node(ctx);
+        ctx->has_id = false;
+        ctx->bytes_read = 0;
+    }
+    return 0;
+}
+
+static int cbor_in_close(anjay_input_ctx_t *ctx_) {
+    cbor_in_t *ctx = (cbor_in_t *) ctx_;
+    _anjay_input_ctx_destroy(&ctx->child);
+    if (ctx->owner) {
+        AVS_LIST_CLEAR(&ctx->records);
+        avs_free(ctx->payload);
+    }
+    return 0;
+}
+
+static anjay_input_ctx_t *cbor_nested_ctx(anjay_input_ctx_t *ctx_);
+
+static const anjay_input_ctx_vtable_t CBOR_IN_VTABLE = {
+    .some_bytes = cbor_get_some_bytes,
+    .string = cbor_get_string,
+    .i32 = cbor_get_i32,
+    .i64 = cbor_get_i64,
+    .f32 = cbor_get_float,
+    .f64 = cbor_get_double,
+    .boolean = cbor_get_bool,
+    .objlnk = cbor_get_objlnk,
+    .nested_ctx = cbor_nested_ctx,
+    .get_id = cbor_get_id,
+    .next_entry = cbor_next_entry,
+    .close = cbor_in_close
+};
+
+static anjay_input_ctx_t *cbor_nested_ctx(anjay_input_ctx_t *ctx_) {
+    cbor_in_t *ctx = (cbor_in_t *) ctx_;
+    if (!ctx->has_id || ctx->current == ctx->end) {
+        return NULL;
+    }
+    cbor_in_t *child = (cbor_in_t *) avs_calloc(1, sizeof(cbor_in_t));
+    if (!child) {
+        cbor_log(ERROR, "out of memory");
+        return NULL;
+    }
+    child->vtable = &CBOR_IN_VTABLE;
+    child->level = ctx->level + 1;
+    child->current = ctx->current;
+    child->end = next_node(ctx);
+    _anjay_input_ctx_destroy(&ctx->child);
+    ctx->child = (anjay_input_ctx_t *) child;
+    return ctx->child;
+}
+
+static int check_records_match_uri(cbor_in_t *ctx,
+                                   const anjay_uri_path_t *uri) {
+    uint16_t uri_path[3];
+    size_t uri_path_elems = 0;
+    if (_anjay_uri_path_has_oid(uri)) {
+        uri_path[uri_path_elems++] = uri->oid;
+    }
+    if (_anjay_uri_path_has_iid(uri)) {
+        uri_path[uri_path_elems++] = uri->iid;
+    }
+    if (_anjay_uri_path_has_rid(uri)) {
+        uri_path[uri_path_elems++] = uri->rid;
+    }
+    // entries are always presented as children of an Instance at most, like
+    // in TLV, where writes on a Resource contain a Resource-level entry
+    ctx->level = AVS_MIN(uri_path_elems, (size_t) ANJAY_ID_RID);
+
+    AVS_LIST(senml_record_t) record;
+    AVS_LIST_FOREACH(record, ctx->records) {
+        if (record->num_path_elems <= ctx->level
+                || record->num_path_elems < uri_path_elems
+                || memcmp(record->path, uri_path,
+                          uri_path_elems * sizeof(*uri_path))) {
+            cbor_log(DEBUG, "SenML record outside of the request URI");
+            return ANJAY_ERR_BAD_REQUEST;
+        }
+    }
+    return 0;
+}
+
+int _anjay_input_senml_cbor_create(anjay_input_ctx_t **out,
+                                   avs_stream_abstract_t **stream_ptr,
+                                   bool autoclose,
+                                   const anjay_uri_path_t *uri) {
+    *out = NULL;
+    cbor_in_t *ctx = (cbor_in_t *) avs_calloc(1, sizeof(cbor_in_t));
+    if (!ctx) {
+        cbor_log(ERROR, "out of memory");
+        return ANJAY_ERR_INTERNAL;
+    }
+    ctx->vtable = &CBOR_IN_VTABLE;
+    ctx->owner = true;
+
+    size_t payload_size;
+    int retval;
+    if ((retval = read_payload(*stream_ptr, &ctx->payload, &payload_size))
+            || (retval = parse_payload(ctx, payload_size))
+            || (retval = check_records_match_uri(ctx, uri))) {
+        cbor_in_close((anjay_input_ctx_t *) ctx);
+        avs_free(ctx);
+        return retval;
+    }
+    // the whole payload is already parsed, the stream is no longer needed
+    if (autoclose) {
+        avs_stream_cleanup(stream_ptr);
+    }
+    ctx->current = ctx->records;
+    *out = (anjay_input_ctx_t *) ctx;
+    return 0;
+}
+
+#ifdef ANJAY_TEST
+#    include "test/cbor_in.c"
+#endif
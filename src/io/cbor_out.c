@@ -0,0 +1,430 @@
+/*
+ * Copyright 2017-2018 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <anjay_config.h>
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <avsystem/commons/memory.h>
+#include <avsystem/commons/stream.h>
+#include <avsystem/commons/utils.h>
+
+#include "../coap/content_format.h"
+
+#include "../io_core.h"
+#include "cbor.h"
+#include "vtable.h"
+
+#define cbor_log(level, ...) _anjay_log(senml_cbor, level, __VA_ARGS__)
+
+VISIBILITY_SOURCE_BEGIN
+
+#define MAX_PATH_LEN sizeof("/65535/65535/65535/65535")
+
+typedef struct {
+    const anjay_output_ctx_vtable_t *vtable;
+    const anjay_ret_bytes_ctx_vtable_t *ret_bytes_vtable;
+    avs_stream_abstract_t *stream;
+    int *errno_ptr;
+
+    /* Path of the currently processed node. anjay_id_type_t values are used
+     * as indices, i.e. path[ANJAY_ID_RID] is the Resource ID. The first
+     * num_base_path_elems elements come from the request URI and are written
+     * only once, as the SenML Base Name. */
+    uint16_t path[4];
+    size_t num_path_elems;
+    size_t num_base_path_elems;
+    bool base_name_written;
+
+    bool returning_array;
+    size_t bytes_left;
+} cbor_out_t;
+
+static int write_header(avs_stream_abstract_t *stream,
+                        cbor_major_type_t major_type,
+                        uint64_t value) {
+    uint8_t buf[9];
+    size_t length;
+    if (value < CBOR_EXT_LENGTH_1BYTE) {
+        buf[0] = CBOR_INITIAL_BYTE(major_type, value);
+        length = 1;
+    } else if (value <= UINT8_MAX) {
+        buf[0] = CBOR_INITIAL_BYTE(major_type, CBOR_EXT_LENGTH_1BYTE);
+        length = 2;
+    } else if (value <= UINT16_MAX) {
+        buf[0] = CBOR_INITIAL_BYTE(major_type, CBOR_EXT_LENGTH_2BYTE);
+        length = 3;
+    } else if (value <= UINT32_MAX) {
+        buf[0] = CBOR_INITIAL_BYTE(major_type, CBOR_EXT_LENGTH_4BYTE);
+        length = 5;
+    } else {
+        buf[0] = CBOR_INITIAL_BYTE(major_type, CBOR_EXT_LENGTH_8BYTE);
+        length = 9;
+    }
+    for (size_t i = length - 1; i > 0; --i) {
+        buf[i] = (uint8_t) (value & 0xFF);
+        value >>= 8;
+    }
+    return avs_stream_write(stream, buf, length);
+}
+
+static int write_int(avs_stream_abstract_t *stream, int64_t value) {
+    if (value < 0) {
+        return write_header(stream, CBOR_MAJOR_NEGATIVE_INT,
+                            (uint64_t) (-(value + 1)));
+    }
+    return write_header(stream, CBOR_MAJOR_UINT, (uint64_t) value);
+}
+
+static int write_text(avs_stream_abstract_t *stream, const char *value) {
+    size_t length = strlen(value);
+    int retval = write_header(stream, CBOR_MAJOR_TEXT_STRING, length);
+    if (!retval && length) {
+        retval = avs_stream_write(stream, value, length);
+    }
+    return retval;
+}
+
+static int write_simple(avs_stream_abstract_t *stream, uint8_t value) {
+    const uint8_t byte = CBOR_INITIAL_BYTE(CBOR_MAJOR_SIMPLE, value);
+    return avs_stream_write(stream, &byte, 1);
+}
+
+static int write_float(avs_stream_abstract_t *stream, float value) {
+    const uint32_t raw = _anjay_htonf(value);
+    int retval = write_simple(stream, CBOR_SIMPLE_FLOAT);
+    if (!retval) {
+        retval = avs_stream_write(stream, &raw, sizeof(raw));
+    }
+    return retval;
+}
+
+static int write_double(avs_stream_abstract_t *stream, double value) {
+    if ((double) (float) value == value) {
+        return write_float(stream, (float) value);
+    }
+    const uint64_t raw = _anjay_htond(value);
+    int retval = write_simple(stream, CBOR_SIMPLE_DOUBLE);
+    if (!retval) {
+        retval = avs_stream_write(stream, &raw, sizeof(raw));
+    }
+    return retval;
+}
+
+static int path_to_string(const cbor_out_t *ctx,
+                          size_t start_index,
+                          char *dest,
+                          size_t size) {
+    *dest = '\0';
+    for (size_t i = start_index; i < ctx->num_path_elems; i++) {
+        int written_chars =
+                avs_simple_snprintf(dest, size, "/%" PRIu16, ctx->path[i]);
+        if (written_chars < 0) {
+            return -1;
+        }
+        dest += written_chars;
+        size -= (size_t) written_chars;
+    }
+    return 0;
+}
+
+static int finish_ret_bytes(cbor_out_t *ctx) {
+    if (ctx->bytes_left) {
+        cbor_log(ERROR, "not enough data returned, %lu bytes missing",
+                 (unsigned long) ctx->bytes_left);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Writes the beginning of a SenML Record: the map header, Base Name (only in
+ * the first Record) and Name (unless it would be empty). The caller is
+ * expected to write exactly one key-value pair afterwards.
+ */
+static int write_record_begin(cbor_out_t *ctx) {
+    int retval = finish_ret_bytes(ctx);
+    if (retval) {
+        return retval;
+    }
+    const bool write_base_name =
+            !ctx->base_name_written && ctx->num_base_path_elems;
+    const bool write_name = ctx->num_path_elems > ctx->num_base_path_elems;
+    char buf[MAX_PATH_LEN];
+    if ((retval = write_header(ctx->stream, CBOR_MAJOR_MAP,
+                               1u + write_base_name + write_name))) {
+        return retval;
+    }
+    if (write_base_name) {
+        const size_t num_path_elems = ctx->num_path_elems;
+        ctx->num_path_elems = ctx->num_base_path_elems;
+        retval = path_to_string(ctx, 0, buf, sizeof(buf));
+        ctx->num_path_elems = num_path_elems;
+        if (retval
+                || (retval = write_int(ctx->stream, SENML_LABEL_BASE_NAME))
+                || (retval = write_text(ctx->stream, buf))) {
+            return retval ? retval : -1;
+        }
+        ctx->base_name_written = true;
+    }
+    if (write_name
+            && ((retval = path_to_string(ctx, ctx->num_base_path_elems, buf,
+                                         sizeof(buf)))
+                || (retval = write_int(ctx->stream, SENML_LABEL_NAME))
+                || (retval = write_text(ctx->stream, buf)))) {
+        return retval;
+    }
+    return 0;
+}
+
+static int write_record_value_key(cbor_out_t *ctx, senml_label_t label) {
+    int retval = write_record_begin(ctx);
+    if (!retval) {
+        retval = write_int(ctx->stream, label);
+    }
+    return retval;
+}
+
+static int *cbor_errno_ptr(anjay_output_ctx_t *ctx) {
+    return ((cbor_out_t *) ctx)->errno_ptr;
+}
+
+static anjay_ret_bytes_ctx_t *cbor_ret_bytes_begin(anjay_output_ctx_t *ctx_,
+                                                   size_t length) {
+    cbor_out_t *ctx = (cbor_out_t *) ctx_;
+    if (write_record_value_key(ctx, SENML_LABEL_VALUE_OPAQUE)
+            || write_header(ctx->stream, CBOR_MAJOR_BYTE_STRING, length)) {
+        return NULL;
+    }
+    ctx->bytes_left = length;
+    return (anjay_ret_bytes_ctx_t *) &ctx->ret_bytes_vtable;
+}
+
+static int cbor_ret_bytes_append(anjay_ret_bytes_ctx_t *ctx_,
+                                 const void *data,
+                                 size_t size) {
+    cbor_out_t *ctx = AVS_CONTAINER_OF(ctx_, cbor_out_t, ret_bytes_vtable);
+    if (size > ctx->bytes_left) {
+        cbor_log(ERROR, "tried to write too many bytes, expected %lu, got %lu",
+                 (unsigned long) ctx->bytes_left, (unsigned long) size);
+        return -1;
+    }
+    int retval = avs_stream_write(ctx->stream, data, size);
+    if (!retval) {
+        ctx->bytes_left -= size;
+    }
+    return retval;
+}
+
+static int cbor_ret_string(anjay_output_ctx_t *ctx_, const char *value) {
+    cbor_out_t *ctx = (cbor_out_t *) ctx_;
+    int retval = write_record_value_key(ctx, SENML_LABEL_VALUE_STRING);
+    if (!retval) {
+        retval = write_text(ctx->stream, value);
+    }
+    return retval;
+}
+
+static int cbor_ret_i64(anjay_output_ctx_t *ctx_, int64_t value) {
+    cbor_out_t *ctx = (cbor_out_t *) ctx_;
+    int retval = write_record_value_key(ctx, SENML_LABEL_VALUE);
+    if (!retval) {
+        retval = write_int(ctx->stream, value);
+    }
+    return retval;
+}
+
+static int cbor_ret_i32(anjay_output_ctx_t *ctx, int32_t value) {
+    return cbor_ret_i64(ctx, value);
+}
+
+static int cbor_ret_float(anjay_output_ctx_t *ctx_, float value) {
+    cbor_out_t *ctx = (cbor_out_t *) ctx_;
+    int retval = write_record_value_key(ctx, SENML_LABEL_VALUE);
+    if (!retval) {
+        retval = write_float(ctx->stream, value);
+    }
+    return retval;
+}
+
+static int cbor_ret_double(anjay_output_ctx_t *ctx_, double value) {
+    cbor_out_t *ctx = (cbor_out_t *) ctx_;
+    int retval = write_record_value_key(ctx, SENML_LABEL_VALUE);
+    if (!retval) {
+        retval = write_double(ctx->stream, value);
+    }
+    return retval;
+}
+
+static int cbor_ret_bool(anjay_output_ctx_t *ctx_, bool value) {
+    cbor_out_t *ctx = (cbor_out_t *) ctx_;
+    int retval = write_record_value_key(ctx, SENML_LABEL_VALUE_BOOL);
+    if (!retval) {
+        retval = write_simple(ctx->stream,
+                              value ? CBOR_SIMPLE_TRUE : CBOR_SIMPLE_FALSE);
+    }
+    return retval;
+}
+
+static int
+cbor_ret_objlnk(anjay_output_ctx_t *ctx_, anjay_oid_t oid, anjay_iid_t iid) {
+    cbor_out_t *ctx = (cbor_out_t *) ctx_;
+    char buf[sizeof("65535:65535")];
+    if (avs_simple_snprintf(buf, sizeof(buf), "%" PRIu16 ":%" PRIu16, oid,
+                            iid)
+            < 0) {
+        return -1;
+    }
+    int retval;
+    (void) ((retval = write_record_begin(ctx))
+            || (retval = write_text(ctx->stream, SENML_EXT_OBJLNK_LABEL))
+            || (retval = write_text(ctx->stream, buf)));
+    return retval;
+}
+
+static anjay_output_ctx_t *cbor_ret_array_start(anjay_output_ctx_t *ctx_) {
+    cbor_out_t *ctx = (cbor_out_t *) ctx_;
+    if (ctx->returning_array) {
+        cbor_log(ERROR, "attempted to start array while already started");
+        return NULL;
+    }
+    if (finish_ret_bytes(ctx)) {
+        return NULL;
+    }
+    ctx->returning_array = true;
+    return ctx_;
+}
+
+static int cbor_ret_array_finish(anjay_output_ctx_t *ctx_) {
+    cbor_out_t *ctx = (cbor_out_t *) ctx_;
+    if (!ctx->returning_array) {
+        cbor_log(ERROR, "cannot finish non-started array");
+        return -1;
+    }
+    ctx->returning_array = false;
+    return 0;
+}
+
+static anjay_output_ctx_t *cbor_ret_object_start(anjay_output_ctx_t *ctx) {
+    return ctx;
+}
+
+static int cbor_ret_object_finish(anjay_output_ctx_t *ctx) {
+    (void) ctx;
+    return 0;
+}
+
+static int
+cbor_set_id(anjay_output_ctx_t *ctx_, anjay_id_type_t type, uint16_t id) {
+    cbor_out_t *ctx = (cbor_out_t *) ctx_;
+    if (type == ANJAY_ID_RIID && !ctx->returning_array) {
+        cbor_log(ERROR, "cannot return array index on non-started array");
+        return -1;
+    }
+    if ((size_t) type < ctx->num_base_path_elems && ctx->path[type] != id) {
+        cbor_log(ERROR, "ID %" PRIu16 " does not match the request URI", id);
+        return -1;
+    }
+    ctx->path[type] = id;
+    ctx->num_path_elems = (size_t) type + 1;
+    if (ctx->num_path_elems < ctx->num_base_path_elems) {
+        ctx->num_path_elems = ctx->num_base_path_elems;
+    }
+    return finish_ret_bytes(ctx);
+}
+
+static int cbor_output_close(anjay_output_ctx_t *ctx_) {
+    cbor_out_t *ctx = (cbor_out_t *) ctx_;
+    const uint8_t array_end = CBOR_BREAK;
+    int retval = finish_ret_bytes(ctx);
+    if (!retval) {
+        retval = avs_stream_write(ctx->stream, &array_end, 1);
+    }
+    return retval;
+}
+
+static const anjay_output_ctx_vtable_t CBOR_OUT_VTABLE = {
+    .errno_ptr = cbor_errno_ptr,
+    .bytes_begin = cbor_ret_bytes_begin,
+    .string = cbor_ret_string,
+    .i32 = cbor_ret_i32,
+    .i64 = cbor_ret_i64,
+    .f32 = cbor_ret_float,
+    .f64 = cbor_ret_double,
+    .boolean = cbor_ret_bool,
+    .objlnk = cbor_ret_objlnk,
+    .array_start = cbor_ret_array_start,
+    .array_finish = cbor_ret_array_finish,
+    .object_start = cbor_ret_object_start,
+    .object_finish = cbor_ret_object_finish,
+    .set_id = cbor_set_id,
+    .close = cbor_output_close
+};
+
+static const anjay_ret_bytes_ctx_vtable_t CBOR_BYTES_VTABLE = {
+    .append = cbor_ret_bytes_append
+};
+
+static const uint8_t ARRAY_START =
+        CBOR_INITIAL_BYTE(CBOR_MAJOR_ARRAY, CBOR_EXT_LENGTH_INDEFINITE);
+
+static cbor_out_t *cbor_out_new(avs_stream_abstract_t *stream,
+                                int *errno_ptr,
+                                const anjay_uri_path_t *uri) {
+    cbor_out_t *ctx = (cbor_out_t *) avs_calloc(1, sizeof(cbor_out_t));
+    if (!ctx) {
+        return NULL;
+    }
+    ctx->vtable = &CBOR_OUT_VTABLE;
+    ctx->ret_bytes_vtable = &CBOR_BYTES_VTABLE;
+    ctx->errno_ptr = errno_ptr;
+    ctx->stream = stream;
+    if (_anjay_uri_path_has_oid(uri)) {
+        ctx->path[ctx->num_base_path_elems++] = uri->oid;
+    }
+    if (_anjay_uri_path_has_iid(uri)) {
+        ctx->path[ctx->num_base_path_elems++] = uri->iid;
+    }
+    if (_anjay_uri_path_has_rid(uri)) {
+        ctx->path[ctx->num_base_path_elems++] = uri->rid;
+    }
+    ctx->num_path_elems = ctx->num_base_path_elems;
+    return ctx;
+}
+
+anjay_output_ctx_t *
+_anjay_output_senml_cbor_create(avs_stream_abstract_t *stream,
+                                int *errno_ptr,
+                                anjay_msg_details_t *inout_details,
+                                const anjay_uri_path_t *uri) {
+    cbor_out_t *ctx = cbor_out_new(stream, errno_ptr, uri);
+    if (!ctx) {
+        return NULL;
+    }
+    if ((*errno_ptr = _anjay_handle_requested_format(
+                 &inout_details->format, ANJAY_COAP_FORMAT_SENML_CBOR))
+            || _anjay_coap_stream_setup_response(stream, inout_details)
+            || avs_stream_write(stream, &ARRAY_START, 1)) {
+        avs_free(ctx);
+        return NULL;
+    }
+    return (anjay_output_ctx_t *) ctx;
+}
+
+#ifdef ANJAY_TEST
+#    include "test/cbor_out.c"
+#endif
@@ -81,6 +81,19 @@ static anjay_output_ctx_t *spawn_json(dynamic_out_t *ctx, uint16_t format) {
 }
 #endif
 
+#ifdef WITH_SENML_CBOR
+static anjay_output_ctx_t *spawn_senml_cbor(dynamic_out_t *ctx) {
+    anjay_output_ctx_t *result =
+            _anjay_output_senml_cbor_create(ctx->stream, ctx->errno_ptr,
+                                            &ctx->details, &ctx->uri);
+    if (result && ctx->id >= 0
+            && _anjay_output_set_id(result, ctx->id_type, (uint16_t) ctx->id)) {
+        _anjay_output_ctx_destroy(&result);
+    }
+    return result;
+}
+#endif // WITH_SENML_CBOR
+
 static anjay_output_ctx_t *spawn_backend(dynamic_out_t *ctx, uint16_t format) {
     switch (_anjay_translate_legacy_content_format(format)) {
     case ANJAY_COAP_FORMAT_OPAQUE:
@@ -93,6 +106,10 @@ static anjay_output_ctx_t *spawn_backend(dynamic_out_t *ctx, uint16_t format) {
     case ANJAY_COAP_FORMAT_JSON:
         return spawn_json(ctx, ANJAY_COAP_FORMAT_JSON);
 #endif
+#ifdef WITH_SENML_CBOR
+    case ANJAY_COAP_FORMAT_SENML_CBOR:
+        return spawn_senml_cbor(ctx);
+#endif // WITH_SENML_CBOR
     default:
         anjay_log(ERROR, "Unsupported output format: %" PRIu16, format);
         *ctx->errno_ptr = -AVS_COAP_CODE_NOT_ACCEPTABLE;
@@ -252,6 +269,16 @@ dynamic_set_id(anjay_output_ctx_t *ctx_, anjay_id_type_t type, uint16_t id) {
     }
 }
 
+static int dynamic_set_next_size(anjay_output_ctx_t *ctx_, size_t size) {
+    dynamic_out_t *ctx = (dynamic_out_t *) ctx_;
+    // the size is only meaningful for a nested entry, which makes the format
+    // default to TLV just like in dynamic_ret_object_start()
+    if (!ensure_backend(ctx, ANJAY_COAP_FORMAT_TLV)) {
+        return -1;
+    }
+    return _anjay_output_set_next_size(ctx->backend, size);
+}
+
 static int dynamic_close(anjay_output_ctx_t *ctx_) {
     dynamic_out_t *ctx = (dynamic_out_t *) ctx_;
 
@@ -274,6 +301,7 @@ static const anjay_output_ctx_vtable_t DYNAMIC_OUT_VTABLE = {
     .array_start = dynamic_ret_array_start,
     .object_start = dynamic_ret_object_start,
     .set_id = dynamic_set_id,
+    .set_next_size = dynamic_set_next_size,
     .close = dynamic_close
 };
 
@@ -304,7 +332,9 @@ _anjay_output_dynamic_create(avs_stream_abstract_t *stream,
 
 int _anjay_input_dynamic_create(anjay_input_ctx_t **out,
                                 avs_stream_abstract_t **stream_ptr,
-                                bool autoclose) {
+                                bool autoclose,
+                                const anjay_uri_path_t *uri) {
+    (void) uri;
     const avs_coap_msg_t *msg;
     uint16_t format;
     int result;
@@ -320,6 +350,14 @@ int _anjay_input_dynamic_create(anjay_input_ctx_t **out,
         return _anjay_input_tlv_create(out, stream_ptr, autoclose);
     case ANJAY_COAP_FORMAT_OPAQUE:
         return _anjay_input_opaque_create(out, stream_ptr, autoclose);
+#ifdef WITH_JSON
+    case ANJAY_COAP_FORMAT_JSON:
+        return _anjay_input_json_create(out, stream_ptr, autoclose, uri);
+#endif // WITH_JSON
+#ifdef WITH_SENML_CBOR
+    case ANJAY_COAP_FORMAT_SENML_CBOR:
+        return _anjay_input_senml_cbor_create(out, stream_ptr, autoclose, uri);
+#endif // WITH_SENML_CBOR
     default:
         return ANJAY_ERR_UNSUPPORTED_CONTENT_FORMAT;
     }
@@ -0,0 +1,1202 @@
+/*
+ * Copyright 2017-2018 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <anjay_config.h>
+
+#include <assert.h>
+#include <ctype.h>
+#include <limits.h>
+#include <string.h>
+
+#include <avsystem/commons/base64.h>
+#include <avsystem/commons/memory.h>
+#include <avsystem/commons/stream.h>
+#include <avsystem/commons/utils.h>
+
+#include "../io_core.h"
+#include "../utils_core.h"
+#include "vtable.h"
+
+#define json_log(level, ...) _anjay_log(json, level, __VA_ARGS__)
+
+VISIBILITY_SOURCE_BEGIN
+
+#define MAX_NESTING_DEPTH 8
+#define MAX_PATH_LEN sizeof("/65535/65535/65535/65535")
+/* longest key meaningful for LwM2M JSON, longer ones are skipped */
+#define MAX_KEY_LEN sizeof("bn")
+/* longer numbers are not a sensible representation of anything LwM2M uses */
+#define MAX_NUMBER_LEN 64
+#define READ_BUFFER_SIZE 64
+
+typedef enum {
+    JSON_VALUE_NONE,
+    JSON_VALUE_INT,
+    JSON_VALUE_DOUBLE,
+    JSON_VALUE_BOOL,
+    JSON_VALUE_OBJLNK,
+    JSON_VALUE_STRING
+} json_value_type_t;
+
+typedef enum {
+    /* "sv" value has not been accessed yet */
+    JSON_STRING_UNREAD,
+    /* "sv" value is being read as text using get_string */
+    JSON_STRING_TEXT,
+    /* "sv" value is being read as Base64-encoded data using some_bytes */
+    JSON_STRING_BYTES
+} json_string_mode_t;
+
+typedef struct {
+    /* anjay_id_type_t values are used as indices */
+    uint16_t path[4];
+    size_t num_path_elems;
+    json_value_type_t type;
+    union {
+        int64_t i64;
+        double f64;
+        bool boolean;
+        struct {
+            anjay_oid_t oid;
+            anjay_iid_t iid;
+        } objlnk;
+    } value;
+
+    /* "sv" values are not buffered; they are decoded directly from the stream
+     * while being read, so they must be the last thing parsed before the
+     * element is presented to the user */
+    bool string_pending;
+    json_string_mode_t string_mode;
+    uint8_t bytes_cached[3];
+    size_t num_bytes_cached;
+
+    /* true if the closing brace of the element has already been consumed */
+    bool closed;
+} json_element_t;
+
+typedef enum {
+    /* the next element of the "e" array has not been parsed yet */
+    JSON_BEFORE_ELEMENT,
+    /* header of the current element is parsed and available in element */
+    JSON_IN_ELEMENT,
+    /* the whole payload has been consumed */
+    JSON_END
+} json_parser_state_t;
+
+typedef struct {
+    avs_stream_abstract_t *stream;
+    bool autoclose;
+    char buffer[READ_BUFFER_SIZE];
+    size_t buffer_pos;
+    size_t buffer_size;
+    char stream_finished;
+
+    /* UTF-8 encoding of the last escape sequence, not returned yet */
+    char escaped[4];
+    size_t escaped_pos;
+    size_t escaped_size;
+
+    char base_name[MAX_PATH_LEN];
+    uint16_t uri_path[3];
+    size_t uri_path_elems;
+
+    json_parser_state_t state;
+    json_element_t element;
+} json_parser_t;
+
+typedef struct {
+    const anjay_input_ctx_vtable_t *vtable;
+    /* parser and stream are owned by the top-level context; nested contexts
+     * are only views of the same sequence of elements */
+    json_parser_t *parser;
+    bool owner;
+
+    /* Number of path elements common to all elements in this context; IDs of
+     * the next level are returned by get_id. If has_id is set, path[level] is
+     * the last returned ID. */
+    size_t level;
+    uint16_t path[4];
+    bool has_id;
+    anjay_input_ctx_t *child;
+} json_in_t;
+
+/////////////////////////////////////////////////////////////////////// LEXING
+
+static int fill_buffer(json_parser_t *parser) {
+    while (parser->buffer_pos == parser->buffer_size
+           && !parser->stream_finished) {
+        size_t bytes_read;
+        int retval = avs_stream_read(parser->stream, &bytes_read,
+                                     &parser->stream_finished, parser->buffer,
+                                     sizeof(parser->buffer));
+        if (retval) {
+            return retval;
+        }
+        parser->buffer_pos = 0;
+        parser->buffer_size = bytes_read;
+    }
+    return 0;
+}
+
+static int peek_char(json_parser_t *parser, char *out) {
+    int retval = fill_buffer(parser);
+    if (retval) {
+        return retval;
+    }
+    if (parser->buffer_pos == parser->buffer_size) {
+        json_log(DEBUG, "unexpected end of JSON payload");
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    *out = parser->buffer[parser->buffer_pos];
+    return 0;
+}
+
+static int next_char(json_parser_t *parser, char *out) {
+    int retval = peek_char(parser, out);
+    if (!retval) {
+        ++parser->buffer_pos;
+    }
+    return retval;
+}
+
+static int skip_whitespace(json_parser_t *parser) {
+    while (true) {
+        int retval = fill_buffer(parser);
+        if (retval) {
+            return retval;
+        }
+        if (parser->buffer_pos == parser->buffer_size) {
+            return 0;
+        }
+        const char c = parser->buffer[parser->buffer_pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            return 0;
+        }
+        ++parser->buffer_pos;
+    }
+}
+
+static int expect_char(json_parser_t *parser, char expected) {
+    char c;
+    int retval;
+    if ((retval = skip_whitespace(parser))
+            || (retval = next_char(parser, &c))) {
+        return retval;
+    }
+    if (c != expected) {
+        json_log(DEBUG, "expected '%c' in JSON payload, got '%c'", expected, c);
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    return 0;
+}
+
+static int read_hex4(json_parser_t *parser, uint32_t *out) {
+    *out = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c;
+        int retval = next_char(parser, &c);
+        if (retval) {
+            return retval;
+        }
+        if (c >= '0' && c <= '9') {
+            *out = (*out << 4) | (uint32_t) (c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            *out = (*out << 4) | (uint32_t) (c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            *out = (*out << 4) | (uint32_t) (c - 'A' + 10);
+        } else {
+            return ANJAY_ERR_BAD_REQUEST;
+        }
+    }
+    return 0;
+}
+
+static int read_code_point(json_parser_t *parser, uint32_t *out) {
+    int retval = read_hex4(parser, out);
+    if (retval) {
+        return retval;
+    }
+    if (*out >= 0xDC00 && *out < 0xE000) {
+        return ANJAY_ERR_BAD_REQUEST;
+    } else if (*out >= 0xD800 && *out < 0xDC00) {
+        // high surrogate, a low surrogate escape must follow
+        char c1, c2;
+        uint32_t low;
+        if ((retval = next_char(parser, &c1))
+                || (retval = next_char(parser, &c2))
+                || (retval = (c1 == '\\' && c2 == 'u')
+                                     ? 0
+                                     : ANJAY_ERR_BAD_REQUEST)
+                || (retval = read_hex4(parser, &low))) {
+            return retval;
+        }
+        if (low < 0xDC00 || low >= 0xE000) {
+            return ANJAY_ERR_BAD_REQUEST;
+        }
+        *out = 0x10000 + ((*out - 0xD800) << 10) + (low - 0xDC00);
+    }
+    return *out ? 0 : ANJAY_ERR_BAD_REQUEST;
+}
+
+static void encode_utf8(json_parser_t *parser, uint32_t code_point) {
+    char *out = parser->escaped;
+    if (code_point < 0x80) {
+        *out++ = (char) code_point;
+    } else if (code_point < 0x800) {
+        *out++ = (char) (0xC0 | (code_point >> 6));
+        *out++ = (char) (0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        *out++ = (char) (0xE0 | (code_point >> 12));
+        *out++ = (char) (0x80 | ((code_point >> 6) & 0x3F));
+        *out++ = (char) (0x80 | (code_point & 0x3F));
+    } else {
+        *out++ = (char) (0xF0 | (code_point >> 18));
+        *out++ = (char) (0x80 | ((code_point >> 12) & 0x3F));
+        *out++ = (char) (0x80 | ((code_point >> 6) & 0x3F));
+        *out++ = (char) (0x80 | (code_point & 0x3F));
+    }
+    parser->escaped_pos = 0;
+    parser->escaped_size = (size_t) (out - parser->escaped);
+}
+
+/**
+ * Decodes an escape sequence, whose backslash has already been consumed, into
+ * parser->escaped.
+ */
+static int read_escape(json_parser_t *parser) {
+    char c;
+    int retval = next_char(parser, &c);
+    if (retval) {
+        return retval;
+    }
+    switch (c) {
+    case '"':
+    case '\\':
+    case '/':
+        break;
+    case 'b':
+        c = '\b';
+        break;
+    case 'f':
+        c = '\f';
+        break;
+    case 'n':
+        c = '\n';
+        break;
+    case 'r':
+        c = '\r';
+        break;
+    case 't':
+        c = '\t';
+        break;
+    case 'u': {
+        uint32_t code_point;
+        if ((retval = read_code_point(parser, &code_point))) {
+            return retval;
+        }
+        encode_utf8(parser, code_point);
+        return 0;
+    }
+    default:
+        json_log(DEBUG, "invalid escape sequence in JSON string");
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    encode_utf8(parser, (uint32_t) (unsigned char) c);
+    return 0;
+}
+
+/**
+ * Reads up to @p size characters of a string, whose opening quote has already
+ * been consumed. Escape sequences are decoded. @p out_finished is set if the
+ * closing quote has been reached; it is consumed in that case.
+ */
+static int read_string_chunk(json_parser_t *parser,
+                             char *out,
+                             size_t size,
+                             size_t *out_size,
+                             bool *out_finished) {
+    char c;
+    int retval;
+    *out_size = 0;
+    *out_finished = false;
+    while (*out_size < size) {
+        if (parser->escaped_pos < parser->escaped_size) {
+            out[(*out_size)++] = parser->escaped[parser->escaped_pos++];
+            continue;
+        }
+        if ((retval = next_char(parser, &c))) {
+            return retval;
+        }
+        if (c == '"') {
+            *out_finished = true;
+            return 0;
+        } else if ((unsigned char) c < 0x20) {
+            json_log(DEBUG, "unescaped control character in JSON string");
+            return ANJAY_ERR_BAD_REQUEST;
+        } else if (c == '\\') {
+            if ((retval = read_escape(parser))) {
+                return retval;
+            }
+        } else {
+            out[(*out_size)++] = c;
+        }
+    }
+    // report the end of string as soon as possible, without an extra call
+    if (parser->escaped_pos == parser->escaped_size) {
+        if ((retval = peek_char(parser, &c))) {
+            return retval;
+        }
+        if (c == '"') {
+            ++parser->buffer_pos;
+            *out_finished = true;
+        }
+    }
+    return 0;
+}
+
+static int skip_string_rest(json_parser_t *parser) {
+    bool finished = false;
+    while (!finished) {
+        char buf[16];
+        size_t bytes_read;
+        int retval = read_string_chunk(parser, buf, sizeof(buf), &bytes_read,
+                                       &finished);
+        if (retval) {
+            return retval;
+        }
+    }
+    return 0;
+}
+
+static int read_string(json_parser_t *parser, char *out, size_t size) {
+    assert(size > 0);
+    size_t length;
+    bool finished;
+    int retval;
+    if ((retval = expect_char(parser, '"'))
+            || (retval = read_string_chunk(parser, out, size - 1, &length,
+                                           &finished))) {
+        return retval;
+    }
+    if (!finished) {
+        json_log(DEBUG, "JSON string too long");
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    out[length] = '\0';
+    return 0;
+}
+
+/**
+ * Reads a key of a JSON object member, along with the following colon. Keys
+ * longer than @p size - 1 are returned as empty strings.
+ */
+static int read_key(json_parser_t *parser, char *out, size_t size) {
+    size_t length;
+    bool finished;
+    int retval;
+    if ((retval = expect_char(parser, '"'))
+            || (retval = read_string_chunk(parser, out, size - 1, &length,
+                                           &finished))
+            || (!finished && (retval = skip_string_rest(parser)))) {
+        return retval;
+    }
+    out[finished ? length : 0] = '\0';
+    return expect_char(parser, ':');
+}
+
+static int read_token(json_parser_t *parser,
+                      const char *allowed_chars,
+                      char *out,
+                      size_t size) {
+    size_t length = 0;
+    int retval = skip_whitespace(parser);
+    while (!retval) {
+        char c;
+        if ((retval = peek_char(parser, &c))) {
+            break;
+        }
+        if (!c || !strchr(allowed_chars, c)) {
+            out[length] = '\0';
+            return length ? 0 : ANJAY_ERR_BAD_REQUEST;
+        }
+        if (length + 1 >= size) {
+            return ANJAY_ERR_BAD_REQUEST;
+        }
+        out[length++] = c;
+        ++parser->buffer_pos;
+    }
+    return retval;
+}
+
+static int read_number_token(json_parser_t *parser, char *out, size_t size) {
+    int retval = read_token(parser, "+-.0123456789Ee", out, size);
+    if (retval) {
+        return retval;
+    }
+    // reject forms accepted by strtod() and strtoll() but not valid in JSON
+    const char *digits = out + (*out == '-');
+    if (!isdigit((unsigned char) *digits)
+            || (digits[0] == '0' && isdigit((unsigned char) digits[1]))) {
+        json_log(DEBUG, "invalid JSON number: %s", out);
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    return 0;
+}
+
+static int skip_value(json_parser_t *parser, unsigned depth) {
+    char c;
+    int retval;
+    if (depth > MAX_NESTING_DEPTH) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    if ((retval = skip_whitespace(parser))
+            || (retval = peek_char(parser, &c))) {
+        return retval;
+    }
+    if (c == '"') {
+        ++parser->buffer_pos;
+        return skip_string_rest(parser);
+    } else if (c == '{' || c == '[') {
+        const char closing = (c == '{' ? '}' : ']');
+        ++parser->buffer_pos;
+        if ((retval = skip_whitespace(parser))
+                || (retval = peek_char(parser, &c))) {
+            return retval;
+        }
+        if (c == closing) {
+            ++parser->buffer_pos;
+            return 0;
+        }
+        do {
+            char key[1];
+            if ((closing == '}'
+                 && (retval = read_key(parser, key, sizeof(key))))
+                    || (retval = skip_value(parser, depth + 1))
+                    || (retval = skip_whitespace(parser))
+                    || (retval = next_char(parser, &c))) {
+                return retval;
+            }
+        } while (c == ',');
+        return c == closing ? 0 : ANJAY_ERR_BAD_REQUEST;
+    } else if (c == '-' || isdigit((unsigned char) c)) {
+        char number[MAX_NUMBER_LEN];
+        return read_number_token(parser, number, sizeof(number));
+    } else {
+        char literal[sizeof("false")];
+        if ((retval = read_token(parser, "aeflnrstu", literal,
+                                 sizeof(literal)))) {
+            return retval;
+        }
+        return (!strcmp(literal, "true") || !strcmp(literal, "false")
+                || !strcmp(literal, "null"))
+                       ? 0
+                       : ANJAY_ERR_BAD_REQUEST;
+    }
+}
+
+////////////////////////////////////////////////////////////////////// PARSING
+
+static int read_number(json_parser_t *parser, json_element_t *element) {
+    char number[MAX_NUMBER_LEN];
+    int retval = read_number_token(parser, number, sizeof(number));
+    if (retval) {
+        return retval;
+    }
+    long long ll;
+    if (!strpbrk(number, ".Ee") && !_anjay_safe_strtoll(number, &ll)
+#if LLONG_MAX != INT64_MAX
+            && ll >= INT64_MIN && ll <= INT64_MAX
+#endif
+    ) {
+        element->type = JSON_VALUE_INT;
+        element->value.i64 = (int64_t) ll;
+    } else if (!_anjay_safe_strtod(number, &element->value.f64)) {
+        // integers out of int64_t range end up here as well
+        element->type = JSON_VALUE_DOUBLE;
+    } else {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    return 0;
+}
+
+static int read_bool(json_parser_t *parser, json_element_t *element) {
+    char literal[sizeof("false")];
+    int retval = read_token(parser, "aeflrstu", literal, sizeof(literal));
+    if (retval) {
+        return retval;
+    }
+    if (!strcmp(literal, "true")) {
+        element->value.boolean = true;
+    } else if (!strcmp(literal, "false")) {
+        element->value.boolean = false;
+    } else {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    element->type = JSON_VALUE_BOOL;
+    return 0;
+}
+
+static int parse_id(const char **ptr, uint16_t *out) {
+    uint32_t value = 0;
+    if (!(**ptr >= '0' && **ptr <= '9')) {
+        return -1;
+    }
+    while (**ptr >= '0' && **ptr <= '9') {
+        value = 10 * value + (uint32_t) (*(*ptr)++ - '0');
+        if (value > UINT16_MAX) {
+            return -1;
+        }
+    }
+    *out = (uint16_t) value;
+    return 0;
+}
+
+static int read_objlnk(json_parser_t *parser, json_element_t *element) {
+    char buf[sizeof("65535:65535")];
+    int retval = read_string(parser, buf, sizeof(buf));
+    if (retval) {
+        return retval;
+    }
+    const char *ptr = buf;
+    if (parse_id(&ptr, &element->value.objlnk.oid) || *ptr++ != ':'
+            || parse_id(&ptr, &element->value.objlnk.iid) || *ptr) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    element->type = JSON_VALUE_OBJLNK;
+    return 0;
+}
+
+/**
+ * Parses members of an element until its end, or until the beginning of an
+ * "sv" value, which is left in the stream to be read on demand.
+ */
+static int parse_element_members(json_parser_t *parser,
+                                 char *name,
+                                 bool *inout_has_name) {
+    json_element_t *element = &parser->element;
+    while (true) {
+        char key[MAX_KEY_LEN];
+        int retval = read_key(parser, key, sizeof(key));
+        if (retval) {
+            return retval;
+        }
+        const bool is_value = (!strcmp(key, "v") || !strcmp(key, "bv")
+                               || !strcmp(key, "ov") || !strcmp(key, "sv"));
+        if (is_value && element->type != JSON_VALUE_NONE) {
+            json_log(DEBUG, "more than one value in a JSON element");
+            return ANJAY_ERR_BAD_REQUEST;
+        }
+        if (!strcmp(key, "n")) {
+            if (*inout_has_name) {
+                json_log(DEBUG, "\"n\" must precede \"sv\" and occur once");
+                return ANJAY_ERR_BAD_REQUEST;
+            }
+            *inout_has_name = true;
+            retval = read_string(parser, name, MAX_PATH_LEN);
+        } else if (!strcmp(key, "v")) {
+            retval = read_number(parser, element);
+        } else if (!strcmp(key, "bv")) {
+            retval = read_bool(parser, element);
+        } else if (!strcmp(key, "ov")) {
+            retval = read_objlnk(parser, element);
+        } else if (!strcmp(key, "sv")) {
+            // the name cannot be changed once the value is handed out
+            *inout_has_name = true;
+            element->type = JSON_VALUE_STRING;
+            if (!(retval = expect_char(parser, '"'))) {
+                element->string_pending = true;
+            }
+            return retval;
+        } else {
+            retval = skip_value(parser, 0);
+        }
+
+        char c;
+        if (retval || (retval = skip_whitespace(parser))
+                || (retval = next_char(parser, &c))) {
+            return retval;
+        }
+        if (c == '}') {
+            element->closed = true;
+            return 0;
+        } else if (c != ',') {
+            return ANJAY_ERR_BAD_REQUEST;
+        }
+    }
+}
+
+static int parse_path(json_parser_t *parser, const char *name) {
+    json_element_t *element = &parser->element;
+    char buf[MAX_PATH_LEN];
+    if (avs_simple_snprintf(buf, sizeof(buf), "%s%s", parser->base_name, name)
+            < 0) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    const size_t max_path_elems =
+            sizeof(element->path) / sizeof(*element->path);
+    const char *ptr = buf;
+    element->num_path_elems = 0;
+    while (*ptr) {
+        if (*ptr++ != '/' || element->num_path_elems >= max_path_elems
+                || parse_id(&ptr,
+                            &element->path[element->num_path_elems++])) {
+            json_log(DEBUG, "invalid JSON element name: %s", buf);
+            return ANJAY_ERR_BAD_REQUEST;
+        }
+    }
+    // entries are always presented as children of an Instance at most, see
+    // _anjay_input_json_create()
+    if (element->num_path_elems
+                    <= AVS_MIN(parser->uri_path_elems, (size_t) ANJAY_ID_RID)
+            || element->num_path_elems < parser->uri_path_elems
+            || memcmp(element->path, parser->uri_path,
+                      parser->uri_path_elems * sizeof(*parser->uri_path))) {
+        json_log(DEBUG, "JSON element outside of the request URI: %s", buf);
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    return 0;
+}
+
+static int finish_payload(json_parser_t *parser) {
+    int retval = skip_whitespace(parser);
+    if (retval) {
+        return retval;
+    }
+    if (parser->buffer_pos != parser->buffer_size) {
+        json_log(DEBUG, "garbage after the JSON payload");
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    parser->state = JSON_END;
+    return 0;
+}
+
+/**
+ * Parses the remaining members of the top-level object, after the "e" array.
+ */
+static int parse_trailer(json_parser_t *parser) {
+    while (true) {
+        char c;
+        char key[MAX_KEY_LEN];
+        int retval;
+        if ((retval = skip_whitespace(parser))
+                || (retval = next_char(parser, &c))) {
+            return retval;
+        }
+        if (c == '}') {
+            return finish_payload(parser);
+        }
+        if (c != ',' || (retval = read_key(parser, key, sizeof(key)))) {
+            return retval ? retval : ANJAY_ERR_BAD_REQUEST;
+        }
+        if (!strcmp(key, "bn")) {
+            json_log(DEBUG, "\"bn\" after \"e\" is not supported");
+            return ANJAY_ERR_BAD_REQUEST;
+        }
+        if ((retval = skip_value(parser, 0))) {
+            return retval;
+        }
+    }
+}
+
+static int parse_preamble(json_parser_t *parser) {
+    char c;
+    int retval;
+    if ((retval = expect_char(parser, '{'))
+            || (retval = skip_whitespace(parser))
+            || (retval = peek_char(parser, &c))) {
+        return retval;
+    }
+    if (c == '}') {
+        ++parser->buffer_pos;
+        return finish_payload(parser);
+    }
+    while (true) {
+        char key[MAX_KEY_LEN];
+        if ((retval = read_key(parser, key, sizeof(key)))) {
+            return retval;
+        }
+        if (!strcmp(key, "bn")) {
+            retval = read_string(parser, parser->base_name,
+                                 sizeof(parser->base_name));
+        } else if (!strcmp(key, "e")) {
+            if ((retval = expect_char(parser, '['))
+                    || (retval = skip_whitespace(parser))
+                    || (retval = peek_char(parser, &c))) {
+                return retval;
+            }
+            if (c == ']') {
+                ++parser->buffer_pos;
+                return parse_trailer(parser);
+            }
+            parser->state = JSON_BEFORE_ELEMENT;
+            return 0;
+        } else {
+            retval = skip_value(parser, 0);
+        }
+        if (retval || (retval = skip_whitespace(parser))
+                || (retval = next_char(parser, &c))) {
+            return retval;
+        }
+        if (c == '}') {
+            return finish_payload(parser);
+        } else if (c != ',') {
+            return ANJAY_ERR_BAD_REQUEST;
+        }
+    }
+}
+
+static int parse_element(json_parser_t *parser) {
+    assert(parser->state == JSON_BEFORE_ELEMENT);
+    json_element_t *element = &parser->element;
+    memset(element, 0, sizeof(*element));
+    char name[MAX_PATH_LEN] = "";
+    bool has_name = false;
+    char c;
+    int retval;
+    if ((retval = expect_char(parser, '{'))
+            || (retval = skip_whitespace(parser))
+            || (retval = peek_char(parser, &c))) {
+        return retval;
+    }
+    if (c == '}') {
+        ++parser->buffer_pos;
+        element->closed = true;
+    } else if ((retval = parse_element_members(parser, name, &has_name))) {
+        return retval;
+    }
+    if ((retval = parse_path(parser, name))) {
+        return retval;
+    }
+    parser->state = JSON_IN_ELEMENT;
+    return 0;
+}
+
+/**
+ * Consumes whatever is left of the current element in the stream.
+ */
+static int finish_element(json_parser_t *parser) {
+    assert(parser->state == JSON_IN_ELEMENT);
+    json_element_t *element = &parser->element;
+    char c;
+    int retval;
+    if (element->string_pending) {
+        if ((retval = skip_string_rest(parser))) {
+            return retval;
+        }
+        element->string_pending = false;
+    }
+    if (!element->closed) {
+        if ((retval = skip_whitespace(parser))
+                || (retval = next_char(parser, &c))) {
+            return retval;
+        }
+        if (c == ',') {
+            char name[MAX_PATH_LEN];
+            bool has_name = true;
+            if ((retval = parse_element_members(parser, name, &has_name))) {
+                return retval;
+            }
+            // the element already has a value, so nothing else is accepted
+            assert(element->closed);
+        } else if (c != '}') {
+            return ANJAY_ERR_BAD_REQUEST;
+        }
+    }
+    if ((retval = skip_whitespace(parser))
+            || (retval = next_char(parser, &c))) {
+        return retval;
+    }
+    if (c == ',') {
+        parser->state = JSON_BEFORE_ELEMENT;
+        return 0;
+    } else if (c == ']') {
+        return parse_trailer(parser);
+    }
+    return ANJAY_ERR_BAD_REQUEST;
+}
+
+/**
+ * Makes sure that the header of the next element with a value is parsed,
+ * unless the end of payload has been reached.
+ */
+static int peek_element(json_parser_t *parser) {
+    while (parser->state == JSON_BEFORE_ELEMENT) {
+        int retval = parse_element(parser);
+        if (!retval && parser->element.type == JSON_VALUE_NONE) {
+            // elements without a value carry no data for the data model
+            retval = finish_element(parser);
+        }
+        if (retval) {
+            return retval;
+        }
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////// DECODING
+
+static bool element_in_node(const json_element_t *element,
+                            const uint16_t *path,
+                            size_t num_path_elems) {
+    return element->num_path_elems >= num_path_elems
+           && !memcmp(element->path, path, num_path_elems * sizeof(*path));
+}
+
+static int get_element(json_in_t *ctx, json_element_t **out_element) {
+    int retval = peek_element(ctx->parser);
+    if (retval) {
+        return retval;
+    }
+    json_element_t *element = &ctx->parser->element;
+    if (ctx->parser->state == JSON_END
+            || !element_in_node(element, ctx->path,
+                                ctx->level + (ctx->has_id ? 1 : 0))
+            || element->num_path_elems > ctx->level + 1) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    *out_element = element;
+    return 0;
+}
+
+static void flush_bytes_cached(json_element_t *element,
+                               uint8_t **out_buf,
+                               size_t *buf_size) {
+    size_t bytes_to_copy = AVS_MIN(element->num_bytes_cached, *buf_size);
+    memcpy(*out_buf, element->bytes_cached, bytes_to_copy);
+    memmove(element->bytes_cached, element->bytes_cached + bytes_to_copy,
+            sizeof(element->bytes_cached) - bytes_to_copy);
+    element->num_bytes_cached -= bytes_to_copy;
+    *buf_size -= bytes_to_copy;
+    *out_buf += bytes_to_copy;
+}
+
+static int json_get_some_bytes(anjay_input_ctx_t *ctx_,
+                               size_t *out_bytes_read,
+                               bool *out_message_finished,
+                               void *out_buf,
+                               size_t buf_size) {
+    json_in_t *ctx = (json_in_t *) ctx_;
+    json_element_t *element;
+    int retval = get_element(ctx, &element);
+    if (retval) {
+        return retval;
+    }
+    if (element->type != JSON_VALUE_STRING
+            || element->string_mode == JSON_STRING_TEXT) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    element->string_mode = JSON_STRING_BYTES;
+    uint8_t *current = (uint8_t *) out_buf;
+    while (true) {
+        flush_bytes_cached(element, &current, &buf_size);
+        if (!buf_size || !element->string_pending) {
+            break;
+        }
+        // 4 bytes + null terminator
+        char encoded[5];
+        size_t length;
+        bool finished;
+        if ((retval = read_string_chunk(ctx->parser, encoded, 4, &length,
+                                        &finished))) {
+            return retval;
+        }
+        element->string_pending = !finished;
+        if (!length) {
+            continue;
+        }
+        encoded[length] = '\0';
+        if (length != 4 || (!finished && encoded[3] == '=')) {
+            return ANJAY_ERR_BAD_REQUEST;
+        }
+        ssize_t num_decoded =
+                avs_base64_decode_strict(element->bytes_cached,
+                                         sizeof(element->bytes_cached),
+                                         encoded);
+        if (num_decoded < 0) {
+            return ANJAY_ERR_BAD_REQUEST;
+        }
+        element->num_bytes_cached = (size_t) num_decoded;
+    }
+    *out_bytes_read = (size_t) (current - (uint8_t *) out_buf);
+    *out_message_finished =
+            !element->string_pending && !element->num_bytes_cached;
+    return 0;
+}
+
+static int
+json_get_string(anjay_input_ctx_t *ctx_, char *out_buf, size_t buf_size) {
+    json_in_t *ctx = (json_in_t *) ctx_;
+    json_element_t *element;
+    int retval = get_element(ctx, &element);
+    if (retval) {
+        return retval;
+    }
+    if (element->type != JSON_VALUE_STRING
+            || element->string_mode == JSON_STRING_BYTES || !buf_size) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    element->string_mode = JSON_STRING_TEXT;
+    size_t length = 0;
+    if (element->string_pending) {
+        bool finished;
+        if ((retval = read_string_chunk(ctx->parser, out_buf, buf_size - 1,
+                                        &length, &finished))) {
+            return retval;
+        }
+        element->string_pending = !finished;
+    }
+    out_buf[length] = '\0';
+    return element->string_pending ? ANJAY_BUFFER_TOO_SHORT : 0;
+}
+
+static int get_integer(anjay_input_ctx_t *ctx,
+                       int64_t min_value,
+                       int64_t max_value,
+                       int64_t *out) {
+    json_element_t *element;
+    int retval = get_element((json_in_t *) ctx, &element);
+    if (retval) {
+        return retval;
+    }
+    if (element->type == JSON_VALUE_INT) {
+        *out = element->value.i64;
+    } else if (element->type == JSON_VALUE_DOUBLE
+               // (double) INT64_MAX rounds up to 2^63, so the bounds need to
+               // be checked against exact powers of two before the cast
+               && element->value.f64 >= -9223372036854775808.0
+               && element->value.f64 < 9223372036854775808.0
+               && (double) (int64_t) element->value.f64
+                          == element->value.f64) {
+        *out = (int64_t) element->value.f64;
+    } else {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    return (*out < min_value || *out > max_value) ? ANJAY_ERR_BAD_REQUEST : 0;
+}
+
+static int json_get_i32(anjay_input_ctx_t *ctx, int32_t *out) {
+    int64_t value;
+    int retval = get_integer(ctx, INT32_MIN, INT32_MAX, &value);
+    if (!retval) {
+        *out = (int32_t) value;
+    }
+    return retval;
+}
+
+static int json_get_i64(anjay_input_ctx_t *ctx, int64_t *out) {
+    return get_integer(ctx, INT64_MIN, INT64_MAX, out);
+}
+
+static int json_get_double(anjay_input_ctx_t *ctx, double *out) {
+    json_element_t *element;
+    int retval = get_element((json_in_t *) ctx, &element);
+    if (retval) {
+        return retval;
+    }
+    switch (element->type) {
+    case JSON_VALUE_INT:
+        *out = (double) element->value.i64;
+        return 0;
+    case JSON_VALUE_DOUBLE:
+        *out = element->value.f64;
+        return 0;
+    default:
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+}
+
+static int json_get_float(anjay_input_ctx_t *ctx, float *out) {
+    double value;
+    int retval = json_get_double(ctx, &value);
+    if (!retval) {
+        *out = (float) value;
+    }
+    return retval;
+}
+
+static int json_get_bool(anjay_input_ctx_t *ctx, bool *out) {
+    json_element_t *element;
+    int retval = get_element((json_in_t *) ctx, &element);
+    if (retval) {
+        return retval;
+    }
+    if (element->type != JSON_VALUE_BOOL) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    *out = element->value.boolean;
+    return 0;
+}
+
+static int json_get_objlnk(anjay_input_ctx_t *ctx,
+                           anjay_oid_t *out_oid,
+                           anjay_iid_t *out_iid) {
+    json_element_t *element;
+    int retval = get_element((json_in_t *) ctx, &element);
+    if (retval) {
+        return retval;
+    }
+    if (element->type != JSON_VALUE_OBJLNK) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    *out_oid = element->value.objlnk.oid;
+    *out_iid = element->value.objlnk.iid;
+    return 0;
+}
+
+static int json_get_id(anjay_input_ctx_t *ctx_,
+                       anjay_id_type_t *out_type,
+                       uint16_t *out_id) {
+    json_in_t *ctx = (json_in_t *) ctx_;
+    int retval = peek_element(ctx->parser);
+    if (retval) {
+        return retval;
+    }
+    const json_element_t *element = &ctx->parser->element;
+    // elements that do not belong to this context belong to one of its
+    // ancestors, so this context has been fully read
+    if (ctx->parser->state == JSON_END
+            || !element_in_node(element, ctx->path, ctx->level)) {
+        return ANJAY_GET_INDEX_END;
+    }
+    if (element->num_path_elems <= ctx->level) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    ctx->path[ctx->level] = element->path[ctx->level];
+    ctx->has_id = true;
+    *out_type = (anjay_id_type_t) ctx->level;
+    *out_id = ctx->path[ctx->level];
+    return 0;
+}
+
+static int json_next_entry(anjay_input_ctx_t *ctx_) {
+    json_in_t *ctx = (json_in_t *) ctx_;
+    if (!ctx->has_id) {
+        return 0;
+    }
+    ctx->has_id = false;
+    while (true) {
+        int retval = peek_element(ctx->parser);
+        if (retval || ctx->parser->state == JSON_END
+                || !element_in_node(&ctx->parser->element, ctx->path,
+                                    ctx->level + 1)) {
+            return retval;
+        }
+        if ((retval = finish_element(ctx->parser))) {
+            return retval;
+        }
+    }
+}
+
+static int json_in_close(anjay_input_ctx_t *ctx_) {
+    json_in_t *ctx = (json_in_t *) ctx_;
+    int retval = _anjay_input_ctx_destroy(&ctx->child);
+    if (ctx->owner) {
+        if (ctx->parser->autoclose) {
+            int cleanup_retval = avs_stream_cleanup(&ctx->parser->stream);
+            retval = retval ? retval : cleanup_retval;
+        }
+        avs_free(ctx->parser);
+    }
+    return retval;
+}
+
+static anjay_input_ctx_t *json_nested_ctx(anjay_input_ctx_t *ctx_);
+
+static const anjay_input_ctx_vtable_t JSON_IN_VTABLE = {
+    .some_bytes = json_get_some_bytes,
+    .string = json_get_string,
+    .i32 = json_get_i32,
+    .i64 = json_get_i64,
+    .f32 = json_get_float,
+    .f64 = json_get_double,
+    .boolean = json_get_bool,
+    .objlnk = json_get_objlnk,
+    .nested_ctx = json_nested_ctx,
+    .get_id = json_get_id,
+    .next_entry = json_next_entry,
+    .close = json_in_close
+};
+
+static anjay_input_ctx_t *json_nested_ctx(anjay_input_ctx_t *ctx_) {
+    json_in_t *ctx = (json_in_t *) ctx_;
+    if (!ctx->has_id
+            || ctx->level + 1 >= sizeof(ctx->path) / sizeof(*ctx->path)) {
+        return NULL;
+    }
+    json_in_t *child = (json_in_t *) avs_calloc(1, sizeof(json_in_t));
+    if (!child) {
+        json_log(ERROR, "out of memory");
+        return NULL;
+    }
+    child->vtable = &JSON_IN_VTABLE;
+    child->parser = ctx->parser;
+    child->level = ctx->level + 1;
+    memcpy(child->path, ctx->path, sizeof(child->path));
+    _anjay_input_ctx_destroy(&ctx->child);
+    ctx->child = (anjay_input_ctx_t *) child;
+    return ctx->child;
+}
+
+int _anjay_input_json_create(anjay_input_ctx_t **out,
+                             avs_stream_abstract_t **stream_ptr,
+                             bool autoclose,
+                             const anjay_uri_path_t *uri) {
+    *out = NULL;
+    json_in_t *ctx = (json_in_t *) avs_calloc(1, sizeof(json_in_t));
+    json_parser_t *parser =
+            (json_parser_t *) avs_calloc(1, sizeof(json_parser_t));
+    if (!ctx || !parser) {
+        json_log(ERROR, "out of memory");
+        avs_free(ctx);
+        avs_free(parser);
+        return ANJAY_ERR_INTERNAL;
+    }
+    ctx->vtable = &JSON_IN_VTABLE;
+    ctx->parser = parser;
+    ctx->owner = true;
+    parser->stream = *stream_ptr;
+
+    if (_anjay_uri_path_has_oid(uri)) {
+        parser->uri_path[parser->uri_path_elems++] = uri->oid;
+    }
+    if (_anjay_uri_path_has_iid(uri)) {
+        parser->uri_path[parser->uri_path_elems++] = uri->iid;
+    }
+    if (_anjay_uri_path_has_rid(uri)) {
+        parser->uri_path[parser->uri_path_elems++] = uri->rid;
+    }
+    // entries are always presented as children of an Instance at most, like
+    // in TLV, where writes on a Resource contain a Resource-level entry
+    ctx->level = AVS_MIN(parser->uri_path_elems, (size_t) ANJAY_ID_RID);
+    memcpy(ctx->path, parser->uri_path, ctx->level * sizeof(*ctx->path));
+
+    int retval = parse_preamble(parser);
+    if (retval) {
+        avs_free(parser);
+        avs_free(ctx);
+        return retval;
+    }
+    if (autoclose) {
+        *stream_ptr = NULL;
+        parser->autoclose = true;
+    }
+    *out = (anjay_input_ctx_t *) ctx;
+    return 0;
+}
+
+#ifdef ANJAY_TEST
+#    include "test/json_in.c"
+#endif
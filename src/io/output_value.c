@@ -0,0 +1,212 @@
+/*
+ * Copyright 2017-2018 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <anjay_config.h>
+
+#include <string.h>
+
+#include "../utils_core.h"
+#include "vtable.h"
+
+VISIBILITY_SOURCE_BEGIN
+
+static int *output_value_errno_ptr(anjay_output_ctx_t *ctx) {
+    return &((anjay_output_value_ctx_t *) ctx)->errno_;
+}
+
+static int output_value_set_id(anjay_output_ctx_t *ctx_,
+                               anjay_id_type_t type,
+                               uint16_t id) {
+    anjay_output_value_ctx_t *ctx = (anjay_output_value_ctx_t *) ctx_;
+    if (type == ANJAY_ID_RIID) {
+        if (!ctx->in_array) {
+            return -1;
+        }
+        ctx->has_riid = true;
+        ctx->next_riid = id;
+    }
+    return 0;
+}
+
+static int type_mismatch(anjay_output_value_ctx_t *ctx) {
+    anjay_log(DEBUG, "unexpected type of value returned for an internal read");
+    ctx->errno_ = ANJAY_OUTCTXERR_METHOD_NOT_IMPLEMENTED;
+    return -1;
+}
+
+/**
+ * Finds the array element the next typed value shall be stored in. Elements
+ * beyond the capacity are only counted.
+ */
+static int next_element(anjay_output_value_ctx_t *ctx, size_t *out_index) {
+    if (ctx->in_array) {
+        if (!ctx->has_riid) {
+            return -1;
+        }
+        if (ctx->count < ctx->capacity) {
+            ctx->riids[ctx->count] = ctx->next_riid;
+        }
+        ctx->has_riid = false;
+    } else if (ctx->count) {
+        return -1;
+    }
+    *out_index = ctx->count++;
+    return 0;
+}
+
+static int append_bytes(anjay_output_value_ctx_t *ctx,
+                        const void *data,
+                        size_t data_size) {
+    if (ctx->type != ANJAY_OUTPUT_VALUE_BYTES) {
+        return type_mismatch(ctx);
+    }
+    if (data_size > ctx->capacity - ctx->count) {
+        anjay_log(DEBUG, "value does not fit in the buffer");
+        return -1;
+    }
+    if (data_size) {
+        memcpy((char *) ctx->values + ctx->count, data, data_size);
+        ctx->count += data_size;
+    }
+    return 0;
+}
+
+static int output_value_ret_string(anjay_output_ctx_t *ctx, const char *str) {
+    return append_bytes((anjay_output_value_ctx_t *) ctx, str, strlen(str));
+}
+
+static int output_value_ret_i64(anjay_output_ctx_t *ctx_, int64_t value) {
+    anjay_output_value_ctx_t *ctx = (anjay_output_value_ctx_t *) ctx_;
+    if (ctx->type == ANJAY_OUTPUT_VALUE_BYTES) {
+        return append_bytes(ctx, &value, sizeof(value));
+    } else if (ctx->type != ANJAY_OUTPUT_VALUE_I64) {
+        return type_mismatch(ctx);
+    }
+    size_t index;
+    if (next_element(ctx, &index)) {
+        return -1;
+    }
+    if (index < ctx->capacity) {
+        ((int64_t *) ctx->values)[index] = value;
+    }
+    return 0;
+}
+
+static int output_value_ret_i32(anjay_output_ctx_t *ctx, int32_t value) {
+    return output_value_ret_i64(ctx, value);
+}
+
+static int output_value_ret_bool(anjay_output_ctx_t *ctx_, bool value) {
+    anjay_output_value_ctx_t *ctx = (anjay_output_value_ctx_t *) ctx_;
+    if (ctx->type == ANJAY_OUTPUT_VALUE_BYTES) {
+        return append_bytes(ctx, &value, sizeof(value));
+    } else if (ctx->type != ANJAY_OUTPUT_VALUE_BOOL) {
+        return type_mismatch(ctx);
+    }
+    size_t index;
+    if (next_element(ctx, &index)) {
+        return -1;
+    }
+    if (index < ctx->capacity) {
+        ((bool *) ctx->values)[index] = value;
+    }
+    return 0;
+}
+
+static int output_value_ret_double(anjay_output_ctx_t *ctx, double value) {
+    return append_bytes((anjay_output_value_ctx_t *) ctx, &value,
+                        sizeof(value));
+}
+
+static int output_value_ret_float(anjay_output_ctx_t *ctx, float value) {
+    return output_value_ret_double(ctx, value);
+}
+
+static anjay_ret_bytes_ctx_t *
+output_value_ret_bytes_begin(anjay_output_ctx_t *ctx_, size_t length) {
+    anjay_output_value_ctx_t *ctx = (anjay_output_value_ctx_t *) ctx_;
+    if (ctx->type != ANJAY_OUTPUT_VALUE_BYTES) {
+        type_mismatch(ctx);
+        return NULL;
+    }
+    if (length > ctx->capacity - ctx->count) {
+        anjay_log(DEBUG, "value does not fit in the buffer");
+        return NULL;
+    }
+    return (anjay_ret_bytes_ctx_t *) &ctx->ret_bytes_vtable;
+}
+
+static int output_value_ret_bytes_append(anjay_ret_bytes_ctx_t *ctx,
+                                         const void *data,
+                                         size_t size) {
+    return append_bytes(AVS_CONTAINER_OF(ctx, anjay_output_value_ctx_t,
+                                         ret_bytes_vtable),
+                        data, size);
+}
+
+static anjay_output_ctx_t *output_value_array_start(anjay_output_ctx_t *ctx_) {
+    anjay_output_value_ctx_t *ctx = (anjay_output_value_ctx_t *) ctx_;
+    if (ctx->type == ANJAY_OUTPUT_VALUE_BYTES || !ctx->riids || ctx->in_array
+            || ctx->count) {
+        type_mismatch(ctx);
+        return NULL;
+    }
+    ctx->in_array = true;
+    return ctx_;
+}
+
+static int output_value_array_finish(anjay_output_ctx_t *ctx_) {
+    anjay_output_value_ctx_t *ctx = (anjay_output_value_ctx_t *) ctx_;
+    if (!ctx->in_array) {
+        return -1;
+    }
+    ctx->in_array = false;
+    ctx->has_riid = false;
+    return 0;
+}
+
+static const anjay_output_ctx_vtable_t VALUE_OUT_VTABLE = {
+    .errno_ptr = output_value_errno_ptr,
+    .bytes_begin = output_value_ret_bytes_begin,
+    .string = output_value_ret_string,
+    .i32 = output_value_ret_i32,
+    .i64 = output_value_ret_i64,
+    .f32 = output_value_ret_float,
+    .f64 = output_value_ret_double,
+    .boolean = output_value_ret_bool,
+    .array_start = output_value_array_start,
+    .array_finish = output_value_array_finish,
+    .set_id = output_value_set_id
+};
+
+static const anjay_ret_bytes_ctx_vtable_t VALUE_BYTES_VTABLE = {
+    .append = output_value_ret_bytes_append
+};
+
+anjay_output_value_ctx_t
+_anjay_output_value_ctx_init(anjay_output_value_type_t type,
+                             void *values,
+                             anjay_riid_t *riids,
+                             size_t capacity) {
+    return (anjay_output_value_ctx_t) {
+        .vtable = &VALUE_OUT_VTABLE,
+        .ret_bytes_vtable = &VALUE_BYTES_VTABLE,
+        .type = type,
+        .values = values,
+        .riids = riids,
+        .capacity = capacity
+    };
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2017-2018 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <anjay_config.h>
+
+#include <avsystem/commons/unit/memstream.h>
+#include <avsystem/commons/unit/test.h>
+
+#define TEST_ENV(Data)                                                       \
+    avs_stream_abstract_t *stream = NULL;                                    \
+    AVS_UNIT_ASSERT_SUCCESS(avs_unit_memstream_alloc(&stream, sizeof(Data))); \
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(stream, Data, sizeof(Data) - 1))
+
+#define TEST_TEARDOWN                                           \
+    do {                                                        \
+        AVS_UNIT_ASSERT_SUCCESS(_anjay_input_ctx_destroy(&in)); \
+        AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));   \
+    } while (0)
+
+#define ASSERT_ID(Ctx, IdType, Id)                                     \
+    do {                                                               \
+        anjay_id_type_t type;                                          \
+        uint16_t id;                                                   \
+        AVS_UNIT_ASSERT_SUCCESS(_anjay_input_get_id((Ctx), &type, &id)); \
+        AVS_UNIT_ASSERT_EQUAL(type, (IdType));                         \
+        AVS_UNIT_ASSERT_EQUAL(id, (Id));                               \
+    } while (0)
+
+AVS_UNIT_TEST(cbor_in, instance) {
+    TEST_ENV("\x83"
+             // {-2: "/3/0/", 0: "2", 3: "ab"}
+             "\xA3\x21\x65/3/0/\x00\x61"
+             "2"
+             "\x03\x62"
+             "ab"
+             // {0: "1", 2: 1.5}, encoded as a half-precision float
+             "\xA2\x00\x61"
+             "1"
+             "\x02\xF9\x3E\x00"
+             // {0: "3", 4: true}
+             "\xA2\x00\x61"
+             "3"
+             "\x04\xF5");
+    anjay_input_ctx_t *in;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_senml_cbor_create(
+            &in, &stream, false, &MAKE_INSTANCE_PATH(3, 0)));
+
+    // records are sorted by path
+    double double_value;
+    int32_t i32_value;
+    ASSERT_ID(in, ANJAY_ID_RID, 1);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_double(in, &double_value));
+    AVS_UNIT_ASSERT_EQUAL(double_value, 1.5);
+    AVS_UNIT_ASSERT_FAILED(anjay_get_i32(in, &i32_value));
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_next_entry(in));
+
+    char buf[8];
+    ASSERT_ID(in, ANJAY_ID_RID, 2);
+    AVS_UNIT_ASSERT_EQUAL(anjay_get_string(in, buf, 2),
+                          ANJAY_BUFFER_TOO_SHORT);
+    AVS_UNIT_ASSERT_EQUAL_STRING(buf, "a");
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_string(in, buf, sizeof(buf)));
+    AVS_UNIT_ASSERT_EQUAL_STRING(buf, "b");
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_next_entry(in));
+
+    bool bool_value;
+    ASSERT_ID(in, ANJAY_ID_RID, 3);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_bool(in, &bool_value));
+    AVS_UNIT_ASSERT_TRUE(bool_value);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_next_entry(in));
+
+    anjay_id_type_t type;
+    uint16_t id;
+    AVS_UNIT_ASSERT_EQUAL(_anjay_input_get_id(in, &type, &id),
+                          ANJAY_GET_INDEX_END);
+    TEST_TEARDOWN;
+}
+
+AVS_UNIT_TEST(cbor_in, multiple_resource) {
+    TEST_ENV("\x9F"
+             // {0: "/3/0/7/1", 2: -2}
+             "\xA2\x00\x68/3/0/7/1\x02\x21"
+             // {_ 0: "/3/0/7/0", "vlo": "3:1"}
+             "\xBF\x00\x68/3/0/7/0\x63vlo\x63"
+             "3:1"
+             "\xFF"
+             "\xFF");
+    anjay_input_ctx_t *in;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_senml_cbor_create(
+            &in, &stream, false, &MAKE_RESOURCE_PATH(3, 0, 7)));
+
+    ASSERT_ID(in, ANJAY_ID_RID, 7);
+    anjay_input_ctx_t *array = anjay_get_array(in);
+    AVS_UNIT_ASSERT_NOT_NULL(array);
+
+    anjay_riid_t riid;
+    anjay_oid_t oid;
+    anjay_iid_t iid;
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_array_index(array, &riid));
+    AVS_UNIT_ASSERT_EQUAL(riid, 0);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_objlnk(array, &oid, &iid));
+    AVS_UNIT_ASSERT_EQUAL(oid, 3);
+    AVS_UNIT_ASSERT_EQUAL(iid, 1);
+
+    int64_t i64_value;
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_array_index(array, &riid));
+    AVS_UNIT_ASSERT_EQUAL(riid, 1);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_i64(array, &i64_value));
+    AVS_UNIT_ASSERT_EQUAL(i64_value, -2);
+
+    AVS_UNIT_ASSERT_EQUAL(anjay_get_array_index(array, &riid),
+                          ANJAY_GET_INDEX_END);
+    TEST_TEARDOWN;
+}
+
+AVS_UNIT_TEST(cbor_in, record_outside_uri) {
+    // [{0: "/3/1/1", 2: 0}]
+    TEST_ENV("\x81\xA2\x00\x66/3/1/1\x02\x00");
+    anjay_input_ctx_t *in = NULL;
+    AVS_UNIT_ASSERT_EQUAL(_anjay_input_senml_cbor_create(
+                                  &in, &stream, false,
+                                  &MAKE_INSTANCE_PATH(3, 0)),
+                          ANJAY_ERR_BAD_REQUEST);
+    AVS_UNIT_ASSERT_NULL(in);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+}
+
+AVS_UNIT_TEST(cbor_in, duplicate_record) {
+    // [{0: "/3/0/1", 2: 1}, {0: "/3/0/2", 2: 2}, {0: "/3/0/2", 2: 3}]
+    TEST_ENV("\x83"
+             "\xA2\x00\x66/3/0/1\x02\x01"
+             "\xA2\x00\x66/3/0/2\x02\x02"
+             "\xA2\x00\x66/3/0/2\x02\x03");
+    anjay_input_ctx_t *in = NULL;
+    AVS_UNIT_ASSERT_EQUAL(_anjay_input_senml_cbor_create(
+                                  &in, &stream, false,
+                                  &MAKE_INSTANCE_PATH(3, 0)),
+                          ANJAY_ERR_BAD_REQUEST);
+    AVS_UNIT_ASSERT_NULL(in);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+}
+
+AVS_UNIT_TEST(cbor_in, integer_out_of_range) {
+    TEST_ENV("\x83"
+             // {0: "/3/0/1", 2: 2^63}, encoded as an unsigned integer
+             "\xA2\x00\x66/3/0/1\x02\x1B\x80\x00\x00\x00\x00\x00\x00\x00"
+             // {0: "/3/0/2", 2: 2^63}, encoded as a double
+             "\xA2\x00\x66/3/0/2\x02\xFB\x43\xE0\x00\x00\x00\x00\x00\x00"
+             // {0: "/3/0/3", 2: -2^63}, encoded as a double
+             "\xA2\x00\x66/3/0/3\x02\xFB\xC3\xE0\x00\x00\x00\x00\x00\x00");
+    anjay_input_ctx_t *in;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_senml_cbor_create(
+            &in, &stream, false, &MAKE_INSTANCE_PATH(3, 0)));
+
+    int64_t i64_value;
+    double double_value;
+    ASSERT_ID(in, ANJAY_ID_RID, 1);
+    AVS_UNIT_ASSERT_EQUAL(anjay_get_i64(in, &i64_value),
+                          ANJAY_ERR_BAD_REQUEST);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_double(in, &double_value));
+    AVS_UNIT_ASSERT_EQUAL(double_value, 9223372036854775808.0);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_next_entry(in));
+
+    ASSERT_ID(in, ANJAY_ID_RID, 2);
+    AVS_UNIT_ASSERT_EQUAL(anjay_get_i64(in, &i64_value),
+                          ANJAY_ERR_BAD_REQUEST);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_next_entry(in));
+
+    int32_t i32_value;
+    ASSERT_ID(in, ANJAY_ID_RID, 3);
+    AVS_UNIT_ASSERT_EQUAL(anjay_get_i32(in, &i32_value),
+                          ANJAY_ERR_BAD_REQUEST);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_i64(in, &i64_value));
+    AVS_UNIT_ASSERT_EQUAL(i64_value, INT64_MIN);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_next_entry(in));
+    TEST_TEARDOWN;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2017-2018 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <anjay_config.h>
+
+#include <avsystem/commons/unit/test.h>
+
+#define TEST_ENV(Size, Uri)                                                  \
+    char buf[Size];                                                          \
+    avs_stream_outbuf_t outbuf = AVS_STREAM_OUTBUF_STATIC_INITIALIZER;       \
+    avs_stream_outbuf_set_buffer(&outbuf, buf, sizeof(buf));                 \
+    int outctx_errno = 0;                                                    \
+    anjay_output_ctx_t *out = (anjay_output_ctx_t *) cbor_out_new(           \
+            (avs_stream_abstract_t *) &outbuf, &outctx_errno, &(Uri));       \
+    AVS_UNIT_ASSERT_NOT_NULL(out);                                           \
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(                                \
+            (avs_stream_abstract_t *) &outbuf, &ARRAY_START, 1))
+
+#define VERIFY_BYTES(Data)                                       \
+    do {                                                         \
+        AVS_UNIT_ASSERT_EQUAL(avs_stream_outbuf_offset(&outbuf), \
+                              sizeof(Data) - 1);                 \
+        AVS_UNIT_ASSERT_EQUAL_BYTES(buf, Data);                  \
+    } while (0)
+
+AVS_UNIT_TEST(cbor_out, instance) {
+    TEST_ENV(64, MAKE_INSTANCE_PATH(3, 0));
+
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_set_id(out, ANJAY_ID_RID, 1));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_i32(out, 42));
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_set_id(out, ANJAY_ID_RID, 2));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_string(out, "ab"));
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_set_id(out, ANJAY_ID_RID, 3));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_bool(out, true));
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_set_id(out, ANJAY_ID_RID, 4));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_double(out, 1.5));
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_ctx_destroy(&out));
+    VERIFY_BYTES("\x9F"
+                 // {-2: "/3/0", 0: "/1", 2: 42}
+                 "\xA3\x21\x64/3/0\x00\x62/1\x02\x18\x2A"
+                 // {0: "/2", 3: "ab"}
+                 "\xA2\x00\x62/2\x03\x62"
+                 "ab"
+                 // {0: "/3", 4: true}
+                 "\xA2\x00\x62/3\x04\xF5"
+                 // {0: "/4", 2: 1.5}, encoded as a single-precision float
+                 "\xA2\x00\x62/4\x02\xFA\x3F\xC0\x00\x00"
+                 "\xFF");
+}
+
+AVS_UNIT_TEST(cbor_out, multiple_resource) {
+    TEST_ENV(64, MAKE_RESOURCE_PATH(3, 0, 7));
+
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_set_id(out, ANJAY_ID_RID, 7));
+    anjay_output_ctx_t *array = anjay_ret_array_start(out);
+    AVS_UNIT_ASSERT_NOT_NULL(array);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_array_index(array, 0));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_i64(array, -1));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_array_index(array, 1));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_objlnk(array, 3, 1));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_array_finish(array));
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_ctx_destroy(&out));
+    VERIFY_BYTES("\x9F"
+                 // {-2: "/3/0/7", 0: "/0", 2: -1}
+                 "\xA3\x21\x66/3/0/7\x00\x62/0\x02\x20"
+                 // {0: "/1", "vlo": "3:1"}
+                 "\xA2\x00\x62/1\x63vlo\x63"
+                 "3:1"
+                 "\xFF");
+}
+
+AVS_UNIT_TEST(cbor_out, bytes) {
+    TEST_ENV(64, MAKE_RESOURCE_PATH(5, 0, 0));
+
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_set_id(out, ANJAY_ID_RID, 0));
+    anjay_ret_bytes_ctx_t *bytes = anjay_ret_bytes_begin(out, 3);
+    AVS_UNIT_ASSERT_NOT_NULL(bytes);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_bytes_append(bytes, "\x01", 1));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_bytes_append(bytes, "\x02\x03", 2));
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_ctx_destroy(&out));
+    VERIFY_BYTES("\x9F"
+                 // {-2: "/5/0/0", 8: h'010203'}
+                 "\xA2\x21\x66/5/0/0\x08\x43\x01\x02\x03"
+                 "\xFF");
+}
+
+AVS_UNIT_TEST(cbor_out, bytes_too_short) {
+    TEST_ENV(64, MAKE_RESOURCE_PATH(5, 0, 0));
+
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_set_id(out, ANJAY_ID_RID, 0));
+    anjay_ret_bytes_ctx_t *bytes = anjay_ret_bytes_begin(out, 3);
+    AVS_UNIT_ASSERT_NOT_NULL(bytes);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_bytes_append(bytes, "\x01", 1));
+    AVS_UNIT_ASSERT_FAILED(anjay_ret_bytes_append(bytes, "\x02\x03\x04", 3));
+    AVS_UNIT_ASSERT_FAILED(_anjay_output_ctx_destroy(&out));
+}
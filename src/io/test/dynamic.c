@@ -264,10 +264,13 @@ AVS_UNIT_TEST(dynamic_out, format_mismatch) {
             _anjay_mock_coap_stream_create(&coap, mocksock, 256, 256); \
     avs_unit_mocksock_input(mocksock, Data, sizeof(Data) - 1)
 
-#define TEST_ENV(Data)                                                       \
-    TEST_ENV_COMMON(Data);                                                   \
-    anjay_input_ctx_t *ctx;                                                  \
-    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_dynamic_create(&ctx, &coap, true)); \
+#define TEST_URI (&MAKE_INSTANCE_PATH(1, 2))
+
+#define TEST_ENV(Data)                                                      \
+    TEST_ENV_COMMON(Data);                                                  \
+    anjay_input_ctx_t *ctx;                                                 \
+    AVS_UNIT_ASSERT_SUCCESS(                                                \
+            _anjay_input_dynamic_create(&ctx, &coap, true, TEST_URI));      \
     AVS_UNIT_ASSERT_NOT_NULL(ctx)
 
 #define TEST_TEARDOWN _anjay_input_ctx_destroy(&ctx)
@@ -279,6 +282,7 @@ AVS_UNIT_TEST(dynamic_out, format_mismatch) {
 #define LITERAL_COAP_FORMAT_FIRSTOPT_TLV "\xC2\x2d\x16"
 #define LITERAL_COAP_FORMAT_FIRSTOPT_JSON "\xC2\x2d\x17"
 #define LITERAL_COAP_FORMAT_FIRSTOPT_OPAQUE "\xC1\x2A"
+#define LITERAL_COAP_FORMAT_FIRSTOPT_SENML_CBOR "\xC1\x70"
 #define LITERAL_COAP_FORMAT_FIRSTOPT_UNKNOWN "\xC2\x69\x69"
 
 AVS_UNIT_TEST(dynamic_in, plain) {
@@ -305,7 +309,8 @@ AVS_UNIT_TEST(dynamic_in, no_content_format) {
     TEST_ENV_COMMON("\x50\x01\x00\x00\xFF"
                     "514");
     anjay_input_ctx_t *ctx;
-    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_dynamic_create(&ctx, &coap, true));
+    AVS_UNIT_ASSERT_SUCCESS(
+            _anjay_input_dynamic_create(&ctx, &coap, true, TEST_URI));
     AVS_UNIT_ASSERT_SUCCESS(_anjay_input_ctx_destroy(&ctx));
     AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&coap));
 }
@@ -346,14 +351,59 @@ AVS_UNIT_TEST(dynamic_in, opaque) {
 #undef HELLO_WORLD
 }
 
+#ifdef WITH_JSON
+AVS_UNIT_TEST(dynamic_in, json) {
+    TEST_ENV(COAP_HEADER(LITERAL_COAP_FORMAT_FIRSTOPT_JSON)
+             "{\"e\":[{\"n\":\"/1/2/42\",\"v\":69}]}");
+
+    int32_t value;
+    anjay_id_type_t type;
+    uint16_t id;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_get_id(ctx, &type, &id));
+    AVS_UNIT_ASSERT_EQUAL(type, ANJAY_ID_RID);
+    AVS_UNIT_ASSERT_EQUAL(id, 42);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_i32(ctx, &value));
+    AVS_UNIT_ASSERT_EQUAL(value, 69);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_next_entry(ctx));
+    AVS_UNIT_ASSERT_EQUAL(_anjay_input_get_id(ctx, &type, &id),
+                          ANJAY_GET_INDEX_END);
+
+    TEST_TEARDOWN;
+}
+#endif // WITH_JSON
+
+#ifdef WITH_SENML_CBOR
+AVS_UNIT_TEST(dynamic_in, senml_cbor) {
+    // [{0: "/1/2/42", 2: 69}]
+    TEST_ENV(COAP_HEADER(LITERAL_COAP_FORMAT_FIRSTOPT_SENML_CBOR)
+             "\x81\xA2\x00\x67/1/2/42\x02\x18\x45");
+
+    int32_t value;
+    anjay_id_type_t type;
+    uint16_t id;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_get_id(ctx, &type, &id));
+    AVS_UNIT_ASSERT_EQUAL(type, ANJAY_ID_RID);
+    AVS_UNIT_ASSERT_EQUAL(id, 42);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_i32(ctx, &value));
+    AVS_UNIT_ASSERT_EQUAL(value, 69);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_next_entry(ctx));
+    AVS_UNIT_ASSERT_EQUAL(_anjay_input_get_id(ctx, &type, &id),
+                          ANJAY_GET_INDEX_END);
+
+    TEST_TEARDOWN;
+}
+#endif // WITH_SENML_CBOR
+
 AVS_UNIT_TEST(dynamic_in, unrecognized) {
     TEST_ENV_COMMON(COAP_HEADER(LITERAL_COAP_FORMAT_FIRSTOPT_UNKNOWN) "514");
     anjay_input_ctx_t *ctx;
-    AVS_UNIT_ASSERT_EQUAL(_anjay_input_dynamic_create(&ctx, &coap, true),
-                          ANJAY_ERR_UNSUPPORTED_CONTENT_FORMAT);
+    AVS_UNIT_ASSERT_EQUAL(
+            _anjay_input_dynamic_create(&ctx, &coap, true, TEST_URI),
+            ANJAY_ERR_UNSUPPORTED_CONTENT_FORMAT);
     AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&coap));
 }
 
 #undef COAP_HEADER
+#undef TEST_URI
 #undef TEST_TEARDOWN
 #undef TEST_ENV
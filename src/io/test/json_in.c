@@ -0,0 +1,224 @@
+/*
+ * Copyright 2017-2018 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <anjay_config.h>
+
+#include <avsystem/commons/unit/memstream.h>
+#include <avsystem/commons/unit/test.h>
+
+#define TEST_ENV(Data)                                                       \
+    avs_stream_abstract_t *stream = NULL;                                    \
+    AVS_UNIT_ASSERT_SUCCESS(avs_unit_memstream_alloc(&stream, sizeof(Data))); \
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(stream, Data, sizeof(Data) - 1))
+
+#define TEST_TEARDOWN                                           \
+    do {                                                        \
+        AVS_UNIT_ASSERT_SUCCESS(_anjay_input_ctx_destroy(&in)); \
+        AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));   \
+    } while (0)
+
+#define ASSERT_ID(Ctx, IdType, Id)                                     \
+    do {                                                               \
+        anjay_id_type_t type;                                          \
+        uint16_t id;                                                   \
+        AVS_UNIT_ASSERT_SUCCESS(_anjay_input_get_id((Ctx), &type, &id)); \
+        AVS_UNIT_ASSERT_EQUAL(type, (IdType));                         \
+        AVS_UNIT_ASSERT_EQUAL(id, (Id));                               \
+    } while (0)
+
+AVS_UNIT_TEST(json_in, instance) {
+    TEST_ENV("{\"bn\":\"/3/0/\",\"e\":["
+             "{\"v\":1.5,\"n\":\"1\"},"
+             "{\"n\":\"2\",\"sv\":\"a\\u00e9\\\"\"},"
+             "{\"n\":\"3\",\"t\":0,\"bv\":true},"
+             "{\"n\":\"4\",\"v\":-12e1}"
+             "]}");
+    anjay_input_ctx_t *in;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_json_create(
+            &in, &stream, false, &MAKE_INSTANCE_PATH(3, 0)));
+
+    double double_value;
+    int32_t i32_value;
+    ASSERT_ID(in, ANJAY_ID_RID, 1);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_double(in, &double_value));
+    AVS_UNIT_ASSERT_EQUAL(double_value, 1.5);
+    AVS_UNIT_ASSERT_FAILED(anjay_get_i32(in, &i32_value));
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_next_entry(in));
+
+    char buf[8];
+    ASSERT_ID(in, ANJAY_ID_RID, 2);
+    AVS_UNIT_ASSERT_EQUAL(anjay_get_string(in, buf, 3),
+                          ANJAY_BUFFER_TOO_SHORT);
+    AVS_UNIT_ASSERT_EQUAL_STRING(buf, "a\xC3");
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_string(in, buf, sizeof(buf)));
+    AVS_UNIT_ASSERT_EQUAL_STRING(buf, "\xA9\"");
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_next_entry(in));
+
+    bool bool_value;
+    ASSERT_ID(in, ANJAY_ID_RID, 3);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_bool(in, &bool_value));
+    AVS_UNIT_ASSERT_TRUE(bool_value);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_next_entry(in));
+
+    ASSERT_ID(in, ANJAY_ID_RID, 4);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_i32(in, &i32_value));
+    AVS_UNIT_ASSERT_EQUAL(i32_value, -120);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_next_entry(in));
+
+    anjay_id_type_t type;
+    uint16_t id;
+    AVS_UNIT_ASSERT_EQUAL(_anjay_input_get_id(in, &type, &id),
+                          ANJAY_GET_INDEX_END);
+    TEST_TEARDOWN;
+}
+
+AVS_UNIT_TEST(json_in, multiple_resource) {
+    TEST_ENV("{\"e\":[\n"
+             "  {\"n\":\"/3/0/7/0\",\"ov\":\"3:1\"},\n"
+             "  {\"n\":\"/3/0/7/1\",\"v\":-2}\n"
+             "], \"bt\": 25462634}");
+    anjay_input_ctx_t *in;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_json_create(
+            &in, &stream, false, &MAKE_RESOURCE_PATH(3, 0, 7)));
+
+    ASSERT_ID(in, ANJAY_ID_RID, 7);
+    anjay_input_ctx_t *array = anjay_get_array(in);
+    AVS_UNIT_ASSERT_NOT_NULL(array);
+
+    anjay_riid_t riid;
+    anjay_oid_t oid;
+    anjay_iid_t iid;
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_array_index(array, &riid));
+    AVS_UNIT_ASSERT_EQUAL(riid, 0);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_objlnk(array, &oid, &iid));
+    AVS_UNIT_ASSERT_EQUAL(oid, 3);
+    AVS_UNIT_ASSERT_EQUAL(iid, 1);
+
+    int64_t i64_value;
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_array_index(array, &riid));
+    AVS_UNIT_ASSERT_EQUAL(riid, 1);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_i64(array, &i64_value));
+    AVS_UNIT_ASSERT_EQUAL(i64_value, -2);
+
+    AVS_UNIT_ASSERT_EQUAL(anjay_get_array_index(array, &riid),
+                          ANJAY_GET_INDEX_END);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_next_entry(in));
+
+    anjay_id_type_t type;
+    uint16_t id;
+    AVS_UNIT_ASSERT_EQUAL(_anjay_input_get_id(in, &type, &id),
+                          ANJAY_GET_INDEX_END);
+    TEST_TEARDOWN;
+}
+
+AVS_UNIT_TEST(json_in, bytes) {
+    // the value is longer than the internal read buffer
+    TEST_ENV("{\"bn\":\"/3/0/1\",\"e\":[{\"sv\":"
+             "\"MDEyMzQ1Njc4OTAxMjM0NTY3ODkwMTIzNDU2Nzg5MDEyMzQ1Njc4OTAxMjM0"
+             "NTY3ODkwMTIzNDU2Nzg5MDEyMzQ1Njc4OQ==\"}]}");
+    anjay_input_ctx_t *in;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_json_create(
+            &in, &stream, false, &MAKE_RESOURCE_PATH(3, 0, 1)));
+
+    char buf[100];
+    size_t bytes_read;
+    bool message_finished;
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_bytes(in, &bytes_read, &message_finished,
+                                            buf, 16));
+    AVS_UNIT_ASSERT_EQUAL(bytes_read, 16);
+    AVS_UNIT_ASSERT_FALSE(message_finished);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "0123456789012345", 16);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_bytes(in, &bytes_read, &message_finished,
+                                            buf, sizeof(buf)));
+    AVS_UNIT_ASSERT_EQUAL(bytes_read, 54);
+    AVS_UNIT_ASSERT_TRUE(message_finished);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(
+            buf, "678901234567890123456789012345678901234567890123456789", 54);
+    TEST_TEARDOWN;
+}
+
+AVS_UNIT_TEST(json_in, name_after_string_value) {
+    TEST_ENV("{\"bn\":\"/3/0/1\",\"e\":[{\"sv\":\"x\",\"n\":\"\"}]}");
+    anjay_input_ctx_t *in;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_json_create(
+            &in, &stream, false, &MAKE_INSTANCE_PATH(3, 0)));
+
+    // string values are streamed, so the element name must be known before
+    // the value; "sv" without a preceding "n" refers to the base name
+    char buf[8];
+    ASSERT_ID(in, ANJAY_ID_RID, 1);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_string(in, buf, sizeof(buf)));
+    AVS_UNIT_ASSERT_EQUAL_STRING(buf, "x");
+    AVS_UNIT_ASSERT_EQUAL(_anjay_input_next_entry(in), ANJAY_ERR_BAD_REQUEST);
+    TEST_TEARDOWN;
+}
+
+AVS_UNIT_TEST(json_in, integer_out_of_range) {
+    TEST_ENV("{\"bn\":\"/3/0/\",\"e\":["
+             "{\"n\":\"1\",\"v\":9223372036854775808},"
+             "{\"n\":\"2\",\"v\":9.223372036854775808e18},"
+             "{\"n\":\"3\",\"v\":-9.223372036854775808e18}"
+             "]}");
+    anjay_input_ctx_t *in;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_json_create(
+            &in, &stream, false, &MAKE_INSTANCE_PATH(3, 0)));
+
+    int64_t i64_value;
+    double double_value;
+    ASSERT_ID(in, ANJAY_ID_RID, 1);
+    AVS_UNIT_ASSERT_EQUAL(anjay_get_i64(in, &i64_value),
+                          ANJAY_ERR_BAD_REQUEST);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_double(in, &double_value));
+    AVS_UNIT_ASSERT_EQUAL(double_value, 9223372036854775808.0);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_next_entry(in));
+
+    ASSERT_ID(in, ANJAY_ID_RID, 2);
+    AVS_UNIT_ASSERT_EQUAL(anjay_get_i64(in, &i64_value),
+                          ANJAY_ERR_BAD_REQUEST);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_next_entry(in));
+
+    int32_t i32_value;
+    ASSERT_ID(in, ANJAY_ID_RID, 3);
+    AVS_UNIT_ASSERT_EQUAL(anjay_get_i32(in, &i32_value),
+                          ANJAY_ERR_BAD_REQUEST);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_i64(in, &i64_value));
+    AVS_UNIT_ASSERT_EQUAL(i64_value, INT64_MIN);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_next_entry(in));
+    TEST_TEARDOWN;
+}
+
+AVS_UNIT_TEST(json_in, element_outside_uri) {
+    TEST_ENV("{\"e\":[{\"n\":\"/3/1/1\",\"v\":0}]}");
+    anjay_input_ctx_t *in;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_input_json_create(
+            &in, &stream, false, &MAKE_INSTANCE_PATH(3, 0)));
+
+    anjay_id_type_t type;
+    uint16_t id;
+    AVS_UNIT_ASSERT_EQUAL(_anjay_input_get_id(in, &type, &id),
+                          ANJAY_ERR_BAD_REQUEST);
+    TEST_TEARDOWN;
+}
+
+AVS_UNIT_TEST(json_in, malformed) {
+    TEST_ENV("[{\"n\":\"/3/0/1\",\"v\":0}]");
+    anjay_input_ctx_t *in = NULL;
+    AVS_UNIT_ASSERT_EQUAL(_anjay_input_json_create(&in, &stream, false,
+                                                   &MAKE_INSTANCE_PATH(3, 0)),
+                          ANJAY_ERR_BAD_REQUEST);
+    AVS_UNIT_ASSERT_NULL(in);
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_cleanup(&stream));
+}
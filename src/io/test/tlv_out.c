@@ -347,3 +347,57 @@ AVS_UNIT_TEST(tlv_out, object_with_empty_bytes) {
 
     AVS_UNIT_ASSERT_SUCCESS(_anjay_output_ctx_destroy(&out));
 }
+
+static void write_instance_contents(anjay_output_ctx_t *obj) {
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_set_id(obj, ANJAY_ID_RID, 1));
+    anjay_output_ctx_t *array = anjay_ret_array_start(obj);
+    AVS_UNIT_ASSERT_NOT_NULL(array);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_array_index(array, 42));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_i32(array, 69));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_array_index(array, 514));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_i32(array, 696969));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_array_finish(array));
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_set_id(obj, ANJAY_ID_RID, 2));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_ret_i32(obj, 4));
+}
+
+AVS_UNIT_TEST(tlv_out, sized_object) {
+    anjay_output_ctx_t *measure = _anjay_output_tlv_measure_create();
+    AVS_UNIT_ASSERT_NOT_NULL(measure);
+    write_instance_contents(measure);
+    size_t size = _anjay_output_tlv_measured_size(measure);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_ctx_destroy(&measure));
+    AVS_UNIT_ASSERT_EQUAL(size, 16);
+
+    TEST_ENV(512);
+
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_set_id(out, ANJAY_ID_IID, 1));
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_set_next_size(out, size));
+    anjay_output_ctx_t *obj = _anjay_output_object_start(out);
+    AVS_UNIT_ASSERT_NOT_NULL(obj);
+    // the header is written before any of the contents
+    AVS_UNIT_ASSERT_EQUAL(avs_stream_outbuf_offset(&outbuf), 3);
+    write_instance_contents(obj);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_object_finish(obj));
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_ctx_destroy(&out));
+
+    VERIFY_BYTES("\x08\x01\x10"                 // instance
+                 "\x88\x01\x0A"                 // array
+                 "\x41\x2A\x45"                 // first entry
+                 "\x64\x02\x02\x00\x0A\xA2\x89" // second entry
+                 "\xC1\x02\x04"                 // another entry
+    );
+}
+
+AVS_UNIT_TEST(tlv_out, sized_object_too_long) {
+    TEST_ENV(512);
+
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_set_id(out, ANJAY_ID_IID, 1));
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_set_next_size(out, 2));
+    anjay_output_ctx_t *obj = _anjay_output_object_start(out);
+    AVS_UNIT_ASSERT_NOT_NULL(obj);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_set_id(obj, ANJAY_ID_RID, 2));
+    AVS_UNIT_ASSERT_FAILED(anjay_ret_i32(obj, 4));
+    AVS_UNIT_ASSERT_FAILED(_anjay_output_object_finish(obj));
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_output_ctx_destroy(&out));
+}
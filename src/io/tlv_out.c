@@ -61,6 +61,20 @@ typedef struct tlv_out_struct {
     avs_stream_abstract_t *stream;
     tlv_id_t next_id;
     tlv_bytes_t bytes_ctx;
+
+    // if true, nothing is written and only the encoded size is calculated
+    bool measure;
+    size_t measured_size;
+
+    // size of the next nested entry, declared using set_next_size
+    bool has_next_size;
+    size_t next_size;
+
+    // if true, this is a nested entry with a declared size, which is written
+    // directly to the stream; sized_bytes_left is the size of the remaining
+    // part of its contents
+    bool sized;
+    size_t sized_bytes_left;
 } tlv_out_t;
 
 static int *tlv_errno_ptr(anjay_output_ctx_t *ctx) {
@@ -138,6 +152,31 @@ static int write_entry(avs_stream_abstract_t *stream,
     return retval;
 }
 
+static int write_streamed_header(tlv_out_t *ctx, size_t length) {
+    int retval = write_header(ctx->stream, &ctx->next_id, length);
+    if (!retval && ctx->sized) {
+        size_t entry_size =
+                header_size((uint16_t) ctx->next_id.id, length) + length;
+        if (entry_size > ctx->sized_bytes_left) {
+            retval = -1;
+        } else {
+            ctx->sized_bytes_left -= entry_size;
+        }
+    }
+    ctx->next_id.id = -1;
+    return retval;
+}
+
+static int measure_entry(tlv_out_t *ctx, size_t length) {
+    if (ctx->next_id.id != (uint16_t) ctx->next_id.id || length >> 24) {
+        return -1;
+    }
+    ctx->measured_size +=
+            header_size((uint16_t) ctx->next_id.id, length) + length;
+    ctx->next_id.id = -1;
+    return 0;
+}
+
 static char *add_buffered_entry(tlv_out_t *ctx, size_t length) {
     tlv_entry_t *new_entry =
             (tlv_entry_t *) AVS_LIST_NEW_BUFFER(sizeof(tlv_entry_t) + length);
@@ -207,14 +246,39 @@ static int buffered_bytes_append(anjay_ret_bytes_ctx_t *ctx_,
     return retval;
 }
 
+static int measured_bytes_append(anjay_ret_bytes_ctx_t *ctx_,
+                                 const void *data,
+                                 size_t length);
+
+static const anjay_ret_bytes_ctx_vtable_t MEASURED_BYTES_VTABLE = {
+    .append = measured_bytes_append
+};
+
+static int measured_bytes_append(anjay_ret_bytes_ctx_t *ctx_,
+                                 const void *data,
+                                 size_t length) {
+    (void) data;
+    tlv_bytes_t *ctx = (tlv_bytes_t *) ctx_;
+    assert(ctx->vtable == &MEASURED_BYTES_VTABLE);
+    if (length > ctx->bytes_left) {
+        return -1;
+    }
+    ctx->bytes_left -= length;
+    return 0;
+}
+
 static anjay_ret_bytes_ctx_t *add_entry(tlv_out_t *ctx, size_t length) {
     if (length >> 24 || ctx->bytes_ctx.bytes_left) {
         return NULL;
     }
-    if (ctx->stream) {
-        int retval = write_header(ctx->stream, &ctx->next_id, length);
-        ctx->next_id.id = -1;
-        if (!retval) {
+    if (ctx->measure) {
+        if (!measure_entry(ctx, length)) {
+            ctx->bytes_ctx.vtable = &MEASURED_BYTES_VTABLE;
+            ctx->bytes_ctx.bytes_left = length;
+            return (anjay_ret_bytes_ctx_t *) &ctx->bytes_ctx;
+        }
+    } else if (ctx->stream) {
+        if (!write_streamed_header(ctx, length)) {
             ctx->bytes_ctx.vtable = &STREAMED_BYTES_VTABLE;
             ctx->bytes_ctx.output.stream = ctx->stream;
             ctx->bytes_ctx.bytes_left = length;
@@ -292,10 +356,7 @@ static anjay_output_ctx_t *tlv_slave_start(tlv_out_t *ctx,
                                            tlv_id_type_t new_type,
                                            tlv_id_type_t inner_type);
 
-static int tlv_slave_finish(tlv_out_t *ctx, tlv_id_type_t next_id_type) {
-    if (!ctx->parent) {
-        return -1;
-    }
+static int buffered_slave_finish(tlv_out_t *ctx) {
     size_t data_size = 0;
     {
         tlv_entry_t *entry = NULL;
@@ -323,6 +384,22 @@ static int tlv_slave_finish(tlv_out_t *ctx, tlv_id_type_t next_id_type) {
         retval = !bytes ? -1 : anjay_ret_bytes_append(bytes, buffer, length);
     }
     avs_free(buffer);
+    return retval;
+}
+
+static int tlv_slave_finish(tlv_out_t *ctx, tlv_id_type_t next_id_type) {
+    if (!ctx->parent) {
+        return -1;
+    }
+    int retval;
+    if (ctx->measure) {
+        retval = measure_entry(ctx->parent, ctx->measured_size);
+    } else if (ctx->sized) {
+        // the header has already been written with the declared size
+        retval = (ctx->sized_bytes_left ? -1 : 0);
+    } else {
+        retval = buffered_slave_finish(ctx);
+    }
     ctx->parent->next_id.type = next_id_type;
     _anjay_output_ctx_destroy((anjay_output_ctx_t **) &ctx);
     return retval;
@@ -379,6 +456,16 @@ tlv_set_id(anjay_output_ctx_t *ctx_, anjay_id_type_t type, uint16_t id) {
     return 0;
 }
 
+static int tlv_set_next_size(anjay_output_ctx_t *ctx_, size_t size) {
+    tlv_out_t *ctx = (tlv_out_t *) ctx_;
+    if (ctx->slave || !ctx->stream || size >> 24) {
+        return -1;
+    }
+    ctx->has_next_size = true;
+    ctx->next_size = size;
+    return 0;
+}
+
 static int tlv_output_close(anjay_output_ctx_t *ctx_) {
     tlv_out_t *ctx = (tlv_out_t *) ctx_;
     AVS_LIST_CLEAR(&ctx->entries);
@@ -405,6 +492,7 @@ static const anjay_output_ctx_vtable_t TLV_OUT_VTABLE = {
     .object_start = tlv_ret_object_start,
     .object_finish = tlv_ret_object_finish,
     .set_id = tlv_set_id,
+    .set_next_size = tlv_set_next_size,
     .close = tlv_output_close
 };
 
@@ -413,6 +501,8 @@ static anjay_output_ctx_t *tlv_slave_start(tlv_out_t *ctx,
                                            tlv_id_type_t new_type,
                                            tlv_id_type_t inner_type) {
     tlv_out_t *object = NULL;
+    const bool has_size = ctx->has_next_size;
+    ctx->has_next_size = false;
     if (ctx->slave || ctx->next_id.type != expected_type || ctx->next_id.id < 0
             || !(object = (tlv_out_t *) avs_calloc(1, sizeof(tlv_out_t)))) {
         return NULL;
@@ -423,6 +513,17 @@ static anjay_output_ctx_t *tlv_slave_start(tlv_out_t *ctx,
     object->next_entry_ptr = &object->entries;
     object->next_id.type = inner_type;
     object->next_id.id = -1;
+    object->measure = ctx->measure;
+    if (has_size && ctx->stream) {
+        // size is known up front, so the contents may be streamed directly
+        if (write_streamed_header(ctx, ctx->next_size)) {
+            avs_free(object);
+            return NULL;
+        }
+        object->stream = ctx->stream;
+        object->sized = true;
+        object->sized_bytes_left = ctx->next_size;
+    }
     ctx->next_id.type = new_type;
     return (ctx->slave = (anjay_output_ctx_t *) object);
 }
@@ -441,6 +542,24 @@ _anjay_output_raw_tlv_create(avs_stream_abstract_t *stream) {
     return (anjay_output_ctx_t *) ctx;
 }
 
+anjay_output_ctx_t *_anjay_output_tlv_measure_create(void) {
+    tlv_out_t *ctx = (tlv_out_t *) avs_calloc(1, sizeof(tlv_out_t));
+
+    if (ctx) {
+        ctx->vtable = &TLV_OUT_VTABLE;
+        ctx->next_entry_ptr = &ctx->entries;
+        ctx->next_id.id = -1;
+        ctx->measure = true;
+    }
+    return (anjay_output_ctx_t *) ctx;
+}
+
+size_t _anjay_output_tlv_measured_size(anjay_output_ctx_t *ctx) {
+    assert(((tlv_out_t *) ctx)->vtable == &TLV_OUT_VTABLE);
+    assert(((tlv_out_t *) ctx)->measure);
+    return ((tlv_out_t *) ctx)->measured_size;
+}
+
 anjay_output_ctx_t *
 _anjay_output_tlv_create(avs_stream_abstract_t *stream,
                          int *errno_ptr,
@@ -44,6 +44,8 @@ typedef int (*anjay_output_ctx_object_finish_t)(anjay_output_ctx_t *);
 typedef int (*anjay_output_ctx_set_id_t)(anjay_output_ctx_t *,
                                          anjay_id_type_t,
                                          uint16_t);
+typedef int (*anjay_output_ctx_set_next_size_t)(anjay_output_ctx_t *,
+                                                size_t);
 typedef int (*anjay_output_ctx_close_t)(anjay_output_ctx_t *);
 
 typedef struct {
@@ -61,6 +63,7 @@ typedef struct {
     anjay_output_ctx_object_start_t object_start;
     anjay_output_ctx_object_finish_t object_finish;
     anjay_output_ctx_set_id_t set_id;
+    anjay_output_ctx_set_next_size_t set_next_size;
     anjay_output_ctx_close_t close;
 } anjay_output_ctx_vtable_t;
 
@@ -85,6 +88,8 @@ typedef int (*anjay_input_ctx_objlnk_t)(anjay_input_ctx_t *,
                                         anjay_iid_t *);
 typedef int (*anjay_input_ctx_attach_child_t)(anjay_input_ctx_t *,
                                               anjay_input_ctx_t *);
+typedef anjay_input_ctx_t *(*anjay_input_ctx_nested_ctx_t)(
+        anjay_input_ctx_t *);
 typedef int (*anjay_input_ctx_get_id_t)(anjay_input_ctx_t *,
                                         anjay_id_type_t *,
                                         uint16_t *);
@@ -101,6 +106,7 @@ typedef struct {
     anjay_input_ctx_boolean_t boolean;
     anjay_input_ctx_objlnk_t objlnk;
     anjay_input_ctx_attach_child_t attach_child;
+    anjay_input_ctx_nested_ctx_t nested_ctx;
     anjay_input_ctx_get_id_t get_id;
     anjay_input_ctx_next_entry_t next_entry;
     anjay_input_ctx_close_t close;
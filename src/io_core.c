@@ -252,6 +252,13 @@ int _anjay_output_object_finish(anjay_output_ctx_t *ctx) {
     return ctx->vtable->object_finish(ctx);
 }
 
+int _anjay_output_set_next_size(anjay_output_ctx_t *ctx, size_t size) {
+    if (!ctx->vtable->set_next_size) {
+        return -1;
+    }
+    return ctx->vtable->set_next_size(ctx, size);
+}
+
 int _anjay_output_set_id(anjay_output_ctx_t *ctx,
                          anjay_id_type_t type,
                          uint16_t id) {
@@ -431,6 +438,9 @@ int _anjay_input_attach_child(anjay_input_ctx_t *ctx,
 }
 
 anjay_input_ctx_t *_anjay_input_nested_ctx(anjay_input_ctx_t *ctx) {
+    if (ctx->vtable->nested_ctx) {
+        return ctx->vtable->nested_ctx(ctx);
+    }
     anjay_input_ctx_t *retval = NULL;
     avs_stream_abstract_t *stream = _anjay_input_bytes_stream(ctx);
     if (stream && _anjay_input_tlv_create(&retval, &stream, true)) {
@@ -38,7 +38,15 @@ typedef enum {
     ANJAY_ID_RIID
 } anjay_id_type_t;
 
-anjay_input_ctx_constructor_t _anjay_input_dynamic_create;
+/**
+ * Creates an input context appropriate for the Content-Format of the incoming
+ * message. @p uri is the path the request was made on; it is necessary to
+ * interpret SenML payloads, in which all values are named with absolute paths.
+ */
+int _anjay_input_dynamic_create(anjay_input_ctx_t **out,
+                                avs_stream_abstract_t **stream_ptr,
+                                bool autoclose,
+                                const anjay_uri_path_t *uri);
 anjay_input_ctx_constructor_t _anjay_input_opaque_create;
 anjay_input_ctx_constructor_t _anjay_input_text_create;
 
@@ -80,6 +88,16 @@ _anjay_output_tlv_create(avs_stream_abstract_t *stream,
                          int *errno_ptr,
                          anjay_msg_details_t *inout_details);
 
+/**
+ * Creates a TLV output context that does not write anything, but only
+ * calculates the size of the data that would be written, which may then be
+ * retrieved using @ref _anjay_output_tlv_measured_size. Contents of nested
+ * entries are not buffered.
+ */
+anjay_output_ctx_t *_anjay_output_tlv_measure_create(void);
+
+size_t _anjay_output_tlv_measured_size(anjay_output_ctx_t *ctx);
+
 #if defined(WITH_JSON) || defined(WITH_SENML_JSON)
 anjay_output_ctx_t *
 _anjay_output_json_create(avs_stream_abstract_t *stream,
@@ -89,9 +107,55 @@ _anjay_output_json_create(avs_stream_abstract_t *stream,
                           uint16_t format);
 #endif
 
+#ifdef WITH_JSON
+/**
+ * Creates an input context for LwM2M JSON payloads. The payload is parsed
+ * incrementally while being read, and string values are decoded directly from
+ * the stream, so memory usage does not depend on the payload size. Elements
+ * are presented as children of the node addressed by @p uri, or of the Object
+ * Instance if @p uri points to a Resource; elements referring to a single
+ * node must be adjacent in the payload.
+ */
+int _anjay_input_json_create(anjay_input_ctx_t **out,
+                             avs_stream_abstract_t **stream_ptr,
+                             bool autoclose,
+                             const anjay_uri_path_t *uri);
+#endif // WITH_JSON
+
+#ifdef WITH_SENML_CBOR
+anjay_output_ctx_t *
+_anjay_output_senml_cbor_create(avs_stream_abstract_t *stream,
+                                int *errno_ptr,
+                                anjay_msg_details_t *inout_details,
+                                const anjay_uri_path_t *uri);
+
+/**
+ * Creates an input context for SenML CBOR payloads. The whole payload is read
+ * from the stream and parsed immediately. Records are presented as children of
+ * the node addressed by @p uri, or of the Object Instance if @p uri points to
+ * a Resource.
+ */
+int _anjay_input_senml_cbor_create(anjay_input_ctx_t **out,
+                                   avs_stream_abstract_t **stream_ptr,
+                                   bool autoclose,
+                                   const anjay_uri_path_t *uri);
+#endif // WITH_SENML_CBOR
+
 int *_anjay_output_ctx_errno_ptr(anjay_output_ctx_t *ctx);
 anjay_output_ctx_t *_anjay_output_object_start(anjay_output_ctx_t *ctx);
 int _anjay_output_object_finish(anjay_output_ctx_t *ctx);
+
+/**
+ * Declares that the nested entry started by the next call to
+ * @ref _anjay_output_object_start will be exactly @p size bytes long when
+ * encoded, so that the output context may write it directly, without
+ * buffering its contents to determine the length first.
+ *
+ * @returns 0 on success, or a negative value if the output context does not
+ *          make use of this information; the nested entry may be written
+ *          normally in both cases.
+ */
+int _anjay_output_set_next_size(anjay_output_ctx_t *ctx, size_t size);
 int _anjay_output_set_id(anjay_output_ctx_t *ctx,
                          anjay_id_type_t type,
                          uint16_t id);
@@ -105,13 +169,47 @@ int _anjay_input_get_id(anjay_input_ctx_t *ctx,
                         uint16_t *out_id);
 int _anjay_input_next_entry(anjay_input_ctx_t *ctx);
 
-typedef struct anjay_output_buf_ctx {
+typedef enum {
+    ANJAY_OUTPUT_VALUE_BYTES,
+    ANJAY_OUTPUT_VALUE_I64,
+    ANJAY_OUTPUT_VALUE_BOOL
+} anjay_output_value_type_t;
+
+/**
+ * Output context that stores the value returned by a resource read handler
+ * directly in caller-provided memory, without encoding it in any format:
+ *
+ * - for ANJAY_OUTPUT_VALUE_BYTES, <c>values</c> is a buffer of
+ *   <c>capacity</c> bytes; strings and bytes are appended to it, and other
+ *   values are stored in their in-memory representation,
+ * - for ANJAY_OUTPUT_VALUE_I64 and ANJAY_OUTPUT_VALUE_BOOL, <c>values</c> is
+ *   an array of <c>capacity</c> elements of <c>int64_t</c> or <c>bool</c>,
+ *   respectively; values of other types are rejected.
+ *
+ * Multiple Resources are only accepted by the typed variants, and only if
+ * <c>riids</c> is not NULL; it then receives the Resource Instance IDs. Array
+ * elements that do not fit are not stored, but are still counted in
+ * <c>count</c>, so that the caller may retry with a larger array.
+ */
+typedef struct anjay_output_value_ctx {
     const void *vtable;
     const void *ret_bytes_vtable;
-    avs_stream_outbuf_t *stream;
-} anjay_output_buf_ctx_t;
-
-anjay_output_buf_ctx_t _anjay_output_buf_ctx_init(avs_stream_outbuf_t *stream);
+    int errno_;
+    anjay_output_value_type_t type;
+    void *values;
+    anjay_riid_t *riids;
+    size_t capacity;
+    size_t count;
+    bool in_array;
+    bool has_riid;
+    anjay_riid_t next_riid;
+} anjay_output_value_ctx_t;
+
+anjay_output_value_ctx_t
+_anjay_output_value_ctx_init(anjay_output_value_type_t type,
+                             void *values,
+                             anjay_riid_t *riids,
+                             size_t capacity);
 
 VISIBILITY_PRIVATE_HEADER_END
 
@@ -22,6 +22,8 @@
 #include "coap/content_format.h"
 
 #include "anjay_core.h"
+#include "dm/query.h"
+#include "interface/register.h"
 #include "observe/observe_core.h"
 #include "servers_utils.h"
 
@@ -38,6 +40,15 @@ static int observe_notify(anjay_t *anjay, anjay_notify_queue_t queue) {
     };
     int ret = 0;
     AVS_LIST(anjay_notify_queue_object_entry_t) it;
+    AVS_LIST_FOREACH(it, queue) {
+        if (it->oid == ANJAY_DM_OID_SERVER
+                || it->instance_set_changes.instance_set_changed) {
+            // Default Minimum/Maximum Period or the instances that the
+            // attributes are inherited from might have changed
+            _anjay_observe_invalidate_attrs(anjay);
+            break;
+        }
+    }
     AVS_LIST_FOREACH(it, queue) {
         observe_key.oid = it->oid;
         if (it->instance_set_changes.instance_set_changed) {
@@ -120,10 +131,12 @@ int _anjay_notify_perform(anjay_t *anjay, anjay_notify_queue_t queue) {
         } else if (it->oid == ANJAY_DM_OID_SECURITY) {
             _anjay_update_ret(&ret, security_modified_notify(anjay, it));
         } else if (it->oid == ANJAY_DM_OID_SERVER) {
+            _anjay_dm_invalidate_server_iids(anjay);
             _anjay_update_ret(&ret, server_modified_notify(anjay, it));
         }
     }
     _anjay_update_ret(&ret, observe_notify(anjay, queue));
+    _anjay_update_ret(&ret, _anjay_registration_objects_notify(anjay, queue));
     AVS_LIST(anjay_dm_installed_module_t) module;
     AVS_LIST_FOREACH(module, anjay->dm.modules) {
         if (module->def->notify_callback) {
@@ -254,6 +267,7 @@ int _anjay_notify_queue_instance_set_unknown_change(
         return -1;
     }
     (*entry_ptr)->instance_set_changes.instance_set_changed = true;
+    (*entry_ptr)->instance_set_changes.unknown_change = true;
     return 0;
 }
 
@@ -338,6 +352,9 @@ int anjay_notify_changed(anjay_t *anjay,
                          anjay_oid_t oid,
                          anjay_iid_t iid,
                          anjay_rid_t rid) {
+    if (oid == ANJAY_DM_OID_SERVER) {
+        _anjay_dm_invalidate_server_iids(anjay);
+    }
     int retval;
     (void) ((retval = _anjay_notify_queue_resource_change(
                      &anjay->scheduled_notify.queue, oid, iid, rid))
@@ -346,6 +363,12 @@ int anjay_notify_changed(anjay_t *anjay,
 }
 
 int anjay_notify_instances_changed(anjay_t *anjay, anjay_oid_t oid) {
+    // attributes may be read from the data model before the queued
+    // notification is processed, so the cached ones are discarded right away
+    _anjay_observe_invalidate_attrs(anjay);
+    if (oid == ANJAY_DM_OID_SERVER) {
+        _anjay_dm_invalidate_server_iids(anjay);
+    }
     int retval;
     (void) ((retval = _anjay_notify_queue_instance_set_unknown_change(
                      &anjay->scheduled_notify.queue, oid))
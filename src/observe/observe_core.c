@@ -19,10 +19,12 @@
 #include <inttypes.h>
 #include <math.h>
 
+#include <avsystem/commons/memory.h>
 #include <avsystem/commons/stream_v_table.h>
 
 #include <anjay_modules/time_defs.h>
 
+#include "../access_utils.h"
 #include "../anjay_core.h"
 #include "../coap/content_format.h"
 #include "../dm/query.h"
@@ -46,7 +48,7 @@ static int connection_key_cmp(const anjay_connection_key_t *left,
     return tmp_diff;
 }
 
-static int connection_state_cmp(const void *left, const void *right) {
+int _anjay_observe_connection_entry_cmp(const void *left, const void *right) {
     return connection_key_cmp(
             &((const anjay_observe_connection_entry_t *) left)->key,
             &((const anjay_observe_connection_entry_t *) right)->key);
@@ -81,17 +83,132 @@ int _anjay_observe_entry_cmp(const void *left, const void *right) {
 }
 
 int _anjay_observe_init(anjay_observe_state_t *observe,
-                        bool confirmable_notifications) {
-    if (!(observe->connection_entries = AVS_RBTREE_NEW(
-                  anjay_observe_connection_entry_t, connection_state_cmp))) {
+                        bool confirmable_notifications,
+                        bool coalesce_notifications,
+                        bool cache_attrs,
+                        bool share_reads,
+                        bool sent_value_digests) {
+    if (!(observe->connection_entries =
+                  AVS_RBTREE_NEW(anjay_observe_connection_entry_t,
+                                 _anjay_observe_connection_entry_cmp))) {
         anjay_log(ERROR, "Could not initialize Observe structures");
         return -1;
     }
     observe->confirmable_notifications = confirmable_notifications;
+    observe->coalesce_notifications = coalesce_notifications;
+    observe->cache_attrs = cache_attrs;
+    observe->attrs_generation = 1;
+    observe->share_reads = share_reads;
+    observe->sent_value_digests = sent_value_digests;
     return 0;
 }
 
-void _anjay_observe_cleanup_connection(anjay_sched_t *sched,
+void _anjay_observe_invalidate_attrs(anjay_t *anjay) {
+    // 0 is reserved for entries that have never had their attributes cached
+    if (!++anjay->observe.attrs_generation) {
+        anjay->observe.attrs_generation = 1;
+    }
+}
+
+void _anjay_observe_set_queue_limits(
+        anjay_observe_state_t *observe,
+        size_t connection_limit,
+        size_t total_limit,
+        anjay_notify_queue_drop_policy_t drop_policy) {
+    observe->queue_connection_limit = connection_limit;
+    observe->queue_total_limit = total_limit;
+    observe->queue_drop_policy = drop_policy;
+}
+
+void _anjay_observe_queue_stats(anjay_observe_state_t *observe,
+                                anjay_ssid_t ssid,
+                                anjay_notify_queue_stats_t *out_stats) {
+    if (ssid == ANJAY_SSID_ANY) {
+        out_stats->queued_values = observe->unsent_count;
+        out_stats->queued_bytes = observe->unsent_bytes;
+        out_stats->dropped_values = observe->dropped_count;
+        return;
+    }
+
+    memset(out_stats, 0, sizeof(*out_stats));
+    AVS_RBTREE_ELEM(anjay_observe_connection_entry_t) conn;
+    AVS_RBTREE_FOREACH(conn, observe->connection_entries) {
+        if (conn->key.ssid == ssid) {
+            out_stats->queued_values += conn->unsent_count;
+            out_stats->queued_bytes += conn->unsent_bytes;
+            out_stats->dropped_values += conn->dropped_count;
+        }
+    }
+}
+
+#ifdef WITH_POOL_ALLOCATOR
+/**
+ * Default size of notification value that fits in a pool block - enough for
+ * a single numeric or short string resource in any content format.
+ */
+#    define OBSERVE_POOL_DEFAULT_VALUE_SIZE 64
+
+int _anjay_observe_init_pool(anjay_observe_state_t *observe,
+                             size_t block_size,
+                             size_t block_count) {
+    assert(!AVS_RBTREE_FIRST(observe->connection_entries));
+    if (!block_size) {
+        block_size = offsetof(anjay_observe_resource_value_t, value)
+                     + OBSERVE_POOL_DEFAULT_VALUE_SIZE;
+    }
+    return _anjay_pool_init(&observe->value_pool, block_size, block_count);
+}
+#endif // WITH_POOL_ALLOCATOR
+
+static inline size_t
+resource_value_size(const anjay_observe_resource_value_t *value) {
+    return offsetof(anjay_observe_resource_value_t, value)
+           + value->value_length;
+}
+
+static void delete_resource_value(
+        anjay_observe_state_t *observe,
+        AVS_LIST(anjay_observe_resource_value_t) *value_ptr) {
+    _anjay_pool_delete(&observe->value_pool, value_ptr,
+                       resource_value_size(*value_ptr));
+}
+
+void _anjay_observe_unsent_value_added(
+        anjay_observe_state_t *observe,
+        anjay_observe_connection_entry_t *conn,
+        const anjay_observe_resource_value_t *value) {
+    const size_t size = resource_value_size(value);
+    ++conn->unsent_count;
+    conn->unsent_bytes += size;
+    ++observe->unsent_count;
+    observe->unsent_bytes += size;
+}
+
+static void unsent_value_removed(anjay_observe_state_t *observe,
+                                 anjay_observe_connection_entry_t *conn,
+                                 const anjay_observe_resource_value_t *value) {
+    const size_t size = resource_value_size(value);
+    assert(conn->unsent_count > 0 && conn->unsent_bytes >= size);
+    --conn->unsent_count;
+    conn->unsent_bytes -= size;
+    --observe->unsent_count;
+    observe->unsent_bytes -= size;
+}
+
+static inline bool is_error_value(const anjay_observe_resource_value_t *value) {
+    return avs_coap_msg_code_get_class(value->details.msg_code) >= 4;
+}
+
+static void
+clear_resource_values(anjay_observe_state_t *observe,
+                      AVS_LIST(anjay_observe_resource_value_t) *list_ptr) {
+    while (*list_ptr) {
+        delete_resource_value(observe, list_ptr);
+    }
+}
+
+void _anjay_observe_cleanup_connection(anjay_observe_state_t *observe,
+                                       anjay_sched_t *sched,
                                        anjay_observe_connection_entry_t *conn) {
     /*
      * Usually, we wouldn't bother checking if the scheduler task handles are
@@ -104,19 +221,91 @@ void _anjay_observe_cleanup_connection(anjay_sched_t *sched,
         if ((*conn->entries)->notify_task) {
             _anjay_sched_del(sched, &(*conn->entries)->notify_task);
         }
-        AVS_LIST_CLEAR(&(*conn->entries)->last_sent);
+        clear_resource_values(observe, &(*conn->entries)->last_sent);
     }
     if (conn->flush_task) {
         _anjay_sched_del(sched, &conn->flush_task);
     }
-    AVS_LIST_CLEAR(&conn->unsent);
+    assert(observe->unsent_count >= conn->unsent_count);
+    assert(observe->unsent_bytes >= conn->unsent_bytes);
+    observe->unsent_count -= conn->unsent_count;
+    observe->unsent_bytes -= conn->unsent_bytes;
+    conn->unsent_count = 0;
+    conn->unsent_bytes = 0;
+    clear_resource_values(observe, &conn->unsent);
+}
+
+/**
+ * Initial capacity of anjay_observe_state_t::read_buffer; it is doubled
+ * whenever a larger value needs to be serialized.
+ */
+#define OBSERVE_BUFFER_INITIAL_CAPACITY 64
+
+// upper bound of the exponent of the delay before retrying to send
+// a Confirmable notification that has not been acknowledged; the delay is
+// ACK_TIMEOUT * 2^exponent
+#define MAX_FLUSH_BACKOFF_EXPONENT 5
+
+static int observe_buffer_reserve(anjay_observe_buffer_t *buffer,
+                                  size_t size) {
+    if (size > ANJAY_MAX_OBSERVABLE_RESOURCE_SIZE) {
+        anjay_log(ERROR, "observed value too large, the limit is %u bytes",
+                  (unsigned) ANJAY_MAX_OBSERVABLE_RESOURCE_SIZE);
+        return -1;
+    }
+    if (size <= buffer->capacity) {
+        return 0;
+    }
+    size_t new_capacity = buffer->capacity ? buffer->capacity
+                                           : OBSERVE_BUFFER_INITIAL_CAPACITY;
+    while (new_capacity < size) {
+        new_capacity *= 2;
+    }
+    if (new_capacity > ANJAY_MAX_OBSERVABLE_RESOURCE_SIZE) {
+        new_capacity = ANJAY_MAX_OBSERVABLE_RESOURCE_SIZE;
+    }
+    char *new_data = (char *) avs_realloc(buffer->data, new_capacity);
+    if (!new_data) {
+        anjay_log(ERROR, "Out of memory");
+        return -1;
+    }
+    buffer->data = new_data;
+    buffer->capacity = new_capacity;
+    return 0;
+}
+
+int _anjay_observe_buffer_assign(anjay_observe_buffer_t *buffer,
+                                 const void *data,
+                                 size_t size) {
+    buffer->size = 0;
+    if (observe_buffer_reserve(buffer, size)) {
+        return -1;
+    }
+    if (size) {
+        memcpy(buffer->data, data, size);
+    }
+    buffer->size = size;
+    return 0;
+}
+
+static void observe_buffer_cleanup(anjay_observe_buffer_t *buffer) {
+    avs_free(buffer->data);
+    memset(buffer, 0, sizeof(*buffer));
 }
 
 void _anjay_observe_cleanup(anjay_observe_state_t *observe,
                             anjay_sched_t *sched) {
     AVS_RBTREE_DELETE(&observe->connection_entries) {
-        _anjay_observe_cleanup_connection(sched, *observe->connection_entries);
+        _anjay_observe_cleanup_connection(observe, sched,
+                                          *observe->connection_entries);
     }
+    _anjay_observe_clear_read_cache(observe);
+    observe_buffer_cleanup(&observe->read_buffer);
+    _anjay_pool_cleanup(&observe->value_pool);
+}
+
+void _anjay_observe_clear_read_cache(anjay_observe_state_t *observe) {
+    AVS_LIST_CLEAR(&observe->read_cache);
 }
 
 static int observe_setup_for_sending(avs_stream_abstract_t *stream,
@@ -127,15 +316,39 @@ static int observe_setup_for_sending(avs_stream_abstract_t *stream,
     return 0;
 }
 
-const anjay_observe_stream_t *_anjay_observe_stream_initializer__(void) {
-    static volatile bool initialized = false;
+static int observe_stream_write(avs_stream_abstract_t *stream_,
+                                const void *data,
+                                size_t *data_length) {
+    anjay_observe_buffer_t *buffer =
+            ((anjay_observe_stream_t *) stream_)->buffer;
+    if (*data_length > SIZE_MAX - buffer->size
+            || observe_buffer_reserve(buffer, buffer->size + *data_length)) {
+        return -1;
+    }
+    if (*data_length) {
+        memcpy(buffer->data + buffer->size, data, *data_length);
+        buffer->size += *data_length;
+    }
+    return 0;
+}
+
+static int observe_stream_noop(avs_stream_abstract_t *stream) {
+    (void) stream;
+    return 0;
+}
 
-    static avs_stream_v_table_t vtable;
-    static const anjay_observe_stream_t initializer = {
-        .outbuf = {
-            .vtable = &vtable
-        }
-    };
+static int observe_stream_reset(avs_stream_abstract_t *stream) {
+    ((anjay_observe_stream_t *) stream)->buffer->size = 0;
+    return 0;
+}
+
+static int observe_stream_unimplemented() {
+    return -1;
+}
+
+anjay_observe_stream_t
+_anjay_new_observe_stream(anjay_msg_details_t *details,
+                          anjay_observe_buffer_t *buffer) {
     static const anjay_coap_stream_ext_t coap_ext = {
         .setup_response = observe_setup_for_sending
     };
@@ -143,25 +356,45 @@ const anjay_observe_stream_t *_anjay_observe_stream_initializer__(void) {
         { ANJAY_COAP_STREAM_EXTENSION, &coap_ext },
         AVS_STREAM_V_TABLE_EXTENSION_NULL
     };
+    static const avs_stream_v_table_t vtable = {
+        observe_stream_write,
+        observe_stream_noop,
+        (avs_stream_read_t) observe_stream_unimplemented,
+        (avs_stream_peek_t) observe_stream_unimplemented,
+        observe_stream_reset,
+        observe_stream_noop,
+        (avs_stream_errno_t) observe_stream_unimplemented,
+        extensions
+    };
 
-    if (!initialized) {
-        memcpy(&vtable, AVS_STREAM_OUTBUF_STATIC_INITIALIZER.vtable,
-               sizeof(avs_stream_v_table_t));
-        vtable.extension_list = extensions;
+    buffer->size = 0;
+    return (anjay_observe_stream_t) {
+        .vtable = &vtable,
+        .details = details,
+        .buffer = buffer
+    };
+}
 
-        initialized = true;
+static void abort_in_flight(anjay_t *anjay,
+                            anjay_observe_connection_entry_t *conn) {
+    if (conn->in_flight) {
+        _anjay_exchange_cancel(anjay, conn->key,
+                               conn->in_flight->identity.msg_id);
+        conn->in_flight = NULL;
     }
-
-    return &initializer;
 }
 
 static void clear_entry(anjay_t *anjay,
                         anjay_observe_connection_entry_t *connection,
                         anjay_observe_entry_t *entry) {
     _anjay_sched_del(anjay->sched, &entry->notify_task);
-    AVS_LIST_CLEAR(&entry->last_sent);
+    clear_resource_values(&anjay->observe, &entry->last_sent);
+    entry->attrs_generation = 0;
 
     if (entry->last_unsent) {
+        if (connection->in_flight && connection->in_flight->ref == entry) {
+            abort_in_flight(anjay, connection);
+        }
         anjay_observe_resource_value_t **unsent_ptr;
         anjay_observe_resource_value_t *helper;
         anjay_observe_resource_value_t *server_last_unsent = NULL;
@@ -170,7 +403,8 @@ static void clear_entry(anjay_t *anjay,
             if ((*unsent_ptr)->ref != entry) {
                 server_last_unsent = *unsent_ptr;
             } else {
-                AVS_LIST_DELETE(unsent_ptr);
+                unsent_value_removed(&anjay->observe, connection, *unsent_ptr);
+                delete_resource_value(&anjay->observe, unsent_ptr);
             }
         }
         connection->unsent_last = server_last_unsent;
@@ -181,7 +415,8 @@ static void clear_entry(anjay_t *anjay,
 static void
 delete_connection(anjay_t *anjay,
                   AVS_RBTREE_ELEM(anjay_observe_connection_entry_t) *conn_ptr) {
-    _anjay_observe_cleanup_connection(anjay->sched, *conn_ptr);
+    abort_in_flight(anjay, *conn_ptr);
+    _anjay_observe_cleanup_connection(&anjay->observe, anjay->sched, *conn_ptr);
     AVS_RBTREE_DELETE_ELEM(anjay->observe.connection_entries, conn_ptr);
 }
 
@@ -244,15 +479,31 @@ schedule_trigger(anjay_t *anjay, anjay_observe_entry_t *entry, int32_t period) {
     return retval;
 }
 
-static AVS_LIST(anjay_observe_resource_value_t)
-create_resource_value(const anjay_msg_details_t *details,
-                      anjay_observe_entry_t *ref,
-                      const avs_coap_msg_identity_t *identity,
-                      double numeric,
-                      const void *data,
-                      size_t size) {
+/**
+ * 64-bit FNV-1a hash, used for detecting changes of values that are only
+ * retained as digests.
+ */
+static uint64_t value_digest(const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *) data;
+    uint64_t result = UINT64_C(0xCBF29CE484222325);
+    for (size_t i = 0; i < size; ++i) {
+        result ^= bytes[i];
+        result *= UINT64_C(0x100000001B3);
+    }
+    return result;
+}
+
+AVS_LIST(anjay_observe_resource_value_t)
+_anjay_observe_create_resource_value(anjay_observe_state_t *observe,
+                                     const anjay_msg_details_t *details,
+                                     anjay_observe_entry_t *ref,
+                                     const avs_coap_msg_identity_t *identity,
+                                     double numeric,
+                                     const void *data,
+                                     size_t size) {
     AVS_LIST(anjay_observe_resource_value_t) result =
-            (anjay_observe_resource_value_t *) AVS_LIST_NEW_BUFFER(
+            (anjay_observe_resource_value_t *) _anjay_pool_alloc(
+                    &observe->value_pool,
                     offsetof(anjay_observe_resource_value_t, value) + size);
     if (!result) {
         anjay_log(ERROR, "Out of memory");
@@ -265,15 +516,201 @@ create_resource_value(const anjay_msg_details_t *details,
     AVS_STATIC_ASSERT(sizeof(result->value_length) == sizeof(size),
                       length_size);
     memcpy((void *) (intptr_t) &result->value_length, &size, sizeof(size));
-    assert(data || !size);
+    result->digest = 0;
+    result->digest_only = false;
     if (data) {
         memcpy(result->value, data, size);
+        if (observe->sent_value_digests) {
+            result->digest = value_digest(data, size);
+        }
     }
     result->timestamp = avs_time_real_now();
     return result;
 }
 
-static int insert_new_value(anjay_observe_connection_entry_t *conn_state,
+/**
+ * If sent_value_digests is enabled, replaces the value at @p value_ptr with
+ * a copy that retains everything but the contents. The full value is kept if
+ * the copy could not be allocated, which is less efficient, but still correct.
+ */
+static void compact_sent_value(
+        anjay_observe_state_t *observe,
+        AVS_LIST(anjay_observe_resource_value_t) *value_ptr) {
+    assert(*value_ptr);
+    if (!observe->sent_value_digests || (*value_ptr)->digest_only) {
+        return;
+    }
+    AVS_LIST(anjay_observe_resource_value_t) compact =
+            _anjay_observe_create_resource_value(
+                    observe, &(*value_ptr)->details, (*value_ptr)->ref,
+                    &(*value_ptr)->identity, (*value_ptr)->numeric, NULL, 0);
+    if (!compact) {
+        return;
+    }
+    compact->timestamp = (*value_ptr)->timestamp;
+    compact->digest = (*value_ptr)->digest;
+    compact->digest_only = true;
+    AVS_LIST_INSERT(value_ptr, compact);
+    delete_resource_value(observe, AVS_LIST_NEXT_PTR(value_ptr));
+}
+
+/**
+ * Puts @p new_value in the send queue in place of the value for @p entry that
+ * has not been sent yet, so that only the newest one will ever be sent.
+ */
+static void
+replace_unsent_value(anjay_observe_state_t *observe,
+                     anjay_observe_connection_entry_t *conn_state,
+                     anjay_observe_entry_t *entry,
+                     AVS_LIST(anjay_observe_resource_value_t) new_value) {
+    AVS_LIST(anjay_observe_resource_value_t) *value_ptr;
+    AVS_LIST_FOREACH_PTR(value_ptr, &conn_state->unsent) {
+        if (*value_ptr == entry->last_unsent) {
+            break;
+        }
+    }
+    assert(value_ptr && *value_ptr);
+    assert(*value_ptr != conn_state->in_flight);
+
+    AVS_LIST_INSERT(value_ptr, new_value);
+    if (conn_state->unsent_last == entry->last_unsent) {
+        conn_state->unsent_last = new_value;
+    }
+    _anjay_observe_unsent_value_added(observe, conn_state, new_value);
+    unsent_value_removed(observe, conn_state, entry->last_unsent);
+    delete_resource_value(observe, AVS_LIST_NEXT_PTR(value_ptr));
+}
+
+/**
+ * Finds the value in the send queue of @p conn_state that shall be dropped
+ * first according to the drop policy. @p out_superseded is set to true if the
+ * value is known to be replaced by a newer one for the same observation; such
+ * values are always dropped before the others.
+ *
+ * Error values are only ever chosen by ANJAY_NOTIFY_QUEUE_DROP_OLDEST.
+ */
+static AVS_LIST(anjay_observe_resource_value_t) *
+find_value_to_drop(anjay_observe_state_t *observe,
+                   anjay_observe_connection_entry_t *conn_state,
+                   bool *out_superseded) {
+    AVS_LIST(anjay_observe_resource_value_t) *oldest_ptr = NULL;
+    AVS_LIST(anjay_observe_resource_value_t) *value_ptr;
+    *out_superseded = false;
+    AVS_LIST_FOREACH_PTR(value_ptr, &conn_state->unsent) {
+        if (*value_ptr == conn_state->in_flight) {
+            continue;
+        }
+        if (observe->queue_drop_policy == ANJAY_NOTIFY_QUEUE_DROP_OLDEST) {
+            return value_ptr;
+        }
+        if (is_error_value(*value_ptr)) {
+            continue;
+        }
+        if (observe->queue_drop_policy
+                        == ANJAY_NOTIFY_QUEUE_KEEP_LATEST_PER_PATH
+                && *value_ptr != (*value_ptr)->ref->last_unsent) {
+            *out_superseded = true;
+            return value_ptr;
+        }
+        if (!oldest_ptr) {
+            oldest_ptr = value_ptr;
+            if (observe->queue_drop_policy
+                    == ANJAY_NOTIFY_QUEUE_DROP_NON_ERROR) {
+                break;
+            }
+        }
+    }
+    return oldest_ptr;
+}
+
+/**
+ * Finds the value that shall be dropped first among the send queues of all
+ * connections. Superseded values go first, then the oldest ones.
+ */
+static AVS_LIST(anjay_observe_resource_value_t) *
+find_value_to_drop_globally(anjay_observe_state_t *observe,
+                            anjay_observe_connection_entry_t **out_conn) {
+    AVS_LIST(anjay_observe_resource_value_t) *result = NULL;
+    bool result_superseded = false;
+    AVS_RBTREE_ELEM(anjay_observe_connection_entry_t) conn;
+    AVS_RBTREE_FOREACH(conn, observe->connection_entries) {
+        bool superseded;
+        AVS_LIST(anjay_observe_resource_value_t) *value_ptr =
+                find_value_to_drop(observe, conn, &superseded);
+        if (value_ptr
+                && (!result || (superseded && !result_superseded)
+                    || (superseded == result_superseded
+                        && avs_time_real_before((*value_ptr)->timestamp,
+                                                (*result)->timestamp)))) {
+            result = value_ptr;
+            result_superseded = superseded;
+            *out_conn = conn;
+        }
+    }
+    return result;
+}
+
+static void drop_unsent_value(anjay_observe_state_t *observe,
+                              anjay_observe_connection_entry_t *conn_state,
+                              AVS_LIST(anjay_observe_resource_value_t) *ptr) {
+    anjay_observe_entry_t *entry = (*ptr)->ref;
+    const bool was_server_last = (*ptr == conn_state->unsent_last);
+    const bool was_entry_last = (*ptr == entry->last_unsent);
+
+    if (is_error_value(*ptr)) {
+        anjay_log(WARNING,
+                  "notification queue limit exceeded, dropping error "
+                  "notification for /%u/%u/%" PRId32,
+                  entry->key.oid, entry->key.iid, entry->key.rid);
+    } else {
+        anjay_log(DEBUG, "notification queue limit exceeded, dropping value");
+    }
+    unsent_value_removed(observe, conn_state, *ptr);
+    delete_resource_value(observe, ptr);
+    ++conn_state->dropped_count;
+    ++observe->dropped_count;
+
+    if (was_server_last || was_entry_last) {
+        anjay_observe_resource_value_t *server_last = NULL;
+        anjay_observe_resource_value_t *entry_last = NULL;
+        AVS_LIST(anjay_observe_resource_value_t) it;
+        AVS_LIST_FOREACH(it, conn_state->unsent) {
+            server_last = it;
+            if (it->ref == entry) {
+                entry_last = it;
+            }
+        }
+        conn_state->unsent_last = server_last;
+        if (was_entry_last) {
+            entry->last_unsent = entry_last;
+        }
+    }
+}
+
+void _anjay_observe_enforce_queue_limits(
+        anjay_observe_state_t *observe,
+        anjay_observe_connection_entry_t *conn_state) {
+    AVS_LIST(anjay_observe_resource_value_t) *value_ptr;
+    bool superseded;
+    while (observe->queue_connection_limit
+           && conn_state->unsent_bytes > observe->queue_connection_limit
+           && (value_ptr = find_value_to_drop(observe, conn_state,
+                                              &superseded))) {
+        drop_unsent_value(observe, conn_state, value_ptr);
+    }
+    // the total limit is shared, so the value to drop may belong to any
+    // connection, not only to the one that has just grown
+    anjay_observe_connection_entry_t *victim_conn;
+    while (observe->queue_total_limit
+           && observe->unsent_bytes > observe->queue_total_limit
+           && (value_ptr = find_value_to_drop_globally(observe,
+                                                       &victim_conn))) {
+        drop_unsent_value(observe, victim_conn, value_ptr);
+    }
+}
+
+static int insert_new_value(anjay_t *anjay,
+                            anjay_observe_connection_entry_t *conn_state,
                             anjay_observe_entry_t *entry,
                             const anjay_msg_details_t *details,
                             const avs_coap_msg_identity_t *identity,
@@ -281,17 +718,30 @@ static int insert_new_value(anjay_observe_connection_entry_t *conn_state,
                             const void *data,
                             size_t size) {
     AVS_LIST(anjay_observe_resource_value_t) res_value =
-            create_resource_value(details, entry, identity, numeric, data,
-                                  size);
+            _anjay_observe_create_resource_value(&anjay->observe, details,
+                                                 entry, identity, numeric,
+                                                 data, size);
     if (!res_value) {
         return -1;
     }
-    AVS_LIST_APPEND(&conn_state->unsent_last, res_value);
-    conn_state->unsent_last = res_value;
-    if (!conn_state->unsent) {
-        conn_state->unsent = res_value;
+    // error values are never replaced, as they end the observation and must
+    // be delivered
+    if (anjay->observe.coalesce_notifications && entry->last_unsent
+            && entry->last_unsent != conn_state->in_flight
+            && !is_error_value(entry->last_unsent)) {
+        anjay_log(TRACE, "replacing queued notification value");
+        replace_unsent_value(&anjay->observe, conn_state, entry, res_value);
+    } else {
+        AVS_LIST_APPEND(&conn_state->unsent_last, res_value);
+        conn_state->unsent_last = res_value;
+        if (!conn_state->unsent) {
+            conn_state->unsent = res_value;
+        }
+        _anjay_observe_unsent_value_added(&anjay->observe, conn_state,
+                                          res_value);
     }
     entry->last_unsent = res_value;
+    _anjay_observe_enforce_queue_limits(&anjay->observe, conn_state);
     return 0;
 }
 
@@ -306,8 +756,8 @@ static int insert_error(anjay_t *anjay,
         .msg_code = _anjay_make_error_response_code(outer_result),
         .format = AVS_COAP_FORMAT_NONE
     };
-    return insert_new_value(conn_state, entry, &details, identity, NAN, NULL,
-                            0);
+    return insert_new_value(anjay, conn_state, entry, &details, identity, NAN,
+                            NULL, 0);
 }
 
 static int get_effective_attrs(anjay_t *anjay,
@@ -353,12 +803,29 @@ static int get_effective_attrs(anjay_t *anjay,
     return _anjay_dm_effective_attrs(anjay, &details, out_attrs);
 }
 
+static int get_entry_attrs(anjay_t *anjay,
+                           anjay_dm_internal_res_attrs_t *out_attrs,
+                           const anjay_dm_object_def_t *const *obj,
+                           anjay_observe_entry_t *entry) {
+    if (anjay->observe.cache_attrs
+            && entry->attrs_generation == anjay->observe.attrs_generation) {
+        *out_attrs = entry->attrs;
+        return 0;
+    }
+    int result = get_effective_attrs(anjay, out_attrs, obj, &entry->key);
+    if (!result && anjay->observe.cache_attrs) {
+        entry->attrs = *out_attrs;
+        entry->attrs_generation = anjay->observe.attrs_generation;
+    }
+    return result;
+}
+
 static inline int get_attrs(anjay_t *anjay,
                             anjay_dm_internal_res_attrs_t *out_attrs,
-                            const anjay_observe_key_t *key) {
+                            anjay_observe_entry_t *entry) {
     const anjay_dm_object_def_t *const *obj =
-            _anjay_dm_find_object_by_oid(anjay, key->oid);
-    return get_effective_attrs(anjay, out_attrs, obj, key);
+            _anjay_dm_find_object_by_oid(anjay, entry->key.oid);
+    return get_entry_attrs(anjay, out_attrs, obj, entry);
 }
 
 static inline bool is_pmax_valid(anjay_dm_attributes_t attr) {
@@ -382,7 +849,7 @@ int _anjay_observe_schedule_pmax_trigger(anjay_t *anjay,
     anjay_dm_internal_res_attrs_t attrs;
     int result;
 
-    if ((result = get_attrs(anjay, &attrs, &entry->key))) {
+    if ((result = get_attrs(anjay, &attrs, entry))) {
         anjay_log(DEBUG, "Could not get observe attributes, result: %d",
                   result);
         return result;
@@ -412,9 +879,12 @@ static int insert_initial_value(anjay_t *anjay,
     int result = -1;
     // we assume that the initial value should be treated as sent,
     // even though we haven't actually sent it ourselves
-    if ((entry->last_sent = create_resource_value(details, entry, identity,
-                                                  numeric, data, size))
+    if ((entry->last_sent =
+                 _anjay_observe_create_resource_value(
+                         &anjay->observe, details, entry, identity, numeric,
+                         data, size))
             && !(result = _anjay_observe_schedule_pmax_trigger(anjay, entry))) {
+        compact_sent_value(&anjay->observe, &entry->last_sent);
         entry->last_confirmable = now;
     } else {
         clear_entry(anjay, conn_state, entry);
@@ -561,6 +1031,13 @@ void _anjay_observe_gc(anjay_t *anjay) {
     }
 }
 
+void _anjay_observe_remove_all(anjay_t *anjay) {
+    AVS_RBTREE_ELEM(anjay_observe_connection_entry_t) conn;
+    while ((conn = AVS_RBTREE_FIRST(anjay->observe.connection_entries))) {
+        delete_connection(anjay, &conn);
+    }
+}
+
 static bool has_pmax_expired(const anjay_observe_resource_value_t *value,
                              const anjay_dm_attributes_t *attrs) {
     return is_pmax_valid(*attrs)
@@ -590,8 +1067,10 @@ static bool should_update(const anjay_observe_resource_value_t *previous,
                           const char *data,
                           size_t length) {
     if (details->format == previous->details.format
-            && length == previous->value_length
-            && memcmp(data, previous->value, length) == 0) {
+            && (previous->digest_only
+                        ? value_digest(data, length) == previous->digest
+                        : (length == previous->value_length
+                           && memcmp(data, previous->value, length) == 0))) {
         return false;
     }
 
@@ -608,13 +1087,12 @@ static bool should_update(const anjay_observe_resource_value_t *previous,
            || process_ltgt(previous, attrs->greater_than, numeric);
 }
 
-static inline ssize_t read_new_value(anjay_t *anjay,
-                                     const anjay_dm_object_def_t *const *obj,
-                                     const anjay_observe_entry_t *entry,
-                                     anjay_msg_details_t *out_details,
-                                     double *out_numeric,
-                                     char *buffer,
-                                     size_t size) {
+static inline int read_new_value(anjay_t *anjay,
+                                 const anjay_dm_object_def_t *const *obj,
+                                 const anjay_observe_entry_t *entry,
+                                 anjay_msg_details_t *out_details,
+                                 double *out_numeric,
+                                 anjay_observe_buffer_t *out_buffer) {
     anjay_uri_path_type_t path_type = ANJAY_PATH_OBJECT;
     if (entry->key.rid >= 0) {
         path_type = ANJAY_PATH_RESOURCE;
@@ -634,7 +1112,96 @@ static inline ssize_t read_new_value(anjay_t *anjay,
                 .requested_format = entry->key.format,
                 .observe_serial = true
             },
-            out_details, out_numeric, buffer, size);
+            out_details, out_numeric, out_buffer);
+}
+
+static bool read_cache_entry_matches(
+        const anjay_observe_read_cache_entry_t *cached,
+        const anjay_observe_entry_t *entry,
+        anjay_ssid_t ssid) {
+    return cached->oid == entry->key.oid && cached->iid == entry->key.iid
+           && cached->rid == entry->key.rid
+           && cached->format == entry->key.format && cached->ssid == ssid;
+}
+
+static void cache_read_value(anjay_observe_state_t *observe,
+                             const anjay_observe_entry_t *entry,
+                             anjay_ssid_t ssid,
+                             const anjay_msg_details_t *details,
+                             double numeric,
+                             const char *value,
+                             size_t value_length) {
+    AVS_LIST(anjay_observe_read_cache_entry_t) cached =
+            (AVS_LIST(anjay_observe_read_cache_entry_t)) AVS_LIST_NEW_BUFFER(
+                    offsetof(anjay_observe_read_cache_entry_t, value)
+                    + value_length);
+    if (!cached) {
+        // not an error: the value will just be read again if needed
+        anjay_log(DEBUG, "could not cache value for sharing");
+        return;
+    }
+    cached->oid = entry->key.oid;
+    cached->iid = entry->key.iid;
+    cached->rid = entry->key.rid;
+    cached->format = entry->key.format;
+    cached->ssid = ssid;
+    cached->details = *details;
+    cached->numeric = numeric;
+    cached->value_length = value_length;
+    memcpy(cached->value, value, value_length);
+    AVS_LIST_INSERT(&observe->read_cache, cached);
+}
+
+/**
+ * Works like read_new_value(), but if share_reads is enabled, reuses the value
+ * already read for another observation of the same path and format during the
+ * current scheduler run.
+ */
+static int read_shared_value(anjay_t *anjay,
+                             const anjay_dm_object_def_t *const *obj,
+                             const anjay_observe_entry_t *entry,
+                             anjay_msg_details_t *out_details,
+                             double *out_numeric,
+                             anjay_observe_buffer_t *out_buffer) {
+    anjay_observe_state_t *observe = &anjay->observe;
+    if (!observe->share_reads) {
+        return read_new_value(anjay, obj, entry, out_details, out_numeric,
+                              out_buffer);
+    }
+
+    anjay_ssid_t ssid = (entry->key.iid == ANJAY_IID_INVALID)
+                                ? entry->key.connection.ssid
+                                : ANJAY_SSID_ANY;
+    AVS_LIST(anjay_observe_read_cache_entry_t) cached;
+    AVS_LIST_FOREACH(cached, observe->read_cache) {
+        if (!read_cache_entry_matches(cached, entry, ssid)) {
+            continue;
+        }
+        // the instance was present when the value was cached, but access
+        // rights may still differ between servers
+        const anjay_action_info_t action_info = {
+            .oid = entry->key.oid,
+            .iid = entry->key.iid,
+            .ssid = entry->key.connection.ssid,
+            .action = ANJAY_ACTION_READ
+        };
+        if (ssid == ANJAY_SSID_ANY
+                && !_anjay_instance_action_allowed(anjay, &action_info)) {
+            return ANJAY_ERR_UNAUTHORIZED;
+        }
+        *out_details = cached->details;
+        *out_numeric = cached->numeric;
+        return _anjay_observe_buffer_assign(out_buffer, cached->value,
+                                            cached->value_length);
+    }
+
+    int result = read_new_value(anjay, obj, entry, out_details, out_numeric,
+                                out_buffer);
+    if (!result) {
+        cache_read_value(observe, entry, ssid, out_details, *out_numeric,
+                         out_buffer->data, out_buffer->size);
+    }
+    return result;
 }
 
 static bool confirmable_required(const avs_time_real_t now,
@@ -645,8 +1212,10 @@ static bool confirmable_required(const avs_time_real_t now,
 }
 
 static anjay_observe_resource_value_t *
-detach_first_unsent_value(anjay_observe_connection_entry_t *conn_state) {
+detach_first_unsent_value(anjay_observe_state_t *observe,
+                          anjay_observe_connection_entry_t *conn_state) {
     assert(conn_state->unsent);
+    unsent_value_removed(observe, conn_state, conn_state->unsent);
     anjay_observe_entry_t *entry = conn_state->unsent->ref;
     if (entry->last_unsent == conn_state->unsent) {
         entry->last_unsent = NULL;
@@ -660,15 +1229,23 @@ detach_first_unsent_value(anjay_observe_connection_entry_t *conn_state) {
     return result;
 }
 
-static void value_sent(anjay_observe_connection_entry_t *conn_state) {
+static void value_sent(anjay_t *anjay,
+                       anjay_observe_connection_entry_t *conn_state) {
     anjay_observe_resource_value_t *sent =
-            detach_first_unsent_value(conn_state);
+            detach_first_unsent_value(&anjay->observe, conn_state);
     anjay_observe_entry_t *entry = sent->ref;
     assert(AVS_LIST_SIZE(entry->last_sent) <= 1);
-    AVS_LIST_CLEAR(&entry->last_sent);
+    clear_resource_values(&anjay->observe, &entry->last_sent);
     entry->last_sent = sent;
+    compact_sent_value(&anjay->observe, &entry->last_sent);
 }
 
+static void notification_exchange_finished(anjay_t *anjay,
+                                           anjay_connection_key_t key,
+                                           uint16_t msg_id,
+                                           anjay_exchange_result_t result,
+                                           const avs_coap_msg_t *response);
+
 static int send_entry(anjay_t *anjay,
                       anjay_observe_connection_entry_t *conn_state) {
     assert(conn_state->unsent);
@@ -684,6 +1261,25 @@ static int send_entry(anjay_t *anjay,
     }
 
     int result;
+    if (details.msg_type == AVS_COAP_MSG_NON_CONFIRMABLE) {
+        // fast path for the common case of a short Non-confirmable
+        // notification - there is no need to involve the client state machine
+        result = _anjay_coap_stream_send_nonconfirmable(
+                anjay->comm_stream, &details, &id->token,
+                conn_state->unsent->value, conn_state->unsent->value_length,
+                &notify_id);
+        if (result <= 0) {
+            if (!result) {
+                value_sent(anjay, conn_state);
+                entry->last_sent->identity.msg_id = notify_id.msg_id;
+            }
+            return result;
+        }
+        // the value does not fit in a single message, so it needs to be sent
+        // using a block-wise transfer
+    }
+
+    const avs_coap_msg_t *sent_con = NULL;
     (void) ((result = _anjay_coap_stream_setup_request(anjay->comm_stream,
                                                        &details, &id->token))
             || (result = avs_stream_write(anjay->comm_stream,
@@ -691,13 +1287,24 @@ static int send_entry(anjay_t *anjay,
                                           conn_state->unsent->value_length))
             || (result = _anjay_coap_stream_get_request_identity(
                         anjay->comm_stream, &notify_id))
-            || (result = avs_stream_finish_message(anjay->comm_stream)));
-
-    if (!result) {
+            || (result = _anjay_coap_stream_finish_request_async(
+                        anjay->comm_stream, &sent_con)));
+
+    if (!result && sent_con) {
+        // the value stays in the queue until it is acknowledged;
+        // see notification_exchange_finished()
+        if ((result = _anjay_exchange_start(anjay, conn_state->key, sent_con,
+                                            notification_exchange_finished))) {
+            return result;
+        }
+        conn_state->unsent->identity.msg_id = notify_id.msg_id;
+        conn_state->in_flight = conn_state->unsent;
+        conn_state->in_flight_sent = now;
+    } else if (!result) {
         if (details.msg_type == AVS_COAP_MSG_CONFIRMABLE) {
             entry->last_confirmable = now;
         }
-        value_sent(conn_state);
+        value_sent(anjay, conn_state);
         entry->last_sent->identity.msg_id = notify_id.msg_id;
     }
     return result;
@@ -753,15 +1360,13 @@ static observe_conn_state_t conn_state(anjay_t *anjay,
     return result;
 }
 
-static inline bool is_error_value(const anjay_observe_resource_value_t *value) {
-    return avs_coap_msg_code_get_class(value->details.msg_code) >= 4;
-}
-
-static void remove_all_unsent_values(anjay_observe_connection_entry_t *conn) {
+static void remove_all_unsent_values(anjay_t *anjay,
+                                     anjay_observe_connection_entry_t *conn) {
+    abort_in_flight(anjay, conn);
     while (conn->unsent) {
         AVS_LIST(anjay_observe_resource_value_t) value =
-                detach_first_unsent_value(conn);
-        AVS_LIST_DELETE(&value);
+                detach_first_unsent_value(&anjay->observe, conn);
+        delete_resource_value(&anjay->observe, &value);
     }
 }
 
@@ -772,7 +1377,10 @@ static int handle_send_queue_entry(anjay_t *anjay,
     assert(observe_state->server_active);
     bool is_error = is_error_value(conn_state->unsent);
     int result = send_entry(anjay, conn_state);
-    if (result > 0) {
+    if (!result && conn_state->in_flight) {
+        // the outcome is handled in notification_exchange_finished()
+        return 0;
+    } else if (result > 0) {
         anjay_log(INFO, "Reset received as reply to notification, result == %d",
                   result);
     } else if (result < 0) {
@@ -781,7 +1389,7 @@ static int handle_send_queue_entry(anjay_t *anjay,
         if (result != AVS_COAP_CTX_ERR_NETWORK
                 && result != AVS_COAP_CTX_ERR_TIMEOUT
                 && !observe_state->notification_storing_enabled) {
-            remove_all_unsent_values(conn_state);
+            remove_all_unsent_values(anjay, conn_state);
         }
     }
     if (is_error && result != AVS_COAP_CTX_ERR_NETWORK
@@ -806,6 +1414,73 @@ static void schedule_all_triggers(anjay_t *anjay,
     }
 }
 
+static avs_time_duration_t
+flush_backoff(anjay_t *anjay, const anjay_observe_connection_entry_t *conn) {
+    assert(conn->flush_failures > 0);
+    unsigned exponent =
+            AVS_MIN(conn->flush_failures - 1, MAX_FLUSH_BACKOFF_EXPONENT);
+    return avs_time_duration_mul(
+            _anjay_tx_params_for_conn_type(anjay, conn->key.type)->ack_timeout,
+            (int32_t) (1 << exponent));
+}
+
+static int sched_flush(anjay_t *anjay,
+                       anjay_observe_connection_entry_t *conn,
+                       avs_time_duration_t delay);
+
+static void notification_exchange_finished(anjay_t *anjay,
+                                           anjay_connection_key_t key,
+                                           uint16_t msg_id,
+                                           anjay_exchange_result_t result,
+                                           const avs_coap_msg_t *response) {
+    (void) response;
+    AVS_RBTREE_ELEM(anjay_observe_connection_entry_t) conn =
+            AVS_RBTREE_FIND(anjay->observe.connection_entries,
+                            connection_query(&key));
+    if (!conn || !conn->in_flight
+            || conn->in_flight->identity.msg_id != msg_id) {
+        anjay_log(TRACE, "notification %" PRIu16 " no longer in flight",
+                  msg_id);
+        return;
+    }
+    assert(conn->in_flight == conn->unsent);
+    conn->in_flight = NULL;
+
+    anjay_observe_key_t observe_key = conn->unsent->ref->key;
+    switch (result) {
+    case ANJAY_EXCHANGE_ACKED: {
+        bool is_error = is_error_value(conn->unsent);
+        conn->unsent->ref->last_confirmable = conn->in_flight_sent;
+        conn->flush_failures = 0;
+        value_sent(anjay, conn);
+        if (is_error) {
+            _anjay_observe_remove_entry(anjay, &observe_key);
+            // the above might've deleted the connection entry
+            conn = AVS_RBTREE_FIND(anjay->observe.connection_entries,
+                                   connection_query(&key));
+        }
+        if (conn && conn->unsent) {
+            _anjay_observe_sched_flush(anjay, key);
+        } else if (conn) {
+            schedule_all_triggers(anjay, conn);
+        }
+        break;
+    }
+    case ANJAY_EXCHANGE_RESET:
+        anjay_log(INFO, "Reset received as reply to notification");
+        _anjay_observe_remove_entry(anjay, &observe_key);
+        break;
+    case ANJAY_EXCHANGE_TIMEOUT:
+    case ANJAY_EXCHANGE_FAILED:
+        // the value is still at the head of the queue,
+        // it will be sent again during the next flush
+        anjay_log(ERROR, "Confirmable notification not acknowledged");
+        ++conn->flush_failures;
+        sched_flush(anjay, conn, flush_backoff(anjay, conn));
+        break;
+    }
+}
+
 static void flush_send_queue(anjay_t *anjay,
                              anjay_observe_connection_entry_t *conn,
                              const observe_conn_state_t *observe_state) {
@@ -817,7 +1492,7 @@ static void flush_send_queue(anjay_t *anjay,
     int result = _anjay_bind_server_stream(anjay, observe_state->ref);
     assert(result == 0);
 
-    while (result >= 0 && conn && conn->unsent) {
+    while (result >= 0 && conn && conn->unsent && !conn->in_flight) {
         anjay_observe_key_t key = conn->unsent->ref->key;
         if ((result = handle_send_queue_entry(anjay, conn, observe_state))
                 > 0) {
@@ -846,7 +1521,7 @@ static void flush_send_queue(anjay_t *anjay,
 static void flush_send_queue_job(anjay_t *anjay, const void *conn_ptr) {
     anjay_observe_connection_entry_t *conn =
             *(anjay_observe_connection_entry_t *const *) conn_ptr;
-    if (conn && conn->unsent) {
+    if (conn && conn->unsent && !conn->in_flight) {
         observe_conn_state_t observe_state =
                 conn_state(anjay, &conn->unsent->ref->key.connection);
         if (observe_state.server_active
@@ -872,14 +1547,24 @@ int _anjay_observe_sched_flush(anjay_t *anjay, anjay_connection_key_t key) {
     anjay_observe_connection_entry_t *conn =
             AVS_RBTREE_FIND(anjay->observe.connection_entries,
                             connection_query(&key));
-    if (!conn || conn->flush_task) {
-        anjay_log(TRACE, "skipping notification flush scheduling: %s",
-                  !conn ? "no appropriate connection found"
-                        : "flush task already scheduled");
+    if (!conn) {
+        anjay_log(TRACE, "skipping notification flush scheduling: "
+                         "no appropriate connection found");
         return 0;
     }
-    if (_anjay_sched_now(anjay->sched, &conn->flush_task, flush_send_queue_job,
-                         &conn, sizeof(conn))) {
+    return sched_flush(anjay, conn, AVS_TIME_DURATION_ZERO);
+}
+
+static int sched_flush(anjay_t *anjay,
+                       anjay_observe_connection_entry_t *conn,
+                       avs_time_duration_t delay) {
+    if (conn->flush_task) {
+        anjay_log(TRACE, "skipping notification flush scheduling: "
+                         "flush task already scheduled");
+        return 0;
+    }
+    if (_anjay_sched(anjay->sched, &conn->flush_task, delay,
+                     flush_send_queue_job, &conn, sizeof(conn))) {
         anjay_log(WARNING, "Could not schedule notification flush");
         return -1;
     }
@@ -901,20 +1586,19 @@ update_notification_value(anjay_t *anjay,
     }
 
     anjay_dm_internal_res_attrs_t attrs;
-    int result = get_effective_attrs(anjay, &attrs, obj, &entry->key);
+    int result = get_entry_attrs(anjay, &attrs, obj, entry);
     if (result) {
         return result;
     }
 
     bool pmax_expired =
             has_pmax_expired(newest_value(entry), &attrs.standard.common);
-    char buf[ANJAY_MAX_OBSERVABLE_RESOURCE_SIZE];
+    anjay_observe_buffer_t *buf = &anjay->observe.read_buffer;
     anjay_msg_details_t observe_details;
     double numeric = NAN;
-    ssize_t size = read_new_value(anjay, obj, entry, &observe_details, &numeric,
-                                  buf, sizeof(buf));
-    if (size < 0) {
-        return (int) size;
+    if ((result = read_shared_value(anjay, obj, entry, &observe_details,
+                                    &numeric, buf))) {
+        return result;
     }
 #ifdef WITH_CON_ATTR
     if (attrs.custom.data.con >= 0) {
@@ -931,10 +1615,11 @@ update_notification_value(anjay_t *anjay,
 
     if (pmax_expired
             || should_update(newest_value(entry), &attrs.standard,
-                             &observe_details, numeric, buf, (size_t) size)) {
-        result = insert_new_value(conn_state, entry, &observe_details,
-                                  &newest_value(entry)->identity, numeric, buf,
-                                  (size_t) size);
+                             &observe_details, numeric, buf->data,
+                             buf->size)) {
+        result = insert_new_value(anjay, conn_state, entry, &observe_details,
+                                  &newest_value(entry)->identity, numeric,
+                                  buf->data, buf->size);
     }
 
     if (is_pmax_valid(attrs.standard.common)) {
@@ -960,7 +1645,9 @@ static void trigger_observe(anjay_t *anjay, const void *entry_ptr) {
         insert_error(anjay, conn, entry, &newest_value(entry)->identity,
                      result);
     }
-    if (state.server_active && conn->unsent) {
+    // if a delayed retry is pending, new values will be sent along with it
+    if (state.server_active && conn->unsent
+            && !(conn->flush_failures && conn->flush_task)) {
         _anjay_sched_del(anjay->sched, &conn->flush_task);
         assert(!conn->flush_task);
         assert(state.ref.server);
@@ -972,7 +1659,7 @@ static void trigger_observe(anjay_t *anjay, const void *entry_ptr) {
             // once the connection is up, _anjay_observe_sched_flush()
             // will be called; we're done here
         } else if (!state.notification_storing_enabled) {
-            remove_all_unsent_values(conn);
+            remove_all_unsent_values(anjay, conn);
         }
     }
 }
@@ -982,7 +1669,7 @@ static inline int notify_entry(anjay_t *anjay,
                                anjay_observe_entry_t *entry) {
     anjay_dm_internal_res_attrs_t attrs = ANJAY_DM_INTERNAL_RES_ATTRS_EMPTY;
     int32_t period = 0;
-    if (!get_effective_attrs(anjay, &attrs, obj, &entry->key)
+    if (!get_entry_attrs(anjay, &attrs, obj, entry)
             && attrs.standard.common.min_period > 0) {
         period = attrs.standard.common.min_period;
     }
@@ -1170,6 +1857,8 @@ int _anjay_observe_notify(anjay_t *anjay,
                           const anjay_observe_key_t *key,
                           bool invert_server_match) {
     assert(key->format == AVS_COAP_FORMAT_NONE);
+    // values read before the change must not be reused
+    _anjay_observe_clear_read_cache(&anjay->observe);
     const anjay_dm_object_def_t *const *obj =
             _anjay_dm_find_object_by_oid(anjay, key->oid);
 
@@ -19,38 +19,88 @@
 
 #include <avsystem/commons/rbtree.h>
 #include <avsystem/commons/stream.h>
-#include <avsystem/commons/stream/stream_outbuf.h>
+#include <avsystem/commons/stream_v_table.h>
+
+#include <anjay/core.h>
+#include <anjay/stats.h>
 
 #include <anjay_modules/observe.h>
 
 #include "../coap/coap_stream.h"
+#include "../pool.h"
 #include "../servers.h"
 
 VISIBILITY_PRIVATE_HEADER_BEGIN
 
 #ifdef WITH_OBSERVE
 
+/**
+ * Heap-allocated buffer for serialized notification values. It is grown on
+ * demand, up to ANJAY_MAX_OBSERVABLE_RESOURCE_SIZE bytes, and reused for
+ * subsequent reads.
+ */
 typedef struct {
-    avs_stream_outbuf_t outbuf;
+    char *data;
+    size_t size;
+    size_t capacity;
+} anjay_observe_buffer_t;
+
+/**
+ * Output stream that serializes a value into an @ref anjay_observe_buffer_t
+ * and captures message details set up by the output context.
+ */
+typedef struct {
+    const avs_stream_v_table_t *vtable;
     anjay_msg_details_t *details;
+    anjay_observe_buffer_t *buffer;
 } anjay_observe_stream_t;
 
-const anjay_observe_stream_t *_anjay_observe_stream_initializer__(void);
+anjay_observe_stream_t
+_anjay_new_observe_stream(anjay_msg_details_t *details,
+                          anjay_observe_buffer_t *buffer);
 
-static inline anjay_observe_stream_t
-_anjay_new_observe_stream(anjay_msg_details_t *details) {
-    anjay_observe_stream_t retval = *_anjay_observe_stream_initializer__();
-    retval.details = details;
-    return retval;
-}
+/**
+ * Replaces contents of @p buffer with @p size bytes of @p data.
+ */
+int _anjay_observe_buffer_assign(anjay_observe_buffer_t *buffer,
+                                 const void *data,
+                                 size_t size);
 
 typedef struct anjay_observe_entry_struct anjay_observe_entry_t;
 typedef struct anjay_observe_connection_entry_struct
         anjay_observe_connection_entry_t;
+typedef struct anjay_observe_read_cache_entry_struct
+        anjay_observe_read_cache_entry_t;
 
 typedef struct {
     AVS_RBTREE(anjay_observe_connection_entry_t) connection_entries;
     bool confirmable_notifications;
+    bool coalesce_notifications;
+    anjay_pool_t value_pool;
+
+    bool cache_attrs;
+    // attributes cached in observe entries are only valid if they were
+    // resolved during the current generation
+    uint32_t attrs_generation;
+
+    bool share_reads;
+    // values read for notifications during the current scheduler run, reused
+    // by all observations of the same path and format
+    AVS_LIST(anjay_observe_read_cache_entry_t) read_cache;
+    // scratch space for values read from the data model
+    anjay_observe_buffer_t read_buffer;
+
+    // if true, values that have already been sent are only kept as digests
+    bool sent_value_digests;
+
+    size_t queue_connection_limit;
+    size_t queue_total_limit;
+    anjay_notify_queue_drop_policy_t queue_drop_policy;
+
+    // totals for all connections
+    size_t unsent_count;
+    size_t unsent_bytes;
+    uint64_t dropped_count;
 } anjay_observe_state_t;
 
 typedef struct {
@@ -59,6 +109,10 @@ typedef struct {
     avs_coap_msg_identity_t identity;
     avs_time_real_t timestamp;
     double numeric;
+    // hash of the value contents; if digest_only is true, the contents
+    // themselves have been discarded and value_length is 0
+    uint64_t digest;
+    bool digest_only;
     const size_t value_length;
     char value[1]; // actually a FAM
 } anjay_observe_resource_value_t;
@@ -72,11 +126,42 @@ typedef struct {
 } anjay_observe_key_t;
 
 int _anjay_observe_init(anjay_observe_state_t *observe,
-                        bool confirmable_notifications);
+                        bool confirmable_notifications,
+                        bool coalesce_notifications,
+                        bool cache_attrs,
+                        bool share_reads,
+                        bool sent_value_digests);
+
+#    ifdef WITH_POOL_ALLOCATOR
+/**
+ * Preallocates a pool used for notification values. MUST be called before any
+ * observation is registered.
+ */
+int _anjay_observe_init_pool(anjay_observe_state_t *observe,
+                             size_t block_size,
+                             size_t block_count);
+#    endif // WITH_POOL_ALLOCATOR
+
+void _anjay_observe_set_queue_limits(
+        anjay_observe_state_t *observe,
+        size_t connection_limit,
+        size_t total_limit,
+        anjay_notify_queue_drop_policy_t drop_policy);
+
+void _anjay_observe_queue_stats(anjay_observe_state_t *observe,
+                                anjay_ssid_t ssid,
+                                anjay_notify_queue_stats_t *out_stats);
 
 void _anjay_observe_cleanup(anjay_observe_state_t *observe,
                             anjay_sched_t *sched);
 
+/**
+ * Discards values cached for reuse by notifications triggered during a single
+ * scheduler run. Shall be called after each run, and whenever the data model
+ * might have changed.
+ */
+void _anjay_observe_clear_read_cache(anjay_observe_state_t *observe);
+
 int _anjay_observe_put_entry(anjay_t *anjay,
                              const anjay_observe_key_t *key,
                              const anjay_msg_details_t *details,
@@ -105,11 +190,11 @@ anjay_output_ctx_t *_anjay_observe_decorate_ctx(anjay_output_ctx_t *backend,
 #else // WITH_OBSERVE
 
 #    define _anjay_observe_init(...) 0
+#    define _anjay_observe_set_queue_limits(...) ((void) 0)
 #    define _anjay_observe_cleanup(...) ((void) 0)
+#    define _anjay_observe_clear_read_cache(...) ((void) 0)
 #    define _anjay_observe_sched_flush_current_connection(...) 0
 #    define _anjay_observe_sched_flush(...) 0
-#    define _anjay_observe_persist(...) 0
-#    define _anjay_observe_restore(...) 0
 
 #endif // WITH_OBSERVE
 
@@ -17,6 +17,8 @@
 #ifndef ANJAY_OBSERVE_INTERNAL_H
 #define ANJAY_OBSERVE_INTERNAL_H
 
+#include <anjay_modules/dm/attributes.h>
+
 #include "observe_core.h"
 
 VISIBILITY_PRIVATE_HEADER_BEGIN
@@ -37,6 +39,11 @@ struct anjay_observe_entry_struct {
     // (depending on whether the last unsent value in the server refers
     // to this resource+format or not)
     AVS_LIST(anjay_observe_resource_value_t) last_unsent;
+
+    // effective attributes, valid only if attrs_generation is equal to
+    // anjay_observe_state_t::attrs_generation
+    anjay_dm_internal_res_attrs_t attrs;
+    uint32_t attrs_generation;
 };
 
 struct anjay_observe_connection_entry_struct {
@@ -47,6 +54,36 @@ struct anjay_observe_connection_entry_struct {
     AVS_LIST(anjay_observe_resource_value_t) unsent;
     // pointer to the last element of unsent
     AVS_LIST(anjay_observe_resource_value_t) unsent_last;
+
+    // if not NULL, it is the same as unsent; it means that the value has been
+    // sent as a Confirmable notification that has not been acknowledged yet,
+    // and no other notifications shall be sent until it is
+    anjay_observe_resource_value_t *in_flight;
+    // time at which in_flight was first sent
+    avs_time_real_t in_flight_sent;
+    // number of Confirmable notifications in a row that could not be
+    // delivered; further attempts are delayed exponentially
+    unsigned flush_failures;
+
+    // memory accounting of the unsent list
+    size_t unsent_count;
+    size_t unsent_bytes;
+    uint64_t dropped_count;
+};
+
+struct anjay_observe_read_cache_entry_struct {
+    anjay_oid_t oid;
+    anjay_iid_t iid;
+    int32_t rid;
+    uint16_t format;
+    // results of Object-level reads depend on Access Control settings, so
+    // they are only shared within a single server; ANJAY_SSID_ANY otherwise
+    anjay_ssid_t ssid;
+
+    anjay_msg_details_t details;
+    double numeric;
+    size_t value_length;
+    char value[1]; // actually a FAM
 };
 
 static inline const anjay_observe_entry_t *
@@ -54,16 +91,50 @@ _anjay_observe_entry_query(const anjay_observe_key_t *key) {
     return AVS_CONTAINER_OF(key, anjay_observe_entry_t, key);
 }
 
-void _anjay_observe_cleanup_connection(anjay_sched_t *sched,
+void _anjay_observe_cleanup_connection(anjay_observe_state_t *observe,
+                                       anjay_sched_t *sched,
                                        anjay_observe_connection_entry_t *conn);
 
+int _anjay_observe_connection_entry_cmp(const void *left, const void *right);
 int _anjay_observe_key_cmp(const anjay_observe_key_t *left,
                            const anjay_observe_key_t *right);
 int _anjay_observe_entry_cmp(const void *left, const void *right);
 
+/**
+ * Allocates a new notification value from the value pool. If @p data is NULL,
+ * contents of the value are left uninitialized.
+ */
+AVS_LIST(anjay_observe_resource_value_t)
+_anjay_observe_create_resource_value(anjay_observe_state_t *observe,
+                                     const anjay_msg_details_t *details,
+                                     anjay_observe_entry_t *ref,
+                                     const avs_coap_msg_identity_t *identity,
+                                     double numeric,
+                                     const void *data,
+                                     size_t size);
+
+void _anjay_observe_unsent_value_added(
+        anjay_observe_state_t *observe,
+        anjay_observe_connection_entry_t *conn,
+        const anjay_observe_resource_value_t *value);
+
+/**
+ * Drops queued values according to the configured drop policy until neither
+ * the limit for @p conn nor the total limit is exceeded.
+ */
+void _anjay_observe_enforce_queue_limits(
+        anjay_observe_state_t *observe,
+        anjay_observe_connection_entry_t *conn);
+
 int _anjay_observe_schedule_pmax_trigger(anjay_t *anjay,
                                          anjay_observe_entry_t *entry);
 
+/**
+ * Removes all observations, cancelling any scheduled jobs and Confirmable
+ * notifications that are in flight.
+ */
+void _anjay_observe_remove_all(anjay_t *anjay);
+
 VISIBILITY_PRIVATE_HEADER_END
 
 #endif /* ANJAY_OBSERVE_INTERNAL_H */
@@ -92,6 +92,10 @@ observe_set_id(anjay_output_ctx_t *ctx, anjay_id_type_t type, uint16_t id) {
     return _anjay_output_set_id(((observe_out_t *) ctx)->backend, type, id);
 }
 
+static int observe_set_next_size(anjay_output_ctx_t *ctx, size_t size) {
+    return _anjay_output_set_next_size(((observe_out_t *) ctx)->backend, size);
+}
+
 static int observe_close(anjay_output_ctx_t *ctx) {
     return _anjay_output_ctx_destroy(&((observe_out_t *) ctx)->backend);
 }
@@ -109,6 +113,7 @@ static const anjay_output_ctx_vtable_t OBSERVE_OUT_VTABLE = {
     .array_start = observe_array_start,
     .object_start = observe_object_start,
     .set_id = observe_set_id,
+    .set_next_size = observe_set_next_size,
     .close = observe_close
 };
 
@@ -0,0 +1,491 @@
+/*
+ * Copyright 2017-2018 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <anjay_config.h>
+
+#include <assert.h>
+#include <inttypes.h>
+#include <string.h>
+
+#ifdef WITH_AVS_PERSISTENCE
+#    include <avsystem/commons/persistence.h>
+#endif // WITH_AVS_PERSISTENCE
+
+#include <anjay/core.h>
+
+#include "../anjay_core.h"
+
+#ifdef WITH_OBSERVE
+#    include "observe_internal.h"
+#endif // WITH_OBSERVE
+
+VISIBILITY_SOURCE_BEGIN
+
+#define persistence_log(level, ...) \
+    _anjay_log(observe_persistence, level, __VA_ARGS__)
+
+#if defined(WITH_OBSERVE) && defined(WITH_AVS_PERSISTENCE)
+
+static const char MAGIC[] = { 'O', 'B', 'S', '\0' };
+
+static int handle_timestamp(avs_persistence_context_t *ctx,
+                            avs_time_real_t *timestamp) {
+    const uint64_t seconds = (uint64_t) timestamp->since_real_epoch.seconds;
+    uint32_t seconds_hi = (uint32_t) (seconds >> 32);
+    uint32_t seconds_lo = (uint32_t) seconds;
+    uint32_t nanoseconds = (uint32_t) timestamp->since_real_epoch.nanoseconds;
+    int retval;
+    (void) ((retval = avs_persistence_u32(ctx, &seconds_hi))
+            || (retval = avs_persistence_u32(ctx, &seconds_lo))
+            || (retval = avs_persistence_u32(ctx, &nanoseconds)));
+    if (!retval && avs_persistence_direction(ctx) == AVS_PERSISTENCE_RESTORE) {
+        timestamp->since_real_epoch.seconds =
+                (int64_t) (((uint64_t) seconds_hi << 32) | seconds_lo);
+        timestamp->since_real_epoch.nanoseconds = (int32_t) nanoseconds;
+        if (!avs_time_real_valid(*timestamp)) {
+            persistence_log(ERROR, "Invalid timestamp");
+            retval = -1;
+        }
+    }
+    return retval;
+}
+
+static int handle_connection_key(avs_persistence_context_t *ctx,
+                                 anjay_connection_key_t *key) {
+    uint32_t type = (uint32_t) key->type;
+    int retval;
+    (void) ((retval = avs_persistence_u16(ctx, &key->ssid))
+            || (retval = avs_persistence_u32(ctx, &type)));
+    if (!retval && avs_persistence_direction(ctx) == AVS_PERSISTENCE_RESTORE) {
+        if (type >= ANJAY_CONNECTION_LIMIT_) {
+            persistence_log(ERROR, "Invalid connection type: %" PRIu32, type);
+            return -1;
+        }
+        key->type = (anjay_connection_type_t) type;
+    }
+    return retval;
+}
+
+/**
+ * Handles the path and format part of the observe key. The connection part is
+ * implied by the connection entry the observation belongs to.
+ */
+static int handle_observe_key(avs_persistence_context_t *ctx,
+                              anjay_observe_key_t *key) {
+    uint32_t rid = (uint32_t) key->rid;
+    int retval;
+    (void) ((retval = avs_persistence_u16(ctx, &key->oid))
+            || (retval = avs_persistence_u16(ctx, &key->iid))
+            || (retval = avs_persistence_u32(ctx, &rid))
+            || (retval = avs_persistence_u16(ctx, &key->format)));
+    if (!retval && avs_persistence_direction(ctx) == AVS_PERSISTENCE_RESTORE) {
+        key->rid = (int32_t) rid;
+        if (key->rid < -1 || key->rid > UINT16_MAX) {
+            persistence_log(ERROR, "Invalid Resource ID: %" PRId32, key->rid);
+            return -1;
+        }
+    }
+    return retval;
+}
+
+typedef struct {
+    anjay_msg_details_t details;
+    avs_coap_msg_identity_t identity;
+    avs_time_real_t timestamp;
+    double numeric;
+    uint64_t digest;
+    bool digest_only;
+    uint32_t value_length;
+} value_header_t;
+
+static int handle_value_header(avs_persistence_context_t *ctx,
+                               value_header_t *header) {
+    uint16_t msg_type = (uint16_t) header->details.msg_type;
+    uint16_t msg_code = header->details.msg_code;
+    uint16_t token_size = header->identity.token.size;
+    uint32_t digest_hi = (uint32_t) (header->digest >> 32);
+    uint32_t digest_lo = (uint32_t) header->digest;
+    int retval;
+    (void) ((retval = avs_persistence_u16(ctx, &msg_type))
+            || (retval = avs_persistence_u16(ctx, &msg_code))
+            || (retval = avs_persistence_u16(ctx, &header->details.format))
+            || (retval = avs_persistence_bool(ctx,
+                                              &header->details.observe_serial))
+            || (retval = avs_persistence_u16(ctx, &header->identity.msg_id))
+            || (retval = avs_persistence_u16(ctx, &token_size)));
+    if (!retval && token_size > AVS_COAP_MAX_TOKEN_LENGTH) {
+        persistence_log(ERROR, "Invalid token size: %" PRIu16, token_size);
+        return -1;
+    }
+    (void) (retval
+            || (retval = avs_persistence_bytes(
+                        ctx, header->identity.token.bytes, token_size))
+            || (retval = handle_timestamp(ctx, &header->timestamp))
+            || (retval = avs_persistence_double(ctx, &header->numeric))
+            || (retval = avs_persistence_u32(ctx, &digest_hi))
+            || (retval = avs_persistence_u32(ctx, &digest_lo))
+            || (retval = avs_persistence_bool(ctx, &header->digest_only))
+            || (retval = avs_persistence_u32(ctx, &header->value_length)));
+    if (!retval && avs_persistence_direction(ctx) == AVS_PERSISTENCE_RESTORE) {
+        if (msg_code > UINT8_MAX) {
+            persistence_log(ERROR, "Invalid notification code: %" PRIu16,
+                            msg_code);
+            return -1;
+        }
+        header->details.msg_type = (avs_coap_msg_type_t) msg_type;
+        header->details.msg_code = (uint8_t) msg_code;
+        header->identity.token.size = (uint8_t) token_size;
+        header->digest = ((uint64_t) digest_hi << 32) | digest_lo;
+        if (header->digest_only && header->value_length) {
+            persistence_log(ERROR, "Unexpected contents of a digest value");
+            return -1;
+        }
+    }
+    return retval;
+}
+
+static int persist_value(avs_persistence_context_t *ctx,
+                         anjay_observe_resource_value_t *value) {
+    value_header_t header = {
+        .details = value->details,
+        .identity = value->identity,
+        .timestamp = value->timestamp,
+        .numeric = value->numeric,
+        .digest = value->digest,
+        .digest_only = value->digest_only,
+        .value_length = (uint32_t) value->value_length
+    };
+    if (header.value_length != value->value_length) {
+        persistence_log(ERROR, "Notification value too large");
+        return -1;
+    }
+    int retval;
+    (void) ((retval = handle_value_header(ctx, &header))
+            || (retval = avs_persistence_bytes(ctx, value->value,
+                                               value->value_length)));
+    return retval;
+}
+
+/**
+ * Restores a single notification value. Note that @p out_value is set as soon
+ * as the value is allocated, so that it is released along with the rest of the
+ * restored state if reading its contents fails.
+ */
+static int restore_value(avs_persistence_context_t *ctx,
+                         anjay_observe_state_t *observe,
+                         anjay_observe_entry_t *entry,
+                         AVS_LIST(anjay_observe_resource_value_t) *out_value) {
+    value_header_t header;
+    memset(&header, 0, sizeof(header));
+    int retval = handle_value_header(ctx, &header);
+    if (retval) {
+        return retval;
+    }
+    if (!(*out_value = _anjay_observe_create_resource_value(
+                  observe, &header.details, entry, &header.identity,
+                  header.numeric, NULL, header.value_length))) {
+        return -1;
+    }
+    (*out_value)->timestamp = header.timestamp;
+    (*out_value)->digest = header.digest;
+    (*out_value)->digest_only = header.digest_only;
+    return avs_persistence_bytes(ctx, (*out_value)->value,
+                                 header.value_length);
+}
+
+static int persist_entry(avs_persistence_context_t *ctx,
+                         anjay_observe_entry_t *entry) {
+    anjay_observe_key_t key = entry->key;
+    avs_time_real_t last_confirmable = entry->last_confirmable;
+    int retval;
+    (void) ((retval = handle_observe_key(ctx, &key))
+            || (retval = handle_timestamp(ctx, &last_confirmable))
+            || (retval = persist_value(ctx, entry->last_sent)));
+    return retval;
+}
+
+static int restore_entry(avs_persistence_context_t *ctx,
+                         anjay_observe_state_t *observe,
+                         anjay_observe_connection_entry_t *conn) {
+    anjay_observe_key_t key;
+    memset(&key, 0, sizeof(key));
+    key.connection = conn->key;
+    avs_time_real_t last_confirmable = AVS_TIME_REAL_INVALID;
+    int retval;
+    if ((retval = handle_observe_key(ctx, &key))
+            || (retval = handle_timestamp(ctx, &last_confirmable))) {
+        return retval;
+    }
+
+    AVS_RBTREE_ELEM(anjay_observe_entry_t) entry =
+            AVS_RBTREE_ELEM_NEW(anjay_observe_entry_t);
+    if (!entry) {
+        persistence_log(ERROR, "Out of memory");
+        return -1;
+    }
+    memcpy((void *) (intptr_t) (const void *) &entry->key, &key, sizeof(key));
+    if (AVS_RBTREE_INSERT(conn->entries, entry) != entry) {
+        persistence_log(ERROR, "Duplicate observation entry");
+        AVS_RBTREE_ELEM_DELETE_DETACHED(&entry);
+        return -1;
+    }
+    entry->last_confirmable = last_confirmable;
+    return restore_value(ctx, observe, entry, &entry->last_sent);
+}
+
+static int persist_unsent_value(avs_persistence_context_t *ctx,
+                                anjay_observe_resource_value_t *value) {
+    anjay_observe_key_t key = value->ref->key;
+    int retval;
+    (void) ((retval = handle_observe_key(ctx, &key))
+            || (retval = persist_value(ctx, value)));
+    return retval;
+}
+
+static int restore_unsent_value(avs_persistence_context_t *ctx,
+                                anjay_observe_state_t *observe,
+                                anjay_observe_connection_entry_t *conn) {
+    anjay_observe_key_t key;
+    memset(&key, 0, sizeof(key));
+    key.connection = conn->key;
+    int retval = handle_observe_key(ctx, &key);
+    if (retval) {
+        return retval;
+    }
+
+    AVS_RBTREE_ELEM(anjay_observe_entry_t) entry =
+            AVS_RBTREE_FIND(conn->entries, _anjay_observe_entry_query(&key));
+    if (!entry) {
+        persistence_log(ERROR, "Queued notification for unknown observation");
+        return -1;
+    }
+
+    AVS_LIST(anjay_observe_resource_value_t) value = NULL;
+    retval = restore_value(ctx, observe, entry, &value);
+    if (value) {
+        if (conn->unsent_last) {
+            AVS_LIST_INSERT(AVS_LIST_NEXT_PTR(&conn->unsent_last), value);
+        } else {
+            conn->unsent = value;
+        }
+        conn->unsent_last = value;
+        entry->last_unsent = value;
+        _anjay_observe_unsent_value_added(observe, conn, value);
+    }
+    return retval;
+}
+
+static int persist_connection(avs_persistence_context_t *ctx,
+                              anjay_observe_connection_entry_t *conn) {
+    anjay_connection_key_t key = conn->key;
+    uint32_t entry_count = (uint32_t) AVS_RBTREE_SIZE(conn->entries);
+    uint32_t unsent_count = (uint32_t) AVS_LIST_SIZE(conn->unsent);
+    int retval;
+    if ((retval = handle_connection_key(ctx, &key))
+            || (retval = avs_persistence_u32(ctx, &entry_count))) {
+        return retval;
+    }
+    AVS_RBTREE_ELEM(anjay_observe_entry_t) entry;
+    AVS_RBTREE_FOREACH(entry, conn->entries) {
+        if ((retval = persist_entry(ctx, entry))) {
+            return retval;
+        }
+    }
+    // values that are in flight are persisted as well; they will be sent
+    // again after restoring
+    if ((retval = avs_persistence_u32(ctx, &unsent_count))) {
+        return retval;
+    }
+    AVS_LIST(anjay_observe_resource_value_t) value;
+    AVS_LIST_FOREACH(value, conn->unsent) {
+        if ((retval = persist_unsent_value(ctx, value))) {
+            return retval;
+        }
+    }
+    return 0;
+}
+
+static int
+restore_connection(avs_persistence_context_t *ctx,
+                   anjay_observe_state_t *observe,
+                   AVS_RBTREE(anjay_observe_connection_entry_t) connections) {
+    anjay_connection_key_t key;
+    memset(&key, 0, sizeof(key));
+    uint32_t entry_count;
+    int retval;
+    if ((retval = handle_connection_key(ctx, &key))
+            || (retval = avs_persistence_u32(ctx, &entry_count))) {
+        return retval;
+    }
+    if (!entry_count) {
+        persistence_log(ERROR, "Connection entry without observations");
+        return -1;
+    }
+
+    AVS_RBTREE_ELEM(anjay_observe_connection_entry_t) conn =
+            AVS_RBTREE_ELEM_NEW(anjay_observe_connection_entry_t);
+    if (!conn
+            || !(conn->entries = AVS_RBTREE_NEW(anjay_observe_entry_t,
+                                                _anjay_observe_entry_cmp))) {
+        persistence_log(ERROR, "Out of memory");
+        AVS_RBTREE_ELEM_DELETE_DETACHED(&conn);
+        return -1;
+    }
+    conn->key = key;
+    if (AVS_RBTREE_INSERT(connections, conn) != conn) {
+        persistence_log(ERROR, "Duplicate connection entry");
+        AVS_RBTREE_DELETE(&conn->entries);
+        AVS_RBTREE_ELEM_DELETE_DETACHED(&conn);
+        return -1;
+    }
+
+    for (uint32_t i = 0; !retval && i < entry_count; ++i) {
+        retval = restore_entry(ctx, observe, conn);
+    }
+    uint32_t unsent_count;
+    if (retval || (retval = avs_persistence_u32(ctx, &unsent_count))) {
+        return retval;
+    }
+    for (uint32_t i = 0; !retval && i < unsent_count; ++i) {
+        retval = restore_unsent_value(ctx, observe, conn);
+    }
+    return retval;
+}
+
+int anjay_observe_persist(anjay_t *anjay, avs_stream_abstract_t *out_stream) {
+    assert(anjay);
+
+    int retval = avs_stream_write(out_stream, MAGIC, sizeof(MAGIC));
+    if (retval) {
+        return retval;
+    }
+    avs_persistence_context_t *ctx =
+            avs_persistence_store_context_new(out_stream);
+    if (!ctx) {
+        persistence_log(ERROR, "Out of memory");
+        return -1;
+    }
+    uint32_t conn_count =
+            (uint32_t) AVS_RBTREE_SIZE(anjay->observe.connection_entries);
+    if (!(retval = avs_persistence_u32(ctx, &conn_count))) {
+        AVS_RBTREE_ELEM(anjay_observe_connection_entry_t) conn;
+        AVS_RBTREE_FOREACH(conn, anjay->observe.connection_entries) {
+            if ((retval = persist_connection(ctx, conn))) {
+                break;
+            }
+        }
+    }
+    avs_persistence_context_delete(ctx);
+    if (!retval) {
+        persistence_log(INFO, "Observe state persisted");
+    }
+    return retval;
+}
+
+static void schedule_restored_connections(anjay_t *anjay) {
+    AVS_RBTREE_ELEM(anjay_observe_connection_entry_t) conn;
+    // queue limits might have been lower when the state was persisted;
+    // this is done only after all connections are restored, as the total
+    // limit concerns all of them
+    AVS_RBTREE_FOREACH(conn, anjay->observe.connection_entries) {
+        _anjay_observe_enforce_queue_limits(&anjay->observe, conn);
+    }
+    AVS_RBTREE_FOREACH(conn, anjay->observe.connection_entries) {
+        AVS_RBTREE_ELEM(anjay_observe_entry_t) entry;
+        AVS_RBTREE_FOREACH(entry, conn->entries) {
+            _anjay_observe_schedule_pmax_trigger(anjay, entry);
+        }
+        if (conn->unsent) {
+            _anjay_observe_sched_flush(anjay, conn->key);
+        }
+    }
+}
+
+int anjay_observe_restore(anjay_t *anjay, avs_stream_abstract_t *in_stream) {
+    assert(anjay);
+
+    char magic_header[sizeof(MAGIC)];
+    int retval = avs_stream_read_reliably(in_stream, magic_header,
+                                          sizeof(magic_header));
+    if (retval) {
+        persistence_log(ERROR, "Could not read Observe state header");
+        return retval;
+    }
+    if (memcmp(magic_header, MAGIC, sizeof(MAGIC))) {
+        persistence_log(ERROR, "Header magic constant mismatch");
+        return -1;
+    }
+
+    AVS_RBTREE(anjay_observe_connection_entry_t) restored =
+            AVS_RBTREE_NEW(anjay_observe_connection_entry_t,
+                           _anjay_observe_connection_entry_cmp);
+    if (!restored) {
+        persistence_log(ERROR, "Out of memory");
+        return -1;
+    }
+    avs_persistence_context_t *restore_ctx =
+            avs_persistence_restore_context_new(in_stream);
+    if (!restore_ctx) {
+        persistence_log(ERROR, "Cannot create persistence restore context");
+        AVS_RBTREE_DELETE(&restored);
+        return -1;
+    }
+    uint32_t conn_count;
+    if (!(retval = avs_persistence_u32(restore_ctx, &conn_count))) {
+        for (uint32_t i = 0; !retval && i < conn_count; ++i) {
+            retval = restore_connection(restore_ctx, &anjay->observe,
+                                        restored);
+        }
+    }
+    avs_persistence_context_delete(restore_ctx);
+
+    if (retval) {
+        // nothing has been scheduled for the restored entries yet
+        AVS_RBTREE_DELETE(&restored) {
+            _anjay_observe_cleanup_connection(&anjay->observe, NULL,
+                                              *restored);
+        }
+        return retval;
+    }
+
+    _anjay_observe_remove_all(anjay);
+    AVS_RBTREE(anjay_observe_connection_entry_t) old =
+            anjay->observe.connection_entries;
+    anjay->observe.connection_entries = restored;
+    AVS_RBTREE_DELETE(&old);
+
+    schedule_restored_connections(anjay);
+    persistence_log(INFO, "Observe state restored");
+    return 0;
+}
+
+#else // WITH_OBSERVE && WITH_AVS_PERSISTENCE
+
+int anjay_observe_persist(anjay_t *anjay, avs_stream_abstract_t *out_stream) {
+    (void) anjay;
+    (void) out_stream;
+    persistence_log(ERROR, "Observe persistence not compiled in");
+    return -1;
+}
+
+int anjay_observe_restore(anjay_t *anjay, avs_stream_abstract_t *in_stream) {
+    (void) anjay;
+    (void) in_stream;
+    persistence_log(ERROR, "Observe persistence not compiled in");
+    return -1;
+}
+
+#endif // WITH_OBSERVE && WITH_AVS_PERSISTENCE
@@ -20,6 +20,7 @@
 #include <math.h>
 #include <stdarg.h>
 
+#include <avsystem/commons/stream/stream_membuf.h>
 #include <avsystem/commons/unit/test.h>
 
 #include <anjay_test/dm.h>
@@ -342,6 +343,34 @@ AVS_UNIT_TEST(observe, gc) {
     DM_TEST_FINISH;
 }
 
+#ifdef WITH_AVS_PERSISTENCE
+AVS_UNIT_TEST(observe, persistence) {
+    SUCCESS_TEST(14, 69);
+
+    avs_stream_abstract_t *stream = avs_stream_membuf_create();
+    AVS_UNIT_ASSERT_NOT_NULL(stream);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_observe_persist(anjay, stream));
+
+    _anjay_observe_remove_all(anjay);
+    assert_observe_size(anjay, 0);
+
+    DM_TEST_EXPECT_READ_NULL_ATTRS(14, 69, 4);
+    DM_TEST_EXPECT_READ_NULL_ATTRS(69, 69, 4);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_observe_restore(anjay, stream));
+    assert_observe_size(anjay, 2);
+    ASSERT_SUCCESS_TEST_RESULT(14);
+    ASSERT_SUCCESS_TEST_RESULT(69);
+
+    // invalid data shall leave the current state untouched
+    AVS_UNIT_ASSERT_SUCCESS(avs_stream_write(stream, "OBS", 3));
+    AVS_UNIT_ASSERT_FAILED(anjay_observe_restore(anjay, stream));
+    assert_observe_size(anjay, 2);
+
+    avs_stream_cleanup(&stream);
+    DM_TEST_FINISH;
+}
+#endif // WITH_AVS_PERSISTENCE
+
 static void expect_read_res_attrs(anjay_t *anjay,
                                   const anjay_dm_object_def_t *const *obj_ptr,
                                   anjay_ssid_t ssid,
@@ -460,8 +489,10 @@ static void notify_max_period_test(const char *con_notify_ack,
                      CONTENT_FORMAT(PLAINTEXT), PAYLOAD("Hi!"));
     avs_unit_mocksock_expect_output(mocksocks[0], con_notify_response->content,
                                     con_notify_response->length);
-    avs_unit_mocksock_input(mocksocks[0], con_notify_ack, con_notify_ack_size);
     AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+    assert_observe_size(anjay, 1);
+    avs_unit_mocksock_input(mocksocks[0], con_notify_ack, con_notify_ack_size);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_serve(anjay, mocksocks[0]));
     assert_observe_size(anjay, observe_size_after_ack);
     if (observe_size_after_ack) {
         AVS_UNIT_ASSERT_EQUAL(
@@ -483,6 +514,181 @@ AVS_UNIT_TEST(notify, max_period) {
     notify_max_period_test("\x70\x00\x69\xEE", 4, 0); // Reset
 }
 
+AVS_UNIT_TEST(notify, cached_attrs) {
+    static const anjay_dm_internal_res_attrs_t ATTRS = {
+        .standard = {
+            .common = {
+                .min_period = 1,
+                .max_period = 10
+            },
+            .greater_than = ANJAY_ATTRIB_VALUE_NONE,
+            .less_than = ANJAY_ATTRIB_VALUE_NONE,
+            .step = ANJAY_ATTRIB_VALUE_NONE
+        }
+    };
+
+    DM_TEST_INIT_WITH_SSIDS(14);
+    anjay->observe.cache_attrs = true;
+    expect_read_res_attrs(anjay, &OBJ, 14, 69, 4, &ATTRS);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_observe_put_entry(
+            anjay,
+            &(const anjay_observe_key_t) { { 14, ANJAY_CONNECTION_UDP },
+                                           42,
+                                           69,
+                                           4,
+                                           AVS_COAP_FORMAT_NONE },
+            &(const anjay_msg_details_t) {
+                .msg_type = AVS_COAP_MSG_ACKNOWLEDGEMENT,
+                .msg_code = AVS_COAP_CODE_CONTENT,
+                .format = ANJAY_COAP_FORMAT_PLAINTEXT,
+                .observe_serial = true
+            },
+            &NULL_IDENTITY, 514.0, "514", 3));
+
+    // attributes are not read again when pmax expires
+    _anjay_mock_clock_advance(avs_time_duration_from_scalar(5, AVS_TIME_S));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+    _anjay_mock_clock_advance(avs_time_duration_from_scalar(5, AVS_TIME_S));
+    expect_read_notif_storing(anjay, &FAKE_SERVER, 14, true);
+    expect_read_res(anjay, &OBJ, 69, 4, ANJAY_MOCK_DM_STRING(0, "Hello"));
+    const avs_coap_msg_t *notify_response =
+            COAP_MSG(NON, CONTENT, ID(0x69ED), OBSERVE(0xF90000),
+                     CONTENT_FORMAT(PLAINTEXT), PAYLOAD("Hello"));
+    avs_unit_mocksock_expect_output(mocksocks[0], notify_response->content,
+                                    notify_response->length);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+    assert_observe_size(anjay, 1);
+
+    AVS_RBTREE_ELEM(anjay_observe_entry_t) entry =
+            AVS_RBTREE_FIRST(AVS_RBTREE_FIRST(anjay->observe.connection_entries)
+                                     ->entries);
+    AVS_UNIT_ASSERT_EQUAL(entry->attrs_generation,
+                          anjay->observe.attrs_generation);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_notify_instances_changed(anjay, 42));
+    AVS_UNIT_ASSERT_NOT_EQUAL(entry->attrs_generation,
+                              anjay->observe.attrs_generation);
+    DM_TEST_FINISH;
+}
+
+AVS_UNIT_TEST(notify, shared_reads) {
+    static const anjay_dm_internal_res_attrs_t ATTRS = {
+        .standard = {
+            .common = {
+                .min_period = 1,
+                .max_period = 10
+            },
+            .greater_than = ANJAY_ATTRIB_VALUE_NONE,
+            .less_than = ANJAY_ATTRIB_VALUE_NONE,
+            .step = ANJAY_ATTRIB_VALUE_NONE
+        }
+    };
+
+    DM_TEST_INIT_WITH_SSIDS(14, 34);
+    anjay->observe.share_reads = true;
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(ssids); ++i) {
+        expect_read_res_attrs(anjay, &OBJ, ssids[i], 69, 4, &ATTRS);
+        AVS_UNIT_ASSERT_SUCCESS(_anjay_observe_put_entry(
+                anjay,
+                &(const anjay_observe_key_t) { { ssids[i],
+                                                 ANJAY_CONNECTION_UDP },
+                                               42,
+                                               69,
+                                               4,
+                                               AVS_COAP_FORMAT_NONE },
+                &(const anjay_msg_details_t) {
+                    .msg_type = AVS_COAP_MSG_ACKNOWLEDGEMENT,
+                    .msg_code = AVS_COAP_CODE_CONTENT,
+                    .format = ANJAY_COAP_FORMAT_PLAINTEXT,
+                    .observe_serial = true
+                },
+                &NULL_IDENTITY, 514.0, "514", 3));
+    }
+    assert_observe_size(anjay, 2);
+
+    // the resource is read only once for both servers
+    _anjay_mock_clock_advance(avs_time_duration_from_scalar(10, AVS_TIME_S));
+    expect_read_notif_storing(anjay, &FAKE_SERVER, 14, true);
+    expect_read_res_attrs(anjay, &OBJ, 14, 69, 4, &ATTRS);
+    expect_read_res(anjay, &OBJ, 69, 4, ANJAY_MOCK_DM_STRING(0, "Hello"));
+    const avs_coap_msg_t *notify_response14 =
+            COAP_MSG(NON, CONTENT, ID(0x69ED), OBSERVE(0xF90000),
+                     CONTENT_FORMAT(PLAINTEXT), PAYLOAD("Hello"));
+    avs_unit_mocksock_expect_output(mocksocks[0], notify_response14->content,
+                                    notify_response14->length);
+    expect_read_notif_storing(anjay, &FAKE_SERVER, 34, true);
+    expect_read_res_attrs(anjay, &OBJ, 34, 69, 4, &ATTRS);
+    const avs_coap_msg_t *notify_response34 =
+            COAP_MSG(NON, CONTENT, ID(0x69EE), OBSERVE(0xF90000),
+                     CONTENT_FORMAT(PLAINTEXT), PAYLOAD("Hello"));
+    avs_unit_mocksock_expect_output(mocksocks[1], notify_response34->content,
+                                    notify_response34->length);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+    AVS_UNIT_ASSERT_NULL(anjay->observe.read_cache);
+    DM_TEST_FINISH;
+}
+
+AVS_UNIT_TEST(notify, large_value) {
+    static const anjay_dm_internal_res_attrs_t ATTRS = {
+        .standard = {
+            .common = {
+                .min_period = 1,
+                .max_period = 10
+            },
+            .greater_than = ANJAY_ATTRIB_VALUE_NONE,
+            .less_than = ANJAY_ATTRIB_VALUE_NONE,
+            .step = ANJAY_ATTRIB_VALUE_NONE
+        }
+    };
+#define LARGE_VALUE_PART "The quick brown fox jumps over the lazy dog. "
+#define LARGE_VALUE                                                         \
+    LARGE_VALUE_PART LARGE_VALUE_PART LARGE_VALUE_PART LARGE_VALUE_PART \
+            LARGE_VALUE_PART
+
+    DM_TEST_INIT_WITH_SSIDS(14);
+    expect_read_res_attrs(anjay, &OBJ, 14, 69, 4, &ATTRS);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_observe_put_entry(
+            anjay,
+            &(const anjay_observe_key_t) { { 14, ANJAY_CONNECTION_UDP },
+                                           42,
+                                           69,
+                                           4,
+                                           AVS_COAP_FORMAT_NONE },
+            &(const anjay_msg_details_t) {
+                .msg_type = AVS_COAP_MSG_ACKNOWLEDGEMENT,
+                .msg_code = AVS_COAP_CODE_CONTENT,
+                .format = ANJAY_COAP_FORMAT_PLAINTEXT,
+                .observe_serial = true
+            },
+            &NULL_IDENTITY, 514.0, "514", 3));
+
+    // the read buffer grows to accommodate the value
+    _anjay_mock_clock_advance(avs_time_duration_from_scalar(10, AVS_TIME_S));
+    expect_read_notif_storing(anjay, &FAKE_SERVER, 14, true);
+    expect_read_res_attrs(anjay, &OBJ, 14, 69, 4, &ATTRS);
+    expect_read_res(anjay, &OBJ, 69, 4, ANJAY_MOCK_DM_STRING(0, LARGE_VALUE));
+    const avs_coap_msg_t *notify_response =
+            COAP_MSG(NON, CONTENT, ID(0x69ED), OBSERVE(0xF90000),
+                     CONTENT_FORMAT(PLAINTEXT), PAYLOAD(LARGE_VALUE));
+    avs_unit_mocksock_expect_output(mocksocks[0], notify_response->content,
+                                    notify_response->length);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+    AVS_UNIT_ASSERT_EQUAL(anjay->observe.read_buffer.size,
+                          sizeof(LARGE_VALUE) - 1);
+    AVS_UNIT_ASSERT_TRUE(anjay->observe.read_buffer.capacity
+                         >= sizeof(LARGE_VALUE) - 1);
+    assert_observe(anjay, 14, 42, 69, 4, AVS_COAP_FORMAT_NONE,
+                   &(const anjay_msg_details_t) {
+                       .msg_type = AVS_COAP_MSG_NON_CONFIRMABLE,
+                       .msg_code = AVS_COAP_CODE_CONTENT,
+                       .format = ANJAY_COAP_FORMAT_PLAINTEXT,
+                       .observe_serial = true
+                   },
+                   LARGE_VALUE, sizeof(LARGE_VALUE) - 1);
+#undef LARGE_VALUE
+#undef LARGE_VALUE_PART
+    DM_TEST_FINISH;
+}
+
 AVS_UNIT_TEST(notify, min_period) {
     static const anjay_dm_internal_res_attrs_t ATTRS = {
         .standard = {
@@ -554,6 +760,79 @@ AVS_UNIT_TEST(notify, min_period) {
     DM_TEST_FINISH;
 }
 
+AVS_UNIT_TEST(notify, digests) {
+    static const anjay_dm_internal_res_attrs_t ATTRS = {
+        .standard = {
+            .common = {
+                .min_period = 10,
+                .max_period = 365 * 24 * 60 * 60 // a year
+            },
+            .greater_than = ANJAY_ATTRIB_VALUE_NONE,
+            .less_than = ANJAY_ATTRIB_VALUE_NONE,
+            .step = ANJAY_ATTRIB_VALUE_NONE
+        }
+    };
+
+    ////// INITIALIZATION //////
+    DM_TEST_INIT_WITH_SSIDS(14);
+    anjay->observe.sent_value_digests = true;
+    expect_read_res_attrs(anjay, &OBJ, 14, 69, 4, &ATTRS);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_observe_put_entry(
+            anjay,
+            &(const anjay_observe_key_t) { { 14, ANJAY_CONNECTION_UDP },
+                                           42,
+                                           69,
+                                           4,
+                                           AVS_COAP_FORMAT_NONE },
+            &(const anjay_msg_details_t) {
+                .msg_type = AVS_COAP_MSG_ACKNOWLEDGEMENT,
+                .msg_code = AVS_COAP_CODE_CONTENT,
+                .format = ANJAY_COAP_FORMAT_PLAINTEXT,
+                .observe_serial = true
+            },
+            &NULL_IDENTITY, 514.0, "514", 3));
+    _anjay_mock_dm_expect_clean();
+    assert_observe_size(anjay, 1);
+
+    const anjay_observe_entry_t *entry =
+            AVS_RBTREE_FIRST(AVS_RBTREE_FIRST(anjay->observe.connection_entries)
+                                     ->entries);
+    AVS_UNIT_ASSERT_TRUE(entry->last_sent->digest_only);
+    AVS_UNIT_ASSERT_EQUAL(entry->last_sent->value_length, 0);
+
+    ////// CHANGED VALUE //////
+    _anjay_mock_clock_advance(avs_time_duration_from_scalar(10, AVS_TIME_S));
+    expect_read_res_attrs(anjay, &OBJ, 14, 69, 4, &ATTRS);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_notify_changed(anjay, 42, 69, 4));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+    expect_read_notif_storing(anjay, &FAKE_SERVER, 14, true);
+    expect_read_res_attrs(anjay, &OBJ, 14, 69, 4, &ATTRS);
+    expect_read_res(anjay, &OBJ, 69, 4, ANJAY_MOCK_DM_STRING(0, "Hi!"));
+    const avs_coap_msg_t *notify_response =
+            COAP_MSG(NON, CONTENT, ID(0x69ED), OBSERVE(0xF90000),
+                     CONTENT_FORMAT(PLAINTEXT), PAYLOAD("Hi!"));
+    avs_unit_mocksock_expect_output(mocksocks[0], notify_response->content,
+                                    notify_response->length);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+    entry = AVS_RBTREE_FIRST(
+            AVS_RBTREE_FIRST(anjay->observe.connection_entries)->entries);
+    AVS_UNIT_ASSERT_TRUE(entry->last_sent->digest_only);
+    AVS_UNIT_ASSERT_EQUAL(entry->last_sent->value_length, 0);
+
+    ////// UNCHANGED VALUE //////
+    _anjay_mock_clock_advance(avs_time_duration_from_scalar(10, AVS_TIME_S));
+    expect_read_res_attrs(anjay, &OBJ, 14, 69, 4, &ATTRS);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_notify_changed(anjay, 42, 69, 4));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+    expect_read_notif_storing(anjay, &FAKE_SERVER, 14, true);
+    expect_read_res_attrs(anjay, &OBJ, 14, 69, 4, &ATTRS);
+    expect_read_res(anjay, &OBJ, 69, 4, ANJAY_MOCK_DM_STRING(0, "Hi!"));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+    assert_observe_size(anjay, 1);
+
+    DM_TEST_FINISH;
+}
+
 AVS_UNIT_TEST(notify, confirmable) {
     ////// INITIALIZATION //////
     DM_TEST_INIT_GENERIC((DM_TEST_DEFAULT_OBJECTS), (14),
@@ -594,12 +873,153 @@ AVS_UNIT_TEST(notify, confirmable) {
                      CONTENT_FORMAT(PLAINTEXT), PAYLOAD("42"));
     avs_unit_mocksock_expect_output(mocksocks[0], notify_response->content,
                                     notify_response->length);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+
+    ////// ACKNOWLEDGEMENT //////
     const avs_coap_msg_t *notify_ack =
             COAP_MSG(ACK, EMPTY, ID(0x69ED), NO_PAYLOAD);
     avs_unit_mocksock_input(mocksocks[0], notify_ack->content,
                             notify_ack->length);
     DM_TEST_EXPECT_READ_NULL_ATTRS(14, 69, 4);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_serve(anjay, mocksocks[0]));
+
+    DM_TEST_FINISH;
+}
+
+AVS_UNIT_TEST(notify, confirmable_retransmission) {
+    ////// INITIALIZATION //////
+    DM_TEST_INIT_GENERIC((DM_TEST_DEFAULT_OBJECTS), (14),
+                         (.confirmable_notifications = true));
+    DM_TEST_EXPECT_READ_NULL_ATTRS(14, 69, 4);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_observe_put_entry(
+            anjay,
+            &(const anjay_observe_key_t) { { 14, ANJAY_CONNECTION_UDP },
+                                           42,
+                                           69,
+                                           4,
+                                           AVS_COAP_FORMAT_NONE },
+            &(const anjay_msg_details_t) {
+                .msg_type = AVS_COAP_MSG_ACKNOWLEDGEMENT,
+                .msg_code = AVS_COAP_CODE_CONTENT,
+                .format = ANJAY_COAP_FORMAT_PLAINTEXT,
+                .observe_serial = true
+            },
+            &(avs_coap_msg_identity_t) { 0, AVS_COAP_TOKEN_EMPTY }, 514.0,
+            "514", 3));
+    assert_observe_size(anjay, 1);
+
+    ////// EMPTY SCHEDULER RUN //////
+    _anjay_mock_clock_advance(avs_time_duration_from_scalar(5, AVS_TIME_S));
     AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+    assert_observe_size(anjay, 1);
+
+    ////// CONFIRMABLE NOTIFICATION //////
+    _anjay_mock_clock_advance(avs_time_duration_from_scalar(5, AVS_TIME_S));
+    DM_TEST_EXPECT_READ_NULL_ATTRS(14, 69, 4);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_notify_changed(anjay, 42, 69, 4));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+    expect_read_notif_storing(anjay, &FAKE_SERVER, 14, true);
+    DM_TEST_EXPECT_READ_NULL_ATTRS(14, 69, 4);
+    expect_read_res(anjay, &OBJ, 69, 4, ANJAY_MOCK_DM_INT(0, 42));
+    const avs_coap_msg_t *notify_response =
+            COAP_MSG(CON, CONTENT, ID(0x69ED), OBSERVE(0xF90000),
+                     CONTENT_FORMAT(PLAINTEXT), PAYLOAD("42"));
+    avs_unit_mocksock_expect_output(mocksocks[0], notify_response->content,
+                                    notify_response->length);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+
+    ////// RETRANSMISSION //////
+    // initial ACK_TIMEOUT is randomized between 2 and 3 seconds
+    _anjay_mock_clock_advance(avs_time_duration_from_scalar(3, AVS_TIME_S));
+    avs_unit_mocksock_expect_output(mocksocks[0], notify_response->content,
+                                    notify_response->length);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+    assert_observe_size(anjay, 1);
+
+    ////// ACKNOWLEDGEMENT //////
+    const avs_coap_msg_t *notify_ack =
+            COAP_MSG(ACK, EMPTY, ID(0x69ED), NO_PAYLOAD);
+    avs_unit_mocksock_input(mocksocks[0], notify_ack->content,
+                            notify_ack->length);
+    DM_TEST_EXPECT_READ_NULL_ATTRS(14, 69, 4);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_serve(anjay, mocksocks[0]));
+
+    DM_TEST_FINISH;
+}
+
+AVS_UNIT_TEST(notify, confirmable_retry_after_timeout) {
+    ////// INITIALIZATION //////
+    DM_TEST_INIT_GENERIC((DM_TEST_DEFAULT_OBJECTS), (14),
+                         (.confirmable_notifications = true));
+    DM_TEST_EXPECT_READ_NULL_ATTRS(14, 69, 4);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_observe_put_entry(
+            anjay,
+            &(const anjay_observe_key_t) { { 14, ANJAY_CONNECTION_UDP },
+                                           42,
+                                           69,
+                                           4,
+                                           AVS_COAP_FORMAT_NONE },
+            &(const anjay_msg_details_t) {
+                .msg_type = AVS_COAP_MSG_ACKNOWLEDGEMENT,
+                .msg_code = AVS_COAP_CODE_CONTENT,
+                .format = ANJAY_COAP_FORMAT_PLAINTEXT,
+                .observe_serial = true
+            },
+            &(avs_coap_msg_identity_t) { 0, AVS_COAP_TOKEN_EMPTY }, 514.0,
+            "514", 3));
+    assert_observe_size(anjay, 1);
+    anjay_observe_connection_entry_t *conn =
+            AVS_RBTREE_FIRST(anjay->observe.connection_entries);
+
+    ////// CONFIRMABLE NOTIFICATION //////
+    _anjay_mock_clock_advance(avs_time_duration_from_scalar(10, AVS_TIME_S));
+    DM_TEST_EXPECT_READ_NULL_ATTRS(14, 69, 4);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_notify_changed(anjay, 42, 69, 4));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+    expect_read_notif_storing(anjay, &FAKE_SERVER, 14, true);
+    DM_TEST_EXPECT_READ_NULL_ATTRS(14, 69, 4);
+    expect_read_res(anjay, &OBJ, 69, 4, ANJAY_MOCK_DM_INT(0, 42));
+    const avs_coap_msg_t *notify_response =
+            COAP_MSG(CON, CONTENT, ID(0x69ED), OBSERVE(0xF90000),
+                     CONTENT_FORMAT(PLAINTEXT), PAYLOAD("42"));
+    avs_unit_mocksock_expect_output(mocksocks[0], notify_response->content,
+                                    notify_response->length);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+
+    ////// TIMEOUT //////
+    const anjay_connection_key_t key = { 14, ANJAY_CONNECTION_UDP };
+    _anjay_exchange_cancel(anjay, key, 0x69ED);
+    notification_exchange_finished(anjay, key, 0x69ED, ANJAY_EXCHANGE_TIMEOUT,
+                                   NULL);
+    assert_observe_size(anjay, 1);
+    AVS_UNIT_ASSERT_EQUAL(conn->flush_failures, 1);
+    AVS_UNIT_ASSERT_NOT_NULL(conn->flush_task);
+    // the retry is delayed by ACK_TIMEOUT
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+
+    ////// RETRY //////
+    _anjay_mock_clock_advance(avs_time_duration_from_scalar(2, AVS_TIME_S));
+    expect_read_notif_storing(anjay, &FAKE_SERVER, 14, true);
+    const avs_coap_msg_t *retry_response =
+            COAP_MSG(CON, CONTENT, ID(0x69EE), OBSERVE(0xFA0000),
+                     CONTENT_FORMAT(PLAINTEXT), PAYLOAD("42"));
+    avs_unit_mocksock_expect_output(mocksocks[0], retry_response->content,
+                                    retry_response->length);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+
+    ////// ACKNOWLEDGEMENT //////
+    _anjay_mock_clock_advance(avs_time_duration_from_scalar(1, AVS_TIME_S));
+    const avs_coap_msg_t *notify_ack =
+            COAP_MSG(ACK, EMPTY, ID(0x69EE), NO_PAYLOAD);
+    avs_unit_mocksock_input(mocksocks[0], notify_ack->content,
+                            notify_ack->length);
+    DM_TEST_EXPECT_READ_NULL_ATTRS(14, 69, 4);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_serve(anjay, mocksocks[0]));
+    AVS_UNIT_ASSERT_EQUAL(conn->flush_failures, 0);
+    // time of sending, not of receiving the ACK
+    AVS_UNIT_ASSERT_EQUAL(AVS_RBTREE_FIRST(conn->entries)
+                                  ->last_confirmable.since_real_epoch.seconds,
+                          1012);
 
     DM_TEST_FINISH;
 }
@@ -1322,7 +1742,7 @@ static void test_observe_entry(anjay_t *anjay,
 
 static anjay_t *create_test_env(void) {
     anjay_t *anjay = (anjay_t *) avs_calloc(1, sizeof(anjay_t));
-    _anjay_observe_init(&anjay->observe, false);
+    _anjay_observe_init(&anjay->observe, false, false, false, false, false);
     test_observe_entry(anjay, 1, ANJAY_CONNECTION_UDP, 2, 3, 1);
     test_observe_entry(anjay, 1, ANJAY_CONNECTION_UDP, 2, 3, 2);
     test_observe_entry(anjay, 1, ANJAY_CONNECTION_UDP, 2, 9, 4);
@@ -1568,6 +1988,224 @@ AVS_UNIT_TEST(notify, storing_when_inactive) {
     DM_TEST_FINISH;
 }
 
+/**
+ * Queues "Rin" and "Miku" as values of the observed resource while the server
+ * is inactive, then reactivates it and expects only "Miku" to be sent.
+ */
+static void expect_only_newest_value_sent(anjay_t *anjay,
+                                          avs_net_abstract_socket_t *mocksock) {
+    anjay_server_connection_t *connection =
+            _anjay_get_server_connection((const anjay_connection_ref_t) {
+                .server = anjay->servers->servers,
+                .conn_type = ANJAY_CONNECTION_UDP
+            });
+    AVS_UNIT_ASSERT_NOT_NULL(connection);
+
+    // deactivate the server
+    avs_net_abstract_socket_t *socket14 = connection->conn_socket_;
+    connection->conn_socket_ = NULL;
+    _anjay_observe_gc(anjay);
+    assert_observe_size(anjay, 1);
+
+    static const char *const VALUES[] = { "Rin", "Miku" };
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(VALUES); ++i) {
+        DM_TEST_EXPECT_READ_NULL_ATTRS(14, 69, 4);
+        AVS_UNIT_ASSERT_SUCCESS(anjay_notify_changed(anjay, 42, 69, 4));
+        AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+
+        _anjay_mock_clock_advance(
+                avs_time_duration_from_scalar(1, AVS_TIME_S));
+
+        expect_read_notif_storing(anjay, &FAKE_SERVER, 14, true);
+        DM_TEST_EXPECT_READ_NULL_ATTRS(14, 69, 4);
+        _anjay_mock_dm_expect_instance_present(anjay, &OBJ, 69, 1);
+        _anjay_mock_dm_expect_resource_present(anjay, &OBJ, 69, 4, 1);
+        _anjay_mock_dm_expect_resource_read(anjay, &OBJ, 69, 4, 0,
+                                            ANJAY_MOCK_DM_STRING(0, VALUES[i]));
+        AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+    }
+
+    // reactivate the server
+    connection->conn_socket_ = socket14;
+    _anjay_observe_gc(anjay);
+    assert_observe_size(anjay, 1);
+    anjay->current_connection.server = anjay->servers->servers;
+    anjay->current_connection.conn_type = ANJAY_CONNECTION_UDP;
+    _anjay_observe_sched_flush_current_connection(anjay);
+    memset(&anjay->current_connection, 0, sizeof(anjay->current_connection));
+
+    expect_read_notif_storing(anjay, &FAKE_SERVER, 14, true);
+    const avs_coap_msg_t *notify_response =
+            COAP_MSG(NON, CONTENT, ID(0x69ED), OBSERVE(0xF50000),
+                     CONTENT_FORMAT(PLAINTEXT), PAYLOAD("Miku"));
+    avs_unit_mocksock_expect_output(mocksock, notify_response->content,
+                                    notify_response->length);
+    DM_TEST_EXPECT_READ_NULL_ATTRS(14, 69, 4);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+}
+
+AVS_UNIT_TEST(notify, coalescing_when_inactive) {
+    SUCCESS_TEST(14);
+    anjay->observe.coalesce_notifications = true;
+    expect_only_newest_value_sent(anjay, mocksocks[0]);
+    DM_TEST_FINISH;
+}
+
+AVS_UNIT_TEST(notify, coalescing_keeps_errors) {
+    SUCCESS_TEST(14);
+    anjay->observe.coalesce_notifications = true;
+    anjay_observe_connection_entry_t *conn =
+            AVS_RBTREE_FIRST(anjay->observe.connection_entries);
+    anjay_observe_entry_t *entry = AVS_RBTREE_FIRST(conn->entries);
+    const anjay_msg_details_t details = {
+        .msg_type = AVS_COAP_MSG_NON_CONFIRMABLE,
+        .msg_code = AVS_COAP_CODE_CONTENT,
+        .format = ANJAY_COAP_FORMAT_PLAINTEXT,
+        .observe_serial = true
+    };
+
+    AVS_UNIT_ASSERT_SUCCESS(insert_error(anjay, conn, entry, &NULL_IDENTITY,
+                                         ANJAY_ERR_INTERNAL));
+    AVS_UNIT_ASSERT_SUCCESS(insert_new_value(
+            anjay, conn, entry, &details, &NULL_IDENTITY, 42.0, "42", 2));
+    // the error is not replaced
+    AVS_UNIT_ASSERT_EQUAL(conn->unsent_count, 2);
+    AVS_UNIT_ASSERT_TRUE(is_error_value(conn->unsent));
+    AVS_UNIT_ASSERT_TRUE(entry->last_unsent == conn->unsent_last);
+
+    // but the value queued after it is
+    AVS_UNIT_ASSERT_SUCCESS(insert_new_value(
+            anjay, conn, entry, &details, &NULL_IDENTITY, 43.0, "43", 2));
+    AVS_UNIT_ASSERT_EQUAL(conn->unsent_count, 2);
+    AVS_UNIT_ASSERT_TRUE(is_error_value(conn->unsent));
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(conn->unsent_last->value, "43", 2);
+    DM_TEST_FINISH;
+}
+
+AVS_UNIT_TEST(notify, queue_limit_drop_oldest) {
+    SUCCESS_TEST(14);
+    // enough for a single stored value
+    _anjay_observe_set_queue_limits(
+            &anjay->observe,
+            offsetof(anjay_observe_resource_value_t, value) + sizeof("Miku"),
+            0, ANJAY_NOTIFY_QUEUE_DROP_OLDEST);
+    expect_only_newest_value_sent(anjay, mocksocks[0]);
+
+    anjay_notify_queue_stats_t stats;
+    AVS_UNIT_ASSERT_SUCCESS(anjay_get_notify_queue_stats(anjay, 14, &stats));
+    AVS_UNIT_ASSERT_EQUAL(stats.queued_values, 0);
+    AVS_UNIT_ASSERT_EQUAL(stats.queued_bytes, 0);
+    AVS_UNIT_ASSERT_EQUAL(stats.dropped_values, 1);
+    DM_TEST_FINISH;
+}
+
+static anjay_observe_connection_entry_t *find_conn(anjay_t *anjay,
+                                                   anjay_ssid_t ssid) {
+    const anjay_connection_key_t key = { ssid, ANJAY_CONNECTION_UDP };
+    return AVS_RBTREE_FIND(anjay->observe.connection_entries,
+                           connection_query(&key));
+}
+
+static void queue_value(anjay_t *anjay,
+                        anjay_observe_connection_entry_t *conn,
+                        const char *value) {
+    static const anjay_msg_details_t DETAILS = {
+        .msg_type = AVS_COAP_MSG_NON_CONFIRMABLE,
+        .msg_code = AVS_COAP_CODE_CONTENT,
+        .format = ANJAY_COAP_FORMAT_PLAINTEXT,
+        .observe_serial = true
+    };
+    _anjay_mock_clock_advance(avs_time_duration_from_scalar(1, AVS_TIME_S));
+    AVS_UNIT_ASSERT_SUCCESS(insert_new_value(
+            anjay, conn, AVS_RBTREE_FIRST(conn->entries), &DETAILS,
+            &NULL_IDENTITY, NAN, value, strlen(value)));
+}
+
+AVS_UNIT_TEST(notify, queue_total_limit_across_connections) {
+    SUCCESS_TEST(14, 34);
+    anjay_observe_connection_entry_t *conn14 = find_conn(anjay, 14);
+    anjay_observe_connection_entry_t *conn34 = find_conn(anjay, 34);
+    // enough for two stored values
+    _anjay_observe_set_queue_limits(
+            &anjay->observe, 0,
+            2 * (offsetof(anjay_observe_resource_value_t, value) + 2),
+            ANJAY_NOTIFY_QUEUE_DROP_OLDEST);
+
+    queue_value(anjay, conn14, "Ia");
+    queue_value(anjay, conn34, "Lu");
+    queue_value(anjay, conn34, "Ka");
+
+    // the oldest value is dropped, even though it is queued for a connection
+    // other than the one that exceeded the limit
+    AVS_UNIT_ASSERT_EQUAL(conn14->unsent_count, 0);
+    AVS_UNIT_ASSERT_EQUAL(conn14->dropped_count, 1);
+    AVS_UNIT_ASSERT_EQUAL(conn34->unsent_count, 2);
+    AVS_UNIT_ASSERT_EQUAL(conn34->dropped_count, 0);
+    AVS_UNIT_ASSERT_EQUAL(anjay->observe.dropped_count, 1);
+    DM_TEST_FINISH;
+}
+
+AVS_UNIT_TEST(notify, queue_limit_keep_latest_keeps_errors) {
+    SUCCESS_TEST(14);
+    anjay->observe.coalesce_notifications = false;
+    anjay_observe_connection_entry_t *conn = find_conn(anjay, 14);
+    // enough for an error and a single stored value
+    _anjay_observe_set_queue_limits(
+            &anjay->observe,
+            2 * offsetof(anjay_observe_resource_value_t, value) + 2, 0,
+            ANJAY_NOTIFY_QUEUE_KEEP_LATEST_PER_PATH);
+
+    AVS_UNIT_ASSERT_SUCCESS(insert_error(anjay, conn,
+                                         AVS_RBTREE_FIRST(conn->entries),
+                                         &NULL_IDENTITY, ANJAY_ERR_INTERNAL));
+    queue_value(anjay, conn, "Lu");
+    queue_value(anjay, conn, "Ka");
+
+    // the error has been superseded, but it is never dropped
+    AVS_UNIT_ASSERT_EQUAL(conn->unsent_count, 2);
+    AVS_UNIT_ASSERT_TRUE(is_error_value(conn->unsent));
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(conn->unsent_last->value, "Ka", 2);
+    AVS_UNIT_ASSERT_EQUAL(conn->dropped_count, 1);
+    DM_TEST_FINISH;
+}
+
+#ifdef WITH_AVS_PERSISTENCE
+AVS_UNIT_TEST(notify, persistence_of_queued_values) {
+    SUCCESS_TEST(14);
+    anjay->observe.coalesce_notifications = false;
+    queue_value(anjay, find_conn(anjay, 14), "Ia");
+    queue_value(anjay, find_conn(anjay, 14), "Lu");
+    queue_value(anjay, find_conn(anjay, 14), "Ka");
+
+    avs_stream_abstract_t *stream = avs_stream_membuf_create();
+    AVS_UNIT_ASSERT_NOT_NULL(stream);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_observe_persist(anjay, stream));
+    _anjay_observe_remove_all(anjay);
+    assert_observe_size(anjay, 0);
+
+    // enough for two stored values, i.e. less than has been persisted
+    _anjay_observe_set_queue_limits(
+            &anjay->observe,
+            2 * (offsetof(anjay_observe_resource_value_t, value) + 2), 0,
+            ANJAY_NOTIFY_QUEUE_DROP_OLDEST);
+    DM_TEST_EXPECT_READ_NULL_ATTRS(14, 69, 4);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_observe_restore(anjay, stream));
+    assert_observe_size(anjay, 1);
+
+    anjay_observe_connection_entry_t *conn = find_conn(anjay, 14);
+    AVS_UNIT_ASSERT_EQUAL(conn->unsent_count, 2);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(conn->unsent->value, "Lu", 2);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(conn->unsent_last->value, "Ka", 2);
+    AVS_UNIT_ASSERT_TRUE(AVS_RBTREE_FIRST(conn->entries)->last_unsent
+                         == conn->unsent_last);
+    AVS_UNIT_ASSERT_EQUAL(anjay->observe.unsent_count, 2);
+    AVS_UNIT_ASSERT_EQUAL(anjay->observe.dropped_count, 1);
+
+    avs_stream_cleanup(&stream);
+    DM_TEST_FINISH;
+}
+#endif // WITH_AVS_PERSISTENCE
+
 AVS_UNIT_TEST(notify, no_storing_when_disabled) {
     SUCCESS_TEST(14, 34);
     anjay_server_connection_t *connection =
@@ -1796,10 +2434,12 @@ AVS_UNIT_TEST(notify, storing_of_errors) {
             COAP_MSG(CON, INTERNAL_SERVER_ERROR, ID(0x69EE), NO_PAYLOAD);
     avs_unit_mocksock_expect_output(mocksocks[0], con_notify_response->content,
                                     con_notify_response->length);
+    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+    assert_observe_size(anjay, 1);
     const avs_coap_msg_t *con_ack =
             COAP_MSG(ACK, EMPTY, ID(0x69EE), NO_PAYLOAD);
     avs_unit_mocksock_input(mocksocks[0], con_ack->content, con_ack->length);
-    AVS_UNIT_ASSERT_SUCCESS(anjay_sched_run(anjay));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_serve(anjay, mocksocks[0]));
 
     // now the notification shall be gone
     assert_observe_size(anjay, 0);
@@ -0,0 +1,545 @@
+/*
+ * Copyright 2017-2018 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <anjay_config.h>
+
+#ifdef WITH_AVS_PERSISTENCE
+
+#    include <assert.h>
+#    include <string.h>
+
+#    include <avsystem/commons/stream/stream_inbuf.h>
+#    include <avsystem/commons/stream_v_table.h>
+#    include <avsystem/commons/utils.h>
+
+#    include <anjay_modules/persistence_journal.h>
+
+#    include "utils_core.h"
+
+VISIBILITY_SOURCE_BEGIN
+
+static const char JOURNAL_MAGIC[] = { 'A', 'J', 'N', 'L' };
+
+#    define JOURNAL_HEADER_SIZE \
+        (sizeof(JOURNAL_MAGIC) + sizeof(anjay_journal_magic_t))
+
+/* type + key + size */
+#    define RECORD_HEADER_SIZE 9
+/* header + checksum */
+#    define RECORD_OVERHEAD (RECORD_HEADER_SIZE + 4)
+
+/* anything bigger is considered a damaged record */
+#    define MAX_PAYLOAD_SIZE (1024 * 1024)
+
+#    define BUFFER_INITIAL_CAPACITY 64
+
+typedef enum {
+    RECORD_PUT = 'P',
+    RECORD_DELETE = 'D',
+    RECORD_COMMIT = 'C'
+} record_type_t;
+
+#    define FNV_OFFSET_BASIS UINT64_C(14695981039346656037)
+#    define FNV_PRIME UINT64_C(1099511628211)
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *) data;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint32_t record_checksum(const uint8_t *header,
+                                const void *payload,
+                                uint32_t size) {
+    uint64_t hash = fnv1a(FNV_OFFSET_BASIS, header, RECORD_HEADER_SIZE);
+    hash = fnv1a(hash, payload, size);
+    return (uint32_t) (hash ^ (hash >> 32));
+}
+
+static void encode_record_header(uint8_t *out_header,
+                                 record_type_t type,
+                                 uint32_t key,
+                                 uint32_t size) {
+    const uint32_t key_be = avs_convert_be32(key);
+    const uint32_t size_be = avs_convert_be32(size);
+    out_header[0] = (uint8_t) type;
+    memcpy(&out_header[1], &key_be, sizeof(key_be));
+    memcpy(&out_header[5], &size_be, sizeof(size_be));
+}
+
+//// WRITING ///////////////////////////////////////////////////////////////////
+
+typedef struct {
+    const avs_stream_v_table_t *const vtable;
+    anjay_journal_writer_t *writer;
+} buffer_stream_t;
+
+static int buffer_reserve(anjay_journal_writer_t *writer, size_t size) {
+    if (size > MAX_PAYLOAD_SIZE) {
+        anjay_log(ERROR, "journal record too large, the limit is %u bytes",
+                  (unsigned) MAX_PAYLOAD_SIZE);
+        return -1;
+    }
+    if (size <= writer->buffer_capacity) {
+        return 0;
+    }
+    size_t new_capacity = writer->buffer_capacity ? writer->buffer_capacity
+                                                  : BUFFER_INITIAL_CAPACITY;
+    while (new_capacity < size) {
+        new_capacity *= 2;
+    }
+    char *new_buffer = (char *) avs_realloc(writer->buffer, new_capacity);
+    if (!new_buffer) {
+        anjay_log(ERROR, "Out of memory");
+        return -1;
+    }
+    writer->buffer = new_buffer;
+    writer->buffer_capacity = new_capacity;
+    return 0;
+}
+
+static int buffer_stream_write(avs_stream_abstract_t *stream,
+                               const void *data,
+                               size_t *data_length) {
+    anjay_journal_writer_t *writer = ((buffer_stream_t *) stream)->writer;
+    if (*data_length > MAX_PAYLOAD_SIZE - writer->buffer_size
+            || buffer_reserve(writer, writer->buffer_size + *data_length)) {
+        return -1;
+    }
+    if (*data_length) {
+        memcpy(writer->buffer + writer->buffer_size, data, *data_length);
+        writer->buffer_size += *data_length;
+    }
+    return 0;
+}
+
+static int buffer_stream_noop(avs_stream_abstract_t *stream) {
+    (void) stream;
+    return 0;
+}
+
+static int buffer_stream_unimplemented() {
+    return -1;
+}
+
+static int serialize_element(anjay_journal_writer_t *writer,
+                             avs_persistence_handler_collection_element_t
+                                     *handler,
+                             void *element,
+                             void *user_data) {
+    static const avs_stream_v_table_extension_t extensions[] = {
+        AVS_STREAM_V_TABLE_EXTENSION_NULL
+    };
+    static const avs_stream_v_table_t vtable = {
+        buffer_stream_write,
+        buffer_stream_noop,
+        (avs_stream_read_t) buffer_stream_unimplemented,
+        (avs_stream_peek_t) buffer_stream_unimplemented,
+        (avs_stream_reset_t) buffer_stream_unimplemented,
+        buffer_stream_noop,
+        (avs_stream_errno_t) buffer_stream_unimplemented,
+        extensions
+    };
+    buffer_stream_t stream = {
+        .vtable = &vtable,
+        .writer = writer
+    };
+    writer->buffer_size = 0;
+    avs_persistence_context_t *ctx = avs_persistence_store_context_new(
+            (avs_stream_abstract_t *) &stream);
+    if (!ctx) {
+        anjay_log(ERROR, "Out of memory");
+        return -1;
+    }
+    int result = handler(ctx, element, user_data);
+    avs_persistence_context_delete(ctx);
+    return result;
+}
+
+static int write_record(anjay_journal_writer_t *writer,
+                        record_type_t type,
+                        uint32_t key,
+                        const void *payload,
+                        uint32_t size) {
+    uint8_t header[RECORD_HEADER_SIZE];
+    encode_record_header(header, type, key, size);
+    const uint32_t checksum_be =
+            avs_convert_be32(record_checksum(header, payload, size));
+    int result;
+    (void) ((result = avs_stream_write(writer->stream, header, sizeof(header)))
+            || (size
+                && (result = avs_stream_write(writer->stream, payload, size)))
+            || (result = avs_stream_write(writer->stream, &checksum_be,
+                                          sizeof(checksum_be))));
+    if (!result) {
+        writer->bytes_written += RECORD_OVERHEAD + size;
+    }
+    return result;
+}
+
+static int write_deletes_until(anjay_journal_writer_t *writer,
+                               int64_t key_limit) {
+    while (writer->old_digest
+           && (key_limit < 0 || writer->old_digest->key < key_limit)) {
+        int result = write_record(writer, RECORD_DELETE,
+                                  writer->old_digest->key, NULL, 0);
+        if (result) {
+            return result;
+        }
+        AVS_LIST_ADVANCE(&writer->old_digest);
+    }
+    return 0;
+}
+
+int _anjay_journal_writer_init(anjay_journal_writer_t *writer,
+                               anjay_journal_t *journal,
+                               avs_stream_abstract_t *stream,
+                               const anjay_journal_magic_t magic,
+                               bool compact) {
+    memset(writer, 0, sizeof(*writer));
+    writer->journal = journal;
+    writer->stream = stream;
+    writer->compact = compact;
+    writer->last_key = -1;
+    writer->new_digests_tail = &writer->new_digests;
+    if (!compact) {
+        if (!journal->valid) {
+            anjay_log(ERROR, "journal needs to be compacted before appending");
+            return -1;
+        }
+        writer->old_digest = journal->digests;
+        return 0;
+    }
+    int result;
+    (void) ((result = avs_stream_write(stream, JOURNAL_MAGIC,
+                                       sizeof(JOURNAL_MAGIC)))
+            || (result = avs_stream_write(stream, magic,
+                                          sizeof(anjay_journal_magic_t))));
+    if (!result) {
+        writer->bytes_written = JOURNAL_HEADER_SIZE;
+    }
+    return result;
+}
+
+int _anjay_journal_writer_put(anjay_journal_writer_t *writer,
+                              uint32_t key,
+                              avs_persistence_handler_collection_element_t
+                                      *handler,
+                              void *element,
+                              void *user_data) {
+    if ((int64_t) key <= writer->last_key) {
+        anjay_log(ERROR, "journal elements not sorted by key");
+        return -1;
+    }
+    writer->last_key = key;
+
+    AVS_LIST(anjay_journal_digest_t) digest =
+            AVS_LIST_NEW_ELEMENT(anjay_journal_digest_t);
+    if (!digest) {
+        anjay_log(ERROR, "Out of memory");
+        return -1;
+    }
+    int result;
+    if ((result = serialize_element(writer, handler, element, user_data))
+            || (result = write_deletes_until(writer, key))) {
+        AVS_LIST_DELETE(&digest);
+        return result;
+    }
+    digest->key = key;
+    digest->record_size = (uint32_t) (RECORD_OVERHEAD + writer->buffer_size);
+    digest->payload_hash =
+            fnv1a(FNV_OFFSET_BASIS, writer->buffer, writer->buffer_size);
+
+    const bool unchanged = writer->old_digest
+                           && writer->old_digest->key == key
+                           && writer->old_digest->record_size
+                                      == digest->record_size
+                           && writer->old_digest->payload_hash
+                                      == digest->payload_hash;
+    if (writer->old_digest && writer->old_digest->key == key) {
+        AVS_LIST_ADVANCE(&writer->old_digest);
+    }
+    if (!unchanged
+            && (result = write_record(writer, RECORD_PUT, key, writer->buffer,
+                                      (uint32_t) writer->buffer_size))) {
+        AVS_LIST_DELETE(&digest);
+        return result;
+    }
+    writer->compacted_size += digest->record_size;
+    AVS_LIST_INSERT(writer->new_digests_tail, digest);
+    AVS_LIST_ADVANCE_PTR(&writer->new_digests_tail);
+    return 0;
+}
+
+int _anjay_journal_writer_finish(anjay_journal_writer_t *writer, int result) {
+    anjay_journal_t *journal = writer->journal;
+    if (!result && !writer->compact) {
+        result = write_deletes_until(writer, -1);
+    }
+    if (!result && (writer->compact || writer->bytes_written)) {
+        // batches are only written if anything has actually changed, so that
+        // persisting an unmodified state does not touch the storage at all
+        result = write_record(writer, RECORD_COMMIT, 0, NULL, 0);
+    }
+    if (!result) {
+        AVS_LIST_CLEAR(&journal->digests);
+        journal->digests = writer->new_digests;
+        if (writer->compact) {
+            journal->size = writer->bytes_written;
+        } else {
+            journal->size += writer->bytes_written;
+        }
+        journal->compacted_size = JOURNAL_HEADER_SIZE + writer->compacted_size
+                                  + RECORD_OVERHEAD;
+        journal->valid = true;
+    } else {
+        AVS_LIST_CLEAR(&writer->new_digests);
+        if (!writer->compact) {
+            journal->valid = false;
+        }
+    }
+    avs_free(writer->buffer);
+    memset(writer, 0, sizeof(*writer));
+    return result;
+}
+
+//// RESTORING /////////////////////////////////////////////////////////////////
+
+typedef struct {
+    uint32_t key;
+    uint32_t size;
+    bool is_delete;
+    char payload[];
+} journal_record_t;
+
+typedef enum {
+    RR_SUCCESS,
+    RR_EOF,
+    RR_DAMAGED,
+    RR_ERROR
+} read_record_result_t;
+
+static read_record_result_t read_type_or_eof(avs_stream_abstract_t *stream,
+                                             uint8_t *out_type) {
+    size_t bytes_read = 0;
+    char message_finished = 0;
+    while (!bytes_read && !message_finished) {
+        if (avs_stream_read(stream, &bytes_read, &message_finished, out_type,
+                            1)) {
+            return RR_DAMAGED;
+        }
+    }
+    return bytes_read ? RR_SUCCESS : RR_EOF;
+}
+
+static read_record_result_t read_record(avs_stream_abstract_t *stream,
+                                        uint8_t *out_type,
+                                        AVS_LIST(journal_record_t) *out_record,
+                                        size_t *out_record_size) {
+    uint8_t header[RECORD_HEADER_SIZE];
+    read_record_result_t result = read_type_or_eof(stream, &header[0]);
+    if (result != RR_SUCCESS) {
+        return result;
+    }
+    uint32_t key;
+    uint32_t size;
+    if (avs_stream_read_reliably(stream, &header[1], sizeof(header) - 1)) {
+        return RR_DAMAGED;
+    }
+    memcpy(&key, &header[1], sizeof(key));
+    memcpy(&size, &header[5], sizeof(size));
+    key = avs_convert_be32(key);
+    size = avs_convert_be32(size);
+    *out_type = header[0];
+    if (size > MAX_PAYLOAD_SIZE
+            || (*out_type != RECORD_PUT && *out_type != RECORD_DELETE
+                && *out_type != RECORD_COMMIT)
+            || (*out_type != RECORD_PUT && size)) {
+        return RR_DAMAGED;
+    }
+
+    AVS_LIST(journal_record_t) record = (AVS_LIST(journal_record_t))
+            AVS_LIST_NEW_BUFFER(sizeof(journal_record_t) + size);
+    if (!record) {
+        anjay_log(ERROR, "Out of memory");
+        return RR_ERROR;
+    }
+    record->key = key;
+    record->size = size;
+    record->is_delete = (*out_type == RECORD_DELETE);
+
+    uint32_t checksum;
+    if ((size && avs_stream_read_reliably(stream, record->payload, size))
+            || avs_stream_read_reliably(stream, &checksum, sizeof(checksum))
+            || avs_convert_be32(checksum)
+                           != record_checksum(header, record->payload, size)) {
+        AVS_LIST_DELETE(&record);
+        return RR_DAMAGED;
+    }
+    *out_record = record;
+    *out_record_size = RECORD_OVERHEAD + size;
+    return RR_SUCCESS;
+}
+
+/**
+ * Applies the records of a committed batch to the state image, which is kept
+ * sorted by key. Put records are moved to the image, delete records are freed.
+ */
+static void apply_batch(AVS_LIST(journal_record_t) *image_ptr,
+                        AVS_LIST(journal_record_t) *batch_ptr) {
+    while (*batch_ptr) {
+        AVS_LIST(journal_record_t) record = AVS_LIST_DETACH(batch_ptr);
+        AVS_LIST(journal_record_t) *it = image_ptr;
+        while (*it && (*it)->key < record->key) {
+            AVS_LIST_ADVANCE_PTR(&it);
+        }
+        if (*it && (*it)->key == record->key) {
+            AVS_LIST_DELETE(it);
+        }
+        if (record->is_delete) {
+            AVS_LIST_DELETE(&record);
+        } else {
+            AVS_LIST_INSERT(it, record);
+        }
+    }
+}
+
+static int read_journal(avs_stream_abstract_t *stream,
+                        const anjay_journal_magic_t magic,
+                        AVS_LIST(journal_record_t) *out_image,
+                        size_t *out_size,
+                        bool *out_damaged) {
+    char header[JOURNAL_HEADER_SIZE];
+    if (avs_stream_read_reliably(stream, header, sizeof(header))) {
+        anjay_log(ERROR, "Could not read journal header");
+        return -1;
+    }
+    if (memcmp(header, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC))
+            || memcmp(header + sizeof(JOURNAL_MAGIC), magic,
+                      sizeof(anjay_journal_magic_t))) {
+        anjay_log(ERROR, "Journal header magic constant mismatch");
+        return -1;
+    }
+    *out_size = JOURNAL_HEADER_SIZE;
+
+    AVS_LIST(journal_record_t) batch = NULL;
+    AVS_LIST(journal_record_t) *batch_tail = &batch;
+    size_t batch_size = 0;
+    read_record_result_t result;
+    while (true) {
+        uint8_t type;
+        AVS_LIST(journal_record_t) record = NULL;
+        size_t record_size;
+        result = read_record(stream, &type, &record, &record_size);
+        if (result != RR_SUCCESS) {
+            break;
+        }
+        batch_size += record_size;
+        if (type == RECORD_COMMIT) {
+            AVS_LIST_DELETE(&record);
+            apply_batch(out_image, &batch);
+            batch_tail = &batch;
+            *out_size += batch_size;
+            batch_size = 0;
+        } else {
+            AVS_LIST_INSERT(batch_tail, record);
+            AVS_LIST_ADVANCE_PTR(&batch_tail);
+        }
+    }
+    AVS_LIST_CLEAR(&batch);
+    if (result == RR_ERROR) {
+        return -1;
+    }
+    *out_damaged = (result == RR_DAMAGED || batch_size);
+    return 0;
+}
+
+static int restore_element(journal_record_t *record,
+                           anjay_journal_restore_handler_t *handler,
+                           void *user_data) {
+    avs_stream_inbuf_t inbuf = AVS_STREAM_INBUF_STATIC_INITIALIZER;
+    avs_stream_inbuf_set_buffer(&inbuf, record->payload, record->size);
+    avs_persistence_context_t *ctx = avs_persistence_restore_context_new(
+            (avs_stream_abstract_t *) &inbuf);
+    if (!ctx) {
+        anjay_log(ERROR, "Out of memory");
+        return -1;
+    }
+    int result = handler(ctx, record->key, user_data);
+    avs_persistence_context_delete(ctx);
+    return result;
+}
+
+int _anjay_journal_restore(anjay_journal_t *out_journal,
+                           avs_stream_abstract_t *stream,
+                           const anjay_journal_magic_t magic,
+                           anjay_journal_restore_handler_t *handler,
+                           void *user_data) {
+    assert(!out_journal->digests);
+    AVS_LIST(journal_record_t) image = NULL;
+    size_t size;
+    bool damaged = false;
+    int result = read_journal(stream, magic, &image, &size, &damaged);
+    if (result) {
+        AVS_LIST_CLEAR(&image);
+        return result;
+    }
+    if (damaged) {
+        anjay_log(WARNING, "journal has a damaged or uncommitted tail, "
+                           "it needs to be compacted");
+    }
+
+    AVS_LIST(anjay_journal_digest_t) *digests_tail = &out_journal->digests;
+    size_t compacted_size = JOURNAL_HEADER_SIZE + RECORD_OVERHEAD;
+    AVS_LIST(journal_record_t) record;
+    AVS_LIST_FOREACH(record, image) {
+        AVS_LIST(anjay_journal_digest_t) digest =
+                AVS_LIST_NEW_ELEMENT(anjay_journal_digest_t);
+        if (!digest) {
+            anjay_log(ERROR, "Out of memory");
+            result = -1;
+            break;
+        }
+        digest->key = record->key;
+        digest->record_size = (uint32_t) (RECORD_OVERHEAD + record->size);
+        digest->payload_hash =
+                fnv1a(FNV_OFFSET_BASIS, record->payload, record->size);
+        AVS_LIST_INSERT(digests_tail, digest);
+        AVS_LIST_ADVANCE_PTR(&digests_tail);
+        compacted_size += digest->record_size;
+
+        if ((result = restore_element(record, handler, user_data))) {
+            break;
+        }
+    }
+    AVS_LIST_CLEAR(&image);
+    if (result) {
+        _anjay_journal_cleanup(out_journal);
+    } else {
+        out_journal->size = size;
+        out_journal->compacted_size = compacted_size;
+        out_journal->valid = !damaged;
+    }
+    return result;
+}
+
+#    ifdef ANJAY_TEST
+#        include "test/persistence_journal.c"
+#    endif // ANJAY_TEST
+
+#endif // WITH_AVS_PERSISTENCE
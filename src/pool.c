@@ -0,0 +1,112 @@
+/*
+ * Copyright 2017-2018 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <anjay_config.h>
+
+#include <assert.h>
+#include <string.h>
+
+#include "pool.h"
+#include "utils_core.h"
+
+VISIBILITY_SOURCE_BEGIN
+
+#define pool_log(...) _anjay_log(anjay_pool, __VA_ARGS__)
+
+int _anjay_pool_init(anjay_pool_t *pool,
+                     size_t block_size,
+                     size_t block_count) {
+    memset(pool, 0, sizeof(*pool));
+    pool->stats.block_size = block_size;
+    pool->stats.block_count = block_count;
+    for (size_t i = 0; i < block_count; ++i) {
+        AVS_LIST(avs_max_align_t) block =
+                (avs_max_align_t *) AVS_LIST_NEW_BUFFER(block_size);
+        if (!block) {
+            pool_log(ERROR, "Could not preallocate memory pool");
+            _anjay_pool_cleanup(pool);
+            return -1;
+        }
+        AVS_LIST_INSERT(&pool->free_blocks, block);
+        ++pool->free_count;
+    }
+    return 0;
+}
+
+void _anjay_pool_cleanup(anjay_pool_t *pool) {
+    assert(!pool->stats.blocks_in_use);
+    AVS_LIST_CLEAR(&pool->free_blocks);
+    memset(pool, 0, sizeof(*pool));
+}
+
+static void update_usage(anjay_pool_t *pool) {
+    ++pool->stats.blocks_in_use;
+    if (pool->stats.blocks_in_use > pool->stats.high_water_mark) {
+        pool->stats.high_water_mark = pool->stats.blocks_in_use;
+    }
+}
+
+void *_anjay_pool_alloc(anjay_pool_t *pool, size_t size) {
+    if (size > pool->stats.block_size) {
+        ++pool->stats.heap_fallbacks;
+        return AVS_LIST_NEW_BUFFER(size);
+    }
+
+    void *result;
+    if (pool->free_blocks) {
+        result = AVS_LIST_DETACH(&pool->free_blocks);
+        --pool->free_count;
+        memset(result, 0, pool->stats.block_size);
+    } else {
+        // allocate a full-sized block, so that it is interchangeable with
+        // the preallocated ones
+        if (!(result = AVS_LIST_NEW_BUFFER(pool->stats.block_size))) {
+            return NULL;
+        }
+        ++pool->overflow_in_use;
+        ++pool->stats.heap_fallbacks;
+        pool_log(DEBUG, "pool of %lu-byte blocks exhausted",
+                 (unsigned long) pool->stats.block_size);
+    }
+    update_usage(pool);
+    return result;
+}
+
+void _anjay_pool_free(anjay_pool_t *pool, void *element, size_t size) {
+    if (!element) {
+        return;
+    }
+    assert(!AVS_LIST_NEXT(element));
+    if (size > pool->stats.block_size) {
+        AVS_LIST_DELETE(&element);
+        return;
+    }
+
+    assert(pool->stats.blocks_in_use > 0);
+    --pool->stats.blocks_in_use;
+    if (pool->overflow_in_use) {
+        --pool->overflow_in_use;
+        AVS_LIST_DELETE(&element);
+    } else {
+        assert(pool->free_count < pool->stats.block_count);
+        AVS_LIST_INSERT(&pool->free_blocks, (avs_max_align_t *) element);
+        ++pool->free_count;
+    }
+}
+
+#ifdef ANJAY_TEST
+#    include "test/pool.c"
+#endif // ANJAY_TEST
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2017-2018 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANJAY_POOL_H
+#define ANJAY_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <avsystem/commons/list.h>
+
+#include <anjay/stats.h>
+
+VISIBILITY_PRIVATE_HEADER_BEGIN
+
+/**
+ * Fixed-size block pool. All blocks are preallocated as AVS_LIST elements
+ * during @ref _anjay_pool_init, so memory returned by @ref _anjay_pool_alloc
+ * may be freely used with AVS_LIST macros, except that it MUST be released
+ * using @ref _anjay_pool_free or @ref _anjay_pool_delete.
+ *
+ * Requests for more than <c>stats.block_size</c> bytes, as well as requests made
+ * when all blocks are in use, fall back to regular heap allocation. A
+ * zero-initialized pool is valid and always uses the heap.
+ */
+typedef struct {
+    AVS_LIST(avs_max_align_t) free_blocks;
+    size_t free_count;
+    /** Number of pool-sized blocks in use that were allocated on the heap */
+    size_t overflow_in_use;
+    anjay_pool_stats_t stats;
+} anjay_pool_t;
+
+int _anjay_pool_init(anjay_pool_t *pool, size_t block_size, size_t block_count);
+
+void _anjay_pool_cleanup(anjay_pool_t *pool);
+
+/**
+ * Allocates a zero-initialized AVS_LIST element capable of holding @p size
+ * bytes.
+ */
+void *_anjay_pool_alloc(anjay_pool_t *pool, size_t size);
+
+/**
+ * Releases a detached AVS_LIST element previously returned by
+ * @ref _anjay_pool_alloc. @p size MUST be the same value that has been passed
+ * to @ref _anjay_pool_alloc.
+ */
+void _anjay_pool_free(anjay_pool_t *pool, void *element, size_t size);
+
+/**
+ * Equivalent of AVS_LIST_DELETE for elements allocated from a pool.
+ */
+#define _anjay_pool_delete(Pool, ElementPtr, Size) \
+    _anjay_pool_free((Pool), AVS_LIST_DETACH(ElementPtr), (Size))
+
+VISIBILITY_PRIVATE_HEADER_END
+
+#endif /* ANJAY_POOL_H */
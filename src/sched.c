@@ -16,11 +16,12 @@
 
 #include <anjay_config.h>
 
+#include <assert.h>
 #include <inttypes.h>
 #include <stdbool.h>
 #include <time.h>
 
-#include <avsystem/commons/list.h>
+#include <avsystem/commons/memory.h>
 
 #include <anjay/core.h>
 
@@ -50,25 +51,138 @@ anjay_sched_t *_anjay_sched_new(anjay_t *anjay) {
     return sched;
 }
 
+#define SCHED_HEAP_INITIAL_CAPACITY 8
+
+#ifdef WITH_POOL_ALLOCATOR
+/**
+ * Default size of job data that fits in a pool block - enough for a few
+ * pointers, which covers all jobs scheduled internally by the library.
+ */
+#    define SCHED_POOL_DEFAULT_CLB_DATA_SIZE (4 * sizeof(avs_max_align_t))
+
+int _anjay_sched_init_pool(anjay_sched_t *sched,
+                           size_t block_size,
+                           size_t block_count) {
+    assert(!sched->heap_size);
+    if (!block_size) {
+        block_size = offsetof(anjay_sched_entry_t, clb_data)
+                     + SCHED_POOL_DEFAULT_CLB_DATA_SIZE;
+    }
+    return _anjay_pool_init(&sched->entry_pool, block_size, block_count);
+}
+
+const anjay_pool_stats_t *_anjay_sched_pool_stats(anjay_sched_t *sched) {
+    return &sched->entry_pool.stats;
+}
+#endif // WITH_POOL_ALLOCATOR
+
+static size_t entry_size(size_t clb_data_size) {
+    return offsetof(anjay_sched_entry_t, clb_data) + clb_data_size;
+}
+
+static void delete_entry(anjay_sched_t *sched, anjay_sched_entry_t *entry) {
+    _anjay_pool_free(&sched->entry_pool, entry,
+                     entry_size(entry->clb_data_size));
+}
+
+static bool entry_before(const anjay_sched_entry_t *a,
+                         const anjay_sched_entry_t *b) {
+    if (avs_time_monotonic_before(a->when, b->when)) {
+        return true;
+    }
+    if (avs_time_monotonic_before(b->when, a->when)) {
+        return false;
+    }
+    return a->seq < b->seq;
+}
+
+static void heap_set(anjay_sched_t *sched,
+                     size_t index,
+                     anjay_sched_entry_t *entry) {
+    sched->heap[index] = entry;
+    entry->heap_index = index;
+}
+
+static void heap_sift_up(anjay_sched_t *sched, size_t index) {
+    anjay_sched_entry_t *entry = sched->heap[index];
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (!entry_before(entry, sched->heap[parent])) {
+            break;
+        }
+        heap_set(sched, index, sched->heap[parent]);
+        index = parent;
+    }
+    heap_set(sched, index, entry);
+}
+
+static void heap_sift_down(anjay_sched_t *sched, size_t index) {
+    anjay_sched_entry_t *entry = sched->heap[index];
+    while (true) {
+        size_t child = 2 * index + 1;
+        if (child >= sched->heap_size) {
+            break;
+        }
+        if (child + 1 < sched->heap_size
+                && entry_before(sched->heap[child + 1], sched->heap[child])) {
+            ++child;
+        }
+        if (!entry_before(sched->heap[child], entry)) {
+            break;
+        }
+        heap_set(sched, index, sched->heap[child]);
+        index = child;
+    }
+    heap_set(sched, index, entry);
+}
+
+static int heap_push(anjay_sched_t *sched, anjay_sched_entry_t *entry) {
+    if (sched->heap_size >= sched->heap_capacity) {
+        size_t new_capacity = sched->heap_capacity
+                                      ? 2 * sched->heap_capacity
+                                      : SCHED_HEAP_INITIAL_CAPACITY;
+        anjay_sched_entry_t **new_heap = (anjay_sched_entry_t **) avs_realloc(
+                sched->heap, new_capacity * sizeof(*new_heap));
+        if (!new_heap) {
+            sched_log(ERROR, "Could not grow scheduler queue");
+            return -1;
+        }
+        sched->heap = new_heap;
+        sched->heap_capacity = new_capacity;
+    }
+    entry->seq = sched->next_seq++;
+    heap_set(sched, sched->heap_size++, entry);
+    heap_sift_up(sched, entry->heap_index);
+    return 0;
+}
+
+static void heap_remove(anjay_sched_t *sched, anjay_sched_entry_t *entry) {
+    size_t index = entry->heap_index;
+    assert(index < sched->heap_size && sched->heap[index] == entry);
+    anjay_sched_entry_t *last = sched->heap[--sched->heap_size];
+    if (last != entry) {
+        heap_set(sched, index, last);
+        if (index > 0 && entry_before(last, sched->heap[(index - 1) / 2])) {
+            heap_sift_up(sched, index);
+        } else {
+            heap_sift_down(sched, index);
+        }
+    }
+}
+
 static anjay_sched_entry_t *fetch_task(anjay_sched_t *sched,
                                        const avs_time_monotonic_t *now) {
-    if (sched->entries
-            && !avs_time_monotonic_before(*now, sched->entries->when)) {
-        return AVS_LIST_DETACH(&sched->entries);
+    if (sched->heap_size > 0
+            && !avs_time_monotonic_before(*now, sched->heap[0]->when)) {
+        anjay_sched_entry_t *task = sched->heap[0];
+        heap_remove(sched, task);
+        return task;
     } else {
         return NULL;
     }
 }
 
-static anjay_sched_handle_t sched_delayed(anjay_sched_t *sched,
-                                          avs_time_duration_t delay,
-                                          AVS_LIST(anjay_sched_entry_t) entry);
-
-static void execute_task(anjay_sched_t *sched,
-                         AVS_LIST(anjay_sched_entry_t) entry) {
-    /* make sure the task is detached */
-    assert(AVS_LIST_NEXT(entry) == NULL);
-
+static void execute_task(anjay_sched_t *sched, anjay_sched_entry_t *entry) {
     sched_log(TRACE, "executing task %p", (void *) entry);
 
     if (entry->handle_ptr) {
@@ -76,7 +190,7 @@ static void execute_task(anjay_sched_t *sched,
     }
 
     entry->clb(sched->anjay, &entry->clb_data);
-    AVS_LIST_DELETE(&entry);
+    delete_entry(sched, entry);
 }
 
 ssize_t _anjay_sched_run(anjay_sched_t *sched) {
@@ -100,7 +214,7 @@ ssize_t _anjay_sched_run(anjay_sched_t *sched) {
     sched_log(TRACE,
               "%lu scheduled tasks remain; next after "
               "%" PRId64 ".%09" PRId32,
-              (unsigned long) AVS_LIST_SIZE(sched->entries), delay.seconds,
+              (unsigned long) sched->heap_size, delay.seconds,
               delay.nanoseconds);
     return tasks_executed;
 }
@@ -110,46 +224,39 @@ void _anjay_sched_delete(anjay_sched_t **sched_ptr) {
         return;
     }
 
-    (*sched_ptr)->shut_down = true;
+    anjay_sched_t *sched = *sched_ptr;
+    sched->shut_down = true;
 
     /* execute any remaining tasks */
-    _anjay_sched_run(*sched_ptr);
-    AVS_LIST_CLEAR(&(*sched_ptr)->entries) {
-        if ((*sched_ptr)->entries->handle_ptr) {
-            *(*sched_ptr)->entries->handle_ptr = NULL;
+    _anjay_sched_run(sched);
+    for (size_t i = 0; i < sched->heap_size; ++i) {
+        if (sched->heap[i]->handle_ptr) {
+            *sched->heap[i]->handle_ptr = NULL;
         }
+        delete_entry(sched, sched->heap[i]);
     }
-    avs_free(*sched_ptr);
+    avs_free(sched->heap);
+    _anjay_pool_cleanup(&sched->entry_pool);
+    avs_free(sched);
     *sched_ptr = NULL;
 }
 
 static anjay_sched_handle_t insert_entry(anjay_sched_t *sched,
-                                         AVS_LIST(anjay_sched_entry_t) entry) {
-    anjay_sched_entry_t **entry_ptr = NULL;
-
-    if (!sched || sched->shut_down) {
-        sched_log(DEBUG, "scheduler already shut down");
+                                         anjay_sched_entry_t *entry) {
+    if (heap_push(sched, entry)) {
         return NULL;
     }
-
-    AVS_LIST_FOREACH_PTR(entry_ptr, &sched->entries) {
-        if (avs_time_monotonic_before(entry->when, (*entry_ptr)->when)) {
-            break;
-        }
-    }
-
-    AVS_LIST_INSERT(entry_ptr, entry);
     sched_log(TRACE, "%p inserted; %lu tasks scheduled", (void *) entry,
-              (unsigned long) AVS_LIST_SIZE(sched->entries));
+              (unsigned long) sched->heap_size);
     return entry;
 }
 
-static AVS_LIST(anjay_sched_entry_t) create_entry(anjay_sched_clb_t clb,
-                                                  const void *clb_data,
-                                                  size_t clb_data_size) {
-    AVS_LIST(anjay_sched_entry_t) entry =
-            (anjay_sched_entry_t *) AVS_LIST_NEW_BUFFER(
-                    offsetof(anjay_sched_entry_t, clb_data) + clb_data_size);
+static anjay_sched_entry_t *create_entry(anjay_sched_t *sched,
+                                         anjay_sched_clb_t clb,
+                                         const void *clb_data,
+                                         size_t clb_data_size) {
+    anjay_sched_entry_t *entry = (anjay_sched_entry_t *) _anjay_pool_alloc(
+            &sched->entry_pool, entry_size(clb_data_size));
 
     if (!entry) {
         sched_log(ERROR, "Could not allocate scheduler task");
@@ -157,6 +264,7 @@ static AVS_LIST(anjay_sched_entry_t) create_entry(anjay_sched_clb_t clb,
     }
 
     entry->clb = clb;
+    entry->clb_data_size = clb_data_size;
     if (clb_data_size) {
         memcpy(&entry->clb_data, clb_data, clb_data_size);
     }
@@ -166,7 +274,7 @@ static AVS_LIST(anjay_sched_entry_t) create_entry(anjay_sched_clb_t clb,
 
 static anjay_sched_handle_t sched_delayed(anjay_sched_t *sched,
                                           avs_time_duration_t delay,
-                                          AVS_LIST(anjay_sched_entry_t) entry) {
+                                          anjay_sched_entry_t *entry) {
     avs_time_monotonic_t sched_time = avs_time_monotonic_now();
     sched_log(TRACE, "current time %" PRId64 ".%09" PRId32,
               sched_time.since_monotonic_epoch.seconds,
@@ -198,8 +306,12 @@ int _anjay_sched(anjay_sched_t *sched,
     }
     AVS_ASSERT((!out_handle || *out_handle == NULL),
                "Dangerous non-initialized out_handle");
-    AVS_LIST(anjay_sched_entry_t) entry =
-            create_entry(clb, clb_data, clb_data_size);
+    if (!sched || sched->shut_down) {
+        sched_log(DEBUG, "scheduler already shut down");
+        return -1;
+    }
+    anjay_sched_entry_t *entry =
+            create_entry(sched, clb, clb_data, clb_data_size);
     if (!entry) {
         sched_log(ERROR, "cannot schedule task: out of memory");
         return -1;
@@ -207,7 +319,7 @@ int _anjay_sched(anjay_sched_t *sched,
     entry->handle_ptr = out_handle;
     anjay_sched_handle_t task = sched_delayed(sched, delay, entry);
     if (!task) {
-        AVS_LIST_DELETE(&entry);
+        delete_entry(sched, entry);
         return -1;
     }
     if (out_handle) {
@@ -216,12 +328,15 @@ int _anjay_sched(anjay_sched_t *sched,
     return 0;
 }
 
-static anjay_sched_entry_t **find_task_entry_ptr(anjay_sched_t *sched,
-                                                 anjay_sched_handle_t *handle) {
-    // IAR compiler does not support typeof, so AVS_LIST_FIND_PTR
-    // returns void**, which is not implicitly-convertible
-    return (AVS_LIST(anjay_sched_entry_t) *) AVS_LIST_FIND_PTR(
-            &sched->entries, *((anjay_sched_entry_t **) handle));
+static anjay_sched_entry_t *find_task_entry(anjay_sched_t *sched,
+                                            anjay_sched_handle_t *handle) {
+    // the original handle is cleared whenever the task is executed or deleted,
+    // so a non-NULL *handle always refers to an entry that is still in the heap
+    anjay_sched_entry_t *entry = (anjay_sched_entry_t *) *handle;
+    assert(entry->heap_index < sched->heap_size);
+    assert(sched->heap[entry->heap_index] == entry);
+    (void) sched;
+    return entry;
 }
 
 int _anjay_sched_del(anjay_sched_t *sched, anjay_sched_handle_t *handle) {
@@ -229,40 +344,31 @@ int _anjay_sched_del(anjay_sched_t *sched, anjay_sched_handle_t *handle) {
         return -1;
     }
     sched_log(TRACE, "canceling task %p", *handle);
-    int result = 0;
-    anjay_sched_entry_t **task_ptr = find_task_entry_ptr(sched, handle);
-    if (!task_ptr) {
-        sched_log(ERROR, "cannot delete task %p - not found", *handle);
-        AVS_UNREACHABLE("Dangling handle detected");
-        result = -1;
-    } else if (handle != (*task_ptr)->handle_ptr) {
+    anjay_sched_entry_t *task = find_task_entry(sched, handle);
+    if (handle != task->handle_ptr) {
         AVS_UNREACHABLE("Removing task via non-original handle");
-        result = -1;
-    } else {
-        if ((*task_ptr)->handle_ptr) {
-            *(*task_ptr)->handle_ptr = NULL;
-        }
-        AVS_LIST_DELETE(task_ptr);
+        return -1;
     }
-    return result;
+    heap_remove(sched, task);
+    *task->handle_ptr = NULL;
+    delete_entry(sched, task);
+    return 0;
 }
 
 int _anjay_sched_time_to_next(anjay_sched_t *sched,
                               avs_time_duration_t *delay) {
-    anjay_sched_entry_t *elem;
-    avs_time_monotonic_t now = avs_time_monotonic_now();
+    if (sched->heap_size == 0) {
+        return -1;
+    }
 
-    AVS_LIST_FOREACH(elem, sched->entries) {
-        if (delay) {
-            *delay = avs_time_monotonic_diff(elem->when, now);
-            if (avs_time_duration_less(*delay, AVS_TIME_DURATION_ZERO)) {
-                *delay = AVS_TIME_DURATION_ZERO;
-            }
+    if (delay) {
+        *delay = avs_time_monotonic_diff(sched->heap[0]->when,
+                                         avs_time_monotonic_now());
+        if (avs_time_duration_less(*delay, AVS_TIME_DURATION_ZERO)) {
+            *delay = AVS_TIME_DURATION_ZERO;
         }
-        return 0;
     }
-
-    return -1;
+    return 0;
 }
 
 #ifdef ANJAY_TEST
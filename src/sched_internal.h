@@ -17,6 +17,8 @@
 #ifndef ANJAY_SCHED_INTERNAL_H
 #define ANJAY_SCHED_INTERNAL_H
 
+#include "pool.h"
+
 VISIBILITY_PRIVATE_HEADER_BEGIN
 
 #if !(defined(ANJAY_SCHED_C) || defined(ANJAY_TEST))
@@ -26,13 +28,29 @@ VISIBILITY_PRIVATE_HEADER_BEGIN
 typedef struct {
     anjay_sched_handle_t *handle_ptr;
     avs_time_monotonic_t when;
+    /**
+     * Insertion counter value, used as a tie breaker between jobs scheduled
+     * for the same point in time, so that they are executed in FIFO order.
+     */
+    uint64_t seq;
+    /** Current position of the entry in @ref anjay_sched_struct::heap */
+    size_t heap_index;
+    size_t clb_data_size;
     anjay_sched_clb_t clb;
     avs_max_align_t clb_data;
 } anjay_sched_entry_t;
 
 struct anjay_sched_struct {
     anjay_t *anjay;
-    AVS_LIST(anjay_sched_entry_t) entries;
+    /**
+     * Binary min-heap of scheduled jobs, ordered by (when, seq). heap[0] is
+     * always the job that shall be executed first.
+     */
+    anjay_sched_entry_t **heap;
+    size_t heap_size;
+    size_t heap_capacity;
+    uint64_t next_seq;
+    anjay_pool_t entry_pool;
     bool shut_down;
 };
 
@@ -102,9 +102,26 @@ typedef struct {
     AVS_LIST(anjay_iid_t) instances;
 } anjay_dm_cache_object_t;
 
+/**
+ * Objects and Instances listed in Register and Update messages, maintained
+ * incrementally from the notify queue if
+ * anjay_configuration_t::track_registration_objects is enabled.
+ */
+typedef struct {
+    bool enabled;
+    bool valid;
+    // incremented whenever the contents of objects change; never 0
+    uint32_t generation;
+    AVS_LIST(anjay_dm_cache_object_t) objects;
+} anjay_registration_objects_t;
+
 typedef struct {
     int64_t lifetime_s;
+    // NULL if registration objects are tracked; dm_generation is used then
     AVS_LIST(anjay_dm_cache_object_t) dm;
+    // anjay_registration_objects_t::generation at the time of querying;
+    // 0 if unknown or not tracked
+    uint32_t dm_generation;
     anjay_binding_mode_t binding_mode;
 } anjay_update_parameters_t;
 
@@ -318,6 +335,10 @@ int _anjay_servers_foreach_active(anjay_t *anjay,
  *        internal structures tracking registration state are updated
  *        accordingly) - NOTE THAT THIS IS THE **ONLY** PLACE IN THE ENTIRE CODE
  *        FLOW IN WHICH THE REGISTER MESSAGE MAY BE SENT
+ *      The response to Register or Update is not waited for; the request is
+ *      retransmitted by the exchange table (see exchange.h), and the outcome is
+ *      handled by _anjay_server_on_registration_result() from a scheduler job,
+ *      just like a synchronous failure would be in the steps below.
  * 1.5. If it is a Bootstrap Server, call _anjay_bootstrap_account_prepare(),
  *      which will schedule Client-Initiated Bootstrap if applicable.
  * 1.6. If the above was a success, reset the reactivate_failed flag, the
@@ -443,7 +464,8 @@ _anjay_server_registration_info(anjay_server_info_t *server);
  * NOTE: If any of the move_* parameters are NULL, the relevant fields are NOT
  * updated, i.e., they are left untouched rather than being replaced with NULLs.
  *
- * This is called from _anjay_register() and _anjay_update_registration() to
+ * This is called after receiving a successful response to Register or Update
+ * (see registration_request_finished() in servers/register_internal.c) to
  * update the internally stored values with actual negotiated data, and from
  * _anjay_schedule_socket_update() to invalidate registration.
  */
@@ -93,18 +93,29 @@ void _anjay_server_on_refreshed(anjay_t *anjay,
         // _anjay_bootstrap_request_if_appropriate() may fail only due to
         // failure to schedule a job. Not much that we can do about it then.
     } else {
-        switch (_anjay_server_ensure_valid_registration(anjay, server)) {
-        case ANJAY_REGISTRATION_SUCCESS:
-            server->reactivate_time = AVS_TIME_REAL_INVALID;
-            server->refresh_failed = false;
-            break;
-        case ANJAY_REGISTRATION_TIMEOUT:
-            _anjay_server_on_registration_timeout(anjay, server);
-            break;
-        case ANJAY_REGISTRATION_ERROR:
-            _anjay_server_on_server_communication_error(anjay, server);
-            break;
-        }
+        _anjay_server_on_registration_result(
+                anjay, server,
+                _anjay_server_ensure_valid_registration(anjay, server));
+    }
+}
+
+void _anjay_server_on_registration_result(anjay_t *anjay,
+                                          anjay_server_info_t *server,
+                                          anjay_registration_result_t result) {
+    switch (result) {
+    case ANJAY_REGISTRATION_SUCCESS:
+        server->reactivate_time = AVS_TIME_REAL_INVALID;
+        server->refresh_failed = false;
+        break;
+    case ANJAY_REGISTRATION_TIMEOUT:
+        _anjay_server_on_registration_timeout(anjay, server);
+        break;
+    case ANJAY_REGISTRATION_ERROR:
+        _anjay_server_on_server_communication_error(anjay, server);
+        break;
+    case ANJAY_REGISTRATION_IN_PROGRESS:
+        // this function will be called again after the response arrives
+        break;
     }
 }
 
@@ -20,6 +20,7 @@
 #include <anjay_modules/time_defs.h>
 
 #include "connections.h"
+#include "register_internal.h"
 
 #include "../anjay_core.h"
 #include "../utils_core.h"
@@ -52,6 +53,15 @@ void _anjay_server_on_refreshed(anjay_t *anjay,
                                 anjay_server_info_t *server,
                                 anjay_server_connection_state_t state);
 
+/**
+ * Updates the server state according to the @p result of
+ * @ref _anjay_server_ensure_valid_registration , or of the Register or Update
+ * request it has sent - disabling the server in case of failure.
+ */
+void _anjay_server_on_registration_result(anjay_t *anjay,
+                                          anjay_server_info_t *server,
+                                          anjay_registration_result_t result);
+
 /**
  * Schedules a @ref _anjay_server_activate execution after given @p delay.
  *
@@ -193,39 +193,185 @@ int anjay_schedule_registration_update(anjay_t *anjay, anjay_ssid_t ssid) {
     return result;
 }
 
-typedef enum {
-    ANJAY_UPDATE_SUCCESS = 0,
-    ANJAY_UPDATE_NEEDS_REGISTRATION,
-    ANJAY_UPDATE_FAILED
-} anjay_update_result_t;
+typedef struct {
+    anjay_ssid_t ssid;
+    anjay_registration_result_t result;
+} registration_finished_args_t;
+
+static void registration_finished_job(anjay_t *anjay, const void *args_) {
+    const registration_finished_args_t *args =
+            (const registration_finished_args_t *) args_;
+    AVS_LIST(anjay_server_info_t) server =
+            _anjay_servers_find_active(anjay, args->ssid);
+    if (!server) {
+        return;
+    }
 
-static int registration_update_with_ctx(anjay_registration_update_ctx_t *ctx,
-                                        anjay_server_info_t *server) {
-    int retval = _anjay_update_registration(ctx);
-    switch (retval) {
-    case 0:
-        return (int) ANJAY_UPDATE_SUCCESS;
+    anjay_registration_result_t result = args->result;
+    if (result == ANJAY_REGISTRATION_SUCCESS
+            // Update may have been forced while the request was in flight
+            && (server->registration_info.update_forced
+                        ? reschedule_update_for_server(anjay, server)
+                        : _anjay_server_reschedule_update_job(anjay, server))) {
+        result = ANJAY_REGISTRATION_ERROR;
+    }
+    _anjay_server_on_registration_result(anjay, server, result);
+}
+
+static void clear_registration_request(anjay_registration_request_t *request) {
+    _anjay_update_parameters_cleanup(&request->params);
+    memset(request, 0, sizeof(*request));
+}
+
+static anjay_registration_result_t
+register_finished(anjay_t *anjay,
+                  anjay_server_info_t *server,
+                  anjay_update_parameters_t *params,
+                  anjay_exchange_result_t result,
+                  const avs_coap_msg_t *response) {
+    AVS_LIST(const anjay_string_t) endpoint_path = NULL;
+    switch (result) {
+    case ANJAY_EXCHANGE_ACKED:
+        if (_anjay_register_check_response(response, &endpoint_path)) {
+            anjay_log(ERROR, "could not register to server %u", server->ssid);
+            return ANJAY_REGISTRATION_ERROR;
+        }
+        _anjay_server_update_registration_info(server, &endpoint_path, params);
+        assert(!endpoint_path);
+        // Failure to handle Bootstrap state is not a failure of the Register
+        // operation - hence, not checking return value.
+        _anjay_bootstrap_notify_regular_connection_available(anjay);
+        return ANJAY_REGISTRATION_SUCCESS;
+
+    case ANJAY_EXCHANGE_TIMEOUT:
+        anjay_log(DEBUG, "re-registration timed out");
+        return ANJAY_REGISTRATION_TIMEOUT;
+
+    default:
+        anjay_log(DEBUG, "re-registration failed");
+        return ANJAY_REGISTRATION_ERROR;
+    }
+}
 
-    case ANJAY_REGISTRATION_UPDATE_REJECTED:
+static anjay_registration_result_t
+update_finished(anjay_t *anjay,
+                anjay_server_info_t *server,
+                anjay_update_parameters_t *params,
+                anjay_exchange_result_t result,
+                const avs_coap_msg_t *response) {
+    switch (result) {
+    case ANJAY_EXCHANGE_ACKED:
+        if (!_anjay_update_check_response(response)) {
+            _anjay_server_update_registration_info(server, NULL, params);
+            return ANJAY_REGISTRATION_SUCCESS;
+        }
+        // fall-through
+    case ANJAY_EXCHANGE_RESET:
         anjay_log(DEBUG, "update rejected for SSID = %u; needs re-registration",
                   server->ssid);
-        server->registration_info.expire_time = AVS_TIME_REAL_INVALID;
-        return (int) ANJAY_UPDATE_NEEDS_REGISTRATION;
+        break;
 
-    case AVS_COAP_CTX_ERR_TIMEOUT:
+    case ANJAY_EXCHANGE_TIMEOUT:
         anjay_log(ERROR,
                   "timeout while updating registration for "
                   "SSID==%" PRIu16 "; trying to re-register",
                   server->ssid);
-        server->registration_info.expire_time = AVS_TIME_REAL_INVALID;
-        return (int) ANJAY_UPDATE_NEEDS_REGISTRATION;
+        break;
 
     default:
         anjay_log(ERROR,
-                  "could not send registration update for "
-                  "SSID==%" PRIu16 ": %d",
-                  server->ssid, retval);
-        return (int) ANJAY_UPDATE_FAILED;
+                  "could not send registration update for SSID==%" PRIu16,
+                  server->ssid);
+        return ANJAY_REGISTRATION_ERROR;
+    }
+
+    // the expired registration makes the next refresh send Register
+    server->registration_info.expire_time = AVS_TIME_REAL_INVALID;
+    return reschedule_update_for_server(anjay, server)
+                   ? ANJAY_REGISTRATION_ERROR
+                   : ANJAY_REGISTRATION_IN_PROGRESS;
+}
+
+static void registration_request_finished(anjay_t *anjay,
+                                          anjay_connection_key_t key,
+                                          uint16_t msg_id,
+                                          anjay_exchange_result_t result,
+                                          const avs_coap_msg_t *response) {
+    AVS_LIST(anjay_server_info_t) server =
+            _anjay_servers_find_active(anjay, key.ssid);
+    if (!server
+            || server->registration_request.kind
+                           == ANJAY_REGISTRATION_REQUEST_NONE
+            || server->registration_request.msg_id != msg_id) {
+        anjay_log(TRACE, "registration request %" PRIu16 " no longer in flight",
+                  msg_id);
+        return;
+    }
+    anjay_registration_request_t request = server->registration_request;
+    memset(&server->registration_request, 0,
+           sizeof(server->registration_request));
+
+    registration_finished_args_t args = {
+        .ssid = server->ssid
+    };
+    if (request.kind == ANJAY_REGISTRATION_REQUEST_UPDATE) {
+        args.result = update_finished(anjay, server, &request.params, result,
+                                      response);
+    } else {
+        args.result = register_finished(anjay, server, &request.params, result,
+                                        response);
+    }
+    clear_registration_request(&request);
+
+    // this may be called while handling an incoming message on the server's
+    // connection, so anything that might close it is deferred
+    if (args.result != ANJAY_REGISTRATION_IN_PROGRESS) {
+        _anjay_sched_del(anjay->sched, &server->next_action_handle);
+        if (_anjay_sched_now(anjay->sched, &server->next_action_handle,
+                             registration_finished_job, &args, sizeof(args))) {
+            anjay_log(ERROR, "could not schedule registration_finished_job");
+        }
+    }
+}
+
+static int send_registration_request(anjay_t *anjay,
+                                     anjay_server_info_t *server,
+                                     anjay_registration_request_kind_t kind,
+                                     anjay_update_parameters_t *move_params) {
+    anjay_registration_request_t *request = &server->registration_request;
+    assert(request->kind == ANJAY_REGISTRATION_REQUEST_NONE);
+    request->kind = kind;
+    request->conn_type = _anjay_server_primary_conn_type(server);
+    request->session_token = _anjay_server_primary_session_token(server);
+    request->params = *move_params;
+    memset(move_params, 0, sizeof(*move_params));
+
+    // the response may be handled before returning, in which case the request
+    // is already cleared; see _anjay_register() docs
+    int result = (kind == ANJAY_REGISTRATION_REQUEST_UPDATE
+                          ? _anjay_update_registration
+                          : _anjay_register)(anjay, server, &request->params,
+                                             registration_request_finished,
+                                             &request->msg_id);
+    if (result) {
+        clear_registration_request(request);
+    } else {
+        // any forced Update is fulfilled by the request that has just been sent
+        server->registration_info.update_forced = false;
+    }
+    return result;
+}
+
+void _anjay_server_cancel_registration_request(anjay_t *anjay,
+                                               anjay_server_info_t *server) {
+    anjay_registration_request_t *request = &server->registration_request;
+    if (request->kind != ANJAY_REGISTRATION_REQUEST_NONE) {
+        const anjay_connection_key_t key = {
+            .ssid = server->ssid,
+            .type = request->conn_type
+        };
+        _anjay_exchange_cancel(anjay, key, request->msg_id);
+        clear_registration_request(request);
     }
 }
 
@@ -233,7 +379,7 @@ static int
 ensure_valid_registration_with_ctx(anjay_t *anjay,
                                    anjay_registration_update_ctx_t *ctx,
                                    anjay_server_info_t *server) {
-    anjay_update_result_t update_result;
+    anjay_registration_request_kind_t kind;
 
     if (!_anjay_server_primary_connection_valid(server)) {
         anjay_log(ERROR,
@@ -242,39 +388,21 @@ ensure_valid_registration_with_ctx(anjay_t *anjay,
                   server->ssid);
         return (int) ANJAY_REGISTRATION_ERROR;
     } else if (_anjay_server_registration_expired(server)) {
-        update_result = ANJAY_UPDATE_NEEDS_REGISTRATION;
+        kind = ANJAY_REGISTRATION_REQUEST_REGISTER;
     } else if (!_anjay_needs_registration_update(ctx)) {
-        update_result = ANJAY_UPDATE_SUCCESS;
+        return (int) ANJAY_REGISTRATION_SUCCESS;
     } else {
-        update_result =
-                (anjay_update_result_t) registration_update_with_ctx(ctx,
-                                                                     server);
+        kind = ANJAY_REGISTRATION_REQUEST_UPDATE;
     }
 
-    switch (update_result) {
-    case (int) ANJAY_UPDATE_SUCCESS:
-        return (int) ANJAY_REGISTRATION_SUCCESS;
-    case (int) ANJAY_UPDATE_NEEDS_REGISTRATION: {
-        int retval = _anjay_register(ctx);
-        if (retval == AVS_COAP_CTX_ERR_TIMEOUT) {
-            anjay_log(DEBUG, "re-registration timed out");
-            return (int) ANJAY_REGISTRATION_TIMEOUT;
-        } else if (retval) {
-            anjay_log(DEBUG, "re-registration failed");
-            return (int) ANJAY_REGISTRATION_ERROR;
-        } else {
-            // Failure to handle Bootstrap state is not a failure of the
-            // Register operation - hence, not checking return value.
-            _anjay_bootstrap_notify_regular_connection_available(anjay);
-            return (int) ANJAY_REGISTRATION_SUCCESS;
-        }
-    }
-    default:
-        AVS_UNREACHABLE("Invalid value of anjay_update_result_t");
-        // fall-through
-    case (int) ANJAY_UPDATE_FAILED:
+    if (send_registration_request(anjay, server, kind, &ctx->new_params)) {
+        anjay_log(ERROR, "could not send %s for SSID==%" PRIu16,
+                  kind == ANJAY_REGISTRATION_REQUEST_UPDATE ? "Update"
+                                                            : "Register",
+                  server->ssid);
         return (int) ANJAY_REGISTRATION_ERROR;
     }
+    return (int) ANJAY_REGISTRATION_IN_PROGRESS;
 }
 
 typedef int registration_action_t(anjay_t *anjay,
@@ -305,6 +433,19 @@ static int perform_registration_action(anjay_t *anjay,
 anjay_registration_result_t
 _anjay_server_ensure_valid_registration(anjay_t *anjay,
                                         anjay_server_info_t *server) {
+    if (server->registration_request.kind != ANJAY_REGISTRATION_REQUEST_NONE) {
+        if (_anjay_conn_session_tokens_equal(
+                    server->registration_request.session_token,
+                    _anjay_server_primary_session_token(server))) {
+            anjay_log(DEBUG,
+                      "registration request for SSID = %u already in flight",
+                      server->ssid);
+            return ANJAY_REGISTRATION_IN_PROGRESS;
+        }
+        // the request has been sent over a session that no longer exists
+        _anjay_server_cancel_registration_request(anjay, server);
+    }
+
     int result =
             perform_registration_action(anjay, server,
                                         ensure_valid_registration_with_ctx);
@@ -365,6 +506,7 @@ void _anjay_server_update_registration_info(
         move_params->dm = tmp;
 
         info->last_update_params.lifetime_s = move_params->lifetime_s;
+        info->last_update_params.dm_generation = move_params->dm_generation;
         memcpy(&info->last_update_params.binding_mode,
                &move_params->binding_mode,
                sizeof(info->last_update_params.binding_mode));
@@ -374,6 +516,5 @@ void _anjay_server_update_registration_info(
 
     info->expire_time =
             get_registration_expire_time(info->last_update_params.lifetime_s);
-    info->update_forced = false;
     info->session_token = _anjay_server_primary_session_token(server);
 }
@@ -30,7 +30,8 @@ bool _anjay_server_primary_connection_valid(anjay_server_info_t *server);
 typedef enum {
     ANJAY_REGISTRATION_SUCCESS = 0,
     ANJAY_REGISTRATION_TIMEOUT,
-    ANJAY_REGISTRATION_ERROR
+    ANJAY_REGISTRATION_ERROR,
+    ANJAY_REGISTRATION_IN_PROGRESS
 } anjay_registration_result_t;
 
 /**
@@ -39,6 +40,12 @@ typedef enum {
  * registered, does nothing - unless
  * server->data_active.registration_info.needs_update is set.
  *
+ * Register and Update requests are not waited for - after sending one, or if
+ * one is already in flight, ANJAY_REGISTRATION_IN_PROGRESS is returned, and the
+ * final result is passed to @ref _anjay_server_on_registration_result from
+ * a scheduler job once the response arrives. If an Update is rejected, the
+ * server is refreshed again to send Register instead.
+ *
  * @param anjay  Anjay object to operate on.
  * @param server Active non-bootstrap server for which to manage the
  *               registration state.
@@ -47,6 +54,13 @@ anjay_registration_result_t
 _anjay_server_ensure_valid_registration(anjay_t *anjay,
                                         anjay_server_info_t *server);
 
+/**
+ * Abandons the Register or Update request that is in flight for @p server, if
+ * any, so that its response is ignored.
+ */
+void _anjay_server_cancel_registration_request(anjay_t *anjay,
+                                               anjay_server_info_t *server);
+
 int _anjay_server_reschedule_update_job(anjay_t *anjay,
                                         anjay_server_info_t *server);
 
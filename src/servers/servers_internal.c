@@ -38,13 +38,14 @@
 
 VISIBILITY_SOURCE_BEGIN
 
-void _anjay_server_clean_active_data(const anjay_t *anjay,
+void _anjay_server_clean_active_data(anjay_t *anjay,
                                      anjay_server_info_t *server) {
     _anjay_sched_del(anjay->sched, &server->next_action_handle);
+    _anjay_server_cancel_registration_request(anjay, server);
     _anjay_connections_close(anjay, &server->connections);
 }
 
-void _anjay_server_cleanup(const anjay_t *anjay, anjay_server_info_t *server) {
+void _anjay_server_cleanup(anjay_t *anjay, anjay_server_info_t *server) {
     anjay_log(TRACE, "clear_server SSID %u", server->ssid);
 
     _anjay_server_clean_active_data(anjay, server);
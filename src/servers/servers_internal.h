@@ -48,6 +48,32 @@ struct anjay_servers_struct {
     AVS_LIST(anjay_socket_entry_t) public_sockets;
 };
 
+typedef enum {
+    ANJAY_REGISTRATION_REQUEST_NONE = 0,
+    ANJAY_REGISTRATION_REQUEST_REGISTER,
+    ANJAY_REGISTRATION_REQUEST_UPDATE
+} anjay_registration_request_kind_t;
+
+/**
+ * Register or Update request that has been sent and is waiting for the
+ * response. See _anjay_server_ensure_valid_registration() for details.
+ */
+typedef struct {
+    anjay_registration_request_kind_t kind;
+    anjay_connection_type_t conn_type;
+    uint16_t msg_id;
+    /**
+     * Session over which the request has been sent - if it changes, the
+     * request is abandoned and a new one is sent.
+     */
+    anjay_conn_session_token_t session_token;
+    /**
+     * Parameters sent in the request, which become
+     * registration_info.last_update_params after it succeeds.
+     */
+    anjay_update_parameters_t params;
+} anjay_registration_request_t;
+
 /**
  * Information about a known LwM2M server.
  *
@@ -116,6 +142,14 @@ struct anjay_server_info_struct {
      */
     anjay_registration_info_t registration_info;
 
+    /**
+     * Register or Update request that is currently in flight, if any. Its
+     * retransmissions are handled by the exchange table (see exchange.h), and
+     * the response is handled by registration_request_finished() in
+     * register_internal.c.
+     */
+    anjay_registration_request_t registration_request;
+
     /**
      * When a reactivate job is scheduled (and its handle stored in
      * next_action_handle), this field is filled with the time for which the
@@ -150,13 +184,13 @@ void _anjay_servers_internal_deregister(anjay_t *anjay,
 
 void _anjay_servers_internal_cleanup(anjay_t *anjay, anjay_servers_t *servers);
 
-void _anjay_server_clean_active_data(const anjay_t *anjay,
+void _anjay_server_clean_active_data(anjay_t *anjay,
                                      anjay_server_info_t *server);
 
 /**
  * Cleans up server data. Does not send De-Register message.
  */
-void _anjay_server_cleanup(const anjay_t *anjay, anjay_server_info_t *server);
+void _anjay_server_cleanup(anjay_t *anjay, anjay_server_info_t *server);
 
 bool _anjay_server_active(anjay_server_info_t *server);
 
@@ -563,6 +563,107 @@ AVS_UNIT_TEST(queue_mode, change) {
     DM_TEST_FINISH;
 }
 
+static void assert_registration_iids(anjay_t *anjay,
+                                     anjay_oid_t oid,
+                                     const anjay_iid_t *iids,
+                                     size_t count) {
+    AVS_LIST(anjay_dm_cache_object_t) object =
+            anjay->registration_objects.objects;
+    AVS_UNIT_ASSERT_NOT_NULL(object);
+    AVS_UNIT_ASSERT_EQUAL(object->oid, oid);
+    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(object->instances), count);
+    size_t i = 0;
+    anjay_iid_t *iid;
+    AVS_LIST_FOREACH(iid, object->instances) {
+        AVS_UNIT_ASSERT_EQUAL(*iid, iids[i++]);
+    }
+}
+
+AVS_UNIT_TEST(registration_objects, incremental) {
+    DM_TEST_INIT_WITH_OBJECTS(&OBJ);
+    (void) mocksocks;
+    anjay->registration_objects.enabled = true;
+    anjay->registration_objects.valid = true;
+
+    // unknown changes require querying the object again
+    anjay_notify_queue_t queue = NULL;
+    AVS_UNIT_ASSERT_SUCCESS(
+            _anjay_notify_queue_instance_set_unknown_change(&queue, OBJ->oid));
+    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 0, 0, 3);
+    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 1, 0, 1);
+    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 2, 0, ANJAY_IID_INVALID);
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_registration_objects_notify(anjay, queue));
+    _anjay_notify_clear_queue(&queue);
+    assert_registration_iids(anjay, OBJ->oid, (const anjay_iid_t[]) { 1, 3 },
+                             2);
+    uint32_t generation = anjay->registration_objects.generation;
+    AVS_UNIT_ASSERT_NOT_EQUAL(generation, 0);
+
+    // known changes are applied without calling the data model
+    AVS_UNIT_ASSERT_SUCCESS(
+            _anjay_notify_queue_instance_created(&queue, OBJ->oid, 2));
+    AVS_UNIT_ASSERT_SUCCESS(
+            _anjay_notify_queue_instance_removed(&queue, OBJ->oid, 3));
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_registration_objects_notify(anjay, queue));
+    assert_registration_iids(anjay, OBJ->oid, (const anjay_iid_t[]) { 1, 2 },
+                             2);
+    AVS_UNIT_ASSERT_NOT_EQUAL(anjay->registration_objects.generation,
+                              generation);
+
+    // applying the same changes again does not change anything
+    generation = anjay->registration_objects.generation;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_registration_objects_notify(anjay, queue));
+    _anjay_notify_clear_queue(&queue);
+    AVS_UNIT_ASSERT_EQUAL(anjay->registration_objects.generation, generation);
+    DM_TEST_FINISH;
+}
+
+AVS_UNIT_TEST(anjay_serve_batch, multiple_requests) {
+    DM_TEST_INIT;
+    DM_TEST_REQUEST(mocksocks[0], CON, GET, ID(0xFA3E), PATH("42", "69", "4"),
+                    NO_PAYLOAD);
+    DM_TEST_REQUEST(mocksocks[0], CON, GET, ID(0xFA3F), PATH("42", "69", "5"),
+                    NO_PAYLOAD);
+    _anjay_mock_dm_expect_instance_present(anjay, &OBJ, 69, 1);
+    _anjay_mock_dm_expect_resource_present(anjay, &OBJ, 69, 4, 1);
+    _anjay_mock_dm_expect_resource_read(anjay, &OBJ, 69, 4, 0,
+                                        ANJAY_MOCK_DM_INT(0, 514));
+    DM_TEST_EXPECT_RESPONSE(mocksocks[0], ACK, CONTENT, ID(0xFA3E),
+                            CONTENT_FORMAT(PLAINTEXT), PAYLOAD("514"));
+    _anjay_mock_dm_expect_instance_present(anjay, &OBJ, 69, 1);
+    _anjay_mock_dm_expect_resource_present(anjay, &OBJ, 69, 5, 1);
+    _anjay_mock_dm_expect_resource_read(anjay, &OBJ, 69, 5, 0,
+                                        ANJAY_MOCK_DM_INT(0, 42));
+    DM_TEST_EXPECT_RESPONSE(mocksocks[0], ACK, CONTENT, ID(0xFA3F),
+                            CONTENT_FORMAT(PLAINTEXT), PAYLOAD("42"));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_serve_batch(anjay, mocksocks[0], 2));
+    DM_TEST_FINISH;
+}
+
+AVS_UNIT_TEST(anjay_serve_batch, malformed_message_in_batch) {
+    DM_TEST_INIT;
+    DM_TEST_REQUEST(mocksocks[0], CON, GET, ID(0xFA3E), PATH("42", "69", "4"),
+                    NO_PAYLOAD);
+    avs_unit_mocksock_input(mocksocks[0], "\xFF", 1);
+    DM_TEST_REQUEST(mocksocks[0], CON, GET, ID(0xFA3F), PATH("42", "69", "5"),
+                    NO_PAYLOAD);
+    _anjay_mock_dm_expect_instance_present(anjay, &OBJ, 69, 1);
+    _anjay_mock_dm_expect_resource_present(anjay, &OBJ, 69, 4, 1);
+    _anjay_mock_dm_expect_resource_read(anjay, &OBJ, 69, 4, 0,
+                                        ANJAY_MOCK_DM_INT(0, 514));
+    DM_TEST_EXPECT_RESPONSE(mocksocks[0], ACK, CONTENT, ID(0xFA3E),
+                            CONTENT_FORMAT(PLAINTEXT), PAYLOAD("514"));
+    _anjay_mock_dm_expect_instance_present(anjay, &OBJ, 69, 1);
+    _anjay_mock_dm_expect_resource_present(anjay, &OBJ, 69, 5, 1);
+    _anjay_mock_dm_expect_resource_read(anjay, &OBJ, 69, 5, 0,
+                                        ANJAY_MOCK_DM_INT(0, 42));
+    DM_TEST_EXPECT_RESPONSE(mocksocks[0], ACK, CONTENT, ID(0xFA3F),
+                            CONTENT_FORMAT(PLAINTEXT), PAYLOAD("42"));
+    // the malformed datagram is reported, but does not stop the batch
+    AVS_UNIT_ASSERT_FAILED(anjay_serve_batch(anjay, mocksocks[0], 3));
+    DM_TEST_FINISH;
+}
+
 AVS_UNIT_TEST(anjay_new, no_endpoint_name) {
     const anjay_configuration_t configuration = {
         .endpoint_name = NULL,
@@ -18,6 +18,8 @@
 
 #include <math.h>
 
+#include <avsystem/commons/stream/stream_outbuf.h>
+#include <avsystem/commons/stream_v_table.h>
 #include <avsystem/commons/unit/mocksock.h>
 #include <avsystem/commons/unit/test.h>
 
@@ -50,6 +52,27 @@ AVS_UNIT_TEST(debug, debug_make_path_macro) {
                                  "/65535/65535/65535");
 }
 
+AVS_UNIT_TEST(dm_objects, sorted_lookup) {
+    DM_TEST_INIT;
+    AVS_UNIT_ASSERT_EQUAL(anjay->dm.objects_count, 6);
+    for (size_t i = 1; i < anjay->dm.objects_count; ++i) {
+        AVS_UNIT_ASSERT_TRUE((*anjay->dm.objects[i - 1])->oid
+                             < (*anjay->dm.objects[i])->oid);
+    }
+    AVS_UNIT_ASSERT_TRUE(_anjay_dm_find_object_by_oid(anjay, 0)
+                         == &FAKE_SECURITY);
+    AVS_UNIT_ASSERT_TRUE(_anjay_dm_find_object_by_oid(anjay, 42) == &OBJ);
+    AVS_UNIT_ASSERT_TRUE(
+            _anjay_dm_find_object_by_oid(anjay, 667)
+            == (const anjay_dm_object_def_t *const *) &OBJ_WITH_RES_OPS);
+    AVS_UNIT_ASSERT_NULL(_anjay_dm_find_object_by_oid(anjay, 2));
+    AVS_UNIT_ASSERT_NULL(_anjay_dm_find_object_by_oid(anjay, 43));
+    AVS_UNIT_ASSERT_NULL(_anjay_dm_find_object_by_oid(anjay, 1000));
+    AVS_UNIT_ASSERT_FAILED(anjay_register_object(anjay, &OBJ));
+    AVS_UNIT_ASSERT_EQUAL(anjay->dm.objects_count, 6);
+    DM_TEST_FINISH;
+}
+
 AVS_UNIT_TEST(dm_read, resource) {
     DM_TEST_INIT;
     DM_TEST_REQUEST(mocksocks[0], CON, GET, ID(0xFA3E), PATH("42", "69", "4"),
@@ -278,6 +301,91 @@ AVS_UNIT_TEST(dm_read, object_err_generic) {
     DM_TEST_FINISH;
 }
 
+AVS_UNIT_TEST(dm_read, object_precomputed_size) {
+    DM_TEST_INIT_WITH_CONFIG(.precompute_tlv_sizes = true);
+    DM_TEST_REQUEST(mocksocks[0], CON, GET, ID(0xFA3E), PATH("42"), NO_PAYLOAD);
+    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 0, 0, 3);
+    // measuring pass, then the actual one
+    for (int pass = 0; pass < 2; ++pass) {
+        _anjay_mock_dm_expect_resource_present(anjay, &OBJ, 3, 0, 1);
+        _anjay_mock_dm_expect_resource_read(anjay, &OBJ, 3, 0, 0,
+                                            ANJAY_MOCK_DM_INT(0, 514));
+        for (anjay_rid_t rid = 1; rid <= 6; ++rid) {
+            _anjay_mock_dm_expect_resource_present(anjay, &OBJ, 3, rid, 0);
+        }
+    }
+    _anjay_mock_dm_expect_instance_it(anjay, &OBJ, 1, 0, ANJAY_IID_INVALID);
+    DM_TEST_EXPECT_RESPONSE(mocksocks[0], ACK, CONTENT, ID(0xFA3E),
+                            CONTENT_FORMAT(TLV),
+                            PAYLOAD("\x04\x03\xc2\x00\x02\x02"));
+    AVS_UNIT_ASSERT_SUCCESS(anjay_serve(anjay, mocksocks[0]));
+    DM_TEST_FINISH;
+}
+
+static int setup_response_noop(avs_stream_abstract_t *stream,
+                               const anjay_msg_details_t *details) {
+    (void) stream;
+    (void) details;
+    return 0;
+}
+
+AVS_UNIT_TEST(dm_read, object_precomputed_size_streams_instance) {
+    DM_TEST_INIT_WITH_CONFIG(.precompute_tlv_sizes = true);
+
+    avs_stream_v_table_t vtable;
+    memcpy(&vtable, AVS_STREAM_OUTBUF_STATIC_INITIALIZER.vtable,
+           sizeof(vtable));
+    vtable.extension_list = &(const avs_stream_v_table_extension_t[]) {
+        {
+            .id = ANJAY_COAP_STREAM_EXTENSION,
+            .data = &(const anjay_coap_stream_ext_t) {
+                .setup_response = setup_response_noop
+            }
+        },
+        AVS_STREAM_V_TABLE_EXTENSION_NULL
+    }[0];
+    char buf[64];
+    avs_stream_outbuf_t outbuf = { &vtable, NULL, 0, 0, 0 };
+    avs_stream_outbuf_set_buffer(&outbuf, buf, sizeof(buf));
+
+    // Object reads start without a determined format, like in read_object()
+    anjay_msg_details_t details = {
+        .msg_type = AVS_COAP_MSG_ACKNOWLEDGEMENT,
+        .format = AVS_COAP_FORMAT_NONE
+    };
+    anjay_uri_path_t uri = MAKE_OBJECT_PATH(42);
+    int outctx_errno = 0;
+    anjay_output_ctx_t *out =
+            _anjay_output_dynamic_create((avs_stream_abstract_t *) &outbuf,
+                                         &outctx_errno, &details, &uri);
+    AVS_UNIT_ASSERT_NOT_NULL(out);
+
+    _anjay_mock_dm_expect_resource_present(anjay, &OBJ, 3, 0, 1);
+    _anjay_mock_dm_expect_resource_read(anjay, &OBJ, 3, 0, 0,
+                                        ANJAY_MOCK_DM_INT(0, 514));
+    _anjay_mock_dm_expect_resource_present(anjay, &OBJ, 3, 1, 1);
+    _anjay_mock_dm_expect_resource_read(anjay, &OBJ, 3, 1, 0,
+                                        ANJAY_MOCK_DM_INT(0, 69));
+    for (anjay_rid_t rid = 2; rid <= 6; ++rid) {
+        _anjay_mock_dm_expect_resource_present(anjay, &OBJ, 3, rid, 0);
+    }
+    _anjay_mock_dm_expect_resource_present(anjay, &OBJ, 3, 0, 1);
+    _anjay_mock_dm_expect_resource_read(anjay, &OBJ, 3, 0, 0,
+                                        ANJAY_MOCK_DM_INT(0, 514));
+    _anjay_mock_dm_expect_resource_present(anjay, &OBJ, 3, 1, 1);
+    _anjay_mock_dm_expect_resource_read(anjay, &OBJ, 3, 1, ANJAY_ERR_INTERNAL,
+                                        ANJAY_MOCK_DM_NONE);
+    AVS_UNIT_ASSERT_FAILED(read_instance_wrapped(anjay, &OBJ, 3, out, true));
+
+    // the Instance header and the first Resource have already been written to
+    // the stream; a buffered Instance would not have produced anything
+    AVS_UNIT_ASSERT_EQUAL(avs_stream_outbuf_offset(&outbuf), 6);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "\x07\x03\xc2\x00\x02\x02", 6);
+
+    (void) _anjay_output_ctx_destroy(&out);
+    DM_TEST_FINISH;
+}
+
 AVS_UNIT_TEST(dm_read, no_object) {
     DM_TEST_INIT;
     DM_TEST_REQUEST(mocksocks[0], CON, GET, ID(0xFA3E), NO_PAYLOAD);
@@ -2025,6 +2133,33 @@ AVS_UNIT_TEST(dm_effective_attrs, no_server) {
     DM_TEST_FINISH;
 }
 
+AVS_UNIT_TEST(dm_query, cached_server_iids) {
+    DM_TEST_INIT;
+    (void) mocksocks;
+    anjay->dm.cache_server_iids = true;
+    _anjay_mock_dm_expect_instance_it(anjay, &FAKE_SERVER, 0, 0, 3);
+    _anjay_mock_dm_expect_resource_present(anjay, &FAKE_SERVER, 3,
+                                           ANJAY_DM_RID_SERVER_SSID, 1);
+    _anjay_mock_dm_expect_resource_read(anjay, &FAKE_SERVER, 3,
+                                        ANJAY_DM_RID_SERVER_SSID, 0,
+                                        ANJAY_MOCK_DM_INT(0, 14));
+    _anjay_mock_dm_expect_instance_it(anjay, &FAKE_SERVER, 1, 0,
+                                      ANJAY_IID_INVALID);
+    anjay_iid_t iid = ANJAY_IID_INVALID;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_find_server_iid(anjay, 14, &iid));
+    AVS_UNIT_ASSERT_EQUAL(iid, 3);
+    // subsequent lookups do not call the data model
+    iid = ANJAY_IID_INVALID;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_find_server_iid(anjay, 14, &iid));
+    AVS_UNIT_ASSERT_EQUAL(iid, 3);
+    AVS_UNIT_ASSERT_FAILED(_anjay_find_server_iid(anjay, 15, &iid));
+
+    AVS_UNIT_ASSERT_SUCCESS(anjay_notify_changed(anjay, ANJAY_DM_OID_SERVER,
+                                                 3, ANJAY_DM_RID_SERVER_SSID));
+    AVS_UNIT_ASSERT_FALSE(anjay->dm.server_iids_valid);
+    DM_TEST_FINISH;
+}
+
 AVS_UNIT_TEST(dm_effective_attrs, no_resources) {
     DM_TEST_INIT;
     (void) mocksocks;
@@ -2242,3 +2377,46 @@ AVS_UNIT_TEST(dm_res_read, no_space) {
 
     DM_TEST_FINISH;
 }
+
+AVS_UNIT_TEST(dm_res_read, typed) {
+    DM_TEST_INIT;
+
+    int64_t value = 0;
+    _anjay_mock_dm_expect_resource_present(anjay, &OBJ, 42, 3, 1);
+    _anjay_mock_dm_expect_resource_read(anjay, &OBJ, 42, 3, 0,
+                                        ANJAY_MOCK_DM_INT(0, 514));
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_dm_res_read_i64(
+            anjay, &MAKE_RESOURCE_PATH(OBJ->oid, 42, 3), &value));
+    AVS_UNIT_ASSERT_EQUAL(value, 514);
+
+    bool flag = false;
+    _anjay_mock_dm_expect_resource_present(anjay, &OBJ, 42, 4, 1);
+    _anjay_mock_dm_expect_resource_read(anjay, &OBJ, 42, 4, -1,
+                                        ANJAY_MOCK_DM_INT(-1, 1));
+    AVS_UNIT_ASSERT_FAILED(_anjay_dm_res_read_bool(
+            anjay, &MAKE_RESOURCE_PATH(OBJ->oid, 42, 4), &flag));
+    AVS_UNIT_ASSERT_FALSE(flag);
+
+    anjay_riid_t riids[2];
+    int64_t values[2];
+    size_t count;
+    _anjay_mock_dm_expect_resource_present(anjay, &OBJ, 69, 5, 1);
+    _anjay_mock_dm_expect_resource_read(
+            anjay, &OBJ, 69, 5, 0,
+            ANJAY_MOCK_DM_ARRAY(
+                    0,
+                    ANJAY_MOCK_DM_ARRAY_ENTRY(1, ANJAY_MOCK_DM_INT(0, 11)),
+                    ANJAY_MOCK_DM_ARRAY_ENTRY(3, ANJAY_MOCK_DM_INT(0, 33)),
+                    ANJAY_MOCK_DM_ARRAY_ENTRY(7, ANJAY_MOCK_DM_INT(0, 77))));
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_dm_res_read_i64_array(
+            anjay, &MAKE_RESOURCE_PATH(OBJ->oid, 69, 5), riids, values,
+            AVS_ARRAY_SIZE(values), &count));
+    // values that do not fit are counted, but not stored
+    AVS_UNIT_ASSERT_EQUAL(count, 3);
+    AVS_UNIT_ASSERT_EQUAL(riids[0], 1);
+    AVS_UNIT_ASSERT_EQUAL(values[0], 11);
+    AVS_UNIT_ASSERT_EQUAL(riids[1], 3);
+    AVS_UNIT_ASSERT_EQUAL(values[1], 33);
+
+    DM_TEST_FINISH;
+}
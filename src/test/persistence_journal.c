@@ -0,0 +1,227 @@
+/*
+ * Copyright 2017-2018 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <anjay_config.h>
+
+#include <avsystem/commons/stream/stream_outbuf.h>
+#include <avsystem/commons/unit/test.h>
+
+static const anjay_journal_magic_t TEST_MAGIC = { 'T', 'S', 'T', '\0' };
+
+typedef struct {
+    uint16_t id;
+    uint32_t value;
+} test_element_t;
+
+static int handle_test_element(avs_persistence_context_t *ctx,
+                               void *element_,
+                               void *user_data) {
+    (void) user_data;
+    test_element_t *element = (test_element_t *) element_;
+    return avs_persistence_u32(ctx, &element->value);
+}
+
+typedef struct {
+    test_element_t elements[8];
+    size_t count;
+} test_state_t;
+
+static int restore_test_element(avs_persistence_context_t *ctx,
+                                uint32_t key,
+                                void *state_) {
+    test_state_t *state = (test_state_t *) state_;
+    AVS_UNIT_ASSERT_TRUE(state->count < AVS_ARRAY_SIZE(state->elements));
+    test_element_t *element = &state->elements[state->count++];
+    element->id = (uint16_t) key;
+    return handle_test_element(ctx, element, NULL);
+}
+
+static int write_test_state(anjay_journal_t *journal,
+                            avs_stream_abstract_t *stream,
+                            test_element_t *elements,
+                            size_t count,
+                            bool compact) {
+    anjay_journal_writer_t writer;
+    int result = _anjay_journal_writer_init(&writer, journal, stream,
+                                            TEST_MAGIC, compact);
+    for (size_t i = 0; !result && i < count; ++i) {
+        result = _anjay_journal_writer_put(&writer, elements[i].id,
+                                           handle_test_element, &elements[i],
+                                           NULL);
+    }
+    return _anjay_journal_writer_finish(&writer, result);
+}
+
+#define JOURNAL_TEST_INIT(Size)                                        \
+    char buf[Size];                                                    \
+    avs_stream_outbuf_t outbuf = AVS_STREAM_OUTBUF_STATIC_INITIALIZER; \
+    avs_stream_outbuf_set_buffer(&outbuf, buf, sizeof(buf));           \
+    avs_stream_abstract_t *out = (avs_stream_abstract_t *) &outbuf;    \
+    anjay_journal_t journal = { NULL }
+
+#define JOURNAL_TEST_RESTORE(Size, OutJournal, OutState)                \
+    do {                                                                \
+        avs_stream_inbuf_t inbuf = AVS_STREAM_INBUF_STATIC_INITIALIZER; \
+        avs_stream_inbuf_set_buffer(&inbuf, buf, (Size));               \
+        AVS_UNIT_ASSERT_SUCCESS(_anjay_journal_restore(                 \
+                (OutJournal), (avs_stream_abstract_t *) &inbuf,         \
+                TEST_MAGIC, restore_test_element, (OutState)));         \
+    } while (0)
+
+AVS_UNIT_TEST(persistence_journal, compact) {
+    JOURNAL_TEST_INIT(128);
+    test_element_t elements[] = { { 1, 0x11111111 }, { 3, 0x33333333 } };
+    AVS_UNIT_ASSERT_SUCCESS(
+            write_test_state(&journal, out, elements, 2, true));
+
+    const size_t size = avs_stream_outbuf_offset(&outbuf);
+    // header + 2 * (put with 4-byte payload) + commit
+    AVS_UNIT_ASSERT_EQUAL(size, 8 + 2 * 17 + 13);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(buf, "AJNLTST\0", 8);
+    AVS_UNIT_ASSERT_EQUAL_BYTES_SIZED(&buf[8],
+                                      "P\x00\x00\x00\x01\x00\x00\x00\x04"
+                                      "\x11\x11\x11\x11",
+                                      13);
+    AVS_UNIT_ASSERT_EQUAL(buf[42], 'C');
+    AVS_UNIT_ASSERT_EQUAL(journal.size, size);
+    AVS_UNIT_ASSERT_EQUAL(journal.compacted_size, size);
+    AVS_UNIT_ASSERT_FALSE(_anjay_journal_needs_compaction(&journal));
+
+    anjay_journal_t restored = { NULL };
+    test_state_t state = { .count = 0 };
+    JOURNAL_TEST_RESTORE(size, &restored, &state);
+    AVS_UNIT_ASSERT_EQUAL(state.count, 2);
+    AVS_UNIT_ASSERT_EQUAL(state.elements[0].id, 1);
+    AVS_UNIT_ASSERT_EQUAL(state.elements[0].value, 0x11111111);
+    AVS_UNIT_ASSERT_EQUAL(state.elements[1].id, 3);
+    AVS_UNIT_ASSERT_EQUAL(state.elements[1].value, 0x33333333);
+    AVS_UNIT_ASSERT_TRUE(restored.valid);
+    AVS_UNIT_ASSERT_EQUAL(restored.size, size);
+
+    _anjay_journal_cleanup(&restored);
+    _anjay_journal_cleanup(&journal);
+}
+
+AVS_UNIT_TEST(persistence_journal, append_deltas) {
+    JOURNAL_TEST_INIT(256);
+    test_element_t elements[] = { { 1, 1 }, { 2, 2 }, { 3, 3 } };
+    AVS_UNIT_ASSERT_SUCCESS(
+            write_test_state(&journal, out, elements, 3, true));
+    const size_t compacted_size = avs_stream_outbuf_offset(&outbuf);
+
+    // nothing changed - nothing is written
+    AVS_UNIT_ASSERT_SUCCESS(
+            write_test_state(&journal, out, elements, 3, false));
+    AVS_UNIT_ASSERT_EQUAL(avs_stream_outbuf_offset(&outbuf), compacted_size);
+
+    // one element changed, one removed: put + delete + commit
+    elements[1].value = 42;
+    elements[2] = (test_element_t) { 4, 4 };
+    AVS_UNIT_ASSERT_SUCCESS(
+            write_test_state(&journal, out, elements, 3, false));
+    const size_t size = avs_stream_outbuf_offset(&outbuf);
+    AVS_UNIT_ASSERT_EQUAL(size, compacted_size + 17 + 13 + 17 + 13);
+    AVS_UNIT_ASSERT_EQUAL(journal.size, size);
+    AVS_UNIT_ASSERT_EQUAL(journal.compacted_size, compacted_size);
+
+    anjay_journal_t restored = { NULL };
+    test_state_t state = { .count = 0 };
+    JOURNAL_TEST_RESTORE(size, &restored, &state);
+    AVS_UNIT_ASSERT_EQUAL(state.count, 3);
+    AVS_UNIT_ASSERT_EQUAL(state.elements[0].id, 1);
+    AVS_UNIT_ASSERT_EQUAL(state.elements[0].value, 1);
+    AVS_UNIT_ASSERT_EQUAL(state.elements[1].id, 2);
+    AVS_UNIT_ASSERT_EQUAL(state.elements[1].value, 42);
+    AVS_UNIT_ASSERT_EQUAL(state.elements[2].id, 4);
+    AVS_UNIT_ASSERT_EQUAL(state.elements[2].value, 4);
+    AVS_UNIT_ASSERT_TRUE(restored.valid);
+    AVS_UNIT_ASSERT_EQUAL(restored.size, size);
+    AVS_UNIT_ASSERT_EQUAL(restored.compacted_size, compacted_size);
+
+    // the restored journal knows what is stored, so appending is a no-op
+    AVS_UNIT_ASSERT_SUCCESS(
+            write_test_state(&restored, out, elements, 3, false));
+    AVS_UNIT_ASSERT_EQUAL(avs_stream_outbuf_offset(&outbuf), size);
+
+    _anjay_journal_cleanup(&restored);
+    _anjay_journal_cleanup(&journal);
+}
+
+AVS_UNIT_TEST(persistence_journal, uncommitted_tail) {
+    JOURNAL_TEST_INIT(256);
+    test_element_t elements[] = { { 1, 1 } };
+    AVS_UNIT_ASSERT_SUCCESS(
+            write_test_state(&journal, out, elements, 1, true));
+    const size_t compacted_size = avs_stream_outbuf_offset(&outbuf);
+    elements[0].value = 2;
+    AVS_UNIT_ASSERT_SUCCESS(
+            write_test_state(&journal, out, elements, 1, false));
+
+    // simulate power loss before the commit record was fully written
+    anjay_journal_t restored = { NULL };
+    test_state_t state = { .count = 0 };
+    JOURNAL_TEST_RESTORE(avs_stream_outbuf_offset(&outbuf) - 1, &restored,
+                         &state);
+    AVS_UNIT_ASSERT_EQUAL(state.count, 1);
+    AVS_UNIT_ASSERT_EQUAL(state.elements[0].value, 1);
+    AVS_UNIT_ASSERT_FALSE(restored.valid);
+    AVS_UNIT_ASSERT_EQUAL(restored.size, compacted_size);
+    AVS_UNIT_ASSERT_TRUE(_anjay_journal_needs_compaction(&restored));
+
+    // the damaged journal cannot be appended to
+    AVS_UNIT_ASSERT_FAILED(
+            write_test_state(&restored, out, elements, 1, false));
+
+    _anjay_journal_cleanup(&restored);
+    _anjay_journal_cleanup(&journal);
+}
+
+AVS_UNIT_TEST(persistence_journal, corrupted_record) {
+    JOURNAL_TEST_INIT(128);
+    test_element_t elements[] = { { 1, 1 } };
+    AVS_UNIT_ASSERT_SUCCESS(
+            write_test_state(&journal, out, elements, 1, true));
+    buf[20] ^= 0x01;
+
+    anjay_journal_t restored = { NULL };
+    test_state_t state = { .count = 0 };
+    JOURNAL_TEST_RESTORE(avs_stream_outbuf_offset(&outbuf), &restored, &state);
+    AVS_UNIT_ASSERT_EQUAL(state.count, 0);
+    AVS_UNIT_ASSERT_FALSE(restored.valid);
+
+    _anjay_journal_cleanup(&restored);
+    _anjay_journal_cleanup(&journal);
+}
+
+AVS_UNIT_TEST(persistence_journal, magic_mismatch) {
+    static const char DATA[] = "AJNLXYZ\0";
+    avs_stream_inbuf_t inbuf = AVS_STREAM_INBUF_STATIC_INITIALIZER;
+    avs_stream_inbuf_set_buffer(&inbuf, DATA, sizeof(DATA) - 1);
+    anjay_journal_t restored = { NULL };
+    test_state_t state = { .count = 0 };
+    AVS_UNIT_ASSERT_FAILED(_anjay_journal_restore(
+            &restored, (avs_stream_abstract_t *) &inbuf, TEST_MAGIC,
+            restore_test_element, &state));
+    AVS_UNIT_ASSERT_NULL(restored.digests);
+}
+
+AVS_UNIT_TEST(persistence_journal, unsorted_keys) {
+    JOURNAL_TEST_INIT(128);
+    test_element_t elements[] = { { 2, 2 }, { 1, 1 } };
+    AVS_UNIT_ASSERT_FAILED(write_test_state(&journal, out, elements, 2, true));
+    AVS_UNIT_ASSERT_NULL(journal.digests);
+    AVS_UNIT_ASSERT_FALSE(journal.valid);
+}
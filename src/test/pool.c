@@ -0,0 +1,73 @@
+/*
+ * Copyright 2017-2018 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <anjay_config.h>
+
+#include <avsystem/commons/unit/test.h>
+
+AVS_UNIT_TEST(pool, reuses_blocks) {
+    anjay_pool_t pool;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_pool_init(&pool, 32, 2));
+
+    void *first = _anjay_pool_alloc(&pool, 16);
+    void *second = _anjay_pool_alloc(&pool, 32);
+    AVS_UNIT_ASSERT_NOT_NULL(first);
+    AVS_UNIT_ASSERT_NOT_NULL(second);
+    AVS_UNIT_ASSERT_EQUAL(pool.stats.blocks_in_use, 2);
+    AVS_UNIT_ASSERT_EQUAL(pool.stats.heap_fallbacks, 0);
+
+    _anjay_pool_free(&pool, first, 16);
+    void *third = _anjay_pool_alloc(&pool, 8);
+    AVS_UNIT_ASSERT_TRUE(third == first);
+
+    _anjay_pool_free(&pool, second, 32);
+    _anjay_pool_free(&pool, third, 8);
+    AVS_UNIT_ASSERT_EQUAL(pool.stats.blocks_in_use, 0);
+    AVS_UNIT_ASSERT_EQUAL(pool.stats.high_water_mark, 2);
+    _anjay_pool_cleanup(&pool);
+}
+
+AVS_UNIT_TEST(pool, falls_back_to_heap) {
+    anjay_pool_t pool;
+    AVS_UNIT_ASSERT_SUCCESS(_anjay_pool_init(&pool, 16, 1));
+
+    AVS_LIST(int) list = NULL;
+    void *oversized = _anjay_pool_alloc(&pool, 64);
+    AVS_UNIT_ASSERT_NOT_NULL(oversized);
+    AVS_UNIT_ASSERT_EQUAL(pool.stats.blocks_in_use, 0);
+    AVS_UNIT_ASSERT_EQUAL(pool.stats.heap_fallbacks, 1);
+
+    void *pooled = _anjay_pool_alloc(&pool, 16);
+    void *overflow = _anjay_pool_alloc(&pool, 16);
+    AVS_UNIT_ASSERT_NOT_NULL(pooled);
+    AVS_UNIT_ASSERT_NOT_NULL(overflow);
+    AVS_UNIT_ASSERT_EQUAL(pool.stats.blocks_in_use, 2);
+    AVS_UNIT_ASSERT_EQUAL(pool.stats.high_water_mark, 2);
+    AVS_UNIT_ASSERT_EQUAL(pool.stats.heap_fallbacks, 2);
+
+    // pool-allocated memory is usable as AVS_LIST elements
+    AVS_LIST_APPEND(&list, (int *) pooled);
+    AVS_LIST_APPEND(&list, (int *) overflow);
+    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(list), 2);
+
+    _anjay_pool_delete(&pool, &list, 16);
+    _anjay_pool_delete(&pool, &list, 16);
+    _anjay_pool_free(&pool, oversized, 64);
+    AVS_UNIT_ASSERT_NULL(list);
+    AVS_UNIT_ASSERT_EQUAL(pool.stats.blocks_in_use, 0);
+    AVS_UNIT_ASSERT_EQUAL(pool.free_count, 1);
+    _anjay_pool_cleanup(&pool);
+}
@@ -124,3 +124,84 @@ AVS_UNIT_TEST(sched, oneshot_job_handle_nullification) {
     AVS_UNIT_ASSERT_NULL(global.task);
     teardown_test(&env);
 }
+
+typedef struct {
+    AVS_LIST(int) *out;
+    int id;
+} append_id_args_t;
+
+static void append_id_task(anjay_t *anjay, const void *context) {
+    (void) anjay;
+    const append_id_args_t *args = (const append_id_args_t *) context;
+    int *element = AVS_LIST_APPEND_NEW(int, args->out);
+    AVS_UNIT_ASSERT_NOT_NULL(element);
+    *element = args->id;
+}
+
+AVS_UNIT_TEST(sched, execution_order) {
+    sched_test_env_t env = setup_test();
+
+    static const int DELAYS_S[] = { 5, 3, 3, 0, 7, 3, 1, 5, 0, 2 };
+    static const int EXPECTED_ORDER[] = { 3, 8, 6, 9, 1, 2, 5, 0, 7, 4 };
+    const size_t count = AVS_ARRAY_SIZE(DELAYS_S);
+
+    AVS_LIST(int) executed = NULL;
+    anjay_sched_handle_t tasks[AVS_ARRAY_SIZE(DELAYS_S)] = { NULL };
+    for (size_t i = 0; i < count; ++i) {
+        append_id_args_t args = { &executed, (int) i };
+        AVS_UNIT_ASSERT_SUCCESS(_anjay_sched(
+                env.sched, &tasks[i],
+                avs_time_duration_from_scalar(DELAYS_S[i], AVS_TIME_S),
+                append_id_task, &args, sizeof(args)));
+    }
+
+    _anjay_mock_clock_advance(avs_time_duration_from_scalar(10, AVS_TIME_S));
+    AVS_UNIT_ASSERT_EQUAL(_anjay_sched_run(env.sched), (ssize_t) count);
+    AVS_UNIT_ASSERT_EQUAL(AVS_LIST_SIZE(executed), count);
+
+    const int *id;
+    size_t i = 0;
+    AVS_LIST_FOREACH(id, executed) {
+        AVS_UNIT_ASSERT_EQUAL(*id, EXPECTED_ORDER[i++]);
+    }
+    for (i = 0; i < count; ++i) {
+        AVS_UNIT_ASSERT_NULL(tasks[i]);
+    }
+    AVS_LIST_CLEAR(&executed);
+
+    teardown_test(&env);
+}
+
+AVS_UNIT_TEST(sched, del_keeps_order) {
+    sched_test_env_t env = setup_test();
+
+    AVS_LIST(int) executed = NULL;
+    anjay_sched_handle_t tasks[16] = { NULL };
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(tasks); ++i) {
+        append_id_args_t args = { &executed, (int) i };
+        AVS_UNIT_ASSERT_SUCCESS(_anjay_sched(
+                env.sched, &tasks[i],
+                avs_time_duration_from_scalar(
+                        (int64_t) (AVS_ARRAY_SIZE(tasks) - i), AVS_TIME_S),
+                append_id_task, &args, sizeof(args)));
+    }
+
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(tasks); i += 3) {
+        AVS_UNIT_ASSERT_SUCCESS(_anjay_sched_del(env.sched, &tasks[i]));
+        AVS_UNIT_ASSERT_NULL(tasks[i]);
+    }
+
+    _anjay_mock_clock_advance(avs_time_duration_from_scalar(20, AVS_TIME_S));
+    AVS_UNIT_ASSERT_EQUAL(_anjay_sched_run(env.sched), 10);
+
+    const int *id;
+    int last_id = (int) AVS_ARRAY_SIZE(tasks);
+    AVS_LIST_FOREACH(id, executed) {
+        AVS_UNIT_ASSERT_TRUE(*id < last_id);
+        AVS_UNIT_ASSERT_TRUE(*id % 3 != 0);
+        last_id = *id;
+    }
+    AVS_LIST_CLEAR(&executed);
+
+    teardown_test(&env);
+}